@@ -17,6 +17,7 @@
    <https://www.gnu.org/licenses/>.  */
 
 #include <pthread.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <malloc.h>
@@ -28,7 +29,7 @@
    given size.  This enables performance tracking of the t-cache and fastbins.
    It tests 3 different scenarios: single-threaded using main arena,
    multi-threaded using thread-arena, and main arena with SINGLE_THREAD_P
-   false.  */
+   false.  The first two are repeated with free_sized instead of free.  */
 
 #define NUM_ITERS 200000
 #define NUM_ALLOCS 4
@@ -39,6 +40,7 @@ typedef struct
   size_t iters;
   size_t size;
   int n;
+  bool sized;
   timing_t elapsed;
 } malloc_args;
 
@@ -52,21 +54,31 @@ do_benchmark (malloc_args *args, int **arr)
 
   TIMING_NOW (start);
 
-  for (int j = 0; j < iters; j++)
-    {
-      for (int i = 0; i < n; i++)
-	arr[i] = malloc (size);
+  if (args->sized)
+    for (int j = 0; j < iters; j++)
+      {
+	for (int i = 0; i < n; i++)
+	  arr[i] = malloc (size);
 
-      for (int i = 0; i < n; i++)
-	free (arr[i]);
-    }
+	for (int i = 0; i < n; i++)
+	  free_sized (arr[i], size);
+      }
+  else
+    for (int j = 0; j < iters; j++)
+      {
+	for (int i = 0; i < n; i++)
+	  arr[i] = malloc (size);
+
+	for (int i = 0; i < n; i++)
+	  free (arr[i]);
+      }
 
   TIMING_NOW (stop);
 
   TIMING_DIFF (args->elapsed, start, stop);
 }
 
-static malloc_args tests[3][NUM_ALLOCS];
+static malloc_args tests[5][NUM_ALLOCS];
 static int allocs[NUM_ALLOCS] = { 25, 100, 400, MAX_ALLOCS };
 
 static void *
@@ -77,6 +89,8 @@ thread_test (void *p)
   /* Run benchmark multi-threaded.  */
   for (int i = 0; i < NUM_ALLOCS; i++)
     do_benchmark (&tests[2][i], arr);
+  for (int i = 0; i < NUM_ALLOCS; i++)
+    do_benchmark (&tests[4][i], arr);
 
   return p;
 }
@@ -87,12 +101,13 @@ bench (unsigned long size)
   size_t iters = NUM_ITERS;
   int **arr = (int**) malloc (MAX_ALLOCS * sizeof (void*));
 
-  for (int t = 0; t < 3; t++)
+  for (int t = 0; t < 5; t++)
     for (int i = 0; i < NUM_ALLOCS; i++)
       {
 	tests[t][i].n = allocs[i];
 	tests[t][i].size = size;
 	tests[t][i].iters = iters / allocs[i];
+	tests[t][i].sized = t >= 3;
 
 	/* Do a quick warmup run.  */
 	if (t == 0)
@@ -102,6 +117,8 @@ bench (unsigned long size)
   /* Run benchmark single threaded in main_arena.  */
   for (int i = 0; i < NUM_ALLOCS; i++)
     do_benchmark (&tests[0][i], arr);
+  for (int i = 0; i < NUM_ALLOCS; i++)
+    do_benchmark (&tests[3][i], arr);
 
   /* Run benchmark in a thread_arena.  */
   pthread_t t;
@@ -154,6 +171,18 @@ bench (unsigned long size)
       json_attr_double (&json_ctx, s, tests[2][i].elapsed / iters2);
     }
 
+  for (int i = 0; i < NUM_ALLOCS; i++)
+    {
+      sprintf (s, "main_arena_st_sized_allocs_%04d_time", allocs[i]);
+      json_attr_double (&json_ctx, s, tests[3][i].elapsed / iters2);
+    }
+
+  for (int i = 0; i < NUM_ALLOCS; i++)
+    {
+      sprintf (s, "thread_arena__sized_allocs_%04d_time", allocs[i]);
+      json_attr_double (&json_ctx, s, tests[4][i].elapsed / iters2);
+    }
+
   json_attr_object_end (&json_ctx);
 
   json_attr_object_end (&json_ctx);
@@ -30,6 +30,10 @@
 #include "bench-timing.h"
 #include "json-lib.h"
 
+#ifndef LOCK_TYPE_NAME
+# define LOCK_TYPE_NAME "adaptive"
+#endif
+
 static bench_lock_t lock;
 static bench_lock_attr_t attr;
 static pthread_barrier_t barrier;
@@ -114,8 +118,13 @@ worker (void *v)
   return NULL;
 }
 
+/* Return the mean duration of the threads, and store in *FAIRNESS
+   Jain's fairness index of their acquisition rates: 1.0 if all threads
+   progressed at the same rate, down to 1/NUM_THREADS if one thread
+   acquired the lock while all others were starved.  */
 static double
-do_one_test (int num_threads, int crt_len, int non_crt_len, long iters)
+do_one_test (int num_threads, int crt_len, int non_crt_len, long iters,
+	     double *fairness)
 {
   int i;
   timing_t mean;
@@ -139,10 +148,17 @@ do_one_test (int num_threads, int crt_len, int non_crt_len, long iters)
   LOCK_DESTROY (&lock);
   pthread_barrier_destroy (&barrier);
 
+  double sum = 0.0, sum_sq = 0.0;
   mean = 0;
   for (i = 0; i < num_threads; i++)
-    mean += params[i].duration;
+    {
+      double rate = (double) iters / ((double) params[i].duration + 1.0);
+      sum += rate;
+      sum_sq += rate * rate;
+      mean += params[i].duration;
+    }
   mean /= num_threads;
+  *fairness = sum * sum / (num_threads * sum_sq);
   return mean;
 }
 
@@ -159,7 +175,7 @@ do_bench_one (const char *name, int num_threads, int crt_len, int non_crt_len,
   long iters, iters_limit, total_iters;
   timing_t curs[RUN_COUNT + 2];
   int i, j;
-  double mean, stdev;
+  double mean, stdev, fairness, total_fairness;
 
   iters = START_ITERS;
   iters_limit = LONG_MAX / 100;
@@ -167,7 +183,8 @@ do_bench_one (const char *name, int num_threads, int crt_len, int non_crt_len,
   while (1)
     {
       gettimeofday (&ts, NULL);
-      cur = do_one_test (num_threads, crt_len, non_crt_len, iters);
+      cur = do_one_test (num_threads, crt_len, non_crt_len, iters,
+			 &fairness);
       gettimeofday (&te, NULL);
       /* Make sure the test to run at least MIN_TEST_SEC.  */
       tsd = ts.tv_sec + ts.tv_usec / 1000000.0;
@@ -180,8 +197,13 @@ do_bench_one (const char *name, int num_threads, int crt_len, int non_crt_len,
     }
 
   curs[0] = cur;
+  total_fairness = 0.0;
   for (i = 1; i < RUN_COUNT + 2; i++)
-    curs[i] = do_one_test (num_threads, crt_len, non_crt_len, iters);
+    {
+      curs[i] = do_one_test (num_threads, crt_len, non_crt_len, iters,
+			     &fairness);
+      total_fairness += fairness;
+    }
 
   /* Sort the results so we can discard the fastest and slowest
      times as outliers.  */
@@ -226,6 +248,9 @@ do_bench_one (const char *name, int num_threads, int crt_len, int non_crt_len,
 		    (double) curs[RUN_COUNT] / (double) total_iters);
   json_attr_double (js, "max-outlier",
 		    (double) curs[RUN_COUNT + 1] / (double) total_iters);
+  /* Lock acquisitions per time unit of all threads together.  */
+  json_attr_double (js, "throughput", 1.0 / mean);
+  json_attr_double (js, "fairness", total_fairness / (RUN_COUNT + 1));
 
   json_attr_object_end (js);
 }
@@ -260,7 +285,7 @@ do_bench (void)
   threads[th_conf++] = nprocs + nprocs / 4;
 
   LOCK_ATTR_INIT (&attr);
-  snprintf (name, sizeof name, "type=adaptive");
+  snprintf (name, sizeof name, "type=%s", LOCK_TYPE_NAME);
 
   for (k = 0; k < (sizeof (non_crt_lens) / sizeof (int)); k++)
     {
@@ -0,0 +1,271 @@
+/* Measure the scalability of pthread_rwlock_rdlock.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#define TEST_MAIN
+#define TEST_NAME "pthread-rwlock-rdlock"
+#define TIMEOUT (20 * 60)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/sysinfo.h>
+#include "bench-timing.h"
+#include "json-lib.h"
+
+/* All threads acquire the same lock for reading in a loop, and one in
+   WRITE_EVERY acquisitions is for writing instead (none if zero).  With
+   a lock kind that scales, the time per acquisition stays flat as the
+   number of threads grows, as long as there are enough CPUs.  */
+
+static pthread_rwlock_t lock;
+static pthread_barrier_t barrier;
+
+#define START_ITERS 1000
+
+#pragma GCC push_options
+#pragma GCC optimize(1)
+
+static int __attribute__ ((noinline)) fibonacci (int i)
+{
+  asm("");
+  if (i > 2)
+    return fibonacci (i - 1) + fibonacci (i - 2);
+  return 10 + i;
+}
+
+static void
+do_filler (void)
+{
+  char buf1[512], buf2[512];
+  int f = fibonacci (4);
+  memcpy (buf1, buf2, f);
+}
+
+#pragma GCC pop_options
+
+typedef struct Worker_Params
+{
+  long iters;
+  int crt_len;
+  int write_every;
+  timing_t duration;
+} Worker_Params;
+
+static void *
+worker (void *v)
+{
+  timing_t start, stop;
+  Worker_Params *p = (Worker_Params *) v;
+  long iters = p->iters;
+  int crt_len = p->crt_len;
+  int write_every = p->write_every;
+  int until_write = write_every;
+
+  pthread_barrier_wait (&barrier);
+  TIMING_NOW (start);
+  while (iters--)
+    {
+      if (write_every != 0 && --until_write == 0)
+	{
+	  pthread_rwlock_wrlock (&lock);
+	  until_write = write_every;
+	}
+      else
+	pthread_rwlock_rdlock (&lock);
+      for (int i = crt_len; i > 0; i--)
+	do_filler ();
+      pthread_rwlock_unlock (&lock);
+    }
+  TIMING_NOW (stop);
+
+  TIMING_DIFF (p->duration, start, stop);
+  return NULL;
+}
+
+static timing_t
+do_one_test (int kind, int num_threads, int crt_len, int write_every,
+	     long iters)
+{
+  int i;
+  timing_t mean;
+  Worker_Params params[num_threads];
+  pthread_t threads[num_threads];
+  pthread_rwlockattr_t attr;
+
+  pthread_rwlockattr_init (&attr);
+  pthread_rwlockattr_setkind_np (&attr, kind);
+  pthread_rwlock_init (&lock, &attr);
+  pthread_rwlockattr_destroy (&attr);
+  pthread_barrier_init (&barrier, NULL, num_threads);
+
+  for (i = 0; i < num_threads; i++)
+    {
+      params[i].iters = iters;
+      params[i].crt_len = crt_len;
+      params[i].write_every = write_every;
+      pthread_create (&threads[i], NULL, worker, &params[i]);
+    }
+  for (i = 0; i < num_threads; i++)
+    pthread_join (threads[i], NULL);
+
+  pthread_rwlock_destroy (&lock);
+  pthread_barrier_destroy (&barrier);
+
+  mean = 0;
+  for (i = 0; i < num_threads; i++)
+    mean += params[i].duration;
+  mean /= num_threads;
+  return mean;
+}
+
+#define RUN_COUNT 10
+#define MIN_TEST_SEC 0.01
+
+static void
+do_bench_one (const char *name, int kind, int num_threads, int crt_len,
+	      int write_every, json_ctx_t *js)
+{
+  timing_t cur;
+  struct timeval ts, te;
+  double tsd, ted, td;
+  long iters, iters_limit, total_iters;
+  timing_t curs[RUN_COUNT + 2];
+  int i, j;
+  double mean, stdev;
+
+  iters = START_ITERS;
+  iters_limit = LONG_MAX / 100;
+
+  while (1)
+    {
+      gettimeofday (&ts, NULL);
+      cur = do_one_test (kind, num_threads, crt_len, write_every, iters);
+      gettimeofday (&te, NULL);
+      /* Make sure the test to run at least MIN_TEST_SEC.  */
+      tsd = ts.tv_sec + ts.tv_usec / 1000000.0;
+      ted = te.tv_sec + te.tv_usec / 1000000.0;
+      td = ted - tsd;
+      if (td >= MIN_TEST_SEC || iters >= iters_limit)
+	break;
+
+      iters *= 10;
+    }
+
+  curs[0] = cur;
+  for (i = 1; i < RUN_COUNT + 2; i++)
+    curs[i] = do_one_test (kind, num_threads, crt_len, write_every, iters);
+
+  /* Sort the results so we can discard the fastest and slowest
+     times as outliers.  */
+  for (i = 0; i < RUN_COUNT + 1; i++)
+    for (j = i + 1; j < RUN_COUNT + 2; j++)
+      if (curs[i] > curs[j])
+	{
+	  timing_t temp = curs[i];
+	  curs[i] = curs[j];
+	  curs[j] = temp;
+	}
+
+  /* Calculate mean and standard deviation.  */
+  mean = 0.0;
+  total_iters = iters * num_threads;
+  for (i = 1; i < RUN_COUNT + 1; i++)
+    mean += (double) curs[i] / (double) total_iters;
+  mean /= RUN_COUNT;
+
+  stdev = 0.0;
+  for (i = 1; i < RUN_COUNT + 1; i++)
+    {
+      double s = (double) curs[i] / (double) total_iters - mean;
+      stdev += s * s;
+    }
+  stdev = sqrt (stdev / (RUN_COUNT - 1));
+
+  char buf[256];
+  snprintf (buf, sizeof buf, "%s,write_every=%d,crt_len=%d,threads=%d",
+	    name, write_every, crt_len, num_threads);
+
+  json_attr_object_begin (js, buf);
+
+  json_attr_double (js, "duration", (double) cur);
+  json_attr_double (js, "iterations", (double) total_iters);
+  json_attr_double (js, "mean", mean);
+  json_attr_double (js, "stdev", stdev);
+  json_attr_double (js, "min", (double) curs[1] / (double) total_iters);
+  json_attr_double (js, "max",
+		    (double) curs[RUN_COUNT] / (double) total_iters);
+
+  json_attr_object_end (js);
+}
+
+#define TH_CONF_MAX 10
+
+int
+do_bench (void)
+{
+  json_ctx_t json_ctx;
+  int i, j, k, l;
+  int th_num, th_conf, nprocs;
+  int threads[TH_CONF_MAX];
+  int crt_lens[] = { 0, 8 };
+  int write_everys[] = { 0, 10000 };
+  static const struct
+  {
+    const char *name;
+    int kind;
+  } kinds[] =
+    {
+      { "kind=prefer_reader", PTHREAD_RWLOCK_PREFER_READER_NP },
+      { "kind=prefer_writer", PTHREAD_RWLOCK_PREFER_WRITER_NP },
+      { "kind=reader_biased", PTHREAD_RWLOCK_READER_BIASED_NP },
+    };
+
+  json_init (&json_ctx, 2, stdout);
+  json_attr_object_begin (&json_ctx, TEST_NAME);
+
+  /* The thread config begins from 1, and increases by 2x until nprocs.
+     We also wants to test over-saturation case (1.25*nprocs).  */
+  nprocs = get_nprocs ();
+  th_num = 1;
+  for (th_conf = 0; th_conf < (TH_CONF_MAX - 2) && th_num < nprocs; th_conf++)
+    {
+      threads[th_conf] = th_num;
+      th_num <<= 1;
+    }
+  threads[th_conf++] = nprocs;
+  threads[th_conf++] = nprocs + nprocs / 4;
+
+  for (l = 0; l < sizeof (kinds) / sizeof (kinds[0]); l++)
+    for (k = 0; k < sizeof (write_everys) / sizeof (int); k++)
+      for (j = 0; j < sizeof (crt_lens) / sizeof (int); j++)
+	for (i = 0; i < th_conf; i++)
+	  do_bench_one (kinds[l].name, kinds[l].kind, threads[i], crt_lens[j],
+			write_everys[k], &json_ctx);
+
+  json_attr_object_end (&json_ctx);
+
+  return 0;
+}
+
+#define TEST_FUNCTION do_bench ()
+
+#include "../test-skeleton.c"
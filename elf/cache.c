@@ -447,6 +447,58 @@ enum
 			      * sizeof (struct cache_extension_section)))
   };
 
+/* Build the cache_extension_tag_soname_hash section for the sorted
+   cache entries.  Store its size in *SIZE.  */
+static struct cache_soname_hash *
+make_soname_hash (uint32_t *size)
+{
+  /* Entries with the same name are adjacent.  Count the distinct
+     names.  */
+  uint32_t nlibs = 0;
+  uint32_t names = 0;
+  for (struct cache_entry *prev = NULL, *entry = entries; entry != NULL;
+       prev = entry, entry = entry->next)
+    {
+      ++nlibs;
+      if (prev == NULL
+	  || _dl_cache_libcmp (prev->lib->string, entry->lib->string) != 0)
+	++names;
+    }
+
+  /* Keep the load factor at or below one half.  */
+  uint32_t nslots = 1;
+  while (nslots <= 2 * names)
+    nslots *= 2;
+
+  *size = (sizeof (struct cache_soname_hash)
+	   + nslots * sizeof (struct cache_soname_hash_slot));
+  struct cache_soname_hash *hash = xmalloc (*size);
+  hash->nlibs = nlibs;
+  hash->nslots = nslots;
+  for (uint32_t i = 0; i < nslots; ++i)
+    {
+      hash->slots[i].hash = 0;
+      hash->slots[i].index = UINT32_MAX;
+    }
+
+  /* Add the index of the first entry for each name.  */
+  uint32_t index = 0;
+  for (struct cache_entry *prev = NULL, *entry = entries; entry != NULL;
+       prev = entry, entry = entry->next, ++index)
+    if (prev == NULL
+	|| _dl_cache_libcmp (prev->lib->string, entry->lib->string) != 0)
+      {
+	uint32_t name_hash = _dl_cache_libhash (entry->lib->string);
+	uint32_t slot = name_hash & (nslots - 1);
+	while (hash->slots[slot].index != UINT32_MAX)
+	  slot = (slot + 1) & (nslots - 1);
+	hash->slots[slot].hash = name_hash;
+	hash->slots[slot].index = index;
+      }
+
+  return hash;
+}
+
 /* Write the cache extensions to FD.  The string table is shifted by
    STRING_TABLE_OFFSET.  The extension directory is assumed to be
    located at CACHE_EXTENSION_OFFSET.  assign_glibc_hwcaps_indices
@@ -466,15 +518,18 @@ write_extensions (int fd, uint32_t str_offset,
     if (p->used)
       hwcaps_array[p->section_index] = str_offset + p->name->offset;
 
-  /* This is the offset of the generator string.  */
-  uint32_t generator_offset = hwcaps_offset;
   if (hwcaps_count == 0)
     /* There is no section for the hwcaps subdirectories.  */
-    generator_offset -= sizeof (struct cache_extension_section);
-  else
-    /* The string table indices for the hwcaps subdirectories shift
-       the generator string backwards.  */
-    generator_offset += hwcaps_size;
+    hwcaps_offset -= sizeof (struct cache_extension_section);
+
+  /* The hash table for the library names follows the string table
+     indices for the hwcaps subdirectories.  */
+  uint32_t hash_size;
+  struct cache_soname_hash *hash = make_soname_hash (&hash_size);
+  uint32_t hash_offset = hwcaps_offset + hwcaps_size;
+
+  /* This is the offset of the generator string.  */
+  uint32_t generator_offset = hash_offset + hash_size;
 
   struct cache_extension *ext = xmalloc (cache_extension_size);
   ext->magic = cache_extension_magic;
@@ -498,6 +553,12 @@ write_extensions (int fd, uint32_t str_offset,
       ext->sections[xid].size = hwcaps_size;
     }
 
+  ++xid;
+  ext->sections[xid].tag = cache_extension_tag_soname_hash;
+  ext->sections[xid].flags = 0;
+  ext->sections[xid].offset = hash_offset;
+  ext->sections[xid].size = hash_size;
+
   ++xid;
   ext->count = xid;
   assert (xid <= cache_extension_count);
@@ -506,10 +567,12 @@ write_extensions (int fd, uint32_t str_offset,
 		     + xid * sizeof (struct cache_extension_section));
   if (write (fd, ext, ext_size) != ext_size
       || write (fd, hwcaps_array, hwcaps_size) != hwcaps_size
+      || write (fd, hash, hash_size) != hash_size
       || write (fd, generator, strlen (generator)) != strlen (generator))
     error (EXIT_FAILURE, errno, _("Writing of cache extension data failed"));
 
   free (hwcaps_array);
+  free (hash);
   free (ext);
 }
 
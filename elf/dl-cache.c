@@ -32,6 +32,10 @@ static struct cache_file *cache;
 static struct cache_file_new *cache_new;
 static size_t cachesize;
 
+/* The cache_extension_tag_soname_hash section of the new format cache,
+   or NULL if it is not present.  */
+static const struct cache_soname_hash *cache_hash;
+
 #ifdef SHARED
 /* This is used to cache the priorities of glibc-hwcaps
    subdirectories.  The elements of _dl_cache_priorities correspond to
@@ -187,6 +191,146 @@ _dl_cache_file_entry (const struct file_entry *libs, size_t entry_size,
   return (const void *) libs + index * entry_size;
 }
 
+/* Return the best entry for NAME in the group of entries with this
+   name which starts at index START.  The caller has checked that the
+   entry at START matches NAME.  STRING_TABLE_SIZE indicates the
+   maximum offset in STRING_TABLE at which data is mapped; it is not
+   exact.  */
+static const char *
+search_cache_group (const char *string_table, uint32_t string_table_size,
+		    struct file_entry *libs, uint32_t nlibs,
+		    uint32_t entry_size, const char *name, uint32_t start)
+{
+  const char *best = NULL;
+#ifdef SHARED
+  uint32_t best_priority = 0;
+#endif
+
+  for (uint32_t middle = start; middle < nlibs; ++middle)
+    {
+      int flags;
+      const struct file_entry *lib
+	= _dl_cache_file_entry (libs, entry_size, middle);
+
+      /* Only perform the name test if necessary.  */
+      if (middle > start
+	  /* We haven't seen this string so far.  Test whether the
+	     index is ok and whether the name matches.  Otherwise
+	     we are done.  */
+	  && (! _dl_cache_verify_ptr (lib->key, string_table_size)
+	      || (_dl_cache_libcmp (name, string_table + lib->key)
+		  != 0)))
+	break;
+
+      flags = lib->flags;
+      if (_dl_cache_check_flags (flags)
+	  && _dl_cache_verify_ptr (lib->value, string_table_size))
+	{
+	  /* Named/extension hwcaps get slightly different
+	     treatment: We keep searching for a better
+	     match.  */
+	  bool named_hwcap = false;
+
+	  if (entry_size >= sizeof (struct file_entry_new))
+	    {
+	      /* The entry is large enough to include
+		 HWCAP data.  Check it.  */
+	      struct file_entry_new *libnew
+		= (struct file_entry_new *) lib;
+
+#ifdef SHARED
+	      named_hwcap = dl_cache_hwcap_extension (libnew);
+	      if (named_hwcap
+		  && !dl_cache_hwcap_isa_level_compatible (libnew))
+		continue;
+#endif
+
+	      /* The entries with named/extension hwcaps have
+		 been exhausted (they are listed before all
+		 other entries).  Return the best match
+		 encountered so far if there is one.  */
+	      if (!named_hwcap && best != NULL)
+		break;
+
+	      /* Skip entries with the legacy hwcap/platform mechanism
+		 which was removed with glibc 2.37.  */
+	      if (!named_hwcap && libnew->hwcap != 0)
+		continue;
+
+#ifdef SHARED
+	      /* For named hwcaps, determine the priority and
+		 see if beats what has been found so far.  */
+	      if (named_hwcap)
+		{
+		  uint32_t entry_priority
+		    = glibc_hwcaps_priority (libnew->hwcap);
+		  if (entry_priority == 0)
+		    /* Not usable at all.  Skip.  */
+		    continue;
+		  else if (best == NULL
+			   || entry_priority < best_priority)
+		    /* This entry is of higher priority
+		       than the previous one, or it is the
+		       first entry.  */
+		    best_priority = entry_priority;
+		  else
+		    /* An entry has already been found,
+		       but it is a better match.  */
+		    continue;
+		}
+#endif /* SHARED */
+	    }
+
+	  best = string_table + lib->value;
+
+	  if (!named_hwcap && flags == _DL_CACHE_DEFAULT_ID)
+	    /* With named hwcaps, we need to keep searching to
+	       see if we find a better match.  A better match
+	       is also possible if the flags of the current
+	       entry do not match the expected cache flags.
+	       But if the flags match, no better entry will be
+	       found.  */
+	    break;
+	}
+    }
+
+  return best;
+}
+
+/* Use the hash table HASH to find the entries for NAME.  The arguments
+   are the same as for search_cache below.  */
+static const char *
+search_cache_hash (const char *string_table, uint32_t string_table_size,
+		   struct file_entry *libs, uint32_t nlibs, uint32_t entry_size,
+		   const struct cache_soname_hash *hash, const char *name)
+{
+  uint32_t name_hash = _dl_cache_libhash (name);
+  uint32_t mask = hash->nslots - 1;
+  /* Bound the number of probes in case the table is corrupted.  */
+  for (uint32_t i = 0; i < hash->nslots; ++i)
+    {
+      const struct cache_soname_hash_slot *slot
+	= &hash->slots[(name_hash + i) & mask];
+      if (slot->index == UINT32_MAX)
+	/* The name is not in the cache.  */
+	return NULL;
+      if (slot->hash != name_hash)
+	continue;
+
+      /* Make sure the index and the string table index are not bogus
+	 before using them.  */
+      if (slot->index >= nlibs)
+	return NULL;
+      uint32_t key = _dl_cache_file_entry (libs, entry_size, slot->index)->key;
+      if (!_dl_cache_verify_ptr (key, string_table_size))
+	return NULL;
+      if (_dl_cache_libcmp (name, string_table + key) == 0)
+	return search_cache_group (string_table, string_table_size, libs,
+				   nlibs, entry_size, name, slot->index);
+    }
+  return NULL;
+}
+
 /* We use binary search since the table is sorted in the cache file.
    The first matching entry in the table is returned.  It is important
    to use the same algorithm as used while generating the cache file.
@@ -199,10 +343,6 @@ search_cache (const char *string_table, uint32_t string_table_size,
 {
   int left = 0;
   int right = nlibs - 1;
-  const char *best = NULL;
-#ifdef SHARED
-  uint32_t best_priority = 0;
-#endif
 
   while (left <= right)
     {
@@ -218,10 +358,6 @@ search_cache (const char *string_table, uint32_t string_table_size,
       int cmpres = _dl_cache_libcmp (name, string_table + key);
       if (__glibc_unlikely (cmpres == 0))
 	{
-	  /* Found it.  LEFT now marks the last entry for which we
-	     know the name is correct.  */
-	  left = middle;
-
 	  /* There might be entries with this name before the one we
 	     found.  So we have to find the beginning.  */
 	  while (middle > 0)
@@ -236,95 +372,8 @@ search_cache (const char *string_table, uint32_t string_table_size,
 	      --middle;
 	    }
 
-	  do
-	    {
-	      int flags;
-	      const struct file_entry *lib
-		= _dl_cache_file_entry (libs, entry_size, middle);
-
-	      /* Only perform the name test if necessary.  */
-	      if (middle > left
-		  /* We haven't seen this string so far.  Test whether the
-		     index is ok and whether the name matches.  Otherwise
-		     we are done.  */
-		  && (! _dl_cache_verify_ptr (lib->key, string_table_size)
-		      || (_dl_cache_libcmp (name, string_table + lib->key)
-			  != 0)))
-		break;
-
-	      flags = lib->flags;
-	      if (_dl_cache_check_flags (flags)
-		  && _dl_cache_verify_ptr (lib->value, string_table_size))
-		{
-		  /* Named/extension hwcaps get slightly different
-		     treatment: We keep searching for a better
-		     match.  */
-		  bool named_hwcap = false;
-
-		  if (entry_size >= sizeof (struct file_entry_new))
-		    {
-		      /* The entry is large enough to include
-			 HWCAP data.  Check it.  */
-		      struct file_entry_new *libnew
-			= (struct file_entry_new *) lib;
-
-#ifdef SHARED
-		      named_hwcap = dl_cache_hwcap_extension (libnew);
-		      if (named_hwcap
-			  && !dl_cache_hwcap_isa_level_compatible (libnew))
-			continue;
-#endif
-
-		      /* The entries with named/extension hwcaps have
-			 been exhausted (they are listed before all
-			 other entries).  Return the best match
-			 encountered so far if there is one.  */
-		      if (!named_hwcap && best != NULL)
-			break;
-
-		      /* Skip entries with the legacy hwcap/platform mechanism
-			 which was removed with glibc 2.37.  */
-		      if (!named_hwcap && libnew->hwcap != 0)
-			continue;
-
-#ifdef SHARED
-		      /* For named hwcaps, determine the priority and
-			 see if beats what has been found so far.  */
-		      if (named_hwcap)
-			{
-			  uint32_t entry_priority
-			    = glibc_hwcaps_priority (libnew->hwcap);
-			  if (entry_priority == 0)
-			    /* Not usable at all.  Skip.  */
-			    continue;
-			  else if (best == NULL
-				   || entry_priority < best_priority)
-			    /* This entry is of higher priority
-			       than the previous one, or it is the
-			       first entry.  */
-			    best_priority = entry_priority;
-			  else
-			    /* An entry has already been found,
-			       but it is a better match.  */
-			    continue;
-			}
-#endif /* SHARED */
-		    }
-
-		  best = string_table + lib->value;
-
-		  if (!named_hwcap && flags == _DL_CACHE_DEFAULT_ID)
-		    /* With named hwcaps, we need to keep searching to
-		       see if we find a better match.  A better match
-		       is also possible if the flags of the current
-		       entry do not match the expected cache flags.
-		       But if the flags match, no better entry will be
-		       found.  */
-		    break;
-		}
-	    }
-	  while (++middle <= right);
-	  break;
+	  return search_cache_group (string_table, string_table_size, libs,
+				     nlibs, entry_size, name, middle);
 	}
 
       if (cmpres < 0)
@@ -333,7 +382,7 @@ search_cache (const char *string_table, uint32_t string_table_size,
 	right = middle - 1;
     }
 
-  return best;
+  return NULL;
 }
 
 int
@@ -456,6 +505,18 @@ _dl_load_cache_lookup (const char *name)
 	}
 
       assert (cache != NULL);
+
+      cache_hash = NULL;
+      if (cache != (void *) -1 && cache_new != (void *) -1)
+	{
+	  struct cache_extension_all_loaded ext;
+	  if (cache_extension_load (cache_new, cache, cachesize, &ext))
+	    {
+	      cache_hash = ext.sections[cache_extension_tag_soname_hash].base;
+	      if (cache_hash != NULL && cache_hash->nlibs != cache_new->nlibs)
+		cache_hash = NULL;
+	    }
+	}
     }
 
   if (cache == (void *) -1)
@@ -466,9 +527,15 @@ _dl_load_cache_lookup (const char *name)
   if (cache_new != (void *) -1)
     {
       const char *string_table = (const char *) cache_new;
-      best = search_cache (string_table, cachesize,
-			   &cache_new->libs[0].entry, cache_new->nlibs,
-			   sizeof (cache_new->libs[0]), name);
+      if (cache_hash != NULL)
+	best = search_cache_hash (string_table, cachesize,
+				  &cache_new->libs[0].entry, cache_new->nlibs,
+				  sizeof (cache_new->libs[0]), cache_hash,
+				  name);
+      else
+	best = search_cache (string_table, cachesize,
+			     &cache_new->libs[0].entry, cache_new->nlibs,
+			     sizeof (cache_new->libs[0]), name);
     }
   else
     {
@@ -511,6 +578,7 @@ _dl_unload_cache (void)
     {
       __munmap (cache, cachesize);
       cache = NULL;
+      cache_hash = NULL;
     }
 #ifdef SHARED
   /* This marks the glibc_hwcaps_priorities array as out-of-date.  */
@@ -33,6 +33,7 @@
 #include <tls.h>
 #include <stap-probe.h>
 #include <dl-find_object.h>
+#include <dl-scope-index.h>
 
 #include <dl-unmap-segments.h>
 
@@ -443,6 +444,14 @@ _dl_close_worker (struct link_map *map, bool force)
       unsigned int j = 0;
       unsigned int cnt = ns_msl->r_nlist;
 
+      /* The index refers to positions in the list, which change
+	 after the first object which is removed.  It is only rebuilt
+	 if too many objects are no longer covered by it.  */
+      i = 0;
+      while (i < cnt && ns_msl->r_list[i]->l_removed == 0)
+	++i;
+      _dl_scope_index_truncate (ns_msl, i);
+
       while (cnt > 0 && ns_msl->r_list[cnt - 1]->l_removed)
 	--cnt;
 
@@ -458,6 +467,8 @@ _dl_close_worker (struct link_map *map, bool force)
 	      j++;
 	    }
       ns_msl->r_nlist = j;
+
+      _dl_scope_index_update (ns_msl);
     }
 
   if (!RTLD_SINGLE_THREAD_P
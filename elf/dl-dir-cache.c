@@ -0,0 +1,329 @@
+/* Cache of search directory contents for dlopen.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <dl-dir-cache.h>
+#include <dl-new-hash.h>
+#include <dl-tunables.h>
+#include <fcntl.h>
+#include <ldsodefs.h>
+#include <not-cancel.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* With the glibc.rtld.dir_cache tunable, open_path in dl-load.c
+   consults a snapshot of the names in each search directory before
+   trying to open a file there, so that the failing open calls for
+   directories which do not contain the file are avoided.
+
+   A snapshot records the device, inode number, modification time and
+   status change time of the directory.  Creating or removing a file in
+   the directory changes the modification time, and replacing the
+   directory changes the device or inode number of its path.  Setting
+   the modification time back changes the status change time.  A
+   snapshot is revalidated with a stat call on the path; the directory
+   is only kept open while its names are read, so that no descriptor of
+   the program is ever used or closed by the cache.  With the tunable
+   set to 1, the snapshots are revalidated once per dlopen call, which
+   preserves the search results.  With 2, a snapshot is only
+   revalidated if a search which skipped its directory fails to find a
+   file, at most once per dlopen call; a file added to a directory
+   which comes earlier in the search path than an existing copy may
+   then be missed.
+
+   If the directory has been modified less than a second before the
+   snapshot was taken, further modifications may not change its
+   modification time, and the snapshot is not used.
+
+   The cache is only used once the main malloc is available, that is,
+   not for the objects loaded at program startup.  */
+
+/* Directories with more entries than this are not cached.  */
+enum { dir_cache_max_names = 1 << 16 };
+
+struct dir_snapshot
+{
+  struct dir_snapshot *next;
+
+  /* Identity, modification and status change time of the
+     directory.  */
+  dev_t dev;
+  ino64_t ino;
+  struct __timespec64 mtime;
+  struct __timespec64 ctime;
+
+  /* Value of generation when the snapshot was last validated.  */
+  unsigned long long int generation;
+
+  /* Value of generation when the snapshot was last used to skip a
+     directory.  */
+  unsigned long long int skipped_generation;
+
+  /* Open-addressing hash table with the _dl_new_hash values of the
+     names in the directory.  Zero marks unused slots.  NULL if the
+     snapshot cannot be used.  */
+  uint32_t *table;
+  uint32_t mask;
+
+  /* The directory name, with a trailing slash.  */
+  size_t pathlen;
+  char path[];
+};
+
+static struct dir_snapshot *snapshots;
+
+/* Incremented for each dlopen call.  */
+static unsigned long long int generation;
+
+/* Return the value of the glibc.rtld.dir_cache tunable, or 0 if the
+   cache cannot be used yet.  */
+static int
+dir_cache_mode (void)
+{
+#ifdef SHARED
+  if (!__rtld_malloc_is_complete ())
+    return 0;
+#endif
+  return TUNABLE_GET (glibc, rtld, dir_cache, int32_t, NULL);
+}
+
+/* Store the identity and times of the directory described by ST in
+   *SNAPSHOT.  */
+static void
+set_identity (struct dir_snapshot *snapshot, const struct __stat64_t64 *st)
+{
+  snapshot->dev = st->st_dev;
+  snapshot->ino = st->st_ino;
+  snapshot->mtime = (struct __timespec64) { st->st_mtim.tv_sec,
+					    st->st_mtim.tv_nsec };
+  snapshot->ctime = (struct __timespec64) { st->st_ctim.tv_sec,
+					    st->st_ctim.tv_nsec };
+}
+
+/* Store the identity of the directory at PATH in *SNAPSHOT.  Return
+   false if it cannot be determined.  */
+static bool
+get_identity (const char *path, struct dir_snapshot *snapshot)
+{
+  struct __stat64_t64 st;
+  if (__stat64_time64 (path, &st) != 0 || !S_ISDIR (st.st_mode))
+    return false;
+  set_identity (snapshot, &st);
+  return true;
+}
+
+/* Names collected by add_name.  */
+struct name_list
+{
+  uint32_t *hashes;
+  size_t used;
+  size_t allocated;
+};
+
+static bool
+add_name (void *closure, const char *name)
+{
+  struct name_list *list = closure;
+  if (list->used == list->allocated)
+    {
+      if (list->allocated == dir_cache_max_names)
+	return false;
+      size_t allocated = list->allocated == 0 ? 64 : 2 * list->allocated;
+      uint32_t *hashes = realloc (list->hashes, allocated * sizeof (*hashes));
+      if (hashes == NULL)
+	return false;
+      list->hashes = hashes;
+      list->allocated = allocated;
+    }
+  list->hashes[list->used++] = _dl_new_hash (name);
+  return true;
+}
+
+/* Read the names in the directory of SNAPSHOT into its hash table.  */
+static void
+read_names (struct dir_snapshot *snapshot)
+{
+  free (snapshot->table);
+  snapshot->table = NULL;
+  int fd = __open64_nocancel (snapshot->path,
+			      O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  struct __stat64_t64 st;
+  struct __timespec64 now;
+  struct name_list list = { NULL, 0, 0 };
+  bool ok = (__fstat64_time64 (fd, &st) == 0
+	     && _dl_dir_cache_clock (&now)
+	     /* Further changes may not be visible in the modification
+		time.  */
+	     && st.st_mtim.tv_sec < now.tv_sec - 1
+	     && _dl_readdir (fd, add_name, &list));
+  __close_nocancel_nostatus (fd);
+
+  if (ok)
+    {
+      set_identity (snapshot, &st);
+
+      /* Keep the load factor at or below one half.  */
+      size_t size = 1;
+      while (size <= 2 * list.used)
+	size *= 2;
+      uint32_t *table = calloc (size, sizeof (*table));
+      if (table != NULL)
+	{
+	  for (size_t i = 0; i < list.used; ++i)
+	    {
+	      /* Zero marks unused slots.  A name with hash value zero
+		 is treated as if it had value one, which only causes
+		 unnecessary open attempts.  */
+	      uint32_t hash = list.hashes[i] != 0 ? list.hashes[i] : 1;
+	      size_t slot = hash & (size - 1);
+	      while (table[slot] != 0 && table[slot] != hash)
+		slot = (slot + 1) & (size - 1);
+	      table[slot] = hash;
+	    }
+	  snapshot->table = table;
+	  snapshot->mask = size - 1;
+	}
+    }
+  free (list.hashes);
+}
+
+/* Return the snapshot for the directory DIR of length DIRLEN,
+   creating it if necessary.  */
+static struct dir_snapshot *
+get_snapshot (const char *dir, size_t dirlen)
+{
+  struct dir_snapshot **prev = &snapshots;
+  for (struct dir_snapshot *s = snapshots; s != NULL; s = s->next)
+    {
+      if (s->pathlen == dirlen && memcmp (s->path, dir, dirlen) == 0)
+	{
+	  /* Move the snapshot to the front of the list.  */
+	  *prev = s->next;
+	  s->next = snapshots;
+	  snapshots = s;
+	  return s;
+	}
+      prev = &s->next;
+    }
+
+  struct dir_snapshot *s = malloc (sizeof (*s) + dirlen + 1);
+  if (s == NULL)
+    return NULL;
+  s->pathlen = dirlen;
+  *(char *) __mempcpy (s->path, dir, dirlen) = '\0';
+  s->generation = generation;
+  s->skipped_generation = 0;
+  s->table = NULL;
+  read_names (s);
+  s->next = snapshots;
+  snapshots = s;
+  return s;
+}
+
+/* Return true if SNAPSHOT still describes its directory.  */
+static bool
+snapshot_is_current (struct dir_snapshot *snapshot)
+{
+  struct dir_snapshot current;
+  return (snapshot->table != NULL
+	  && get_identity (snapshot->path, &current)
+	  && current.dev == snapshot->dev
+	  && current.ino == snapshot->ino
+	  && current.mtime.tv_sec == snapshot->mtime.tv_sec
+	  && current.mtime.tv_nsec == snapshot->mtime.tv_nsec
+	  && current.ctime.tv_sec == snapshot->ctime.tv_sec
+	  && current.ctime.tv_nsec == snapshot->ctime.tv_nsec);
+}
+
+bool
+_dl_dir_cache_may_exist (const char *dir, size_t dirlen, const char *name)
+{
+  int mode = dir_cache_mode ();
+  if (mode == 0)
+    return true;
+
+  struct dir_snapshot *s = get_snapshot (dir, dirlen);
+  if (s == NULL)
+    return true;
+  /* Snapshots which could not be used are retried in both modes.  */
+  if (s->generation != generation && (mode == 1 || s->table == NULL))
+    {
+      if (!snapshot_is_current (s))
+	read_names (s);
+      s->generation = generation;
+    }
+  if (s->table == NULL)
+    return true;
+
+  uint32_t hash = _dl_new_hash (name);
+  if (hash == 0)
+    hash = 1;
+  for (uint32_t slot = hash & s->mask; s->table[slot] != 0;
+       slot = (slot + 1) & s->mask)
+    if (s->table[slot] == hash)
+      return true;
+  s->skipped_generation = generation;
+  return false;
+}
+
+bool
+_dl_dir_cache_revalidate (void)
+{
+  /* With mode 1, the snapshots have already been checked during this
+     dlopen call.  */
+  if (dir_cache_mode () != 2)
+    return false;
+
+  /* Only check the snapshots which have been used to skip directories
+     during this dlopen call, and each of them only once.  */
+  bool changed = false;
+  for (struct dir_snapshot *s = snapshots; s != NULL; s = s->next)
+    if (s->skipped_generation == generation && s->generation != generation)
+      {
+	if (!snapshot_is_current (s))
+	  {
+	    read_names (s);
+	    changed = true;
+	  }
+	s->generation = generation;
+      }
+  return changed;
+}
+
+void
+_dl_dir_cache_new_generation (void)
+{
+  ++generation;
+}
+
+void
+_dl_dir_cache_freeres (void)
+{
+  struct dir_snapshot *s = snapshots;
+  snapshots = NULL;
+  while (s != NULL)
+    {
+      struct dir_snapshot *next = s->next;
+      free (s->table);
+      free (s);
+      s = next;
+    }
+}
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <ldsodefs.h>
 #include <dl-hash.h>
+#include <dl-scope-index.h>
 
 extern int __libc_argc attribute_hidden;
 extern char **__libc_argv attribute_hidden;
@@ -332,4 +333,10 @@ __dl_libc_freemem (void)
   void *scope_free_list = GL(dl_scope_free_list);
   GL(dl_scope_free_list) = NULL;
   free (scope_free_list);
+
+#ifndef SHARED
+  /* In the shared case, this is done by __rtld_libc_freeres.  */
+  _dl_dir_cache_freeres ();
+  _dl_scope_index_freeres ();
+#endif
 }
@@ -18,9 +18,12 @@
 
 #include <ldsodefs.h>
 #include <dl-find_object.h>
+#include <dl-scope-index.h>
 
 void
 __rtld_libc_freeres (void)
 {
   _dl_find_object_freeres ();
+  _dl_dir_cache_freeres ();
+  _dl_scope_index_freeres ();
 }
@@ -73,6 +73,7 @@ struct filebuf
 #include <dl-unmap-segments.h>
 #include <dl-machine-reject-phdr.h>
 #include <dl-prop.h>
+#include <dl-tunables.h>
 #include <not-cancel.h>
 
 #include <endian.h>
@@ -1252,6 +1253,20 @@ _dl_map_object_from_fd (const char *name, const char *origname, int fd,
 	l->l_map_start = l->l_map_end = 0;
 	goto lose;
       }
+
+    /* Start reading the file contents in the background, so that the
+       I/O overlaps with loading the remaining objects and relocation,
+       instead of happening one page fault at a time.  */
+    if (TUNABLE_GET (glibc, rtld, prefetch, int32_t, NULL) != 0)
+      {
+	for (size_t i = 0; i < nloadcmds; ++i)
+	  if (loadcmds[i].mapend > loadcmds[i].mapstart)
+	    __madvise ((void *) (l->l_addr + loadcmds[i].mapstart),
+		       loadcmds[i].mapend - loadcmds[i].mapstart,
+		       MADV_WILLNEED);
+	if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_FILES))
+	  _dl_debug_printf ("  prefetching file=%s [%lu]\n", name, nsid);
+      }
   }
 
   if (l->l_ld != 0)
@@ -1751,6 +1766,9 @@ open_path (const char *name, size_t namelen, int mode,
   int fd = -1;
   const char *current_what = NULL;
   int any = 0;
+  /* Set if a directory was skipped because of the directory cache.  */
+  bool skipped = false;
+  bool retried = false;
 
   if (__glibc_unlikely (dirs == NULL))
     /* We're called before _dl_init_paths when loading the main executable
@@ -1758,6 +1776,7 @@ open_path (const char *name, size_t namelen, int mode,
     return -1;
 
   buf = alloca (max_dirnamelen + max_capstrlen + namelen);
+ retry:
   do
     {
       struct r_search_path_elem *this_dir = *dirs;
@@ -1792,6 +1811,20 @@ open_path (const char *name, size_t namelen, int mode,
 	  buflen = (char *) __mempcpy (edp, name, namelen) - buf;
 #endif
 
+	  /* Skip the directory if the directory cache says that it does
+	     not contain the file.  */
+	  if (this_dir->status[cnt] == existing
+	      && !_dl_dir_cache_may_exist (buf, buflen - namelen, name))
+	    {
+	      if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_LIBS))
+		_dl_debug_printf ("  skipping file=%s (not in directory cache)\n",
+				  buf);
+	      skipped = true;
+	      here_any = 1;
+	      __set_errno (ENOENT);
+	      continue;
+	    }
+
 	  /* Print name we try if this is wanted.  */
 	  if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_LIBS))
 	    _dl_debug_printf ("  trying file=%s\n", buf);
@@ -1878,6 +1911,17 @@ open_path (const char *name, size_t namelen, int mode,
     }
   while (*++dirs != NULL);
 
+  /* The directory cache may be out of date.  Search again if it has
+     changed.  */
+  if (__glibc_unlikely (skipped) && !retried && _dl_dir_cache_revalidate ())
+    {
+      retried = true;
+      skipped = false;
+      dirs = sps->dirs;
+      any = 0;
+      goto retry;
+    }
+
   /* Remove the whole path if none of the directories exists.  */
   if (__glibc_unlikely (! any))
     {
@@ -25,6 +25,7 @@
 #include <dl-machine.h>
 #include <dl-new-hash.h>
 #include <dl-protected.h>
+#include <dl-scope-index.h>
 #include <sysdep-cancel.h>
 #include <libc-lock.h>
 #include <tls.h>
@@ -353,8 +354,42 @@ do_lookup_x (const char *undef_name, unsigned int new_hash,
   __asm volatile ("" : "+r" (n), "+m" (scope->r_list));
   struct link_map **list = scope->r_list;
 
+  /* If the scope has an index, only the objects it lists for the hash
+     value and the objects added after the index was built need to be
+     searched.  The index is not used for symbol debugging, so that
+     the output shows all objects.  */
+  const struct dl_scope_index *index = atomic_load_acquire (&scope->r_index);
+  const uint32_t *candidates = NULL;
+  const uint32_t *candidates_end = NULL;
+  unsigned int index_nlist = 0;
+  if (index != NULL
+      && __glibc_likely (!(GLRO(dl_debug_mask) & DL_DEBUG_SYMBOLS)))
+    {
+      const struct dl_scope_index_slot *slot
+	= _dl_scope_index_lookup (index, new_hash);
+      if (slot != NULL)
+	{
+	  candidates = &index->positions[slot->start];
+	  candidates_end = candidates + slot->count;
+	}
+      index_nlist = atomic_load_relaxed (&index->nlist);
+    }
+
   do
     {
+      if (i < index_nlist)
+	{
+	  /* Skip to the next object which may define the symbol.  After
+	     dlclose, the index may contain positions beyond the objects
+	     it covers.  */
+	  while (candidates != candidates_end && *candidates < i)
+	    ++candidates;
+	  i = (candidates != candidates_end && *candidates < index_nlist
+	       ? *candidates : index_nlist);
+	  if (i >= n)
+	    break;
+	}
+
       const struct link_map *map = list[i]->l_real;
 
       /* Here come the extra test needed for `_dl_lookup_symbol_skip'.  */
@@ -37,6 +37,7 @@
 #include <libc-early-init.h>
 #include <gnu/lib-names.h>
 #include <dl-find_object.h>
+#include <dl-scope-index.h>
 
 #include <dl-dst.h>
 #include <dl-prop.h>
@@ -204,6 +205,9 @@ add_to_global_update (struct link_map *new)
 
   atomic_write_barrier ();
   ns->_ns_main_searchlist->r_nlist = new_nlist;
+
+  if (added > 0)
+    _dl_scope_index_update (ns->_ns_main_searchlist);
 }
 
 /* Search link maps in all namespaces for the DSO that contains the object at
@@ -844,6 +848,9 @@ no more namespaces available for dlmopen()"));
     _dl_signal_error (EINVAL, file, NULL,
 		      N_("invalid target namespace in dlmopen()"));
 
+  /* Directory contents may have changed since the last call.  */
+  _dl_dir_cache_new_generation ();
+
   struct dl_open_args args;
   args.file = file;
   args.mode = mode;
@@ -0,0 +1,603 @@
+/* Cache of symbol lookup results for relocation at startup.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <_itoa.h>
+#include <dl-tunables.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <ldsodefs.h>
+#include <libc-pointer-arith.h>
+#include <not-cancel.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+
+/* If the glibc.rtld.reloc_cache tunable names a directory, the
+   results of the symbol lookups performed while relocating the
+   initially loaded objects are recorded in a file in this directory.
+   On later starts with the same objects, the file is used instead of
+   looking up the symbols again.
+
+   Relocation processing is deterministic, so the symbol lookups for
+   each object happen in the same order each time.  The file contains,
+   for each object, the sequence of lookups with their results: the
+   defining object (by position in the list of loaded objects) and the
+   index of the symbol in its symbol table.  Each entry also records
+   the looked-up symbol, and a mismatch stops the use of the file for
+   the object in question, as does a recorded result which does not
+   name a definition of that symbol with a matching version.
+
+   The file name is derived from a hash of the identities of the
+   loaded objects, and the file contents are validated against them:
+   the build ID, device and inode number of each object, in load order.
+   Files which could have been written by other users are ignored.
+   Objects without a build ID disable the cache.  Lookups of
+   STB_GNU_UNIQUE symbols are always performed because they have side
+   effects.  The cache is not used with auditing, in trace mode, or
+   with LD_DEBUG=bindings.  */
+
+/* Magic string at the start of the file.  */
+#define RELOC_CACHE_MAGIC "glibc-relocs-001"
+
+/* Flags which affect the relocation results, stored in the file.  */
+enum
+  {
+    reloc_cache_flag_lazy = 1,
+    reloc_cache_flag_dynamic_weak = 2,
+  };
+
+/* Maximum supported build ID length.  */
+enum { reloc_cache_build_id_max = 32 };
+
+struct reloc_cache_header
+{
+  char magic[sizeof (RELOC_CACHE_MAGIC) - 1];
+  uint32_t flags;
+  uint32_t nobjects;
+  uint64_t nentries;
+};
+
+/* Identity of a loaded object.  */
+struct reloc_cache_object
+{
+  uint64_t dev;
+  uint64_t ino;
+  uint32_t build_id_length;
+  uint32_t nentries;
+  unsigned char build_id[reloc_cache_build_id_max];
+};
+
+/* Special values for struct reloc_cache_entry.def.  */
+enum
+  {
+    /* The symbol is undefined (a weak reference).  */
+    reloc_cache_undefined = UINT32_MAX,
+    /* The lookup has to be performed.  */
+    reloc_cache_lookup = UINT32_MAX - 1,
+  };
+
+struct reloc_cache_entry
+{
+  uint32_t symidx;              /* Symbol being looked up.  */
+  uint32_t type_class;          /* ELF_RTYPE_CLASS_* value.  */
+  uint32_t def;                 /* Index of the defining object.  */
+  uint32_t defsymidx;           /* Symbol index in the defining object.  */
+};
+
+static enum
+  {
+    reloc_cache_inactive,
+    reloc_cache_recording,
+    reloc_cache_replaying,
+  } mode;
+
+/* The initially loaded objects, in load order.  */
+static struct link_map **objects;
+static uint32_t nobjects;
+static uint32_t flags;
+
+/* In replay mode, the number of symbols in the hash table of each
+   object, which bounds the recorded symbol indices.  */
+static uint32_t *symbol_counts;
+
+/* Path of the cache file.  */
+static char *path;
+
+/* In replay mode, the mapped file.  In recording mode, the buffer
+   which receives the entries.  */
+static void *data;
+static size_t data_size;
+
+/* Set if the file did not match the relocation processing.  */
+static bool invalid;
+
+static void
+set_directory (tunable_val_t *valp)
+{
+  const char *dir = valp->strval.str;
+  size_t len = valp->strval.len;
+  if (len == 0)
+    return;
+  /* Directory, slash, 16 hexadecimal digits, and the suffix.  */
+  path = malloc (len + 1 + 16 + sizeof (".relocs"));
+  if (path != NULL)
+    {
+      char *p = __mempcpy (path, dir, len);
+      *p = '/';
+      p[1] = '\0';
+    }
+}
+
+/* Return the build ID of L in *ID and *LEN, or false if it has none.  */
+static bool
+get_build_id (struct link_map *l, const unsigned char **id, uint32_t *len)
+{
+  for (const ElfW(Phdr) *ph = l->l_phdr; ph < &l->l_phdr[l->l_phnum]; ++ph)
+    if (ph->p_type == PT_NOTE)
+      {
+        const char *p = (const char *) (l->l_addr + ph->p_vaddr);
+        const char *end = p + ph->p_memsz;
+        size_t align = ph->p_align == 8 ? 8 : 4;
+        while (end - p >= sizeof (ElfW(Nhdr)))
+          {
+            const ElfW(Nhdr) *note = (const ElfW(Nhdr) *) p;
+            const char *name = p + sizeof (*note);
+            const char *desc = name + ALIGN_UP (note->n_namesz, align);
+            p = desc + ALIGN_UP (note->n_descsz, align);
+            if (p > end || p < desc)
+              break;
+            if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4
+                && memcmp (name, "GNU", 4) == 0)
+              {
+                *id = (const unsigned char *) desc;
+                *len = note->n_descsz;
+                return *len > 0 && *len <= reloc_cache_build_id_max;
+              }
+          }
+      }
+  return false;
+}
+
+/* Fill in *OBJ for L.  Return false if L cannot be identified.  */
+static bool
+identify (struct link_map *l, struct reloc_cache_object *obj)
+{
+  const unsigned char *id;
+  uint32_t len;
+  if (!get_build_id (l, &id, &len))
+    return false;
+  memset (obj, 0, sizeof (*obj));
+  obj->dev = l->l_file_id.dev;
+  obj->ino = l->l_file_id.ino;
+  obj->build_id_length = len;
+  memcpy (obj->build_id, id, len);
+  return true;
+}
+
+/* The dynamic linker is relocated before the other objects, and
+   possibly again after them, so it does not use the cache.  */
+static bool
+cached (struct link_map *l)
+{
+  return l != &GL(dl_rtld_map);
+}
+
+/* Upper bound for the number of symbol lookups while relocating L.  */
+static size_t
+max_lookups (struct link_map *l)
+{
+  if (!cached (l))
+    return 0;
+  size_t size = 0;
+  if (l->l_info[DT_RELSZ] != NULL)
+    size += l->l_info[DT_RELSZ]->d_un.d_val;
+  if (l->l_info[DT_RELASZ] != NULL)
+    size += l->l_info[DT_RELASZ]->d_un.d_val;
+  if (l->l_info[DT_PLTRELSZ] != NULL)
+    size += l->l_info[DT_PLTRELSZ]->d_un.d_val;
+  /* ElfW(Rel) is the smaller relocation type.  */
+  return size / sizeof (ElfW(Rel));
+}
+
+/* Load the cache file into DATA.  Return false if it cannot be used.
+   On success, the replay pointers of all objects are set.  */
+static bool
+load_file (const struct reloc_cache_object *ids)
+{
+  int fd = __open64_nocancel (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct __stat64_t64 st;
+  void *map = MAP_FAILED;
+  if (__fstat64_time64 (fd, &st) == 0 && S_ISREG (st.st_mode)
+      && st.st_uid == __geteuid ()
+      && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0
+      && st.st_size >= sizeof (struct reloc_cache_header))
+    map = __mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  __close_nocancel (fd);
+  if (map == MAP_FAILED)
+    return false;
+  data = map;
+  data_size = st.st_size;
+
+  const struct reloc_cache_header *header = data;
+  size_t objects_size = nobjects * sizeof (struct reloc_cache_object);
+  if (memcmp (header->magic, RELOC_CACHE_MAGIC, sizeof (header->magic)) != 0
+      || header->flags != flags || header->nobjects != nobjects
+      || data_size != (sizeof (*header) + objects_size
+                       + header->nentries * sizeof (struct reloc_cache_entry)))
+    return false;
+
+  const struct reloc_cache_object *file_ids
+    = (const struct reloc_cache_object *) (header + 1);
+  for (uint32_t i = 0; i < nobjects; ++i)
+    {
+      /* The entry counts are not part of the identity.  */
+      struct reloc_cache_object id = file_ids[i];
+      id.nentries = 0;
+      if (memcmp (&id, &ids[i], sizeof (id)) != 0)
+        return false;
+    }
+
+  struct reloc_cache_entry *entries
+    = (struct reloc_cache_entry *) (file_ids + nobjects);
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < nobjects; ++i)
+    if (cached (objects[i]))
+      {
+        objects[i]->l_reloc_cache_next = entries + total;
+        total += file_ids[i].nentries;
+        objects[i]->l_reloc_cache_end = entries + total;
+      }
+  if (total != header->nentries)
+    {
+      for (uint32_t i = 0; i < nobjects; ++i)
+        objects[i]->l_reloc_cache_next = NULL;
+      return false;
+    }
+  return true;
+}
+
+/* Return the number of symbols of L which can be found through its
+   symbol hash table.  */
+static uint32_t
+symbol_count (struct link_map *l)
+{
+  if (l->l_nbuckets == 0)
+    return 0;
+  if (l->l_gnu_bitmask == NULL)
+    /* The DT_HASH table has a chain entry for each symbol.  The
+       number of entries precedes the buckets.  */
+    return l->l_buckets[-1];
+
+  /* The hash chain of the last bucket ends with the last symbol.  */
+  Elf32_Word last = 0;
+  for (Elf32_Word bucket = 0; bucket < l->l_nbuckets; ++bucket)
+    last = MAX (last, l->l_gnu_buckets[bucket]);
+  if (last == 0)
+    return 0;
+  while ((l->l_gnu_chain_zero[last] & 1u) == 0)
+    ++last;
+  return last + 1;
+}
+
+void
+_dl_reloc_cache_setup (struct link_map *main_map)
+{
+  TUNABLE_GET (glibc, rtld, reloc_cache, tunable_val_t *, set_directory);
+  if (path == NULL || GLRO(dl_naudit) > 0
+      || (GLRO(dl_debug_mask) & DL_DEBUG_BINDINGS))
+    return;
+
+  nobjects = 0;
+  for (struct link_map *l = main_map; l != NULL; l = l->l_next)
+    ++nobjects;
+  objects = malloc (nobjects * sizeof (*objects));
+  struct reloc_cache_object *ids = calloc (nobjects, sizeof (*ids));
+  if (objects == NULL || ids == NULL)
+    return;
+
+  flags = ((GLRO(dl_lazy) ? reloc_cache_flag_lazy : 0)
+           | (GLRO(dl_dynamic_weak) ? reloc_cache_flag_dynamic_weak : 0));
+
+  /* 64-bit FNV-1a hash of the object identities, for the file
+     name.  */
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  uint32_t i = 0;
+  size_t lookups = 0;
+  for (struct link_map *l = main_map; l != NULL; l = l->l_next, ++i)
+    {
+      if (!identify (l, &ids[i]))
+        {
+          if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_RELOC))
+            _dl_debug_printf ("relocation cache: no build ID in %s\n",
+                              DSO_FILENAME (l->l_name));
+          return;
+        }
+      objects[i] = l;
+      l->l_reloc_cache_index = i + 1;
+      lookups += max_lookups (l);
+      const unsigned char *p = (const unsigned char *) &ids[i];
+      for (size_t j = 0; j < sizeof (ids[i]); ++j)
+        hash = (hash ^ p[j]) * 0x100000001b3ULL;
+    }
+  hash ^= flags;
+
+  char *p = strchr (path, '\0');
+  for (int shift = 60; shift >= 0; shift -= 4)
+    *p++ = "0123456789abcdef"[(hash >> shift) & 15];
+  strcpy (p, ".relocs");
+
+  symbol_counts = malloc (nobjects * sizeof (*symbol_counts));
+  if (symbol_counts != NULL && load_file (ids))
+    {
+      for (i = 0; i < nobjects; ++i)
+        symbol_counts[i] = symbol_count (objects[i]);
+      mode = reloc_cache_replaying;
+      if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_RELOC))
+        _dl_debug_printf ("relocation cache: using %s\n", path);
+      return;
+    }
+  if (data != NULL)
+    __munmap (data, data_size);
+
+  /* Record the lookups.  The buffer starts with the header and the
+     object identities, so that it can be written in one piece.  */
+  size_t entries_offset = (sizeof (struct reloc_cache_header)
+                           + nobjects * sizeof (struct reloc_cache_object));
+  data_size = entries_offset + lookups * sizeof (struct reloc_cache_entry);
+  data = __mmap (NULL, data_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED)
+    {
+      data = NULL;
+      return;
+    }
+  memcpy ((char *) data + sizeof (struct reloc_cache_header), ids,
+          nobjects * sizeof (struct reloc_cache_object));
+  struct reloc_cache_entry *entries
+    = (struct reloc_cache_entry *) ((char *) data + entries_offset);
+  for (i = 0; i < nobjects; ++i)
+    if (cached (objects[i]))
+      {
+        objects[i]->l_reloc_cache_next = entries;
+        entries += max_lookups (objects[i]);
+        objects[i]->l_reloc_cache_end = entries;
+      }
+  mode = reloc_cache_recording;
+}
+
+/* Stop using the cache for L, for example because it does not match.
+   The file is removed at the end.  */
+static void
+disable (struct link_map *l)
+{
+  l->l_reloc_cache_next = NULL;
+  invalid = true;
+}
+
+/* Return true if the symbol with index SYMIDX in the object at
+   position DEF is a definition of UNDEF_NAME which matches VERSION,
+   as the symbol lookup checks it.  The file may have been modified
+   since it was written.  */
+static bool
+check_definition (uint32_t def, uint32_t symidx, const char *undef_name,
+                  const struct r_found_version *version)
+{
+  struct link_map *map = objects[def];
+  if (symidx >= symbol_counts[def])
+    return false;
+  const ElfW(Sym) *sym
+    = (const ElfW(Sym) *) D_PTR (map, l_info[DT_SYMTAB]) + symidx;
+  const char *strtab = (const char *) D_PTR (map, l_info[DT_STRTAB]);
+  if (sym->st_shndx == SHN_UNDEF
+      || strcmp (strtab + sym->st_name, undef_name) != 0)
+    return false;
+
+  const ElfW(Half) *verstab = map->l_versyms;
+  if (verstab == NULL)
+    return true;
+  ElfW(Half) ndx = verstab[symidx] & 0x7fff;
+  if (version == NULL)
+    /* Hidden symbols are only found with their version.  */
+    return (verstab[symidx] & 0x8000) == 0;
+  if (ndx >= map->l_nversions)
+    return false;
+  return ((map->l_versions[ndx].hash == version->hash
+           && strcmp (map->l_versions[ndx].name, version->name) == 0)
+          || (!version->hidden && map->l_versions[ndx].hash == 0
+              && (verstab[symidx] & 0x8000) == 0));
+}
+
+lookup_t
+_dl_reloc_cache_resolve (struct link_map *l, struct r_scope_elem *scope[],
+                         const ElfW(Sym) **ref,
+                         const struct r_found_version *version, int type_class)
+{
+  const ElfW(Sym) *symtab = (const void *) D_PTR (l, l_info[DT_SYMTAB]);
+  uint32_t symidx = *ref - symtab;
+  const char *undef_name
+    = (const char *) D_PTR (l, l_info[DT_STRTAB]) + (*ref)->st_name;
+  struct reloc_cache_entry *e = l->l_reloc_cache_next;
+
+  if (mode == reloc_cache_replaying)
+    {
+      if (e < l->l_reloc_cache_end && e->symidx == symidx
+          && e->type_class == type_class)
+        {
+          l->l_reloc_cache_next = e + 1;
+          if (e->def == reloc_cache_undefined)
+            {
+              *ref = NULL;
+              return NULL;
+            }
+          if (e->def < nobjects
+              && check_definition (e->def, e->defsymidx, undef_name,
+                                   version))
+            {
+              struct link_map *def = objects[e->def];
+              *ref = ((const ElfW(Sym) *) D_PTR (def, l_info[DT_SYMTAB])
+                      + e->defsymidx);
+              def->l_used = 1;
+              return def;
+            }
+          if (e->def != reloc_cache_lookup)
+            disable (l);
+        }
+      else
+        disable (l);
+    }
+
+  lookup_t result = _dl_lookup_symbol_x (undef_name, l, ref, scope, version,
+                                         type_class,
+                                         DL_LOOKUP_ADD_DEPENDENCY
+                                         | DL_LOOKUP_FOR_RELOCATE, NULL);
+
+  if (mode == reloc_cache_recording)
+    {
+      if (e >= l->l_reloc_cache_end)
+        {
+          /* More lookups than expected.  Do not write the file.  */
+          disable (l);
+          return result;
+        }
+      e->symidx = symidx;
+      e->type_class = type_class;
+      e->defsymidx = 0;
+      if (*ref == NULL)
+        e->def = reloc_cache_undefined;
+      else if (ELFW(ST_BIND) ((*ref)->st_info) == STB_GNU_UNIQUE
+               || result->l_reloc_cache_index == 0
+               || objects[result->l_reloc_cache_index - 1] != result)
+        e->def = reloc_cache_lookup;
+      else
+        {
+          e->def = result->l_reloc_cache_index - 1;
+          e->defsymidx = (*ref
+                          - (const ElfW(Sym) *) D_PTR (result,
+                                                       l_info[DT_SYMTAB]));
+        }
+      l->l_reloc_cache_next = e + 1;
+    }
+  return result;
+}
+
+/* Write the recorded entries to the cache file.  */
+static void
+write_file (void)
+{
+  struct reloc_cache_header *header = data;
+  memcpy (header->magic, RELOC_CACHE_MAGIC, sizeof (header->magic));
+  header->flags = flags;
+  header->nobjects = nobjects;
+
+  /* Compact the entries, which were recorded in per-object areas of
+     the maximum size.  */
+  struct reloc_cache_object *ids = (struct reloc_cache_object *) (header + 1);
+  struct reloc_cache_entry *entries
+    = (struct reloc_cache_entry *) (ids + nobjects);
+  struct reloc_cache_entry *start = entries;
+  struct reloc_cache_entry *out = entries;
+  for (uint32_t i = 0; i < nobjects; ++i)
+    {
+      if (!cached (objects[i]))
+        continue;
+      size_t count = objects[i]->l_reloc_cache_next - start;
+      memmove (out, start, count * sizeof (*out));
+      out += count;
+      ids[i].nentries = count;
+      start += max_lookups (objects[i]);
+    }
+  header->nentries = out - entries;
+  size_t size = (char *) out - (char *) data;
+
+  /* Write to a temporary file and rename it, so that concurrent
+     processes never see a partial file.  */
+  size_t path_length = strlen (path);
+  char tmppath[path_length + 24];
+  char pidbuf[16];
+  char *pid = _itoa (__getpid (), pidbuf + sizeof (pidbuf), 10, 0);
+  char *q = __mempcpy (tmppath, path, path_length);
+  *q++ = '.';
+  q = __mempcpy (q, pid, pidbuf + sizeof (pidbuf) - pid);
+  *q = '\0';
+
+  int fd = __open64_nocancel (tmppath,
+                              O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW
+                              | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return;
+  const char *p = data;
+  while (size > 0)
+    {
+      ssize_t n = __write_nocancel (fd, p, size);
+      if (n <= 0)
+        break;
+      p += n;
+      size -= n;
+    }
+  __close_nocancel_nostatus (fd);
+
+  if (size != 0 || __renameat (AT_FDCWD, tmppath, AT_FDCWD, path) != 0)
+    __unlink (tmppath);
+  else if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_RELOC))
+    _dl_debug_printf ("relocation cache: wrote %s\n", path);
+}
+
+void
+_dl_reloc_cache_finish (void)
+{
+  if (mode == reloc_cache_inactive)
+    return;
+
+  /* All objects must have been relocated completely.  */
+  for (uint32_t i = 0; i < nobjects; ++i)
+    {
+      struct link_map *l = objects[i];
+      if (!cached (l))
+        continue;
+      if (l->l_reloc_cache_next == NULL)
+        invalid = true;
+      else if (mode == reloc_cache_replaying
+               && l->l_reloc_cache_next != l->l_reloc_cache_end)
+        invalid = true;
+    }
+
+  if (mode == reloc_cache_recording)
+    {
+      if (!invalid)
+        write_file ();
+    }
+  else if (invalid)
+    {
+      /* The next start records the lookups again.  */
+      if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_RELOC))
+        _dl_debug_printf ("relocation cache: discarding %s\n", path);
+      __unlink (path);
+    }
+
+  for (uint32_t i = 0; i < nobjects; ++i)
+    objects[i]->l_reloc_cache_next = objects[i]->l_reloc_cache_end = NULL;
+  __munmap (data, data_size);
+  data = NULL;
+  mode = reloc_cache_inactive;
+}
@@ -187,9 +187,15 @@ resolve_map (lookup_t l, struct r_scope_elem *scope[], const ElfW(Sym) **ref,
       const struct r_found_version *v = NULL;
       if (version != NULL && version->hash != 0)
 	v = version;
-      lookup_t lr = _dl_lookup_symbol_x (
-	  undef_name, l, ref, scope, v, tc,
-	  DL_LOOKUP_ADD_DEPENDENCY | DL_LOOKUP_FOR_RELOCATE, NULL);
+      lookup_t lr;
+#ifdef SHARED
+      if (__glibc_unlikely (l->l_reloc_cache_next != NULL))
+	lr = _dl_reloc_cache_resolve (l, scope, ref, v, tc);
+      else
+#endif
+	lr = _dl_lookup_symbol_x (
+	    undef_name, l, ref, scope, v, tc,
+	    DL_LOOKUP_ADD_DEPENDENCY | DL_LOOKUP_FOR_RELOCATE, NULL);
       l->l_lookup_cache.ret = *ref;
       l->l_lookup_cache.value = lr;
     }
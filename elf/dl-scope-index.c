@@ -0,0 +1,204 @@
+/* Symbol hash index for the global scope.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <assert.h>
+#include <atomic.h>
+#include <dl-scope-index.h>
+#include <dl-tunables.h>
+#include <stdlib.h>
+
+/* Upper limit for the number of symbols in the index.  */
+enum { scope_index_max_symbols = 1 << 26 };
+
+/* Return the slot for HASH in INDEX, which is either the slot for
+   HASH or the unused slot where it has to be inserted.  */
+static struct dl_scope_index_slot *
+find_slot (struct dl_scope_index *index, uint32_t hash)
+{
+  uint32_t i = (hash >> 1) & index->mask;
+  while (index->slots[i].hash != 0 && index->slots[i].hash != hash)
+    i = (i + 1) & index->mask;
+  return &index->slots[i];
+}
+
+/* Add the hash values of the symbols defined by MAP at POSITION to
+   INDEX.  If FILL is false, only count the positions for each hash
+   value.  If FILL is true, store the positions.  */
+static void
+add_object (struct dl_scope_index *index, const struct link_map *map,
+	    uint32_t position, bool fill)
+{
+  for (Elf32_Word bucket = 0; bucket < map->l_nbuckets; ++bucket)
+    {
+      Elf32_Word symidx = map->l_gnu_buckets[bucket];
+      if (symidx == 0)
+	continue;
+      const Elf32_Word *hasharr = &map->l_gnu_chain_zero[symidx];
+      do
+	{
+	  struct dl_scope_index_slot *slot = find_slot (index, *hasharr | 1);
+	  if (!fill)
+	    {
+	      slot->hash = *hasharr | 1;
+	      ++slot->count;
+	    }
+	  /* Several symbols of an object can have the same hash value,
+	     for example different versions of a symbol.  */
+	  else if (slot->count == 0
+		   || (index->positions[slot->start + slot->count - 1]
+		       != position))
+	    index->positions[slot->start + slot->count++] = position;
+	}
+      while ((*hasharr++ & 1u) == 0);
+    }
+}
+
+/* Return the number of hash chain entries of MAP.  */
+static size_t
+count_symbols (const struct link_map *map)
+{
+  size_t count = 0;
+  for (Elf32_Word bucket = 0; bucket < map->l_nbuckets; ++bucket)
+    {
+      Elf32_Word symidx = map->l_gnu_buckets[bucket];
+      if (symidx == 0)
+	continue;
+      const Elf32_Word *hasharr = &map->l_gnu_chain_zero[symidx];
+      do
+	++count;
+      while ((*hasharr++ & 1u) == 0);
+    }
+  return count;
+}
+
+/* Build the index for the first NLIST objects of LIST.  Return NULL
+   on failure.  */
+static struct dl_scope_index *
+build_index (struct link_map **list, unsigned int nlist)
+{
+  /* Objects with only a DT_HASH table are not supported.  Objects
+     without a symbol hash table are skipped by do_lookup_x.  */
+  for (unsigned int i = 0; i < nlist; ++i)
+    if (list[i]->l_real->l_gnu_bitmask == NULL
+	&& list[i]->l_real->l_nbuckets != 0)
+      return NULL;
+
+  size_t total = 0;
+  for (unsigned int i = 0; i < nlist; ++i)
+    {
+      total += count_symbols (list[i]->l_real);
+      if (total > scope_index_max_symbols)
+	return NULL;
+    }
+
+  /* The load factor is at most one half.  */
+  size_t nslots = 2;
+  while (nslots < 2 * total)
+    nslots *= 2;
+  struct dl_scope_index *index
+    = calloc (1, sizeof (*index)
+	      + nslots * sizeof (struct dl_scope_index_slot)
+	      + total * sizeof (uint32_t));
+  if (index == NULL)
+    return NULL;
+  index->nlist = nlist;
+#ifdef SHARED
+  index->malloced = __rtld_malloc_is_complete ();
+#else
+  index->malloced = true;
+#endif
+  index->mask = nslots - 1;
+  index->slots = (struct dl_scope_index_slot *) (index + 1);
+  index->positions = (uint32_t *) (index->slots + nslots);
+
+  for (unsigned int i = 0; i < nlist; ++i)
+    add_object (index, list[i]->l_real, i, false);
+
+  /* Assign the ranges of the positions array.  The counts include
+     duplicates, which are removed when filling in the positions.  */
+  uint32_t start = 0;
+  for (size_t i = 0; i < nslots; ++i)
+    if (index->slots[i].hash != 0)
+      {
+	index->slots[i].start = start;
+	start += index->slots[i].count;
+	index->slots[i].count = 0;
+      }
+
+  for (unsigned int i = 0; i < nlist; ++i)
+    add_object (index, list[i]->l_real, i, true);
+
+  return index;
+}
+
+void
+_dl_scope_index_update (struct r_scope_elem *scope)
+{
+  if (TUNABLE_GET (glibc, rtld, scope_index, int32_t, NULL) == 0)
+    return;
+
+  struct dl_scope_index *old = scope->r_index;
+  unsigned int nlist = scope->r_nlist;
+  assert (old == NULL || old->nlist <= nlist);
+
+  /* Objects which are not covered by the index are searched without
+     it.  Building the index takes time proportional to the number of
+     symbols in the scope, so it is only rebuilt once enough objects
+     have been added.  */
+  if (old != NULL && nlist - old->nlist <= old->nlist / 4)
+    return;
+
+  struct dl_scope_index *index = build_index (scope->r_list, nlist);
+  if (index == NULL)
+    return;
+
+  if (__glibc_unlikely (GLRO(dl_debug_mask) & DL_DEBUG_SCOPES))
+    _dl_debug_printf ("\nsymbol index for global scope: %u objects\n",
+		      nlist);
+
+  /* Pairs with the acquire MO load in do_lookup_x.  */
+  atomic_store_release (&scope->r_index, index);
+  if (old != NULL && old->malloced)
+    _dl_scope_free (old);
+}
+
+void
+_dl_scope_index_truncate (struct r_scope_elem *scope, unsigned int first)
+{
+  /* The positions of the objects before FIRST do not change, so the
+     index remains valid for them.  The other objects are searched
+     without it until _dl_scope_index_update rebuilds it.  */
+  struct dl_scope_index *index = scope->r_index;
+  if (index != NULL && first < index->nlist)
+    atomic_store_relaxed (&index->nlist, first);
+}
+
+void
+_dl_scope_index_freeres (void)
+{
+  for (Lmid_t ns = 0; ns < GL(dl_nns); ++ns)
+    {
+      struct r_scope_elem *scope = GL(dl_ns)[ns]._ns_main_searchlist;
+      if (scope == NULL)
+	continue;
+      struct dl_scope_index *index = scope->r_index;
+      scope->r_index = NULL;
+      if (index != NULL && index->malloced)
+	free (index);
+    }
+}
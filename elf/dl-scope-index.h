@@ -0,0 +1,101 @@
+/* Symbol hash index for the global scope.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _DL_SCOPE_INDEX_H
+#define _DL_SCOPE_INDEX_H
+
+#include <ldsodefs.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* With the glibc.rtld.scope_index tunable, the global scope of each
+   namespace has an index which maps the GNU hash value of a symbol
+   name to the positions of the objects in the scope which define a
+   symbol with this hash value.  do_lookup_x uses it to skip the other
+   objects without checking their Bloom filters.
+
+   The index covers the first NLIST objects of the scope.  Objects
+   added to the scope by dlopen are searched in the usual way until
+   the index is rebuilt.  dlclose reduces NLIST to the position of the
+   first object it removes, and the positions of later objects which
+   remain in the index are ignored.  */
+
+struct dl_scope_index_slot
+{
+  /* GNU hash value with the least significant bit set, so that zero
+     marks unused slots.  */
+  uint32_t hash;
+
+  /* Range of the positions array for this hash value.  */
+  uint32_t start;
+  uint32_t count;
+};
+
+struct dl_scope_index
+{
+  /* Number of objects at the start of the scope covered by the
+     index.  */
+  unsigned int nlist;
+
+  /* True if the index can be deallocated with free.  The index
+     created at startup uses the minimal malloc.  */
+  bool malloced;
+
+  /* Number of slots minus one.  The number of slots is a power of
+     two.  */
+  uint32_t mask;
+  struct dl_scope_index_slot *slots;
+
+  /* Scope positions, in increasing order for each hash value.  */
+  uint32_t *positions;
+};
+
+/* Return the slot for the GNU hash value NEW_HASH in INDEX, or NULL
+   if no object in the index defines a symbol with this hash value.  */
+static inline const struct dl_scope_index_slot *
+_dl_scope_index_lookup (const struct dl_scope_index *index,
+			uint32_t new_hash)
+{
+  uint32_t hash = new_hash | 1;
+  for (uint32_t i = (hash >> 1) & index->mask; ;
+       i = (i + 1) & index->mask)
+    {
+      const struct dl_scope_index_slot *slot = &index->slots[i];
+      if (slot->hash == hash)
+	return slot;
+      if (slot->hash == 0)
+	return NULL;
+    }
+}
+
+/* Build or extend the index for SCOPE if the glibc.rtld.scope_index
+   tunable is set.  Called at startup and after objects have been
+   added to SCOPE.  Failures are ignored; they leave SCOPE with its
+   previous index.  Needs to be protected by the loader lock.  */
+void _dl_scope_index_update (struct r_scope_elem *scope) attribute_hidden;
+
+/* Limit the index of SCOPE to the objects before position FIRST,
+   before the objects starting at FIRST are removed from it.  Needs to
+   be protected by the loader lock.  */
+void _dl_scope_index_truncate (struct r_scope_elem *scope,
+			       unsigned int first) attribute_hidden;
+
+/* Called from __libc_freeres to deallocate the indexes.  */
+void _dl_scope_index_freeres (void) attribute_hidden;
+
+#endif /* _DL_SCOPE_INDEX_H */
@@ -21,6 +21,7 @@
 #include <libc-early-init.h>
 #include <libc-internal.h>
 #include <lowlevellock.h>
+#include <malloc/malloc-internal.h>
 #include <pthread_early_init.h>
 #include <sys/single_threaded.h>
 
@@ -46,4 +47,9 @@ __libc_early_init (_Bool initial)
 #if ENABLE_ELISION_SUPPORT
   __lll_elision_init ();
 #endif
+
+#ifdef SHARED
+  /* This may start the malloc helper threads, so it comes last.  */
+  __malloc_early_init (initial);
+#endif
 }
@@ -51,6 +51,7 @@
 #include <get-dynamic-info.h>
 #include <dl-execve.h>
 #include <dl-find_object.h>
+#include <dl-scope-index.h>
 #include <dl-audit-check.h>
 #include <dl-call_tls_init_tp.h>
 
@@ -2256,6 +2257,10 @@ dl_main (const ElfW(Phdr) *phdr,
      we need it in the memory handling later.  */
   GLRO(dl_initial_searchlist) = *GL(dl_ns)[LM_ID_BASE]._ns_main_searchlist;
 
+  /* Build the symbol hash index for the global scope, for use during
+     relocation.  */
+  _dl_scope_index_update (GL(dl_ns)[LM_ID_BASE]._ns_main_searchlist);
+
   /* Remember the last search directory added at startup, now that
      malloc will no longer be the one from dl-minimal.c.  As a side
      effect, this marks ld.so as initialized, so that the rtld_active
@@ -2288,6 +2293,9 @@ dl_main (const ElfW(Phdr) *phdr,
   /* If we are profiling we also must do lazy reloaction.  */
   GLRO(dl_lazy) |= consider_profiling;
 
+  if (__glibc_likely (state.mode == rtld_mode_normal))
+    _dl_reloc_cache_setup (main_map);
+
   if (GL(dl_ns)[LM_ID_BASE].libc_map != NULL)
     _dl_relocate_object (GL(dl_ns)[LM_ID_BASE].libc_map,
 			 GL(dl_ns)[LM_ID_BASE].libc_map->l_scope,
@@ -2325,6 +2333,8 @@ dl_main (const ElfW(Phdr) *phdr,
   }
   rtld_timer_stop (&relocate_time, start);
 
+  _dl_reloc_cache_finish ();
+
   /* Now enable profiling if needed.  Like the previous call,
      this has to go here because the calls it makes should use the
      rtld versions of the functions (particularly calloc()), but it
@@ -0,0 +1,68 @@
+/* Test the library name hash function for ld.so.cache.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <dl-cache.h>
+#include <support/check.h>
+
+/* The hash table in the cache is only usable if names which are equal
+   according to _dl_cache_libcmp have the same hash value.  */
+static const char *const names[] =
+  {
+    "libc.so.6",
+    "libc.so.06",
+    "libc.so.006",
+    "libc.so.60",
+    "libc.so.7",
+    "libc.so",
+    "libc.so.6.0",
+    "libc.so.6.00",
+    "libm.so.6",
+    "libstdc++.so.6",
+    "libstdc++.so.6.0.30",
+    "libstdc++.so.006.000.030",
+    "libfoo1.so",
+    "libfoo01.so",
+    "libfoo10.so",
+    "libfoo.so.1",
+    "lib1foo.so",
+    "",
+  };
+
+static int
+do_test (void)
+{
+  for (size_t i = 0; i < array_length (names); ++i)
+    for (size_t j = 0; j < array_length (names); ++j)
+      {
+        bool equal = _dl_cache_libcmp (names[i], names[j]) == 0;
+        bool same_hash = (_dl_cache_libhash (names[i])
+                          == _dl_cache_libhash (names[j]));
+        if (equal && !same_hash)
+          FAIL ("\"%s\" and \"%s\" are equal but have different hashes",
+                names[i], names[j]);
+        /* Not required, but the hash function should distinguish
+           these names.  */
+        if (!equal && same_hash)
+          FAIL ("\"%s\" and \"%s\" have the same hash", names[i], names[j]);
+      }
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,240 @@
+/* Test the dlopen directory cache (glibc.rtld.dir_cache).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The program has an RPATH with the directories DIR_A and DIR_B.  The
+   test runs with glibc.rtld.dir_cache=1, or with 2 if TRUSTED is
+   defined, and with LD_DEBUG=libs, writing to DEBUG_OUTPUT.  */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <support/check.h>
+#include <support/descriptors.h>
+#include <support/support.h>
+#include <support/xdlfcn.h>
+#include <support/xstdio.h>
+#include <support/xunistd.h>
+
+#ifndef TRUSTED
+# define TRUSTED 0
+# define DIR_PREFIX "tst-dl-dir-cache"
+#endif
+
+static const char dir_a[] = PFX DIR_PREFIX "-a";
+static const char dir_b[] = PFX DIR_PREFIX "-b";
+static const char debug_output[] = PFX DIR_PREFIX ".debug";
+
+/* Names of the shared objects created by the test.  */
+static const char *const names[] = { "x.so", "y.so", "z.so" };
+
+/* Set the modification time of DIR to SECONDS seconds in the past
+   relative to the start of the test.  The directory cache does not use
+   directories which have been modified recently.  */
+static time_t start_time;
+static void
+set_mtime (const char *dir, int seconds)
+{
+  struct timespec times[2] =
+    {
+      { start_time - seconds, 0 },
+      { start_time - seconds, 0 },
+    };
+  if (utimensat (AT_FDCWD, dir, times, 0) != 0)
+    FAIL_EXIT1 ("utimensat (\"%s\"): %m", dir);
+}
+
+/* Copy firstobj.so to NAME in DIR.  */
+static void
+add_object (const char *dir, const char *name)
+{
+  char *path = xasprintf ("%s/%s", dir, name);
+  support_copy_file (PFX "firstobj.so", path);
+  free (path);
+}
+
+static void
+remove_objects (const char *dir)
+{
+  for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+    {
+      char *path = xasprintf ("%s/%s", dir, names[i]);
+      unlink (path);
+      free (path);
+    }
+}
+
+/* Open NAME with dlopen.  If DIR is NULL, check that this fails.
+   Otherwise, check that the object is loaded from DIR.  */
+static void
+check_open (const char *name, const char *dir)
+{
+  void *handle = dlopen (name, RTLD_NOW);
+  if (dir == NULL)
+    {
+      if (handle != NULL)
+	FAIL ("dlopen (\"%s\") succeeded unexpectedly", name);
+      else
+	printf ("info: dlopen (\"%s\") failed: %s\n", name, dlerror ());
+      return;
+    }
+  if (handle == NULL)
+    {
+      FAIL ("dlopen (\"%s\") failed: %s", name, dlerror ());
+      return;
+    }
+
+  char origin[PATH_MAX];
+  TEST_COMPARE (dlinfo (handle, RTLD_DI_ORIGIN, origin), 0);
+  char *expected = realpath (dir, NULL);
+  TEST_VERIFY_EXIT (expected != NULL);
+  if (strcmp (origin, expected) != 0)
+    FAIL ("dlopen (\"%s\") loaded the object from %s, expected %s",
+	  name, origin, expected);
+  else
+    printf ("info: dlopen (\"%s\") loaded the object from %s\n",
+	    name, origin);
+  free (expected);
+  xdlclose (handle);
+}
+
+/* Return the name of the file with the debugging output.  The dynamic
+   linker adds its process ID, which is that of the parent process if
+   the test runs in a subprocess.  */
+static char *
+debug_output_path (void)
+{
+  char *path = xasprintf ("%s.%d", debug_output, (int) getpid ());
+  if (access (path, F_OK) != 0)
+    {
+      free (path);
+      path = xasprintf ("%s.%d", debug_output, (int) getppid ());
+    }
+  return path;
+}
+
+/* Check that the debugging output reports that the directory cache
+   has been used to skip NAME in DIR.  */
+static void
+check_skipped (const char *dir, const char *name)
+{
+  char *path = debug_output_path ();
+  char *expected = xasprintf ("%s/%s (not in directory cache)",
+			      strrchr (dir, '/'), name);
+  FILE *fp = xfopen (path, "r");
+  bool found = false;
+  char *line = NULL;
+  size_t linelen = 0;
+  while (xgetline (&line, &linelen, fp) > 0)
+    if (strstr (line, "skipping file=") != NULL
+	&& strstr (line, expected) != NULL)
+      found = true;
+  xfclose (fp);
+  if (!found)
+    FAIL ("no skipping line for %s in %s", expected + 1, path);
+  free (line);
+  free (expected);
+  free (path);
+}
+
+static int
+do_test (void)
+{
+  start_time = time (NULL);
+  const char *dirs[] = { dir_a, dir_b };
+  for (int i = 0; i < 2; ++i)
+    {
+      if (mkdir (dirs[i], 0777) != 0 && errno != EEXIST)
+	FAIL_EXIT1 ("mkdir (\"%s\"): %m", dirs[i]);
+      remove_objects (dirs[i]);
+    }
+
+  add_object (dir_b, "x.so");
+  set_mtime (dir_a, 1000);
+  set_mtime (dir_b, 1000);
+
+  /* This creates the cache entries for both directories.  The cache
+     does not keep any descriptors open.  */
+  struct support_descriptors *descriptors = support_descriptors_list ();
+  check_open ("x.so", dir_b);
+  check_open ("y.so", NULL);
+  support_descriptors_check (descriptors);
+  support_descriptors_free (descriptors);
+
+  /* The cache has been used to skip both directories for y.so.  */
+  check_skipped (dir_a, "y.so");
+  check_skipped (dir_b, "y.so");
+
+  /* A file added to a cached directory is found.  */
+  add_object (dir_a, "z.so");
+  set_mtime (dir_a, 900);
+  check_open ("z.so", dir_a);
+
+  /* A file which has not been found before is found after it has been
+     added.  In the trusted mode, this happens by revalidating the
+     cache after the failed search.  */
+  add_object (dir_b, "y.so");
+  set_mtime (dir_b, 900);
+  check_open ("y.so", dir_b);
+
+  /* A file added to a directory earlier in the search path takes
+     precedence, except in the trusted mode, where the cache is not
+     checked if the file is found in a later directory.  */
+  add_object (dir_a, "x.so");
+  set_mtime (dir_a, 800);
+  check_open ("x.so", TRUSTED ? dir_b : dir_a);
+
+  /* Removed files are not found.  */
+  remove_objects (dir_a);
+  remove_objects (dir_b);
+  set_mtime (dir_a, 700);
+  set_mtime (dir_b, 700);
+  check_open ("x.so", NULL);
+  check_open ("z.so", NULL);
+
+  /* A directory which is replaced by renaming is noticed, although the
+     cached directory itself has not been modified.  */
+  char *dir_old = xasprintf ("%s-old", dir_a);
+  char *dir_new = xasprintf ("%s-new", dir_a);
+  xmkdir (dir_new, 0777);
+  add_object (dir_new, "z.so");
+  set_mtime (dir_new, 600);
+  TEST_COMPARE (rename (dir_a, dir_old), 0);
+  TEST_COMPARE (rename (dir_new, dir_a), 0);
+  check_open ("z.so", dir_a);
+  remove_objects (dir_a);
+  TEST_COMPARE (rmdir (dir_old), 0);
+  free (dir_new);
+  free (dir_old);
+
+  TEST_COMPARE (rmdir (dir_a), 0);
+  TEST_COMPARE (rmdir (dir_b), 0);
+  char *path = debug_output_path ();
+  xunlink (path);
+  free (path);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,10 @@
+/* Module loaded at startup by tst-dl-prefetch.  */
+
+/* Data in the writable segment.  */
+int tst_dl_prefetch_data = 1;
+
+int
+tst_dl_prefetch_mod1 (void)
+{
+  return tst_dl_prefetch_data;
+}
@@ -0,0 +1,13 @@
+/* Module loaded with dlopen by tst-dl-prefetch.  */
+
+extern int tst_dl_prefetch_mod1 (void);
+
+/* Zero-initialized data, in pages beyond the end of the file.  */
+static char buffer[65536];
+
+int
+tst_dl_prefetch_mod2 (void)
+{
+  buffer[sizeof (buffer) - 1] = 1;
+  return tst_dl_prefetch_mod1 () + buffer[sizeof (buffer) - 1];
+}
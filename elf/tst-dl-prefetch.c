@@ -0,0 +1,117 @@
+/* Test loading objects with the glibc.rtld.prefetch tunable.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/capture_subprocess.h>
+#include <support/check.h>
+#include <support/xdlfcn.h>
+
+/* Defined in tst-dl-prefetch-mod1.so, which is loaded at startup.  */
+extern int tst_dl_prefetch_mod1 (void);
+
+static int restart;
+#define CMDLINE_OPTIONS \
+  { "restart", no_argument, &restart, 1 },
+
+/* Load the objects, which must work with and without prefetching.  */
+static int
+handle_restart (void)
+{
+  TEST_COMPARE (tst_dl_prefetch_mod1 (), 1);
+
+  void *handle = xdlopen ("tst-dl-prefetch-mod2.so", RTLD_NOW);
+  int (*mod2) (void) = xdlsym (handle, "tst_dl_prefetch_mod2");
+  TEST_COMPARE (mod2 (), 2);
+  xdlclose (handle);
+
+  return 0;
+}
+
+/* Run the test program with the tunable set to VALUE, and check
+   whether the dynamic linker reports prefetching the objects.  */
+static void
+run (char **spargv, int value)
+{
+  char tunables[64];
+  snprintf (tunables, sizeof (tunables),
+            "GLIBC_TUNABLES=glibc.rtld.prefetch=%d", value);
+  char *envp[] = { tunables, (char *) "LD_DEBUG=files", NULL };
+  struct support_capture_subprocess result
+    = support_capture_subprogram (spargv[0], spargv, envp);
+  support_capture_subprocess_check (&result, "tst-dl-prefetch", 0,
+                                    sc_allow_stderr);
+
+  /* The object loaded at startup, and the one loaded with dlopen.  */
+  static const char *const objects[] =
+    { "tst-dl-prefetch-mod1.so", "tst-dl-prefetch-mod2.so" };
+  for (int i = 0; i < 2; ++i)
+    {
+      bool found = false;
+      for (const char *p = result.err.buffer;
+           (p = strstr (p, "prefetching file=")) != NULL; ++p)
+        {
+          const char *name = strstr (p, objects[i]);
+          const char *eol = strchr (p, '\n');
+          if (name != NULL && (eol == NULL || name < eol))
+            found = true;
+        }
+      if (found != (value != 0))
+        FAIL ("%s: prefetching %s with glibc.rtld.prefetch=%d in:\n%s",
+              objects[i], found ? "reported" : "not reported", value,
+              result.err.buffer);
+    }
+  support_capture_subprocess_free (&result);
+}
+
+static int
+do_test (int argc, char *argv[])
+{
+  /* We must have either:
+     - One or four parameters left if called initially:
+       + path to ld.so         optional
+       + "--library-path"      optional
+       + the library path      optional
+       + the application name
+     - One parameter if called through re-execution.  */
+  TEST_VERIFY_EXIT (argc == 1 || argc == 2 || argc == 5);
+
+  if (restart)
+    return handle_restart ();
+
+  char *spargv[10];
+  {
+    int i = 0;
+    for (; i < argc - 1; i++)
+      spargv[i] = argv[i + 1];
+    spargv[i++] = (char *) "--direct";
+    spargv[i++] = (char *) "--restart";
+    spargv[i] = NULL;
+  }
+
+  run (spargv, 1);
+  run (spargv, 0);
+
+  return 0;
+}
+
+#define TEST_FUNCTION_ARGV do_test
+#include <support/test-driver.c>
@@ -0,0 +1,15 @@
+/* First module for tst-reloc-cache.  */
+
+int tst_reloc_cache_data = 1;
+
+int
+tst_reloc_cache_interposed (void)
+{
+  return 1;
+}
+
+int
+tst_reloc_cache_mod1 (void)
+{
+  return 10;
+}
@@ -0,0 +1,26 @@
+/* Second module for tst-reloc-cache.  */
+
+#include <stddef.h>
+
+extern int tst_reloc_cache_data;
+extern int tst_reloc_cache_mod1 (void);
+
+/* Interposed by the definition in tst-reloc-cache-mod1.so, which
+   comes first in the search order.  */
+int
+tst_reloc_cache_interposed (void)
+{
+  return 2;
+}
+
+/* Not defined anywhere.  */
+extern int tst_reloc_cache_missing (void) __attribute__ ((weak));
+
+int
+tst_reloc_cache_mod2 (void)
+{
+  if (tst_reloc_cache_missing != NULL)
+    return -1;
+  return tst_reloc_cache_interposed () + tst_reloc_cache_data
+    + tst_reloc_cache_mod1 ();
+}
@@ -0,0 +1,210 @@
+/* Test the relocation cache (glibc.rtld.reloc_cache tunable).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/capture_subprocess.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/temp_file.h>
+#include <support/xdirent.h>
+#include <support/xunistd.h>
+#include <sys/stat.h>
+
+extern int tst_reloc_cache_data;
+extern int tst_reloc_cache_interposed (void);
+extern int tst_reloc_cache_mod2 (void);
+
+static int restart;
+#define CMDLINE_OPTIONS \
+  { "restart", no_argument, &restart, 1 },
+
+/* Check the symbol bindings, which must be the same with and without
+   the cache.  */
+static int
+handle_restart (void)
+{
+  TEST_COMPARE (tst_reloc_cache_data, 1);
+  TEST_COMPARE (tst_reloc_cache_interposed (), 1);
+  TEST_COMPARE (tst_reloc_cache_mod2 (), 12);
+  return 0;
+}
+
+/* The directory passed to the subprocesses.  */
+static char *cache_dir;
+
+/* Return the path of the only cache file in cache_dir, or NULL if
+   there is none.  */
+static char *
+cache_file (void)
+{
+  DIR *dir = xopendir (cache_dir);
+  char *result = NULL;
+  struct dirent *e;
+  while ((e = xreaddir (dir)) != NULL)
+    if (e->d_name[0] != '.')
+      {
+        TEST_VERIFY (result == NULL);
+        TEST_VERIFY (strstr (e->d_name, ".relocs") != NULL);
+        free (result);
+        result = xasprintf ("%s/%s", cache_dir, e->d_name);
+      }
+  xclosedir (dir);
+  return result;
+}
+
+/* XOR the symbol index in the defining object of all entries in the
+   cache file at PATH which name a definition with MASK.  The layout
+   must match the file format in dl-reloc-cache.c: a 32-byte header
+   with the object count at offset 20, 56 bytes for each object, and
+   then the entries.  */
+static void
+corrupt_defsymidx (const char *path, uint32_t mask)
+{
+  int fd = xopen (path, O_RDWR, 0);
+  struct stat64 st;
+  xfstat64 (fd, &st);
+  unsigned char *buf = xmalloc (st.st_size);
+  TEST_COMPARE (pread64 (fd, buf, st.st_size, 0), st.st_size);
+  uint32_t nobjects;
+  memcpy (&nobjects, buf + 20, sizeof (nobjects));
+  int changed = 0;
+  for (off64_t off = 32 + nobjects * 56; off + 16 <= st.st_size; off += 16)
+    {
+      /* The symbol index, type class, defining object, and symbol
+         index in the defining object.  */
+      uint32_t entry[4];
+      memcpy (entry, buf + off, sizeof (entry));
+      if (entry[2] < nobjects)
+        {
+          entry[3] ^= mask;
+          memcpy (buf + off, entry, sizeof (entry));
+          ++changed;
+        }
+    }
+  TEST_VERIFY (changed > 0);
+  TEST_COMPARE (pwrite64 (fd, buf, st.st_size, 0), st.st_size);
+  xclose (fd);
+  free (buf);
+}
+
+/* Run the test program with the cache and check that MESSAGE is
+   printed by the dynamic linker.  */
+static void
+run (char **spargv, const char *message)
+{
+  char *tunables = xasprintf ("GLIBC_TUNABLES=glibc.rtld.reloc_cache=%s",
+                              cache_dir);
+  char *envp[] = { tunables, (char *) "LD_DEBUG=reloc", NULL };
+  struct support_capture_subprocess result
+    = support_capture_subprogram (spargv[0], spargv, envp);
+  support_capture_subprocess_check (&result, "tst-reloc-cache", 0,
+                                    sc_allow_stderr);
+  if (strstr (result.err.buffer, message) == NULL)
+    FAIL ("message \"%s\" not found in output:\n%s",
+          message, result.err.buffer);
+  support_capture_subprocess_free (&result);
+  free (tunables);
+}
+
+static int
+do_test (int argc, char *argv[])
+{
+  /* We must have either:
+     - One or four parameters left if called initially:
+       + path to ld.so         optional
+       + "--library-path"      optional
+       + the library path      optional
+       + the application name
+     - One parameter if called through re-execution.  */
+  TEST_VERIFY_EXIT (argc == 1 || argc == 2 || argc == 5);
+
+  if (restart)
+    return handle_restart ();
+
+  char *spargv[10];
+  {
+    int i = 0;
+    for (; i < argc - 1; i++)
+      spargv[i] = argv[i + 1];
+    spargv[i++] = (char *) "--direct";
+    spargv[i++] = (char *) "--restart";
+    spargv[i] = NULL;
+  }
+
+  cache_dir = support_create_temp_directory ("tst-reloc-cache-");
+
+  /* The first run records the lookups, and the second one uses
+     them.  */
+  run (spargv, "relocation cache: wrote");
+  char *path = cache_file ();
+  TEST_VERIFY_EXIT (path != NULL);
+  run (spargv, "relocation cache: using");
+  run (spargv, "relocation cache: using");
+
+  /* A file which does not match the lookups is removed, but the
+     program still works.  Overwrite the symbol index of the last
+     entry.  */
+  {
+    int fd = xopen (path, O_RDWR, 0);
+    struct stat64 st;
+    xfstat64 (fd, &st);
+    static const unsigned char garbage[4] = { 0xff, 0xff, 0xff, 0xff };
+    TEST_COMPARE (pwrite64 (fd, garbage, sizeof (garbage), st.st_size - 16),
+                  sizeof (garbage));
+    xclose (fd);
+  }
+  run (spargv, "relocation cache: discarding");
+  TEST_VERIFY (cache_file () == NULL);
+  run (spargv, "relocation cache: wrote");
+  run (spargv, "relocation cache: using");
+
+  /* Symbol indices outside the symbol table, or for other symbols,
+     are not used.  The symbols are looked up instead, which
+     handle_restart checks.  */
+  corrupt_defsymidx (path, 0xffff0000);
+  run (spargv, "relocation cache: discarding");
+  TEST_VERIFY (cache_file () == NULL);
+  run (spargv, "relocation cache: wrote");
+  corrupt_defsymidx (path, 1);
+  run (spargv, "relocation cache: discarding");
+  TEST_VERIFY (cache_file () == NULL);
+  run (spargv, "relocation cache: wrote");
+
+  /* Files which other users could have written are ignored.  */
+  TEST_COMPARE (chmod (path, 0620), 0);
+  run (spargv, "relocation cache: wrote");
+  run (spargv, "relocation cache: using");
+
+  /* Truncated files are ignored and replaced.  */
+  TEST_COMPARE (truncate64 (path, 40), 0);
+  run (spargv, "relocation cache: wrote");
+  run (spargv, "relocation cache: using");
+
+  xunlink (path);
+  free (path);
+  return 0;
+}
+
+#define TEST_FUNCTION_ARGV do_test
+#include <support/test-driver.c>
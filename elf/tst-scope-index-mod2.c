@@ -0,0 +1,37 @@
+/* Test module for tst-scope-index.  Loaded at startup.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+int
+tst_scope_index_dup (void)
+{
+  return 2;
+}
+
+int
+tst_scope_index_mod2 (void)
+{
+  return 2;
+}
+
+/* Weak definitions are overridden by global definitions in later
+   objects.  */
+__attribute__ ((weak)) int
+tst_scope_index_weak (void)
+{
+  return 2;
+}
@@ -0,0 +1,47 @@
+/* Test module for tst-scope-index.  Loaded with dlopen.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+extern int tst_scope_index_mod1 (void);
+extern int tst_scope_index_mod2 (void);
+
+int
+tst_scope_index_dup (void)
+{
+  return 3;
+}
+
+int
+tst_scope_index_weak (void)
+{
+  return 3;
+}
+
+/* These functions use lazy binding to symbols defined in startup
+   objects.  */
+
+int
+tst_scope_index_mod3 (void)
+{
+  return tst_scope_index_mod2 () + 1;
+}
+
+int
+tst_scope_index_late (void)
+{
+  return tst_scope_index_mod1 () + 10;
+}
@@ -0,0 +1,94 @@
+/* Test symbol lookup with the global scope index (glibc.rtld.scope_index).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The lookup results must be the same as without the index, both for
+   the objects covered by the index and for the objects added by
+   dlopen, and after dlclose has removed objects from the global
+   scope.  */
+
+#include <dlfcn.h>
+#include <stddef.h>
+#include <support/check.h>
+#include <support/xdlfcn.h>
+
+/* Defined in tst-scope-index-mod1.so and tst-scope-index-mod2.so,
+   which are loaded at startup in this order.  */
+extern int tst_scope_index_dup (void);
+extern int tst_scope_index_mod2 (void);
+
+/* Call the function NAME found with dlsym (HANDLE, NAME).  Return -1
+   if it is not found.  */
+static int
+call (void *handle, const char *name)
+{
+  int (*fptr) (void) = dlsym (handle, name);
+  if (fptr == NULL)
+    return -1;
+  return fptr ();
+}
+
+static void
+check_startup_objects (void)
+{
+  TEST_COMPARE (tst_scope_index_dup (), 1);
+  TEST_COMPARE (tst_scope_index_mod2 (), 2);
+  TEST_COMPARE (call (RTLD_DEFAULT, "tst_scope_index_dup"), 1);
+  TEST_COMPARE (call (RTLD_DEFAULT, "tst_scope_index_mod1"), 1);
+  TEST_COMPARE (call (RTLD_DEFAULT, "tst_scope_index_mod2"), 2);
+  TEST_COMPARE (call (RTLD_DEFAULT, "tst_scope_index_weak"), 2);
+  TEST_COMPARE (call (RTLD_NEXT, "tst_scope_index_dup"), 1);
+  TEST_VERIFY (dlsym (RTLD_DEFAULT, "tst_scope_index_missing") == NULL);
+}
+
+static int
+do_test (void)
+{
+  check_startup_objects ();
+  TEST_VERIFY (dlsym (RTLD_DEFAULT, "tst_scope_index_mod3") == NULL);
+
+  /* This object is added to the global scope after the objects
+     covered by the index.  Lookups through the handle do not prevent
+     unloading it below.  */
+  void *mod3 = xdlopen ("tst-scope-index-mod3.so", RTLD_LAZY | RTLD_GLOBAL);
+  check_startup_objects ();
+  TEST_COMPARE (call (mod3, "tst_scope_index_mod3"), 3);
+  TEST_COMPARE (call (mod3, "tst_scope_index_dup"), 3);
+
+  /* Adding more objects causes the index to be rebuilt.  */
+  void *mod4 = xdlopen ("tst-scope-index-mod4.so", RTLD_NOW | RTLD_GLOBAL);
+  check_startup_objects ();
+  TEST_COMPARE (call (mod4, "tst_scope_index_mod4"), 4);
+  TEST_COMPARE (call (mod3, "tst_scope_index_late"), 11);
+
+  /* Removing an object from the middle of the global scope changes
+     the positions of the objects after it.  The index then only
+     covers the objects before it, and is not rebuilt.  */
+  xdlclose (mod3);
+  TEST_VERIFY (dlopen ("tst-scope-index-mod3.so", RTLD_NOLOAD) == NULL);
+  check_startup_objects ();
+  TEST_VERIFY (dlsym (RTLD_DEFAULT, "tst_scope_index_mod3") == NULL);
+  TEST_COMPARE (call (RTLD_DEFAULT, "tst_scope_index_mod4"), 4);
+  TEST_COMPARE (call (mod4, "tst_scope_index_dup"), 4);
+
+  xdlclose (mod4);
+  check_startup_objects ();
+
+  return 0;
+}
+
+#include <support/test-driver.c>
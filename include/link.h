@@ -69,6 +69,8 @@ struct r_scope_elem
   struct link_map **r_list;
   /* Number of entries in the scope.  */
   unsigned int r_nlist;
+  /* Symbol hash index for the scope, or NULL.  See dl-scope-index.h.  */
+  struct dl_scope_index *r_index;
 };
 
 
@@ -306,6 +308,14 @@ struct link_map
       const ElfW(Sym) *ret;
     } l_lookup_cache;
 
+    /* Used by the relocation cache at startup (see dl-reloc-cache.c).
+       The next recorded or replayed lookup, the end of the lookups for
+       this object, and the position of the object in the list of
+       initially loaded objects plus one (zero if not known).  */
+    struct reloc_cache_entry *l_reloc_cache_next;
+    struct reloc_cache_entry *l_reloc_cache_end;
+    unsigned int l_reloc_cache_index;
+
     /* Thread-local storage related info.  */
 
     /* Start of the initialization image.  */
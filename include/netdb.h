@@ -287,6 +287,10 @@ DECLARE_NSS_PROTOTYPES (hesiod)
 
 #undef DECLARE_NSS_PROTOTYPES
 
+/* Reset the state of the getaddrinfo_a DNS engine in a new
+   subprocess.  */
+extern void __gai_dns_fork_subprocess (void) attribute_hidden;
+
 #endif
 
 #endif /* !_NETDB_H */
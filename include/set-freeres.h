@@ -56,6 +56,7 @@ extern void __libc_regcomp_freemem (void) attribute_hidden;
 extern void __libc_atfork_freemem (void) attribute_hidden;
 extern void __libc_resolv_conf_freemem (void) attribute_hidden;
 extern void __res_thread_freeres (void) attribute_hidden;
+extern void __res_cache_freemem (void) attribute_hidden;
 extern void __libc_printf_freemem (void) attribute_hidden;
 extern void __libc_fmtmsg_freemem (void) attribute_hidden;
 extern void __libc_setenv_freemem (void) attribute_hidden;
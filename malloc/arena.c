@@ -17,7 +17,12 @@
    not, see <https://www.gnu.org/licenses/>.  */
 
 #include <stdbool.h>
+#include <list.h>
 #include <setvmaname.h>
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+# include <pthreadP.h>
+# include <time.h>
+#endif
 
 #define TUNABLE_NAMESPACE malloc
 #include <elf/dl-tunables.h>
@@ -55,6 +60,22 @@ heap_max_size (void)
   return mp_.hp_pagesize == 0 ? HEAP_MAX_SIZE : mp_.hp_pagesize * 4;
 }
 
+/* If transparent huge pages are used (glibc.malloc.hugetlb=1 with the
+   madvise THP mode), heaps are grown and trimmed in multiples of the
+   huge page size, so that the kernel does not have to split huge pages
+   at the top of a heap.  Return the granularity for a heap with page
+   size PAGESIZE.  */
+
+static inline size_t
+heap_thp_unit (size_t pagesize)
+{
+#ifdef MADV_HUGEPAGE
+  if (mp_.thp_pagesize > pagesize && mp_.thp_pagesize < heap_max_size ())
+    return mp_.thp_pagesize;
+#endif
+  return pagesize;
+}
+
 /***************************************************************************/
 
 #define top(ar_ptr) ((ar_ptr)->top)
@@ -87,6 +108,54 @@ extern int sanity_check_heap_info_alignment[(sizeof (heap_info)
 
 static __thread mstate thread_arena attribute_tls_model_ie;
 
+/* Event counters of the current thread.  Only the thread itself
+   updates them, using relaxed atomic stores, so that other threads can
+   read them in __malloc_info_json.  LIST links them into
+   thread_stats_list once the thread has been attached to an arena.  */
+struct malloc_thread_stats
+{
+  struct malloc_counters counters;
+  list_t list;
+};
+
+static __thread struct malloc_thread_stats thread_stats
+  attribute_tls_model_ie;
+
+/* Count an event of kind FIELD in the current thread.  */
+#define thread_stats_inc(field)						      \
+  atomic_store_relaxed (&thread_stats.counters.field,			      \
+			thread_stats.counters.field + 1)
+
+/* Count a thread cache event of kind FIELD in the current thread, if
+   glibc.malloc.tcache_counters is set.  This keeps the store out of
+   the fast paths of malloc and calloc by default.  */
+#define tcache_stats_inc(field)						      \
+  do {									      \
+    if (__glibc_unlikely (mp_.tcache_counters != 0))			      \
+      thread_stats_inc (field);						      \
+  } while (0)
+
+/* Count an event of kind FIELD in the current thread and in arena AV,
+   which must be locked by the current thread.  */
+#define arena_stats_inc(av, field)					      \
+  do {									      \
+    atomic_store_relaxed (&(av)->counters.field, (av)->counters.field + 1); \
+    thread_stats_inc (field);						      \
+  } while (0)
+
+/* Add the counters in *C to *SUM.  */
+static void
+malloc_counters_add (struct malloc_counters *sum,
+		     const struct malloc_counters *c)
+{
+  sum->tcache_hits += atomic_load_relaxed (&c->tcache_hits);
+  sum->tcache_misses += atomic_load_relaxed (&c->tcache_misses);
+  sum->fastbin_hits += atomic_load_relaxed (&c->fastbin_hits);
+  sum->sysmalloc_calls += atomic_load_relaxed (&c->sysmalloc_calls);
+  sum->mmap_chunks += atomic_load_relaxed (&c->mmap_chunks);
+  sum->lock_contentions += atomic_load_relaxed (&c->lock_contentions);
+}
+
 /* Arena free list.  free_list_lock synchronizes access to the
    free_list variable below, and the next_free and attached_threads
    members of struct malloc_state objects.  No other locks must be
@@ -98,6 +167,36 @@ static size_t narenas = 1;
 #endif
 static mstate free_list;
 
+/* The counters of the threads attached to an arena, and the sums of
+   the counters of the threads which have exited.  free_list_lock
+   synchronizes access to both.  */
+static LIST_HEAD (thread_stats_list);
+static struct malloc_counters exited_thread_counters;
+
+/* Link the counters of the current thread into thread_stats_list.
+   Must be called while free_list_lock is held.  */
+static void
+thread_stats_register (void)
+{
+  if (thread_stats.list.next == NULL)
+    list_add (&thread_stats.list, &thread_stats_list);
+}
+
+/* Move the counters of the exiting current thread to
+   exited_thread_counters.  Must be called while free_list_lock is
+   held.  */
+static void
+thread_stats_exit (void)
+{
+  malloc_counters_add (&exited_thread_counters, &thread_stats.counters);
+  memset (&thread_stats.counters, 0, sizeof (thread_stats.counters));
+  if (thread_stats.list.next != NULL)
+    list_del (&thread_stats.list);
+  /* Do not link the counters again if the thread allocates memory
+     after this point.  */
+  INIT_LIST_HEAD (&thread_stats.list);
+}
+
 /* list_lock prevents concurrent writes to the next member of struct
    malloc_state objects.
 
@@ -112,6 +211,34 @@ static mstate free_list;
    acquired.  */
 __libc_lock_define_initialized (static, list_lock);
 
+/* Arenas indexed by CPU number, used instead of thread_arena when the
+   glibc.malloc.percpu tunable is enabled.  The array is allocated by
+   ptmalloc_init and has percpu_arenas_count entries; CPU numbers beyond
+   that wrap around.  Entries are only ever set once, under
+   percpu_arenas_lock, and are read with acquire MO.  */
+#if IS_IN (libc)
+static mstate *percpu_arenas;
+static size_t percpu_arenas_count;
+__libc_lock_define_initialized (static, percpu_arenas_lock);
+#endif
+
+/* State of the background purge thread.  If glibc.malloc.purge_interval
+   is set, the thread is started during the early initialization of libc,
+   and again in the child after fork.  It is never started from malloc
+   or free, which can be called with internal locks held that
+   pthread_create needs.  Accessed with relaxed MO.  */
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+enum
+  {
+    purge_stopped,
+    purge_requested,
+    purge_starting,
+    purge_running,
+    purge_failed,
+  };
+static int purge_thread_state;
+#endif
+
 /* Already initialized? */
 static bool __malloc_initialized = false;
 
@@ -124,20 +251,80 @@ static bool __malloc_initialized = false;
    once over the circularly linked list of arenas.  If no arena is
    readily available, create a new one.  In this latter case, `size'
    is just a hint as to how much memory will be required immediately
-   in the new arena. */
+   in the new arena.
+
+   If glibc.malloc.percpu is enabled, the arena is instead selected by
+   the CPU the thread is currently running on (see arena_get_percpu).  */
 
 #define arena_get(ptr, size) do { \
-      ptr = thread_arena;						      \
-      arena_lock (ptr, size);						      \
+      if (__glibc_unlikely (mp_.percpu))				      \
+        ptr = arena_get_percpu (size);					      \
+      else								      \
+        {								      \
+          ptr = thread_arena;						      \
+          arena_lock (ptr, size);					      \
+        }								      \
   } while (0)
 
 #define arena_lock(ptr, size) do {					      \
       if (ptr)								      \
-        __libc_lock_lock (ptr->mutex);					      \
+        ptr = arena_lock_alloc (ptr);					      \
       else								      \
         ptr = arena_get2 ((size), NULL);				      \
   } while (0)
 
+/* Count a contended acquisition of the lock of arena AV.  */
+static inline void
+arena_mutex_contended (mstate av)
+{
+  atomic_fetch_add_relaxed (&av->counters.lock_contentions, 1);
+  thread_stats_inc (lock_contentions);
+}
+
+/* Spin on the contended lock of arena AV before sleeping on it, like
+   pthread_mutex_lock does for PTHREAD_MUTEX_ADAPTIVE_NP: for at most
+   glibc.malloc.arena_spin iterations, and about twice as many as
+   recent acquisitions of the lock needed.  Return true if the lock
+   has been acquired.  */
+static bool
+arena_mutex_spin (mstate av)
+{
+  if (mp_.arena_spin == 0)
+    return false;
+
+  int spins = atomic_load_relaxed (&av->spins);
+  int max_cnt = MIN (mp_.arena_spin, spins * 2 + 10);
+  int cnt = 0;
+  bool locked = true;
+  do
+    {
+      if (++cnt >= max_cnt)
+	{
+	  locked = false;
+	  break;
+	}
+      atomic_spin_nop ();
+    }
+  while (atomic_load_relaxed (&av->mutex) != 0
+	 || __libc_lock_trylock (av->mutex) != 0);
+
+  atomic_store_relaxed (&av->spins, spins + (cnt - spins) / 8);
+  return locked;
+}
+
+/* Acquire the lock of arena AV, counting the acquisitions which have
+   to wait for another thread.  */
+static __always_inline void
+arena_mutex_lock (mstate av)
+{
+  if (__glibc_unlikely (__libc_lock_trylock (av->mutex) != 0))
+    {
+      arena_mutex_contended (av);
+      if (!arena_mutex_spin (av))
+	__libc_lock_lock (av->mutex);
+    }
+}
+
 /* find the heap and corresponding arena for a given ptr */
 
 static inline heap_info *
@@ -177,11 +364,18 @@ __malloc_fork_lock_parent (void)
 
   for (mstate ar_ptr = &main_arena;; )
     {
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
       ar_ptr = ar_ptr->next;
       if (ar_ptr == &main_arena)
         break;
     }
+
+  if (slab_base != NULL)
+    slab_fork_lock ();
+#if IS_IN (libc)
+  if (profile_filter != NULL)
+    profile_fork_lock ();
+#endif
 }
 
 void
@@ -190,6 +384,13 @@ __malloc_fork_unlock_parent (void)
   if (!__malloc_initialized)
     return;
 
+#if IS_IN (libc)
+  if (profile_filter != NULL)
+    profile_fork_unlock_parent ();
+#endif
+  if (slab_base != NULL)
+    slab_fork_unlock_parent ();
+
   for (mstate ar_ptr = &main_arena;; )
     {
       __libc_lock_unlock (ar_ptr->mutex);
@@ -227,6 +428,28 @@ __malloc_fork_unlock_child (void)
         break;
     }
 
+  /* The other threads do not exist in the child.  Their counters are
+     dropped.  */
+  INIT_LIST_HEAD (&thread_stats_list);
+  if (thread_stats.list.next != NULL)
+    list_add (&thread_stats.list, &thread_stats_list);
+
+#if IS_IN (libc)
+  __libc_lock_init (percpu_arenas_lock);
+#endif
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+  /* The purge thread does not exist in the child.  A new one is started
+     by __malloc_fork_restart_child once threads can be created.  */
+  int purge_state = atomic_load_relaxed (&purge_thread_state);
+  if (purge_state == purge_starting || purge_state == purge_running)
+    atomic_store_relaxed (&purge_thread_state, purge_requested);
+#endif
+#if IS_IN (libc)
+  if (profile_filter != NULL)
+    profile_fork_unlock_child ();
+#endif
+  if (slab_base != NULL)
+    slab_fork_unlock_child ();
   __libc_lock_init (list_lock);
 }
 
@@ -250,14 +473,48 @@ TUNABLE_CALLBACK_FNDECL (set_arena_test, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_max, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_count, size_t)
 TUNABLE_CALLBACK_FNDECL (set_tcache_unsorted_limit, size_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_batch, size_t)
 #endif
 TUNABLE_CALLBACK_FNDECL (set_mxfast, size_t)
 TUNABLE_CALLBACK_FNDECL (set_hugetlb, size_t)
+TUNABLE_CALLBACK_FNDECL (set_percpu, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_remote_free, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_slab_max, size_t)
+TUNABLE_CALLBACK_FNDECL (set_purge_interval, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_profile_rate, size_t)
+TUNABLE_CALLBACK_FNDECL (set_arena_spin, int32_t)
+TUNABLE_CALLBACK_FNDECL (set_tcache_counters, int32_t)
 
 #if USE_TCACHE
 static void tcache_key_initialize (void);
 #endif
 
+#if IS_IN (libc)
+/* Allocate the per-CPU arena table.  CPU 0 always uses the main arena;
+   the other arenas are created on first use.  On failure, per-CPU arena
+   selection is disabled.  */
+static void
+percpu_arenas_init (void)
+{
+  int n = __get_nprocs_conf ();
+  if (n < 1)
+    n = 1;
+
+  size_t size = ALIGN_UP (n * sizeof (mstate), GLRO (dl_pagesize));
+  void *p = MMAP (NULL, size, PROT_READ | PROT_WRITE, 0);
+  if (p == MAP_FAILED)
+    {
+      mp_.percpu = 0;
+      return;
+    }
+  __set_vma_name (p, size, " glibc: malloc arena");
+
+  percpu_arenas = p;
+  percpu_arenas_count = n;
+  percpu_arenas[0] = &main_arena;
+}
+#endif
+
 static void
 ptmalloc_init (void)
 {
@@ -294,6 +551,9 @@ ptmalloc_init (void)
 #endif
 
   thread_arena = &main_arena;
+  __libc_lock_lock (free_list_lock);
+  thread_stats_register ();
+  __libc_lock_unlock (free_list_lock);
 
   malloc_init_state (&main_arena);
 
@@ -309,9 +569,19 @@ ptmalloc_init (void)
   TUNABLE_GET (tcache_count, size_t, TUNABLE_CALLBACK (set_tcache_count));
   TUNABLE_GET (tcache_unsorted_limit, size_t,
 	       TUNABLE_CALLBACK (set_tcache_unsorted_limit));
+  TUNABLE_GET (tcache_batch, size_t, TUNABLE_CALLBACK (set_tcache_batch));
 # endif
   TUNABLE_GET (mxfast, size_t, TUNABLE_CALLBACK (set_mxfast));
   TUNABLE_GET (hugetlb, size_t, TUNABLE_CALLBACK (set_hugetlb));
+  TUNABLE_GET (percpu, int32_t, TUNABLE_CALLBACK (set_percpu));
+  TUNABLE_GET (remote_free, int32_t, TUNABLE_CALLBACK (set_remote_free));
+  TUNABLE_GET (slab_max, size_t, TUNABLE_CALLBACK (set_slab_max));
+  TUNABLE_GET (purge_interval, int32_t,
+	       TUNABLE_CALLBACK (set_purge_interval));
+  TUNABLE_GET (profile_rate, size_t, TUNABLE_CALLBACK (set_profile_rate));
+  TUNABLE_GET (arena_spin, int32_t, TUNABLE_CALLBACK (set_arena_spin));
+  TUNABLE_GET (tcache_counters, int32_t,
+	       TUNABLE_CALLBACK (set_tcache_counters));
 
   if (mp_.hp_pagesize > 0)
     {
@@ -323,6 +593,18 @@ ptmalloc_init (void)
 	do_set_mmap_threshold (mp_.hp_pagesize);
       __always_fail_morecore = true;
     }
+
+#if IS_IN (libc)
+  if (mp_.percpu)
+    percpu_arenas_init ();
+
+  /* Only the malloc functions in libc allocate from the slabs.  */
+  if (mp_.slab_max != 0)
+    slab_init ();
+
+  if (mp_.profile_rate != 0)
+    profile_init ();
+#endif
 }
 
 /* Managing heaps and arenas (for concurrent threads) */
@@ -392,7 +674,7 @@ alloc_new_heap  (size_t size, size_t top_pad, size_t pagesize,
     return 0;
   else
     size = max_size;
-  size = ALIGN_UP (size, pagesize);
+  size = ALIGN_UP (size, heap_thp_unit (pagesize));
 
   /* A memory region aligned to a multiple of max_size is needed.
      No swap space needs to be reserved for the following large
@@ -447,7 +729,9 @@ alloc_new_heap  (size_t size, size_t top_pad, size_t pagesize,
   /* Only considere the actual usable range.  */
   __set_vma_name (p2, size, " glibc: malloc arena");
 
-  madvise_thp (p2, size);
+  /* Advise the whole reservation, so that the parts made accessible
+     later by grow_heap are eligible for huge pages as well.  */
+  madvise_thp (p2, max_size);
 
   h = (heap_info *) p2;
   h->size = size;
@@ -471,7 +755,8 @@ new_heap (size_t size, size_t top_pad)
 }
 
 /* Grow a heap.  size is automatically rounded up to a
-   multiple of the page size. */
+   multiple of the page size, or of the huge page size if transparent
+   huge pages are used.  */
 
 static int
 grow_heap (heap_info *h, long diff)
@@ -481,7 +766,7 @@ grow_heap (heap_info *h, long diff)
   long new_size;
 
   diff = ALIGN_UP (diff, pagesize);
-  new_size = (long) h->size + diff;
+  new_size = ALIGN_UP ((long) h->size + diff, heap_thp_unit (pagesize));
   if ((unsigned long) new_size > (unsigned long) max_size)
     return -1;
 
@@ -519,6 +804,8 @@ shrink_heap (heap_info *h, long diff)
                          MAP_FIXED) == (char *) MAP_FAILED)
         return -2;
 
+      /* The new mapping does not inherit the huge page advice.  */
+      madvise_thp ((char *) h + new_size, diff);
       h->mprotect_size = new_size;
     }
   else
@@ -540,6 +827,13 @@ heap_trim (heap_info *heap, size_t pad)
   heap_info *prev_heap;
   long new_size, top_size, top_area, extra, prev_size, misalign;
   size_t max_size = heap_max_size ();
+  size_t unit = heap_thp_unit (heap->pagesize);
+
+  /* With transparent huge pages, keep an extra huge page at the top of
+     the heap, so that a heap whose usage fluctuates around a huge page
+     boundary is not trimmed and grown again over and over.  */
+  if (unit != heap->pagesize)
+    pad += unit;
 
   /* Can this heap go away completely? */
   while (top_chunk == chunk_at_offset (heap, sizeof (*heap)))
@@ -591,8 +885,9 @@ heap_trim (heap_info *heap, size_t pad)
   if (top_area < 0 || (size_t) top_area <= pad)
     return 0;
 
-  /* Release in pagesize units and round down to the nearest page.  */
-  extra = ALIGN_DOWN(top_area - pad, heap->pagesize);
+  /* Release in pagesize (or huge page size) units and round down to
+     the nearest page.  */
+  extra = ALIGN_DOWN(top_area - pad, unit);
   if (extra == 0)
     return 0;
 
@@ -608,6 +903,87 @@ heap_trim (heap_info *heap, size_t pad)
   return 1;
 }
 
+/* Background purge thread.  */
+
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+/* Return the free memory of all arenas to the system as it decays.
+   Arenas which are locked are skipped, so that the thread never waits
+   for the application.  */
+static void *
+purge_thread (void *closure)
+{
+  struct timespec interval =
+    {
+      .tv_sec = mp_.purge_interval / 1000,
+      .tv_nsec = (mp_.purge_interval % 1000) * 1000000,
+    };
+
+  while (true)
+    {
+      __clock_nanosleep (CLOCK_MONOTONIC, 0, &interval, NULL);
+
+      mstate ar_ptr = &main_arena;
+      do
+	{
+	  if (__libc_lock_trylock (ar_ptr->mutex) == 0)
+	    {
+	      purge_arena (ar_ptr);
+	      __libc_lock_unlock (ar_ptr->mutex);
+	    }
+	  ar_ptr = ar_ptr->next;
+	}
+      while (ar_ptr != &main_arena);
+    }
+
+  return NULL;
+}
+
+/* Start the purge thread if it has been requested.  Must not be called
+   with any lock held which pthread_create acquires.  If the thread
+   cannot be created, the arenas keep being trimmed by free.  */
+static void
+purge_start (void)
+{
+  int expected = purge_requested;
+  if (!atomic_compare_exchange_weak_acquire (&purge_thread_state, &expected,
+					     purge_starting))
+    return;
+
+  pthread_attr_t attr;
+  __pthread_attr_init (&attr);
+  __pthread_attr_setstacksize (&attr, __pthread_get_minstack (&attr));
+
+  /* Block all signals in the purge thread but SIGSETXID.  */
+  sigset_t ss;
+  __sigfillset (&ss);
+  __sigdelset (&ss, SIGSETXID);
+  int res = __pthread_attr_setsigmask_internal (&attr, &ss);
+
+  pthread_t thr;
+  if (res == 0)
+    res = __pthread_create (&thr, &attr, purge_thread, NULL);
+  __pthread_attr_destroy (&attr);
+
+  atomic_store_relaxed (&purge_thread_state,
+			res == 0 ? purge_running : purge_failed);
+}
+
+/* Return true if free should not trim the arena because the purge
+   thread does it.  */
+static inline bool
+purge_defer_trim (void)
+{
+  return (__glibc_unlikely (mp_.purge_interval != 0)
+	  && atomic_load_relaxed (&purge_thread_state) == purge_running);
+}
+#else
+static inline bool
+purge_defer_trim (void)
+{
+  return false;
+}
+#endif
+
 /* Create a new arena with initial size "size".  */
 
 #if IS_IN (libc)
@@ -625,6 +1001,9 @@ detach_arena (mstate replaced_arena)
 	 reference count reaches zero.  */
       --replaced_arena->attached_threads;
     }
+  else
+    /* The thread is attached to its first arena.  */
+    thread_stats_register ();
 }
 
 static mstate
@@ -649,6 +1028,8 @@ _int_new_arena (size_t size)
   a = h->ar_ptr = (mstate) (h + 1);
   malloc_init_state (a);
   a->attached_threads = 1;
+  /* The heap pages are faulted in by the creating thread.  */
+  a->node = malloc_getnode ();
   /*a->next = NULL;*/
   a->system_mem = a->max_system_mem = h->size;
 
@@ -691,13 +1072,14 @@ _int_new_arena (size_t size)
      but this could result in a deadlock with
      __malloc_fork_lock_parent.  */
 
-  __libc_lock_lock (a->mutex);
+  arena_mutex_lock (a);
 
   return a;
 }
 
 
-/* Remove an arena from free_list.  */
+/* Remove an arena from free_list.  Prefer an arena created on the
+   NUMA node of the current thread.  */
 static mstate
 get_free_list (void)
 {
@@ -705,11 +1087,22 @@ get_free_list (void)
   mstate result = free_list;
   if (result != NULL)
     {
+      int node = malloc_getnode ();
       __libc_lock_lock (free_list_lock);
-      result = free_list;
+      mstate *previous = &free_list;
+      if (node >= 0)
+	for (mstate p = free_list; p != NULL; p = p->next_free)
+	  {
+	    if (p->node == node)
+	      break;
+	    previous = &p->next_free;
+	  }
+      if (*previous == NULL)
+	previous = &free_list;
+      result = *previous;
       if (result != NULL)
 	{
-	  free_list = result->next_free;
+	  *previous = result->next_free;
 
 	  /* The arena will be attached to this thread.  */
 	  assert (result->attached_threads == 0);
@@ -722,8 +1115,12 @@ get_free_list (void)
       if (result != NULL)
         {
           LIBC_PROBE (memory_arena_reuse_free_list, 1, result);
-          __libc_lock_lock (result->mutex);
+          arena_mutex_lock (result);
 	  thread_arena = result;
+
+	  /* Return the chunks freed while the arena was unused.  */
+	  if (atomic_load_relaxed (&result->remote_free) != NULL)
+	    remote_free_drain (result);
         }
     }
 
@@ -750,6 +1147,31 @@ remove_from_free_list (mstate arena)
     }
 }
 
+/* Attach ARENA to the current thread, detaching the previous thread
+   arena, and update the arena thread attachment counters.  */
+static void
+attach_arena (mstate arena)
+{
+  mstate replaced_arena = thread_arena;
+  __libc_lock_lock (free_list_lock);
+  detach_arena (replaced_arena);
+
+  /* We may have picked up an arena on the free list.  We need to
+     preserve the invariant that no arena on the free list has a
+     positive attached_threads counter (otherwise,
+     arena_thread_freeres cannot use the counter to determine if the
+     arena needs to be put on the free list).  We unconditionally
+     remove the selected arena from the free list.  The callers
+     either observed the free list to be empty or are bounded by the
+     number of CPUs, so the list is very short.  */
+  remove_from_free_list (arena);
+
+  ++arena->attached_threads;
+
+  __libc_lock_unlock (free_list_lock);
+  thread_arena = arena;
+}
+
 /* Lock and return an arena that can be reused for memory allocation.
    Avoid AVOID_ARENA as we have already failed to allocate memory in
    it and it is currently locked.  */
@@ -762,6 +1184,23 @@ reused_arena (mstate avoid_arena)
   if (next_to_use == NULL)
     next_to_use = &main_arena;
 
+  /* Try the arenas created on the NUMA node of the current thread
+     first.  */
+  int node = malloc_getnode ();
+  if (node >= 0)
+    {
+      result = next_to_use;
+      do
+	{
+	  if (result->node == node && !__libc_lock_trylock (result->mutex))
+	    goto out;
+
+	  /* FIXME: This is a data race, see _int_new_arena.  */
+	  result = result->next;
+	}
+      while (result != next_to_use);
+    }
+
   /* Iterate over all arenas (including those linked from
      free_list).  */
   result = next_to_use;
@@ -782,38 +1221,53 @@ reused_arena (mstate avoid_arena)
 
   /* No arena available without contention.  Wait for the next in line.  */
   LIBC_PROBE (memory_arena_reuse_wait, 3, &result->mutex, result, avoid_arena);
-  __libc_lock_lock (result->mutex);
+  arena_mutex_lock (result);
 
 out:
   /* Attach the arena to the current thread.  */
-  {
-    /* Update the arena thread attachment counters.   */
-    mstate replaced_arena = thread_arena;
-    __libc_lock_lock (free_list_lock);
-    detach_arena (replaced_arena);
-
-    /* We may have picked up an arena on the free list.  We need to
-       preserve the invariant that no arena on the free list has a
-       positive attached_threads counter (otherwise,
-       arena_thread_freeres cannot use the counter to determine if the
-       arena needs to be put on the free list).  We unconditionally
-       remove the selected arena from the free list.  The caller of
-       reused_arena checked the free list and observed it to be empty,
-       so the list is very short.  */
-    remove_from_free_list (result);
-
-    ++result->attached_threads;
-
-    __libc_lock_unlock (free_list_lock);
-  }
+  attach_arena (result);
+
+  if (atomic_load_relaxed (&result->remote_free) != NULL)
+    remote_free_drain (result);
 
   LIBC_PROBE (memory_arena_reuse, 2, result, avoid_arena);
-  thread_arena = result;
   next_to_use = result->next;
 
   return result;
 }
 
+/* Lock arena A, the arena of the current thread, for an allocation.
+   If the lock is still contended after spinning on it, try the other
+   arenas before sleeping, and attach the thread to the first one that
+   can be locked.  Return the locked arena.  */
+static mstate
+arena_lock_alloc (mstate a)
+{
+  if (__glibc_likely (__libc_lock_trylock (a->mutex) == 0))
+    return a;
+
+  arena_mutex_contended (a);
+  if (mp_.arena_spin == 0)
+    {
+      __libc_lock_lock (a->mutex);
+      return a;
+    }
+  if (arena_mutex_spin (a))
+    return a;
+
+  /* FIXME: This is a data race, see _int_new_arena.  */
+  for (mstate other = a->next; other != a; other = other->next)
+    if (__libc_lock_trylock (other->mutex) == 0)
+      {
+	LIBC_PROBE (memory_arena_reuse_contended, 2, other, a);
+	attach_arena (other);
+	return other;
+      }
+
+  __libc_lock_lock (a->mutex);
+  return a;
+}
+
 static mstate
 arena_get2 (size_t size, mstate avoid_arena)
 {
@@ -864,6 +1318,57 @@ arena_get2 (size_t size, mstate avoid_arena)
   return a;
 }
 
+/* Lock and return the arena for the CPU the calling thread is running
+   on, creating it on first use.  The thread is attached to the selected
+   arena, so that thread_arena keeps tracking the last arena used.  If
+   the CPU number is not available (for example, because rseq
+   registration is disabled), fall back to the per-thread arena.  */
+static mstate
+arena_get_percpu (size_t size)
+{
+  mstate a;
+  int cpu = malloc_getcpu ();
+
+  if (__glibc_unlikely (cpu < 0))
+    goto fallback;
+
+  mstate *slot = &percpu_arenas[cpu % percpu_arenas_count];
+  a = atomic_load_acquire (slot);
+  if (__glibc_unlikely (a == NULL))
+    {
+      /* Another thread may have been scheduled on the same CPU and
+	 raced with us to create the arena.  */
+      __libc_lock_lock (percpu_arenas_lock);
+      a = *slot;
+      if (a == NULL)
+	{
+	  a = _int_new_arena (size);
+	  if (a != NULL)
+	    {
+	      catomic_increment (&narenas);
+	      atomic_store_release (slot, a);
+	      __libc_lock_unlock (percpu_arenas_lock);
+	      /* _int_new_arena attached and locked the new arena.  */
+	      return a;
+	    }
+	}
+      __libc_lock_unlock (percpu_arenas_lock);
+      if (a == NULL)
+	goto fallback;
+    }
+
+  /* The thread migrated to a different CPU.  */
+  if (a != thread_arena)
+    attach_arena (a);
+  arena_mutex_lock (a);
+  return a;
+
+ fallback:
+  a = thread_arena;
+  arena_lock (a, size);
+  return a;
+}
+
 /* If we don't have the main arena, then maybe the failure is due to running
    out of mmapped areas, so we can try allocating on the main arena.
    Otherwise, it is likely that sbrk() has failed and there is still a chance
@@ -876,7 +1381,7 @@ arena_get_retry (mstate ar_ptr, size_t bytes)
     {
       __libc_lock_unlock (ar_ptr->mutex);
       ar_ptr = &main_arena;
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
     }
   else
     {
@@ -899,9 +1404,10 @@ __malloc_arena_thread_freeres (void)
   mstate a = thread_arena;
   thread_arena = NULL;
 
+  __libc_lock_lock (free_list_lock);
+  thread_stats_exit ();
   if (a != NULL)
     {
-      __libc_lock_lock (free_list_lock);
       /* If this was the last attached thread for this arena, put the
 	 arena on the free list.  */
       assert (a->attached_threads > 0);
@@ -910,8 +1416,55 @@ __malloc_arena_thread_freeres (void)
 	  a->next_free = free_list;
 	  free_list = a;
 	}
-      __libc_lock_unlock (free_list_lock);
     }
+  __libc_lock_unlock (free_list_lock);
+
+  /* Chunks freed by other threads are otherwise only returned to the
+     bins once the arena allocates again, which may not happen for a
+     long time if no thread is attached to it.  */
+  if (a != NULL && atomic_load_relaxed (&a->remote_free) != NULL)
+    {
+      arena_mutex_lock (a);
+      remote_free_drain (a);
+      __libc_lock_unlock (a->mutex);
+    }
+}
+
+void
+__malloc_early_init (bool initial)
+{
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+  /* The copies of libc in other namespaces trim their arenas in
+     free.  */
+  if (!initial || TUNABLE_GET (purge_interval, int32_t, NULL) == 0)
+    return;
+
+  if (!__malloc_initialized)
+    ptmalloc_init ();
+  if (mp_.purge_interval != 0)
+    {
+      atomic_store_relaxed (&purge_thread_state, purge_requested);
+      purge_start ();
+    }
+#endif
+}
+
+#if IS_IN (libc)
+/* Load the unwinder for the heap profiler, see profile.c.  */
+static void __attribute__ ((constructor))
+malloc_profile_constructor (void)
+{
+  if (TUNABLE_GET (profile_rate, size_t, NULL) != 0)
+    profile_load_unwinder ();
+}
+#endif
+
+void
+__malloc_fork_restart_child (void)
+{
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+  purge_start ();
+#endif
 }
 
 /*
@@ -213,6 +213,27 @@ __debug_free (void *mem)
 }
 strong_alias (__debug_free, free)
 
+static void
+__debug_free_sized (void *mem, size_t size)
+{
+  /* The size is only checked with MALLOC_CHECK_.  */
+  if (mem != NULL && __is_malloc_debug_enabled (MALLOC_CHECK_HOOK)
+      && size > malloc_usable_size (mem))
+    malloc_printerr ("free_sized(): invalid size");
+  __debug_free (mem);
+}
+strong_alias (__debug_free_sized, free_sized)
+
+static void
+__debug_free_aligned_sized (void *mem, size_t alignment, size_t size)
+{
+  if (mem != NULL && __is_malloc_debug_enabled (MALLOC_CHECK_HOOK)
+      && (!powerof2 (alignment) || (uintptr_t) mem % alignment != 0))
+    malloc_printerr ("free_aligned_sized(): invalid alignment");
+  __debug_free_sized (mem, size);
+}
+strong_alias (__debug_free_aligned_sized, free_aligned_sized)
+
 static void *
 __debug_realloc (void *oldmem, size_t bytes)
 {
@@ -650,6 +671,9 @@ compat_symbol (libc_malloc_debug, malloc_set_state, malloc_set_state,
 compat_symbol (libc_malloc_debug, aligned_alloc, aligned_alloc, GLIBC_2_16);
 compat_symbol (libc_malloc_debug, calloc, calloc, GLIBC_2_0);
 compat_symbol (libc_malloc_debug, free, free, GLIBC_2_0);
+compat_symbol (libc_malloc_debug, free_aligned_sized, free_aligned_sized,
+	       GLIBC_2_41);
+compat_symbol (libc_malloc_debug, free_sized, free_sized, GLIBC_2_41);
 compat_symbol (libc_malloc_debug, mallinfo2, mallinfo2, GLIBC_2_33);
 compat_symbol (libc_malloc_debug, mallinfo, mallinfo, GLIBC_2_0);
 compat_symbol (libc_malloc_debug, malloc_info, malloc_info, GLIBC_2_10);
@@ -33,6 +33,14 @@ void __malloc_fork_unlock_parent (void) attribute_hidden;
 /* Called in the child process after a fork.  */
 void __malloc_fork_unlock_child (void) attribute_hidden;
 
+/* Called in the child process after a fork, once the stacks of the
+   other threads have been reclaimed and threads can be created.  */
+void __malloc_fork_restart_child (void) attribute_hidden;
+
+/* Called from __libc_early_init.  INITIAL is true for the libc in the
+   initial namespace.  */
+void __malloc_early_init (_Bool initial) attribute_hidden;
+
 /* Called as part of the thread shutdown sequence.  */
 void __malloc_arena_thread_freeres (void) attribute_hidden;
 
@@ -554,6 +554,15 @@ tag_at (void *ptr)
 #define HAVE_MREMAP 0
 #endif
 
+/*
+  Define HAVE_MALLOC_PURGE_THREAD if libc can start the background
+  purge thread used by the glibc.malloc.purge_interval tunable.
+*/
+
+#ifndef HAVE_MALLOC_PURGE_THREAD
+#define HAVE_MALLOC_PURGE_THREAD 0
+#endif
+
 /*
   This version of malloc supports the standard SVID/XPG mallinfo
   routine that returns a struct containing usage properties and
@@ -605,6 +614,16 @@ libc_hidden_proto (__libc_malloc)
 void     __libc_free(void*);
 libc_hidden_proto (__libc_free)
 
+/*
+  free_sized(void* p, size_t n)
+  free_aligned_sized(void* p, size_t alignment, size_t n)
+  Like free, for a chunk allocated with a request of n bytes.  Chunks
+  of exactly that size go to the tcache without the checks free needs
+  to find out how the chunk was allocated.
+*/
+void     __libc_free_sized(void*, size_t);
+void     __libc_free_aligned_sized(void*, size_t, size_t);
+
 /*
   calloc(size_t n_elements, size_t element_size);
   Returns a pointer to n_elements * element_size bytes, with all locations
@@ -1087,11 +1106,20 @@ typedef struct malloc_chunk* mchunkptr;
 
 static void*  _int_malloc(mstate, size_t);
 static void     _int_free(mstate, mchunkptr, int);
+static void _int_free_chunk (mstate, mchunkptr, INTERNAL_SIZE_T, int);
+static void remote_free_push (mstate, mchunkptr);
+static INTERNAL_SIZE_T remote_free_merge (mstate);
+static void remote_free_drain (mstate);
 static void _int_free_merge_chunk (mstate, mchunkptr, INTERNAL_SIZE_T);
+static INTERNAL_SIZE_T _int_free_bin_chunk (mstate, mchunkptr,
+					    INTERNAL_SIZE_T);
 static INTERNAL_SIZE_T _int_free_create_chunk (mstate,
 					       mchunkptr, INTERNAL_SIZE_T,
 					       mchunkptr, INTERNAL_SIZE_T);
 static void _int_free_maybe_consolidate (mstate, INTERNAL_SIZE_T);
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+static void purge_arena (mstate);
+#endif
 static void*  _int_realloc(mstate, mchunkptr, INTERNAL_SIZE_T,
 			   INTERNAL_SIZE_T);
 static void*  _int_memalign(mstate, size_t, size_t);
@@ -1851,6 +1879,31 @@ struct malloc_state
   /* Memory allocated from the system in this arena.  */
   INTERNAL_SIZE_T system_mem;
   INTERNAL_SIZE_T max_system_mem;
+
+  /* Chunks freed by threads attached to other arenas, linked through
+     their (protected) fd pointers.  Any thread may push onto this list
+     without the arena lock; it is drained with the lock held.  */
+  mchunkptr remote_free;
+
+  /* Number of chunks ever pushed onto remote_free.  Updated with
+     relaxed atomics.  */
+  size_t remote_frees;
+
+  /* Number of intervals of the background purge thread since the last
+     free into this arena.  */
+  unsigned int purge_ticks;
+
+  /* Event counters of this arena (see __malloc_info_json), updated
+     with relaxed atomics.  The thread cache members are unused.  */
+  struct malloc_counters counters;
+
+  /* Moving average of the number of iterations spent spinning on
+     mutex (see arena_mutex_spin).  */
+  int spins;
+
+  /* NUMA node of the thread which created the arena, or -1 if
+     unknown (see malloc_getnode).  */
+  int node;
 };
 
 struct malloc_par
@@ -1862,6 +1915,31 @@ struct malloc_par
   INTERNAL_SIZE_T arena_test;
   INTERNAL_SIZE_T arena_max;
 
+  /* Select the arena by the current CPU instead of per thread.  */
+  int percpu;
+
+  /* Defer frees of chunks belonging to other arenas to the remote free
+     list of that arena instead of locking it.  */
+  int remote_free;
+
+  /* Largest request served by the slab allocator, 0 if disabled.  */
+  size_t slab_max;
+
+  /* Interval of the background purge thread in milliseconds, 0 if
+     disabled.  */
+  int purge_interval;
+
+  /* Mean number of bytes allocated between two samples of the heap
+     profiler, 0 if disabled.  */
+  size_t profile_rate;
+
+  /* Maximum number of iterations spent spinning on a contended arena
+     lock, 0 to sleep right away.  */
+  int arena_spin;
+
+  /* Nonzero if the thread cache hits and misses are counted.  */
+  int tcache_counters;
+
   /* Transparent Large Page support.  */
   INTERNAL_SIZE_T thp_pagesize;
   /* A value different than 0 means to align mmap allocation to hp_pagesize
@@ -1894,6 +1972,9 @@ struct malloc_par
   /* Maximum number of chunks to remove from the unsorted list, which
      aren't used to prefill the cache.  */
   size_t tcache_unsorted_limit;
+  /* Number of chunks moved between a tcache bin and the arena per
+     arena lock acquisition.  Zero disables batching.  */
+  size_t tcache_batch;
 #endif
 };
 
@@ -1907,7 +1988,8 @@ static struct malloc_state main_arena =
 {
   .mutex = _LIBC_LOCK_INITIALIZER,
   .next = &main_arena,
-  .attached_threads = 1
+  .attached_threads = 1,
+  .node = -1
 };
 
 /* There is only one instance of the malloc parameters.  */
@@ -2021,6 +2103,12 @@ madvise_thp (void *p, INTERNAL_SIZE_T size)
 #endif
 }
 
+/* ------------- Size-class slab allocator for small requests ------------ */
+#include "slab.c"
+
+/* ------------------------- Sampling heap profiler ----------------------- */
+#include "profile.c"
+
 /* ------------------- Support for multiple arenas -------------------- */
 #include "arena.c"
 
@@ -2470,6 +2558,10 @@ sysmalloc_mmap (INTERNAL_SIZE_T nb, size_t pagesize, int extra_flags, mstate av)
   /* update statistics */
   int new = atomic_fetch_add_relaxed (&mp_.n_mmaps, 1) + 1;
   atomic_max (&mp_.max_n_mmaps, new);
+  if (av != NULL)
+    arena_stats_inc (av, mmap_chunks);
+  else
+    thread_stats_inc (mmap_chunks);
 
   unsigned long sum;
   sum = atomic_fetch_add_relaxed (&mp_.mmapped_mem, size) + size;
@@ -2552,6 +2644,10 @@ sysmalloc (INTERNAL_SIZE_T nb, mstate av)
   size_t pagesize = GLRO (dl_pagesize);
   bool tried_mmap = false;
 
+  if (av != NULL)
+    arena_stats_inc (av, sysmalloc_calls);
+  else
+    thread_stats_inc (sysmalloc_calls);
 
   /*
      If have mmap, and the request size meets the mmap threshold, and
@@ -2963,6 +3059,10 @@ systrim (size_t pad, mstate av)
   char *new_brk;         /* address returned by post-check sbrk call */
   long top_area;
 
+  /* Chunks freed by other threads may border the top chunk.  */
+  if (atomic_load_relaxed (&av->remote_free) != NULL)
+    remote_free_merge (av);
+
   top_size = chunksize (av->top);
 
   top_area = top_size - MINSIZE - 1;
@@ -3206,6 +3306,87 @@ tcache_next (tcache_entry *e)
   return (tcache_entry *) REVEAL_PTR (e->next);
 }
 
+/* Move up to glibc.malloc.tcache_batch more chunks of the size of
+   bin TC_IDX from arena AV into the tcache.  AV must be locked by the
+   caller, so the following allocations of this size do not have to
+   acquire the arena lock again.  */
+static void
+tcache_refill (mstate av, size_t bytes, size_t tc_idx)
+{
+  for (size_t n = mp_.tcache_batch;
+       n > 0 && tcache->counts[tc_idx] < mp_.tcache_count; --n)
+    {
+      void *mem = _int_malloc (av, bytes);
+      if (mem == NULL)
+	break;
+
+      mchunkptr p = mem2chunk (mem);
+      if (__glibc_unlikely (chunk_is_mmapped (p)
+			    || csize2tidx (chunksize (p)) != tc_idx))
+	{
+	  /* The request was served from a larger chunk which would not
+	     fit this bin.  Give it back and stop.  */
+	  _int_free_chunk (av, p, chunksize (p), 1);
+	  break;
+	}
+      tcache_put (p, tc_idx);
+    }
+}
+
+/* Return up to N chunks from tcache bin TC_IDX to their arenas.  The
+   chunks are taken from the tail of the bin, which holds the chunks
+   freed least recently, so the chunks which are most likely still in
+   the CPU cache stay in the tcache.  Consecutive chunks usually come
+   from the same arena, so the arena lock is only released when the
+   arena changes.  */
+static void
+tcache_flush (size_t tc_idx, size_t n)
+{
+  size_t count = tcache->counts[tc_idx];
+  if (n > count)
+    n = count;
+  if (n == 0)
+    return;
+
+  /* Find the link to the first chunk which is flushed and detach the
+     chunks after it from the bin.  */
+  tcache_entry **ep = &tcache->entries[tc_idx];
+  tcache_entry *e = *ep;
+  for (size_t keep = count - n; keep > 0; --keep)
+    {
+      if (__glibc_unlikely (!aligned_OK (e)))
+	malloc_printerr ("free(): unaligned chunk detected in tcache");
+      ep = &e->next;
+      e = tcache_next (e);
+    }
+  *ep = ep == &tcache->entries[tc_idx] ? NULL : PROTECT_PTR (ep, NULL);
+  tcache->counts[tc_idx] = count - n;
+
+  mstate locked = NULL;
+  for (; n > 0; --n)
+    {
+      if (__glibc_unlikely (!aligned_OK (e)))
+	malloc_printerr ("free(): unaligned chunk detected in tcache");
+      tcache_entry *next = tcache_next (e);
+      e->key = 0;
+
+      mchunkptr p = mem2chunk (e);
+      mstate av = arena_for_chunk (p);
+      if (av != locked)
+	{
+	  if (locked != NULL)
+	    __libc_lock_unlock (locked->mutex);
+	  arena_mutex_lock (av);
+	  locked = av;
+	}
+      _int_free_chunk (av, p, chunksize (p), 1);
+      e = next;
+    }
+
+  if (locked != NULL)
+    __libc_lock_unlock (locked->mutex);
+}
+
 static void
 tcache_thread_shutdown (void)
 {
@@ -3300,6 +3481,10 @@ __libc_malloc (size_t bytes)
 
   if (!__malloc_initialized)
     ptmalloc_init ();
+
+  if (__glibc_unlikely (profile_due (bytes)))
+    return profile_sample (__libc_malloc (bytes), bytes, RETURN_ADDRESS (0));
+
 #if USE_TCACHE
   /* int_free also calls request2size, be careful to not pad twice.  */
   size_t tbytes = checked_request2size (bytes);
@@ -3317,12 +3502,25 @@ __libc_malloc (size_t bytes)
       && tcache != NULL
       && tcache->counts[tc_idx] > 0)
     {
+      tcache_stats_inc (tcache_hits);
       victim = tcache_get (tc_idx);
       return tag_new_usable (victim);
     }
   DIAG_POP_NEEDS_COMMENT;
+  if (tc_idx < mp_.tcache_bins)
+    tcache_stats_inc (tcache_misses);
 #endif
 
+  /* The slabs are only used when the tcache cannot serve the request,
+     because each slab allocation acquires the lock of its size
+     class.  */
+  if (__glibc_unlikely (mp_.slab_max != 0) && bytes <= mp_.slab_max)
+    {
+      victim = slab_malloc (bytes);
+      if (victim != NULL)
+	return victim;
+    }
+
   if (SINGLE_THREAD_P)
     {
       victim = tag_new_usable (_int_malloc (&main_arena, bytes));
@@ -3343,6 +3541,13 @@ __libc_malloc (size_t bytes)
       victim = _int_malloc (ar_ptr, bytes);
     }
 
+#if USE_TCACHE
+  /* While the arena is locked, prefill the tcache bin for this size.  */
+  if (mp_.tcache_batch > 0 && victim != NULL && ar_ptr != NULL
+      && tc_idx < mp_.tcache_bins && tcache != NULL)
+    tcache_refill (ar_ptr, bytes, tc_idx);
+#endif
+
   if (ar_ptr != NULL)
     __libc_lock_unlock (ar_ptr->mutex);
 
@@ -3363,6 +3568,17 @@ __libc_free (void *mem)
   if (mem == 0)                              /* free(0) has no effect */
     return;
 
+  if (__glibc_unlikely (profile_maybe_sampled (mem)))
+    profile_free (mem);
+
+  if (slab_contains (mem))
+    {
+      int err = errno;
+      slab_free (mem);
+      __set_errno (err);
+      return;
+    }
+
   /* Quickly check that the freed pointer matches the tag for the memory.
      This gives a useful double-free detection.  */
   if (__glibc_unlikely (mtag_enabled))
@@ -3402,14 +3618,70 @@ __libc_free (void *mem)
 }
 libc_hidden_def (__libc_free)
 
-void *
-__libc_realloc (void *oldmem, size_t bytes)
+/* Free MEM, which was allocated with a request of SIZE bytes.  If the
+   chunk has exactly the size of such a request, it cannot be mmapped,
+   and its tcache bin follows from SIZE.  Anything else, including slab
+   objects, tagged memory, sampled allocations and wrong sizes, is left
+   to free.  */
+void
+__libc_free_sized (void *mem, size_t size)
 {
-  mstate ar_ptr;
-  INTERNAL_SIZE_T nb;         /* padded request size */
+  if (mem == NULL)
+    return;
 
-  void *newp;             /* chunk to return */
+  /* A replacement malloc which does not define free_sized gets this
+     definition.  MEM then comes from the replacement, so its header
+     cannot be read, and only the replacement free can release it.
+     The address of free is loaded from the GOT, so that it refers to
+     the interposed definition.  */
+  if (__glibc_unlikely (free != __libc_free))
+    {
+      free (mem);
+      return;
+    }
+
+  mchunkptr p = mem2chunk (mem);
+  INTERNAL_SIZE_T nb = checked_request2size (size);
+  if (__glibc_unlikely (mtag_enabled) || slab_contains (mem)
+      || __glibc_unlikely (profile_maybe_sampled (mem))
+      || (chunksize_nomask (p) & ~(PREV_INUSE | NON_MAIN_ARENA)) != nb
+      || __glibc_unlikely (misaligned_chunk (p)))
+    {
+      __libc_free (mem);
+      return;
+    }
+
+#if USE_TCACHE
+  size_t tc_idx = csize2tidx (nb);
+  if (tc_idx < mp_.tcache_bins && tcache != NULL
+      && tcache->counts[tc_idx] < mp_.tcache_count
+      /* Leave the double free check to _int_free.  */
+      && ((tcache_entry *) mem)->key != tcache_key)
+    {
+      tcache_put (p, tc_idx);
+      return;
+    }
+#endif
+
+  int err = errno;
+  MAYBE_INIT_TCACHE ();
+  _int_free (arena_for_chunk (p), p, 0);
+  __set_errno (err);
+}
+
+/* aligned_alloc does not round the size up to the alignment, so the
+   chunk size is that of a request of SIZE bytes as well.  */
+void
+__libc_free_aligned_sized (void *mem, size_t alignment, size_t size)
+{
+  __libc_free_sized (mem, size);
+}
+
+static void *_mid_realloc (void *oldmem, size_t bytes);
 
+void *
+__libc_realloc (void *oldmem, size_t bytes)
+{
   if (!__malloc_initialized)
     ptmalloc_init ();
 
@@ -3424,6 +3696,37 @@ __libc_realloc (void *oldmem, size_t bytes)
   if (oldmem == 0)
     return __libc_malloc (bytes);
 
+  if (__glibc_unlikely (profile_due (bytes)))
+    return profile_sample (__libc_realloc (oldmem, bytes), bytes,
+			   RETURN_ADDRESS (0));
+
+  /* The sample is dropped even if the block is resized in place, but
+     only if the reallocation succeeds.  */
+  if (__glibc_unlikely (profile_maybe_sampled (oldmem)))
+    {
+      unsigned int sample = profile_realloc_start (oldmem);
+      void *newmem = _mid_realloc (oldmem, bytes);
+      profile_realloc_finish (sample, newmem != NULL);
+      return newmem;
+    }
+
+  return _mid_realloc (oldmem, bytes);
+}
+libc_hidden_def (__libc_realloc)
+
+/* The part of realloc after the special cases of null pointers, zero
+   sizes and the heap profiler.  */
+static void *
+_mid_realloc (void *oldmem, size_t bytes)
+{
+  mstate ar_ptr;
+  INTERNAL_SIZE_T nb;         /* padded request size */
+
+  void *newp;             /* chunk to return */
+
+  if (slab_contains (oldmem))
+    return slab_realloc (oldmem, bytes);
+
   /* Perform a quick check to ensure that the pointer's tag matches the
      memory's tag.  */
   if (__glibc_unlikely (mtag_enabled))
@@ -3512,7 +3815,7 @@ __libc_realloc (void *oldmem, size_t bytes)
       return newp;
     }
 
-  __libc_lock_lock (ar_ptr->mutex);
+  arena_mutex_lock (ar_ptr);
 
   newp = _int_realloc (ar_ptr, oldp, oldsize, nb);
 
@@ -3536,7 +3839,6 @@ __libc_realloc (void *oldmem, size_t bytes)
 
   return newp;
 }
-libc_hidden_def (__libc_realloc)
 
 void *
 __libc_memalign (size_t alignment, size_t bytes)
@@ -3581,6 +3883,10 @@ _mid_memalign (size_t alignment, size_t bytes, void *address)
   if (alignment <= MALLOC_ALIGNMENT)
     return __libc_malloc (bytes);
 
+  if (__glibc_unlikely (profile_due (bytes)))
+    return profile_sample (_mid_memalign (alignment, bytes, address), bytes,
+			   address);
+
   /* Otherwise, ensure that it is at least a minimum chunk size */
   if (alignment < MINSIZE)
     alignment = MINSIZE;
@@ -3717,8 +4023,35 @@ __libc_calloc (size_t n, size_t elem_size)
   if (!__malloc_initialized)
     ptmalloc_init ();
 
+  if (__glibc_unlikely (profile_due (sz)))
+    return profile_sample (__libc_calloc (n, elem_size), sz,
+			   RETURN_ADDRESS (0));
+
   MAYBE_INIT_TCACHE ();
 
+  if (__glibc_unlikely (mp_.slab_max != 0) && sz <= mp_.slab_max)
+    {
+#if USE_TCACHE
+      /* As in malloc, try the tcache before the slabs.  Without the
+	 slabs, calloc does not use the tcache.  */
+      size_t tc_idx = csize2tidx (checked_request2size (sz));
+      if (tc_idx < mp_.tcache_bins
+	  && tcache != NULL
+	  && tcache->counts[tc_idx] > 0)
+	{
+	  tcache_stats_inc (tcache_hits);
+	  mem = tcache_get (tc_idx);
+	  return tag_new_zero_region (mem, memsize (mem2chunk (mem)));
+	}
+      if (tc_idx < mp_.tcache_bins)
+	tcache_stats_inc (tcache_misses);
+#endif
+
+      mem = slab_malloc (sz);
+      if (mem != NULL)
+	return memset (mem, 0, sz);
+    }
+
   if (SINGLE_THREAD_P)
     av = &main_arena;
   else
@@ -3892,6 +4225,11 @@ _int_malloc (mstate av, size_t bytes)
       return p;
     }
 
+  /* Return the chunks freed by other threads to the bins first, so that
+     they can satisfy this request.  */
+  if (atomic_load_relaxed (&av->remote_free) != NULL)
+    remote_free_drain (av);
+
   /*
      If the size qualifies as a fastbin, first check corresponding bin.
      This code is safe to execute even if av is not yet initialized, so we
@@ -3959,6 +4297,7 @@ _int_malloc (mstate av, size_t bytes)
 		    }
 		}
 #endif
+	      arena_stats_inc (av, fastbin_hits);
 	      void *p = chunk2mem (victim);
 	      alloc_perturb (p, bytes);
 	      return p;
@@ -4494,7 +4833,6 @@ static void
 _int_free (mstate av, mchunkptr p, int have_lock)
 {
   INTERNAL_SIZE_T size;        /* its size */
-  mfastbinptr *fb;             /* associated fastbin */
 
   size = chunksize (p);
 
@@ -4549,10 +4887,31 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 	    tcache_put (p, tc_idx);
 	    return;
 	  }
+
+	/* The bin is full.  Return a batch of chunks to their arenas,
+	   which usually needs a single lock acquisition, and cache
+	   this chunk instead.  We must not lock other arenas if the
+	   caller already holds a lock.  */
+	if (mp_.tcache_batch > 0 && mp_.tcache_count > 0 && !have_lock)
+	  {
+	    tcache_flush (tc_idx, mp_.tcache_batch);
+	    tcache_put (p, tc_idx);
+	    return;
+	  }
       }
   }
 #endif
 
+  _int_free_chunk (av, p, size, have_lock);
+}
+
+/* Free chunk P of SIZE bytes to arena AV, bypassing the tcache.  P must
+   have passed the checks in _int_free.  */
+static void
+_int_free_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size, int have_lock)
+{
+  mfastbinptr *fb;             /* associated fastbin */
+
   /*
     If eligible, place chunk on a fastbin so it can be found
     and used quickly in malloc.
@@ -4580,7 +4939,7 @@ _int_free (mstate av, mchunkptr p, int have_lock)
 	   getting the lock.  */
 	if (!have_lock)
 	  {
-	    __libc_lock_lock (av->mutex);
+	    arena_mutex_lock (av);
 	    fail = (chunksize_nomask (chunk_at_offset (p, size)) <= CHUNK_HDR_SZ
 		    || chunksize (chunk_at_offset (p, size)) >= av->system_mem);
 	    __libc_lock_unlock (av->mutex);
@@ -4640,8 +4999,17 @@ _int_free (mstate av, mchunkptr p, int have_lock)
     if (SINGLE_THREAD_P)
       have_lock = true;
 
+    /* A thread attached to a different arena does not take the lock of
+       AV, but leaves the chunk for the next thread that allocates from
+       AV.  */
+    if (!have_lock && mp_.remote_free && av != thread_arena)
+      {
+	remote_free_push (av, p);
+	return;
+      }
+
     if (!have_lock)
-      __libc_lock_lock (av->mutex);
+      arena_mutex_lock (av);
 
     _int_free_merge_chunk (av, p, size);
 
@@ -4657,11 +5025,73 @@ _int_free (mstate av, mchunkptr p, int have_lock)
   }
 }
 
+/* Push chunk P onto the remote free list of AV.  The arena lock is
+   not needed; the chunk stays in use until the list is drained.  */
+static void
+remote_free_push (mstate av, mchunkptr p)
+{
+  mchunkptr old = atomic_load_relaxed (&av->remote_free);
+  do
+    {
+      /* Check that the top of the list is not the chunk we are going to
+	 add (i.e., double free).  */
+      if (__glibc_unlikely (old == p))
+	malloc_printerr ("double free or corruption (remote)");
+      p->fd = PROTECT_PTR (&p->fd, old);
+    }
+  while (!atomic_compare_exchange_weak_release (&av->remote_free, &old, p));
+
+  atomic_fetch_add_relaxed (&av->remote_frees, 1);
+}
+
+/* Detach the remote free list of AV and put its chunks into the bins.
+   Unlike remote_free_drain, this never trims the arena, so the caller
+   can look up the heap of the top chunk afterwards and use it.  Return
+   the size of the largest resulting chunk, or 0 if the list was empty.
+   AV must be locked.  */
+static INTERNAL_SIZE_T
+remote_free_merge (mstate av)
+{
+  INTERNAL_SIZE_T largest = 0;
+  mchunkptr p = atomic_exchange_acquire (&av->remote_free, NULL);
+  while (p != NULL)
+    {
+      if (__glibc_unlikely (misaligned_chunk (p)))
+	malloc_printerr ("malloc(): unaligned remote free chunk detected");
+      mchunkptr next = REVEAL_PTR (p->fd);
+      INTERNAL_SIZE_T size = _int_free_bin_chunk (av, p, chunksize (p));
+      if (size > largest)
+	largest = size;
+      p = next;
+    }
+  return largest;
+}
+
+/* Detach the remote free list of AV, put its chunks into the bins and
+   trim the arena if they make enough memory free.  AV must be
+   locked.  */
+static void
+remote_free_drain (mstate av)
+{
+  INTERNAL_SIZE_T size = remote_free_merge (av);
+  if (size != 0)
+    _int_free_maybe_consolidate (av, size);
+}
+
 /* Try to merge chunk P of SIZE bytes with its neighbors.  Put the
    resulting chunk on the appropriate bin list.  P must not be on a
    bin list yet, and it can be in use.  */
 static void
 _int_free_merge_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size)
+{
+  size = _int_free_bin_chunk (av, p, size);
+  _int_free_maybe_consolidate (av, size);
+}
+
+/* Like _int_free_merge_chunk, but do not consolidate or trim the
+   arena.  Return the size of the resulting chunk.  */
+static INTERNAL_SIZE_T
+_int_free_bin_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size)
 {
   mchunkptr nextchunk = chunk_at_offset(p, size);
 
@@ -4697,8 +5127,7 @@ _int_free_merge_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size)
     }
 
   /* Write the chunk header, maybe after merging with the following chunk.  */
-  size = _int_free_create_chunk (av, p, size, nextchunk, nextsize);
-  _int_free_maybe_consolidate (av, size);
+  return _int_free_create_chunk (av, p, size, nextchunk, nextsize);
 }
 
 /* Create a chunk at P of SIZE bytes, with SIZE potentially increased
@@ -4768,6 +5197,9 @@ _int_free_create_chunk (mstate av, mchunkptr p, INTERNAL_SIZE_T size,
 static void
 _int_free_maybe_consolidate (mstate av, INTERNAL_SIZE_T size)
 {
+  /* The free memory of the arena has changed, so restart its decay.  */
+  av->purge_ticks = 0;
+
   /* Unless max_fast is 0, we don't know if there are fastbins
      bordering top, so we cannot tell for sure whether threshold has
      been reached unless fastbins are consolidated.  But we don't want
@@ -4778,15 +5210,32 @@ _int_free_maybe_consolidate (mstate av, INTERNAL_SIZE_T size)
       if (atomic_load_relaxed (&av->have_fastchunks))
 	malloc_consolidate(av);
 
+      /* Leave trimming to the background purge thread if it runs.  */
+      if (purge_defer_trim ())
+	return;
+
       if (av == &main_arena)
 	{
 #ifndef MORECORE_CANNOT_TRIM
 	  if (chunksize (av->top) >= mp_.trim_threshold)
-	    systrim (mp_.top_pad, av);
+	    {
+	      size_t pad = mp_.top_pad;
+# ifdef MADV_HUGEPAGE
+	      /* Keep an extra huge page, as heap_trim does.  */
+	      pad += mp_.thp_pagesize;
+# endif
+	      systrim (pad, av);
+	    }
 #endif
 	}
       else
 	{
+	  /* Chunks freed by other threads may border the top chunk.
+	     Merge them before looking up the heap, which heap_trim can
+	     unmap.  */
+	  if (atomic_load_relaxed (&av->remote_free) != NULL)
+	    remote_free_merge (av);
+
 	  /* Always try heap_trim, even if the top chunk is not large,
 	     because the corresponding heap might go away.  */
 	  heap_info *heap = heap_for_ptr (top (av));
@@ -5145,12 +5594,11 @@ _int_memalign (mstate av, size_t alignment, size_t bytes)
    ------------------------------ malloc_trim ------------------------------
  */
 
+/* Release the whole pages within the free chunks of AV with
+   madvise ADVICE.  Return 1 if any memory was released.  */
 static int
-mtrim (mstate av, size_t pad)
+mtrim_chunks (mstate av, int advice)
 {
-  /* Ensure all blocks are consolidated.  */
-  malloc_consolidate (av);
-
   const size_t ps = GLRO (dl_pagesize);
   int psindex = bin_index (ps);
   const size_t psm1 = ps - 1;
@@ -5186,7 +5634,7 @@ mtrim (mstate av, size_t pad)
                        content.  */
                     memset (paligned_mem, 0x89, size & ~psm1);
 #endif
-                    __madvise (paligned_mem, size & ~psm1, MADV_DONTNEED);
+                    __madvise (paligned_mem, size & ~psm1, advice);
 
                     result = 1;
                   }
@@ -5194,6 +5642,18 @@ mtrim (mstate av, size_t pad)
           }
       }
 
+  return result;
+}
+
+static int
+mtrim (mstate av, size_t pad)
+{
+  /* Ensure all blocks are consolidated.  */
+  remote_free_merge (av);
+  malloc_consolidate (av);
+
+  int result = mtrim_chunks (av, MADV_DONTNEED);
+
 #ifndef MORECORE_CANNOT_TRIM
   return result | (av == &main_arena ? systrim (pad, av) : 0);
 
@@ -5202,6 +5662,48 @@ mtrim (mstate av, size_t pad)
 #endif
 }
 
+#if IS_IN (libc) && HAVE_MALLOC_PURGE_THREAD
+/* Called by the background purge thread at each wakeup, with the lock
+   of AV held.  AV->purge_ticks counts the wakeups since the last free
+   into AV.  The first wakeup does nothing, because the free may have
+   happened just before it.  At the second wakeup, after at least one
+   full interval without frees, the free pages are marked with
+   MADV_FREE, so that the kernel can reclaim them under memory pressure.
+   At the third wakeup, they are released with MADV_DONTNEED and the top
+   of the arena is trimmed.  */
+static void
+purge_arena (mstate av)
+{
+  if (av->purge_ticks > 2)
+    return;
+
+  unsigned int ticks = ++av->purge_ticks;
+  int advice;
+  if (ticks == 3)
+    advice = MADV_DONTNEED;
+#ifdef MADV_FREE
+  else if (ticks == 2)
+    advice = MADV_FREE;
+#endif
+  else
+    return;
+
+  remote_free_merge (av);
+  malloc_consolidate (av);
+  mtrim_chunks (av, advice);
+  if (advice == MADV_DONTNEED)
+    {
+      if (av != &main_arena)
+	heap_trim (heap_for_ptr (top (av)), mp_.top_pad);
+#ifndef MORECORE_CANNOT_TRIM
+      else
+	systrim (mp_.top_pad, av);
+#endif
+    }
+  LIBC_PROBE (memory_arena_purge, 2, av, advice);
+}
+#endif
+
 
 int
 __malloc_trim (size_t s)
@@ -5214,7 +5716,7 @@ __malloc_trim (size_t s)
   mstate ar_ptr = &main_arena;
   do
     {
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
       result |= mtrim (ar_ptr, s);
       __libc_lock_unlock (ar_ptr->mutex);
 
@@ -5233,6 +5735,9 @@ __malloc_trim (size_t s)
 static size_t
 musable (void *mem)
 {
+  if (slab_contains (mem))
+    return slab_usable (mem);
+
   mchunkptr p = mem2chunk (mem);
 
   if (chunk_is_mmapped (p))
@@ -5334,7 +5839,7 @@ __libc_mallinfo2 (void)
   ar_ptr = &main_arena;
   do
     {
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
       int_mallinfo (ar_ptr, &m);
       __libc_lock_unlock (ar_ptr->mutex);
 
@@ -5342,6 +5847,15 @@ __libc_mallinfo2 (void)
     }
   while (ar_ptr != &main_arena);
 
+  /* The slab runs are mapped separately.  Their free objects are
+     counted as small free blocks.  */
+  struct slab_stats slab;
+  slab_get_stats (&slab);
+  m.hblks += slab.runs;
+  m.hblkhd += slab.system;
+  m.smblks += slab.nfree;
+  m.fsmblks += slab.free;
+
   return m;
 }
 libc_hidden_def (__libc_mallinfo2)
@@ -5388,7 +5902,7 @@ __malloc_stats (void)
       struct mallinfo2 mi;
 
       memset (&mi, 0, sizeof (mi));
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
       int_mallinfo (ar_ptr, &mi);
       fprintf (stderr, "Arena %d:\n", i);
       fprintf (stderr, "system bytes     = %10u\n", (unsigned int) mi.arena);
@@ -5404,6 +5918,16 @@ __malloc_stats (void)
       if (ar_ptr == &main_arena)
         break;
     }
+  struct slab_stats slab;
+  slab_get_stats (&slab);
+  if (slab.runs != 0)
+    {
+      fprintf (stderr, "Slabs:\n");
+      fprintf (stderr, "system bytes     = %10u\n", (unsigned int) slab.system);
+      fprintf (stderr, "in use bytes     = %10u\n", (unsigned int) slab.used);
+      system_b += slab.system;
+      in_use_b += slab.used;
+    }
   fprintf (stderr, "Total (incl. mmap):\n");
   fprintf (stderr, "system bytes     = %10u\n", system_b);
   fprintf (stderr, "in use bytes     = %10u\n", in_use_b);
@@ -5521,6 +6045,18 @@ do_set_tcache_unsorted_limit (size_t value)
   mp_.tcache_unsorted_limit = value;
   return 1;
 }
+
+static __always_inline int
+do_set_tcache_batch (size_t value)
+{
+  if (value <= MAX_TCACHE_COUNT)
+    {
+      LIBC_PROBE (memory_tunable_tcache_batch, 2, value, mp_.tcache_batch);
+      mp_.tcache_batch = value;
+      return 1;
+    }
+  return 0;
+}
 #endif
 
 static __always_inline int
@@ -5554,6 +6090,66 @@ do_set_hugetlb (size_t value)
   return 0;
 }
 
+static __always_inline int
+do_set_percpu (int32_t value)
+{
+  LIBC_PROBE (memory_tunable_percpu, 2, value, mp_.percpu);
+  mp_.percpu = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_remote_free (int32_t value)
+{
+  LIBC_PROBE (memory_tunable_remote_free, 2, value, mp_.remote_free);
+  mp_.remote_free = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_slab_max (size_t value)
+{
+  if (value <= SLAB_MAX_SIZE)
+    {
+      LIBC_PROBE (memory_tunable_slab_max, 2, value, mp_.slab_max);
+      mp_.slab_max = value;
+      return 1;
+    }
+  return 0;
+}
+
+static __always_inline int
+do_set_purge_interval (int32_t value)
+{
+  LIBC_PROBE (memory_tunable_purge_interval, 2, value, mp_.purge_interval);
+  mp_.purge_interval = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_profile_rate (size_t value)
+{
+  LIBC_PROBE (memory_tunable_profile_rate, 2, value, mp_.profile_rate);
+  mp_.profile_rate = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_arena_spin (int32_t value)
+{
+  LIBC_PROBE (memory_tunable_arena_spin, 2, value, mp_.arena_spin);
+  mp_.arena_spin = value;
+  return 1;
+}
+
+static __always_inline int
+do_set_tcache_counters (int32_t value)
+{
+  LIBC_PROBE (memory_tunable_tcache_counters, 2, value, mp_.tcache_counters);
+  mp_.tcache_counters = value;
+  return 1;
+}
+
 int
 __libc_mallopt (int param_number, int value)
 {
@@ -5562,7 +6158,7 @@ __libc_mallopt (int param_number, int value)
 
   if (!__malloc_initialized)
     ptmalloc_init ();
-  __libc_lock_lock (av->mutex);
+  arena_mutex_lock (av);
 
   LIBC_PROBE (memory_mallopt, 2, param_number, value);
 
@@ -5825,6 +6421,9 @@ __malloc_info (int options, FILE *fp)
   size_t total_max_system = 0;
   size_t total_aspace = 0;
   size_t total_aspace_mprotect = 0;
+  size_t total_nremote = 0;
+  size_t total_remoteavail = 0;
+  size_t total_remote_frees = 0;
 
 
 
@@ -5841,8 +6440,10 @@ __malloc_info (int options, FILE *fp)
 
       size_t nblocks = 0;
       size_t nfastblocks = 0;
+      size_t nremote = 0;
       size_t avail = 0;
       size_t fastavail = 0;
+      size_t remoteavail = 0;
       struct
       {
 	size_t from;
@@ -5852,7 +6453,7 @@ __malloc_info (int options, FILE *fp)
       } sizes[NFASTBINS + NBINS - 1];
 #define nsizes (sizeof (sizes) / sizeof (sizes[0]))
 
-      __libc_lock_lock (ar_ptr->mutex);
+      arena_mutex_lock (ar_ptr);
 
       /* Account for top chunk.  The top-most available chunk is
 	 treated specially and is never in any bin. See "initial_top"
@@ -5921,6 +6522,19 @@ __malloc_info (int options, FILE *fp)
 	  avail += sizes[NFASTBINS - 1 + i].total;
 	}
 
+      /* Chunks cannot be removed from the remote free list while the
+	 arena lock is held, only added at the front.  */
+      for (mchunkptr p = atomic_load_acquire (&ar_ptr->remote_free);
+	   p != NULL; p = REVEAL_PTR (p->fd))
+	{
+	  if (__glibc_unlikely (misaligned_chunk (p)))
+	    malloc_printerr ("__malloc_info(): "
+			     "unaligned remote free chunk detected");
+	  ++nremote;
+	  remoteavail += chunksize (p);
+	}
+      size_t remote_frees = atomic_load_relaxed (&ar_ptr->remote_frees);
+
       size_t heap_size = 0;
       size_t heap_mprotect_size = 0;
       size_t heap_count = 0;
@@ -5946,6 +6560,10 @@ __malloc_info (int options, FILE *fp)
       total_nblocks += nblocks;
       total_avail += avail;
 
+      total_nremote += nremote;
+      total_remoteavail += remoteavail;
+      total_remote_frees += remote_frees;
+
       for (size_t i = 0; i < nsizes; ++i)
 	if (sizes[i].count != 0 && i != NFASTBINS)
 	  fprintf (fp, "\
@@ -5964,10 +6582,12 @@ __malloc_info (int options, FILE *fp)
       fprintf (fp,
 	       "</sizes>\n<total type=\"fast\" count=\"%zu\" size=\"%zu\"/>\n"
 	       "<total type=\"rest\" count=\"%zu\" size=\"%zu\"/>\n"
+	       "<total type=\"remote\" count=\"%zu\" size=\"%zu\"/>\n"
+	       "<remote type=\"frees\" count=\"%zu\"/>\n"
 	       "<system type=\"current\" size=\"%zu\"/>\n"
 	       "<system type=\"max\" size=\"%zu\"/>\n",
-	       nfastblocks, fastavail, nblocks, avail,
-	       ar_ptr->system_mem, ar_ptr->max_system_mem);
+	       nfastblocks, fastavail, nblocks, avail, nremote, remoteavail,
+	       remote_frees, ar_ptr->system_mem, ar_ptr->max_system_mem);
 
       if (ar_ptr != &main_arena)
 	{
@@ -5994,27 +6614,221 @@ __malloc_info (int options, FILE *fp)
     }
   while (ar_ptr != &main_arena);
 
+  struct slab_stats slab;
+  slab_get_stats (&slab);
+
   fprintf (fp,
 	   "<total type=\"fast\" count=\"%zu\" size=\"%zu\"/>\n"
 	   "<total type=\"rest\" count=\"%zu\" size=\"%zu\"/>\n"
 	   "<total type=\"mmap\" count=\"%d\" size=\"%zu\"/>\n"
+	   "<total type=\"remote\" count=\"%zu\" size=\"%zu\"/>\n"
+	   "<remote type=\"frees\" count=\"%zu\"/>\n"
+	   "<total type=\"slab\" count=\"%zu\" size=\"%zu\"/>\n"
+	   "<slab type=\"used\" count=\"%zu\" size=\"%zu\"/>\n"
 	   "<system type=\"current\" size=\"%zu\"/>\n"
 	   "<system type=\"max\" size=\"%zu\"/>\n"
+	   "<system type=\"slab\" size=\"%zu\"/>\n"
 	   "<aspace type=\"total\" size=\"%zu\"/>\n"
 	   "<aspace type=\"mprotect\" size=\"%zu\"/>\n"
 	   "</malloc>\n",
 	   total_nfastblocks, total_fastavail, total_nblocks, total_avail,
 	   mp_.n_mmaps, mp_.mmapped_mem,
-	   total_system, total_max_system,
+	   total_nremote, total_remoteavail, total_remote_frees,
+	   slab.nfree, slab.free, slab.nused, slab.used,
+	   total_system, total_max_system, slab.system,
 	   total_aspace, total_aspace_mprotect);
 
   return 0;
 }
+
 #if IS_IN (libc)
+/* Write the samples of the heap profiler to FP, in the heap profile
+   format of gperftools.  */
+int
+__malloc_profile (int options, FILE *fp)
+{
+  if (!__malloc_initialized)
+    ptmalloc_init ();
+
+  /* For now, at least.  */
+  if (options != 0 || profile_tables == NULL)
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  struct profile_tables *t = profile_tables;
+  size_t alloc_count = 0, alloc_bytes = 0, free_count = 0, free_bytes = 0;
+
+  /* Buckets are never removed.  The lock is not held while writing to
+     FP, which may allocate.  */
+  __libc_lock_lock (profile_lock);
+  unsigned int nbuckets = profile_nbuckets;
+  for (unsigned int i = 1; i < nbuckets; ++i)
+    {
+      alloc_count += t->buckets[i].alloc_count;
+      alloc_bytes += t->buckets[i].alloc_bytes;
+      free_count += t->buckets[i].free_count;
+      free_bytes += t->buckets[i].free_bytes;
+    }
+  __libc_lock_unlock (profile_lock);
+
+  fprintf (fp, "heap profile: %6zu: %8zu [%6zu: %8zu] @ heap_v2/%zu\n",
+	   alloc_count - free_count, alloc_bytes - free_bytes,
+	   alloc_count, alloc_bytes, mp_.profile_rate);
+
+  for (unsigned int i = 1; i < nbuckets; ++i)
+    {
+      struct profile_bucket b;
+      __libc_lock_lock (profile_lock);
+      b = t->buckets[i];
+      __libc_lock_unlock (profile_lock);
+
+      fprintf (fp, "%6zu: %8zu [%6zu: %8zu] @",
+	       b.alloc_count - b.free_count, b.alloc_bytes - b.free_bytes,
+	       b.alloc_count, b.alloc_bytes);
+      for (unsigned int j = 0; j < b.depth; ++j)
+	fprintf (fp, " %p", b.frames[j]);
+      fputs ("\n", fp);
+    }
+
+  /* pprof needs the mappings to symbolize the addresses.  */
+  fputs ("\nMAPPED_LIBRARIES:\n", fp);
+  int fd = __open_nocancel ("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      char buf[1024];
+      ssize_t n;
+      while ((n = __read_nocancel (fd, buf, sizeof (buf))) > 0)
+	fwrite (buf, 1, n, fp);
+      __close_nocancel_nostatus (fd);
+    }
+
+  return 0;
+}
+
+size_t
+__malloc_thread_counters (struct malloc_counters *counters, size_t size)
+{
+  /* Counters added in later versions are zero.  */
+  size_t copied = MIN (size, sizeof (thread_stats.counters));
+  memcpy (counters, &thread_stats.counters, copied);
+  memset ((char *) counters + copied, 0, size - copied);
+  return copied;
+}
+
+/* Write the counters in *C to FP, as the members of a JSON object.  */
+static void
+malloc_counters_json (FILE *fp, const struct malloc_counters *c)
+{
+  fprintf (fp,
+	   "\"tcache_hits\": %zu, \"tcache_misses\": %zu, "
+	   "\"fastbin_hits\": %zu, \"sysmalloc_calls\": %zu, "
+	   "\"mmap_chunks\": %zu, \"lock_contentions\": %zu",
+	   c->tcache_hits, c->tcache_misses, c->fastbin_hits,
+	   c->sysmalloc_calls, c->mmap_chunks, c->lock_contentions);
+}
+
+int
+__malloc_info_json (int options, FILE *fp)
+{
+  if (!__malloc_initialized)
+    ptmalloc_init ();
+
+  /* For now, at least.  */
+  if (options != 0)
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  /* Copy the counters of the threads, so that free_list_lock is not
+     held while writing to FP, which may allocate.  This is done before
+     writing anything, so that nothing is written if it fails.  */
+  struct malloc_counters *threads = NULL;
+  size_t nthreads;
+  size_t capacity = 0;
+  struct malloc_counters exited;
+  while (true)
+    {
+      __libc_lock_lock (free_list_lock);
+      nthreads = 0;
+      list_t *runp;
+      list_for_each (runp, &thread_stats_list)
+	++nthreads;
+      if (nthreads <= capacity)
+	{
+	  if (nthreads > 0)
+	    memset (threads, 0, nthreads * sizeof (*threads));
+	  size_t i = 0;
+	  list_for_each (runp, &thread_stats_list)
+	    malloc_counters_add (&threads[i++],
+				 &list_entry (runp, struct malloc_thread_stats,
+					      list)->counters);
+	  exited = exited_thread_counters;
+	  __libc_lock_unlock (free_list_lock);
+	  break;
+	}
+      __libc_lock_unlock (free_list_lock);
+
+      /* Leave some room for threads started in the meantime.  */
+      __libc_free (threads);
+      capacity = nthreads + 16;
+      threads = __libc_malloc (capacity * sizeof (*threads));
+      if (threads == NULL)
+	return -1;
+    }
+
+  fputs ("{\n  \"version\": 1,\n  \"arenas\": [", fp);
+
+  /* The arena counters are read without the arena locks.  */
+  int n = 0;
+  mstate ar_ptr = &main_arena;
+  do
+    {
+      fprintf (fp,
+	       "%s\n    { \"nr\": %d, \"fastbin_hits\": %zu, "
+	       "\"sysmalloc_calls\": %zu, \"mmap_chunks\": %zu, "
+	       "\"lock_contentions\": %zu }",
+	       n == 0 ? "" : ",", n,
+	       atomic_load_relaxed (&ar_ptr->counters.fastbin_hits),
+	       atomic_load_relaxed (&ar_ptr->counters.sysmalloc_calls),
+	       atomic_load_relaxed (&ar_ptr->counters.mmap_chunks),
+	       atomic_load_relaxed (&ar_ptr->counters.lock_contentions));
+      ++n;
+      ar_ptr = ar_ptr->next;
+    }
+  while (ar_ptr != &main_arena);
+
+  struct malloc_counters total = exited;
+  fputs ("\n  ],\n  \"threads\": [", fp);
+  for (size_t i = 0; i < nthreads; ++i)
+    {
+      fputs (i == 0 ? "\n    { " : ",\n    { ", fp);
+      malloc_counters_json (fp, &threads[i]);
+      fputs (" }", fp);
+      malloc_counters_add (&total, &threads[i]);
+    }
+  __libc_free (threads);
+
+  fputs ("\n  ],\n  \"exited_threads\": { ", fp);
+  malloc_counters_json (fp, &exited);
+  fputs (" },\n  \"total\": { ", fp);
+  malloc_counters_json (fp, &total);
+  fputs (" }\n}\n", fp);
+
+  return 0;
+}
+
 weak_alias (__malloc_info, malloc_info)
+weak_alias (__malloc_profile, malloc_profile)
+weak_alias (__malloc_thread_counters, malloc_thread_counters)
+weak_alias (__malloc_info_json, malloc_info_json)
 
 strong_alias (__libc_calloc, __calloc) weak_alias (__libc_calloc, calloc)
 strong_alias (__libc_free, __free) strong_alias (__libc_free, free)
+strong_alias (__libc_free_sized, free_sized)
+strong_alias (__libc_free_aligned_sized, free_aligned_sized)
 strong_alias (__libc_malloc, __malloc) strong_alias (__libc_malloc, malloc)
 strong_alias (__libc_memalign, __memalign)
 weak_alias (__libc_memalign, memalign)
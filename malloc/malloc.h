@@ -116,6 +116,24 @@ extern struct mallinfo mallinfo (void) __THROW __MALLOC_DEPRECATED;
 /* Returns a copy of the updated current mallinfo. */
 extern struct mallinfo2 mallinfo2 (void) __THROW;
 
+/* Allocator event counters.  */
+
+struct malloc_counters
+{
+  size_t tcache_hits;      /* malloc calls served from the thread cache */
+  size_t tcache_misses;    /* malloc calls which found their bin empty */
+  size_t fastbin_hits;     /* allocations served from a fastbin */
+  size_t sysmalloc_calls;  /* requests for more memory from the system */
+  size_t mmap_chunks;      /* allocations served by mmap'ed chunks */
+  size_t lock_contentions; /* arena lock acquisitions which had to wait */
+};
+
+/* Stores the event counters of the calling thread in *COUNTERS, of
+   SIZE bytes.  Returns the number of bytes stored, which is less than
+   SIZE if the library has fewer counters than the caller.  */
+extern size_t malloc_thread_counters (struct malloc_counters *__counters,
+				      size_t __size) __THROW __nonnull ((1));
+
 /* SVID2/XPG mallopt options */
 #ifndef M_MXFAST
 # define M_MXFAST  1    /* maximum request size for "fastbins" */
@@ -157,5 +175,13 @@ extern void malloc_stats (void) __THROW;
 /* Output information about state of allocator to stream FP.  */
 extern int malloc_info (int __options, FILE *__fp) __THROW;
 
+/* Write the samples of the heap profiler enabled by the
+   glibc.malloc.profile_rate tunable to stream FP.  */
+extern int malloc_profile (int __options, FILE *__fp) __THROW;
+
+/* Output the event counters of all arenas and threads to stream FP,
+   in JSON format.  */
+extern int malloc_info_json (int __options, FILE *__fp) __THROW;
+
 __END_DECLS
 #endif /* malloc.h */
@@ -0,0 +1,465 @@
+/* Sampling heap profiler.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; see the file COPYING.LIB.  If
+   not, see <https://www.gnu.org/licenses/>.  */
+
+/* If the glibc.malloc.profile_rate tunable is set, every thread counts
+   the bytes it allocates down from a random interval, drawn from an
+   exponential distribution with that mean.  The allocation which
+   exhausts the interval is sampled: its call stack is recorded in a
+   bucket shared by all samples with the same stack, and the sample
+   itself is entered into a hash table keyed by its address, so that
+   free can account for it.  Sampling larger allocations with a higher
+   probability in this way makes the profile an unbiased estimate of
+   the allocated bytes.
+
+   All tables are allocated at initialization time.  A small bitmap
+   indexed by the address hash tells free whether a pointer may have
+   been sampled without taking the lock.  Once the tables are full,
+   further samples are dropped.
+
+   __backtrace loads the unwinder from libgcc_s on first use.  This
+   must not happen from within malloc, which can be called with the
+   loader lock held, so the unwinder is loaded by a constructor of libc
+   and no samples are taken before.
+
+   malloc_profile writes the buckets in the text format of the heap
+   profiles of gperftools, which pprof reads.  */
+
+#if IS_IN (libc)
+# include <array_length.h>
+# include <execinfo.h>
+# include <limits.h>
+
+# ifdef SHARED
+#  include <unwind-link.h>
+#  define PROFILE_SUPPORTED 1
+# else
+/* Unwinding would link the unwinder into every static program.  */
+#  define PROFILE_SUPPORTED 0
+# endif
+
+/* Maximum number of recorded frames.  */
+# define PROFILE_DEPTH 32
+
+# define PROFILE_NBUCKETS ((unsigned int) 1 << 14)
+# define PROFILE_NSAMPLES ((unsigned int) 1 << 17)
+
+# define PROFILE_BUCKET_HASH_BITS 14
+# define PROFILE_SAMPLE_HASH_BITS 16
+
+# define PROFILE_FILTER_BITS (sizeof (unsigned long int) * CHAR_BIT)
+
+/* Allocations with the same call stack.  Index 0 is unused, so that 0
+   can terminate the hash chains.  */
+struct profile_bucket
+{
+  size_t alloc_count;
+  size_t alloc_bytes;
+  size_t free_count;
+  size_t free_bytes;
+  /* Next bucket with the same hash.  */
+  unsigned int next;
+  unsigned int depth;
+  void *frames[PROFILE_DEPTH];
+};
+
+/* A sampled allocation which has not been freed yet.  */
+struct profile_sample
+{
+  void *mem;
+  size_t size;
+  unsigned int bucket;
+  /* Next sample with the same hash, or on the free list.  */
+  unsigned int next;
+};
+
+struct profile_tables
+{
+  unsigned int bucket_heads[1 << PROFILE_BUCKET_HASH_BITS];
+  unsigned int sample_heads[1 << PROFILE_SAMPLE_HASH_BITS];
+  struct profile_bucket buckets[PROFILE_NBUCKETS];
+  struct profile_sample samples[PROFILE_NSAMPLES];
+};
+
+/* Bit N is set if the sample hash chain N is not empty.  Written under
+   profile_lock, read by free without it.  NULL if the profiler is not
+   in use.  */
+static unsigned long int *profile_filter;
+
+static struct profile_tables *profile_tables;
+
+/* Protects profile_tables and the fields below.  */
+__libc_lock_define_initialized (static, profile_lock);
+
+/* Number of buckets in use, including the unused bucket 0.  */
+static unsigned int profile_nbuckets;
+
+/* Index of the first sample which has never been used, and the list of
+   unused samples.  */
+static unsigned int profile_next_sample;
+static unsigned int profile_free_samples;
+
+/* Bytes to allocate in this thread until the next sample.  */
+static __thread size_t profile_bytes_left;
+
+/* Set while the current thread takes a sample, so that the allocations
+   made by the unwinder are not sampled.  */
+static __thread bool profile_busy;
+
+/* State of the random number generator, 0 if not seeded yet.  */
+static __thread uint64_t profile_rng;
+
+/* 1 once the unwinder has been loaded, -1 if it cannot be loaded.  */
+static int profile_unwinder;
+
+/* Allocate the tables.  Called from ptmalloc_init if the
+   glibc.malloc.profile_rate tunable is set.  */
+static void
+profile_init (void)
+{
+  if (!PROFILE_SUPPORTED || profile_unwinder < 0)
+    {
+      mp_.profile_rate = 0;
+      return;
+    }
+
+  size_t filter_size = ((1 << PROFILE_SAMPLE_HASH_BITS) / PROFILE_FILTER_BITS
+			* sizeof (unsigned long int));
+  size_t size = ALIGN_UP (filter_size + sizeof (struct profile_tables),
+			  GLRO (dl_pagesize));
+  char *p = MMAP (NULL, size, PROT_READ | PROT_WRITE, MAP_NORESERVE);
+  if (p == MAP_FAILED)
+    {
+      mp_.profile_rate = 0;
+      return;
+    }
+  __set_vma_name (p, size, " glibc: malloc profile");
+
+  profile_tables = (struct profile_tables *) (p + filter_size);
+  profile_nbuckets = 1;
+  profile_next_sample = 1;
+  profile_free_samples = 0;
+  profile_filter = (unsigned long int *) p;
+}
+
+/* Load the unwinder.  Called from a constructor of libc if the
+   glibc.malloc.profile_rate tunable is set.  If this fails, the
+   profiler is disabled.  */
+static void
+profile_load_unwinder (void)
+{
+# if PROFILE_SUPPORTED
+  if (__libc_unwind_link_get () != NULL)
+    {
+      atomic_store_relaxed (&profile_unwinder, 1);
+      return;
+    }
+# endif
+  atomic_store_relaxed (&profile_unwinder, -1);
+  mp_.profile_rate = 0;
+}
+
+/* Return the natural logarithm of X, which must be positive and
+   normal.  */
+static double
+profile_log (double x)
+{
+  union { double d; uint64_t i; } u = { .d = x };
+  int e = (int) ((u.i >> 52) & 0x7ff) - 1023;
+  /* Scale the mantissa to [1, 2).  */
+  u.i = (u.i & (((uint64_t) 1 << 52) - 1)) | ((uint64_t) 1023 << 52);
+
+  /* log (m) = 2 * atanh ((m - 1) / (m + 1)), and |t| <= 1/3.  */
+  double t = (u.d - 1) / (u.d + 1);
+  double t2 = t * t;
+  double l = 2 * t * (1 + t2 * (1.0 / 3 + t2 * (1.0 / 5 + t2 * (1.0 / 7
+							      + t2 / 9))));
+  return e * 0x1.62e42fefa39efp-1 + l;
+}
+
+/* Return the number of bytes until the next sample.  */
+static size_t
+profile_interval (void)
+{
+  /* xorshift64*.  */
+  uint64_t x = profile_rng;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  profile_rng = x;
+  uint64_t r = x * 0x2545f4914f6cdd1dULL;
+
+  /* Uniformly distributed in (0, 1].  */
+  double u = ((r >> 11) + 1) * 0x1.0p-53;
+  double interval = -profile_log (u) * mp_.profile_rate;
+  if (interval >= (double) SIZE_MAX)
+    return SIZE_MAX;
+  return (size_t) interval + 1;
+}
+
+/* Slow path of profile_due.  */
+static bool __attribute_noinline__
+profile_start (size_t bytes)
+{
+  if (profile_busy || atomic_load_relaxed (&profile_unwinder) <= 0)
+    return false;
+
+  if (profile_rng == 0)
+    {
+      profile_rng = ((uint64_t) random_bits () << 32
+		     ^ (uintptr_t) &profile_rng) | 1;
+      profile_bytes_left = profile_interval ();
+      if (bytes < profile_bytes_left)
+	{
+	  profile_bytes_left -= bytes;
+	  return false;
+	}
+    }
+
+  /* The nested call which makes the sampled allocation counts BYTES
+     again.  */
+  size_t interval = profile_interval ();
+  profile_bytes_left = (interval > SIZE_MAX - bytes
+			? SIZE_MAX : interval + bytes);
+  profile_busy = true;
+  return true;
+}
+
+/* Return true if an allocation of BYTES bytes is to be sampled.  The
+   allocation must then be made and passed to profile_sample.  */
+static __always_inline bool
+profile_due (size_t bytes)
+{
+  if (!PROFILE_SUPPORTED || __glibc_likely (mp_.profile_rate == 0))
+    return false;
+  if (__glibc_likely (bytes < profile_bytes_left))
+    {
+      profile_bytes_left -= bytes;
+      return false;
+    }
+  return profile_start (bytes);
+}
+
+static __always_inline size_t
+profile_sample_hash (void *mem)
+{
+  uint64_t h = ((uintptr_t) mem >> 4) * 0x9e3779b97f4a7c15ULL;
+  return h >> (64 - PROFILE_SAMPLE_HASH_BITS);
+}
+
+/* Return false if MEM has certainly not been sampled.  */
+static __always_inline bool
+profile_maybe_sampled (void *mem)
+{
+  if (__glibc_likely (profile_filter == NULL))
+    return false;
+  size_t h = profile_sample_hash (mem);
+  return (atomic_load_relaxed (&profile_filter[h / PROFILE_FILTER_BITS])
+	  & (1UL << (h % PROFILE_FILTER_BITS))) != 0;
+}
+
+/* Return the bucket for the call stack FRAMES of DEPTH frames, or 0 if
+   there is no room for a new one.  Called with profile_lock held.  */
+static unsigned int
+profile_bucket (void **frames, int depth)
+{
+  uint64_t h = depth;
+  for (int i = 0; i < depth; ++i)
+    h = (h ^ (uintptr_t) frames[i]) * 0x100000001b3ULL;
+  h = (h * 0x9e3779b97f4a7c15ULL) >> (64 - PROFILE_BUCKET_HASH_BITS);
+
+  struct profile_tables *t = profile_tables;
+  for (unsigned int i = t->bucket_heads[h]; i != 0; i = t->buckets[i].next)
+    if (t->buckets[i].depth == depth
+	&& memcmp (t->buckets[i].frames, frames, depth * sizeof (void *)) == 0)
+      return i;
+
+  if (profile_nbuckets == PROFILE_NBUCKETS)
+    return 0;
+  unsigned int i = profile_nbuckets++;
+  struct profile_bucket *b = &t->buckets[i];
+  b->depth = depth;
+  memcpy (b->frames, frames, depth * sizeof (void *));
+  b->next = t->bucket_heads[h];
+  t->bucket_heads[h] = i;
+  return i;
+}
+
+/* Record the allocation MEM of BYTES bytes, requested by the function
+   returning to CALLER.  */
+static void
+profile_record (void *mem, size_t bytes, void *caller)
+{
+  /* Leave some room for the malloc frames, which are skipped.  */
+  void *frames[PROFILE_DEPTH + 8];
+  int depth = __backtrace (frames, array_length (frames));
+  int first = 0;
+  while (first < depth && frames[first] != caller)
+    ++first;
+  if (first == depth)
+    first = 0;
+  depth = MIN (depth - first, PROFILE_DEPTH);
+
+  struct profile_tables *t = profile_tables;
+  __libc_lock_lock (profile_lock);
+  unsigned int b = profile_bucket (frames + first, depth);
+  unsigned int s = profile_free_samples;
+  if (s != 0)
+    profile_free_samples = t->samples[s].next;
+  else if (profile_next_sample < PROFILE_NSAMPLES)
+    s = profile_next_sample++;
+  if (b != 0 && s != 0)
+    {
+      t->buckets[b].alloc_count++;
+      t->buckets[b].alloc_bytes += bytes;
+
+      size_t h = profile_sample_hash (mem);
+      t->samples[s].mem = mem;
+      t->samples[s].size = bytes;
+      t->samples[s].bucket = b;
+      t->samples[s].next = t->sample_heads[h];
+      t->sample_heads[h] = s;
+      unsigned long int *word = &profile_filter[h / PROFILE_FILTER_BITS];
+      atomic_store_relaxed (word, *word | (1UL << (h % PROFILE_FILTER_BITS)));
+    }
+  else if (s != 0)
+    {
+      t->samples[s].next = profile_free_samples;
+      profile_free_samples = s;
+    }
+  __libc_lock_unlock (profile_lock);
+}
+
+/* Record the sampled allocation MEM of BYTES bytes and return it.  */
+static void * __attribute_noinline__
+profile_sample (void *mem, size_t bytes, void *caller)
+{
+  if (mem != NULL)
+    {
+      int err = errno;
+      profile_record (mem, bytes, caller);
+      __set_errno (err);
+    }
+  profile_busy = false;
+  return mem;
+}
+
+/* Remove the sample for MEM from the hash table and return it, or 0
+   if MEM has not been sampled.  Called with profile_lock held.  */
+static unsigned int
+profile_unlink (void *mem)
+{
+  struct profile_tables *t = profile_tables;
+  size_t h = profile_sample_hash (mem);
+
+  unsigned int *link = &t->sample_heads[h];
+  while (*link != 0 && t->samples[*link].mem != mem)
+    link = &t->samples[*link].next;
+  unsigned int s = *link;
+  if (s != 0)
+    {
+      *link = t->samples[s].next;
+      if (t->sample_heads[h] == 0)
+	{
+	  unsigned long int *word = &profile_filter[h / PROFILE_FILTER_BITS];
+	  atomic_store_relaxed (word,
+				*word & ~(1UL << (h % PROFILE_FILTER_BITS)));
+	}
+    }
+  return s;
+}
+
+/* Account for the deallocation of the sample S, which has been removed
+   from the hash table, and put it on the free list.  Called with
+   profile_lock held.  */
+static void
+profile_release (unsigned int s)
+{
+  struct profile_tables *t = profile_tables;
+  struct profile_bucket *b = &t->buckets[t->samples[s].bucket];
+  b->free_count++;
+  b->free_bytes += t->samples[s].size;
+
+  t->samples[s].next = profile_free_samples;
+  profile_free_samples = s;
+}
+
+/* Account for the deallocation of MEM if it has been sampled.  */
+static void
+profile_free (void *mem)
+{
+  __libc_lock_lock (profile_lock);
+  unsigned int s = profile_unlink (mem);
+  if (s != 0)
+    profile_release (s);
+  __libc_lock_unlock (profile_lock);
+}
+
+/* Detach the sample for MEM, which is about to be reallocated, and
+   return it, or 0 if MEM has not been sampled.  While it is detached,
+   a new allocation at the same address can be sampled.  */
+static unsigned int
+profile_realloc_start (void *mem)
+{
+  __libc_lock_lock (profile_lock);
+  unsigned int s = profile_unlink (mem);
+  __libc_lock_unlock (profile_lock);
+  return s;
+}
+
+/* Finish the reallocation of the sample S returned by
+   profile_realloc_start.  If the reallocation has failed, the original
+   allocation is still live, and S is put back into the hash table.  */
+static void
+profile_realloc_finish (unsigned int s, bool success)
+{
+  if (s == 0)
+    return;
+
+  struct profile_tables *t = profile_tables;
+  __libc_lock_lock (profile_lock);
+  if (success)
+    profile_release (s);
+  else
+    {
+      size_t h = profile_sample_hash (t->samples[s].mem);
+      t->samples[s].next = t->sample_heads[h];
+      t->sample_heads[h] = s;
+      unsigned long int *word = &profile_filter[h / PROFILE_FILTER_BITS];
+      atomic_store_relaxed (word, *word | (1UL << (h % PROFILE_FILTER_BITS)));
+    }
+  __libc_lock_unlock (profile_lock);
+}
+
+static void
+profile_fork_lock (void)
+{
+  __libc_lock_lock (profile_lock);
+}
+
+static void
+profile_fork_unlock_parent (void)
+{
+  __libc_lock_unlock (profile_lock);
+}
+
+static void
+profile_fork_unlock_child (void)
+{
+  __libc_lock_init (profile_lock);
+}
+#endif
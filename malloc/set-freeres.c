@@ -47,6 +47,7 @@
 # pragma weak __libc_regcomp_freemem
 # pragma weak __libc_atfork_freemem
 # pragma weak __res_thread_freeres
+# pragma weak __res_cache_freemem
 # pragma weak __libc_resolv_conf_freemem
 # pragma weak __libc_printf_freemem
 # pragma weak __libc_fmtmsg_freemem
@@ -160,6 +161,8 @@ __libc_freeres (void)
 	 which in turn drop the reference count of the current global object.
 	 So it need to be before __libc_resolv_conf_freemem.  */
       call_function_static_weak (__res_thread_freeres);
+      /* Cache entries hold references to resolv_conf objects, too.  */
+      call_function_static_weak (__res_cache_freemem);
       call_function_static_weak (__libc_resolv_conf_freemem);
       call_function_static_weak (__libc_printf_freemem);
       call_function_static_weak (__libc_fmtmsg_freemem);
@@ -0,0 +1,415 @@
+/* Size-class slab allocator for small requests.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public License as
+   published by the Free Software Foundation; either version 2.1 of the
+   License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; see the file COPYING.LIB.  If
+   not, see <https://www.gnu.org/licenses/>.  */
+
+/* If the glibc.malloc.slab_max tunable is set, requests of up to that
+   many bytes are served from runs of equally sized objects instead of
+   from the arenas.  The objects carry no chunk header; the size class
+   of an object is found through a descriptor kept outside of the run.
+
+   All runs live in a single address range which is reserved at
+   initialization time, so that free, realloc and malloc_usable_size can
+   tell slab objects from chunks with a single comparison.  Runs are
+   made accessible when they are first used.  Once the range is
+   exhausted, small requests fall back to the arenas.
+
+   Each size class has its own lock and a list of runs with free
+   objects.  Free objects within a run are linked through their first
+   word, which is protected like the fastbin and tcache links.  Runs
+   which become empty are returned to the kernel with MADV_DONTNEED and
+   can be reused for any size class.  */
+
+/* The largest request that can be served from a slab.  */
+#define SLAB_MAX_SIZE 256
+
+#define SLAB_NCLASSES (SLAB_MAX_SIZE / MALLOC_ALIGNMENT)
+
+/* Each run is 64 KiB.  */
+#define SLAB_RUN_SHIFT 16
+#define SLAB_RUN_SIZE ((size_t) 1 << SLAB_RUN_SHIFT)
+
+/* Size of the reserved address range.  */
+#if __WORDSIZE == 64
+# define SLAB_REGION_SIZE ((size_t) 1 << 32)
+#else
+# define SLAB_REGION_SIZE ((size_t) 1 << 26)
+#endif
+
+#define SLAB_NRUNS (SLAB_REGION_SIZE >> SLAB_RUN_SHIFT)
+
+/* Out-of-line descriptor of a run.  All fields except cls are
+   protected by the lock of the size class the run belongs to.  */
+struct slab_run
+{
+  /* Neighbors on the list of runs with free objects of the class.  */
+  struct slab_run *next;
+  struct slab_run *prev;
+  /* Free objects which have been allocated before.  */
+  void *free;
+  /* Number of objects handed out by bumping, and currently in use.  */
+  unsigned int carved;
+  unsigned int used;
+  /* Size class index plus one, or 0 if the run is unused.  Written
+     before the run is published under the class lock.  */
+  unsigned int cls;
+  /* Set if the run is on the list of its size class.  */
+  bool listed;
+};
+
+struct slab_class
+{
+  __libc_lock_define (, lock);
+  /* Runs with free objects.  */
+  struct slab_run *partial;
+  /* Number of runs of the class and of objects in use, for the
+     statistics.  */
+  size_t runs;
+  size_t used;
+};
+
+/* Base of the reserved address range, or NULL if slabs are not in use.  */
+static char *slab_base;
+
+static struct slab_run *slab_runs;
+static struct slab_class slab_classes[SLAB_NCLASSES];
+
+/* Protects slab_next_run and slab_empty.  */
+__libc_lock_define_initialized (static, slab_lock);
+
+#if IS_IN (libc)
+/* Index of the first run which has never been used.  */
+static size_t slab_next_run;
+
+/* Runs which have been used before and are now empty, linked through
+   their next pointers.  */
+static struct slab_run *slab_empty;
+#endif
+
+/* Return true if MEM was allocated from a slab.  */
+static __always_inline bool
+slab_contains (void *mem)
+{
+  return slab_base != NULL
+	 && (uintptr_t) mem - (uintptr_t) slab_base < SLAB_REGION_SIZE;
+}
+
+static __always_inline size_t
+slab_class_size (unsigned int cls)
+{
+  return (cls + 1) * MALLOC_ALIGNMENT;
+}
+
+static __always_inline unsigned int
+slab_size_to_class (size_t bytes)
+{
+  return bytes == 0 ? 0 : (bytes - 1) / MALLOC_ALIGNMENT;
+}
+
+static __always_inline struct slab_run *
+slab_run_of (void *mem)
+{
+  return &slab_runs[((char *) mem - slab_base) >> SLAB_RUN_SHIFT];
+}
+
+static __always_inline char *
+slab_run_base (struct slab_run *run)
+{
+  return slab_base + ((size_t) (run - slab_runs) << SLAB_RUN_SHIFT);
+}
+
+#if IS_IN (libc)
+/* Reserve the address range for the slabs.  Called from ptmalloc_init
+   if the glibc.malloc.slab_max tunable is set.  */
+static void
+slab_init (void)
+{
+  /* Memory tagging relies on the chunk layout.  */
+  if (mtag_enabled)
+    {
+      mp_.slab_max = 0;
+      return;
+    }
+
+  size_t runs_size = ALIGN_UP (SLAB_NRUNS * sizeof (struct slab_run),
+			       GLRO (dl_pagesize));
+  void *runs = MMAP (NULL, runs_size, PROT_READ | PROT_WRITE, MAP_NORESERVE);
+  if (runs == MAP_FAILED)
+    {
+      mp_.slab_max = 0;
+      return;
+    }
+
+  /* The runs are aligned to their size so that the descriptor index
+     can be computed from any address within a run.  */
+  char *p = MMAP (NULL, SLAB_REGION_SIZE + SLAB_RUN_SIZE, PROT_NONE,
+		  MAP_NORESERVE);
+  if (p == MAP_FAILED)
+    {
+      __munmap (runs, runs_size);
+      mp_.slab_max = 0;
+      return;
+    }
+  char *base = PTR_ALIGN_UP (p, SLAB_RUN_SIZE);
+  size_t head = base - p;
+  if (head != 0)
+    __munmap (p, head);
+  if (head != SLAB_RUN_SIZE)
+    __munmap (base + SLAB_REGION_SIZE, SLAB_RUN_SIZE - head);
+  __set_vma_name (runs, runs_size, " glibc: malloc slab");
+  __set_vma_name (base, SLAB_REGION_SIZE, " glibc: malloc slab");
+
+  for (size_t i = 0; i < SLAB_NCLASSES; ++i)
+    __libc_lock_init (slab_classes[i].lock);
+  slab_runs = runs;
+  slab_base = base;
+}
+
+/* Get an empty run for size class CLS.  Return NULL if the address
+   range is exhausted.  */
+static struct slab_run *
+slab_new_run (unsigned int cls)
+{
+  struct slab_run *run;
+
+  __libc_lock_lock (slab_lock);
+  run = slab_empty;
+  if (run != NULL)
+    slab_empty = run->next;
+  else if (slab_next_run < SLAB_NRUNS)
+    {
+      run = &slab_runs[slab_next_run];
+      if (__mprotect (slab_run_base (run), SLAB_RUN_SIZE,
+		      PROT_READ | PROT_WRITE) != 0)
+	run = NULL;
+      else
+	++slab_next_run;
+    }
+  __libc_lock_unlock (slab_lock);
+
+  if (run != NULL)
+    {
+      run->next = run->prev = NULL;
+      run->free = NULL;
+      run->carved = 0;
+      run->used = 0;
+      run->cls = cls + 1;
+      run->listed = false;
+    }
+  return run;
+}
+
+/* Allocate an object of at least BYTES bytes, which must not exceed
+   mp_.slab_max.  Return NULL if no slab memory is available.  */
+static void *
+slab_malloc (size_t bytes)
+{
+  unsigned int cls = slab_size_to_class (bytes);
+  size_t size = slab_class_size (cls);
+  struct slab_class *sc = &slab_classes[cls];
+  void *mem;
+
+  __libc_lock_lock (sc->lock);
+  struct slab_run *run = sc->partial;
+  if (run == NULL)
+    {
+      run = slab_new_run (cls);
+      if (run == NULL)
+	{
+	  __libc_lock_unlock (sc->lock);
+	  return NULL;
+	}
+      run->listed = true;
+      sc->partial = run;
+      ++sc->runs;
+    }
+
+  if (run->free != NULL)
+    {
+      mem = run->free;
+      if (__glibc_unlikely (!aligned_OK (mem)))
+	malloc_printerr ("malloc(): unaligned slab object detected");
+      run->free = REVEAL_PTR (*(void **) mem);
+    }
+  else
+    mem = slab_run_base (run) + run->carved++ * size;
+  ++run->used;
+  ++sc->used;
+
+  /* Take full runs off the list.  */
+  if (run->free == NULL && (run->carved + 1) * size > SLAB_RUN_SIZE)
+    {
+      sc->partial = run->next;
+      if (run->next != NULL)
+	run->next->prev = NULL;
+      run->next = NULL;
+      run->listed = false;
+    }
+  __libc_lock_unlock (sc->lock);
+
+  return mem;
+}
+
+/* Return the object MEM to its run.  */
+static void
+slab_free (void *mem)
+{
+  struct slab_run *run = slab_run_of (mem);
+  unsigned int cls = run->cls - 1;
+  if (__glibc_unlikely (cls >= SLAB_NCLASSES))
+    malloc_printerr ("free(): invalid pointer");
+  size_t size = slab_class_size (cls);
+  size_t offset = (char *) mem - slab_run_base (run);
+  struct slab_class *sc = &slab_classes[cls];
+
+  __libc_lock_lock (sc->lock);
+  if (__glibc_unlikely (offset % size != 0 || offset >= run->carved * size))
+    malloc_printerr ("free(): invalid pointer");
+  /* Check that the first free object is not the one we are going to
+     add (i.e., double free).  */
+  if (__glibc_unlikely (mem == run->free || run->used == 0))
+    malloc_printerr ("double free or corruption (slab)");
+
+  free_perturb (mem, size);
+  *(void **) mem = PROTECT_PTR (mem, run->free);
+  run->free = mem;
+  --run->used;
+  --sc->used;
+
+  if (!run->listed)
+    {
+      run->next = sc->partial;
+      run->prev = NULL;
+      if (sc->partial != NULL)
+	sc->partial->prev = run;
+      sc->partial = run;
+      run->listed = true;
+    }
+  else if (run->used == 0 && (run->prev != NULL || run->next != NULL))
+    {
+      /* Release the run if it is empty and the class has other runs
+	 with free objects.  */
+      if (run->prev != NULL)
+	run->prev->next = run->next;
+      else
+	sc->partial = run->next;
+      if (run->next != NULL)
+	run->next->prev = run->prev;
+      run->cls = 0;
+      --sc->runs;
+      __libc_lock_unlock (sc->lock);
+
+      __madvise (slab_run_base (run), SLAB_RUN_SIZE, MADV_DONTNEED);
+      __libc_lock_lock (slab_lock);
+      run->next = slab_empty;
+      slab_empty = run;
+      __libc_lock_unlock (slab_lock);
+      return;
+    }
+  __libc_lock_unlock (sc->lock);
+}
+#endif
+
+/* Return the usable size of the slab object MEM.  */
+static size_t
+slab_usable (void *mem)
+{
+  unsigned int cls = slab_run_of (mem)->cls;
+  return cls == 0 ? 0 : slab_class_size (cls - 1);
+}
+
+#if IS_IN (libc)
+/* Resize the slab object OLDMEM to BYTES bytes.  The object is kept if
+   it is large enough and not more than twice as large as needed.  */
+static void *
+slab_realloc (void *oldmem, size_t bytes)
+{
+  size_t oldsize = slab_usable (oldmem);
+  if (bytes <= oldsize && bytes > oldsize / 2)
+    return oldmem;
+
+  void *newmem = __libc_malloc (bytes);
+  if (newmem == NULL)
+    return NULL;
+  memcpy (newmem, oldmem, MIN (oldsize, bytes));
+  slab_free (oldmem);
+  return newmem;
+}
+#endif
+
+struct slab_stats
+{
+  /* Number of runs and the memory they occupy.  */
+  size_t runs;
+  size_t system;
+  /* Objects in use and free objects in the runs, and their sizes.  */
+  size_t nused;
+  size_t used;
+  size_t nfree;
+  size_t free;
+};
+
+/* Store the statistics of the slab allocator in *STATS.  */
+static void
+slab_get_stats (struct slab_stats *stats)
+{
+  memset (stats, 0, sizeof (*stats));
+  if (slab_base == NULL)
+    return;
+
+  for (unsigned int cls = 0; cls < SLAB_NCLASSES; ++cls)
+    {
+      struct slab_class *sc = &slab_classes[cls];
+      size_t size = slab_class_size (cls);
+      __libc_lock_lock (sc->lock);
+      size_t runs = sc->runs;
+      size_t used = sc->used;
+      __libc_lock_unlock (sc->lock);
+
+      size_t nfree = runs * (SLAB_RUN_SIZE / size) - used;
+      stats->runs += runs;
+      stats->nused += used;
+      stats->used += used * size;
+      stats->nfree += nfree;
+      stats->free += nfree * size;
+    }
+  stats->system = stats->runs * SLAB_RUN_SIZE;
+}
+
+/* The class locks are acquired before slab_lock, as in slab_malloc.  */
+static void
+slab_fork_lock (void)
+{
+  for (size_t i = 0; i < SLAB_NCLASSES; ++i)
+    __libc_lock_lock (slab_classes[i].lock);
+  __libc_lock_lock (slab_lock);
+}
+
+static void
+slab_fork_unlock_parent (void)
+{
+  __libc_lock_unlock (slab_lock);
+  for (size_t i = 0; i < SLAB_NCLASSES; ++i)
+    __libc_lock_unlock (slab_classes[i].lock);
+}
+
+static void
+slab_fork_unlock_child (void)
+{
+  for (size_t i = 0; i < SLAB_NCLASSES; ++i)
+    __libc_lock_init (slab_classes[i].lock);
+  __libc_lock_init (slab_lock);
+}
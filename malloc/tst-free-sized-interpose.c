@@ -0,0 +1,51 @@
+/* Test free_sized and free_aligned_sized with a replacement malloc.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The replacement malloc in tst-interpose-aux.c does not define
+   free_sized and free_aligned_sized, so the definitions in libc are
+   used.  They must pass the pointers to the replacement free.  */
+
+#include <stdlib.h>
+#include <support/check.h>
+
+#include "tst-interpose-aux.h"
+
+static int
+do_test (void)
+{
+  /* The replacement free reports pointers it has not allocated.  */
+  for (size_t size = 1; size <= 1024; size *= 2)
+    {
+      void *p = malloc (size);
+      TEST_VERIFY_EXIT (p != NULL);
+      size_t count = malloc_deallocation_count ();
+      free_sized (p, size);
+      TEST_COMPARE (malloc_deallocation_count (), count + 1);
+
+      p = malloc (size);
+      TEST_VERIFY_EXIT (p != NULL);
+      count = malloc_deallocation_count ();
+      free_aligned_sized (p, 1, size);
+      TEST_COMPARE (malloc_deallocation_count (), count + 1);
+    }
+
+  free_sized (NULL, 0);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,131 @@
+/* Test free_sized and free_aligned_sized.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+
+enum
+  {
+    block_count = 1000,
+    rounds = 20,
+  };
+
+struct block
+{
+  unsigned char *p;
+  size_t size;
+  size_t alignment;
+};
+
+static struct block blocks[block_count];
+
+/* Allocate block I with a size and allocation function depending on
+   SEED, and fill it with a pattern.  */
+static void
+allocate (int i, unsigned int seed)
+{
+  struct block *b = &blocks[i];
+  unsigned int r = (i * 2654435761U) ^ seed;
+
+  /* Mostly small sizes, which are cached, and a few mmapped blocks.  */
+  if (r % 97 == 0)
+    b->size = 256 * 1024 + r % 4096;
+  else
+    b->size = r % 1100;
+  b->alignment = 0;
+
+  switch (r % 5)
+    {
+    case 0:
+      b->p = xcalloc (1, b->size);
+      for (size_t j = 0; j < b->size; ++j)
+	TEST_COMPARE (b->p[j], 0);
+      break;
+    case 1:
+      b->p = xmalloc (b->size / 2 + 1);
+      b->p = xrealloc (b->p, b->size);
+      break;
+    case 2:
+      b->alignment = (size_t) 16 << (r % 7);
+      b->p = aligned_alloc (b->alignment, b->size);
+      TEST_VERIFY_EXIT (b->p != NULL);
+      TEST_COMPARE ((uintptr_t) b->p % b->alignment, 0);
+      break;
+    default:
+      b->p = xmalloc (b->size);
+      break;
+    }
+  memset (b->p, i, b->size);
+}
+
+static void
+deallocate (int i)
+{
+  struct block *b = &blocks[i];
+  for (size_t j = 0; j < b->size; ++j)
+    if (b->p[j] != (unsigned char) i)
+      FAIL_EXIT1 ("block %d of size %zu corrupted at offset %zu",
+		  i, b->size, j);
+
+  if (b->alignment != 0)
+    free_aligned_sized (b->p, b->alignment, b->size);
+  else
+    free_sized (b->p, b->size);
+  b->p = NULL;
+}
+
+static int
+do_test (void)
+{
+  free_sized (NULL, 0);
+  free_sized (NULL, 100);
+  free_aligned_sized (NULL, 64, 64);
+
+  /* Both functions preserve errno, like free.  */
+  void *p = xmalloc (100);
+  errno = 1789;
+  free_sized (p, 100);
+  TEST_COMPARE (errno, 1789);
+  p = aligned_alloc (4096, 4096);
+  TEST_VERIFY_EXIT (p != NULL);
+  free_aligned_sized (p, 4096, 4096);
+  TEST_COMPARE (errno, 1789);
+
+  /* Free the blocks in a different order than they were allocated in,
+     and reuse the memory for blocks of other sizes.  */
+  for (int i = 0; i < block_count; ++i)
+    allocate (i, 0);
+  for (unsigned int round = 1; round <= rounds; ++round)
+    {
+      for (int i = round % 3; i < block_count; i += 3)
+	{
+	  deallocate (i);
+	  allocate (i, round);
+	}
+    }
+  for (int i = block_count - 1; i >= 0; --i)
+    deallocate (i);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,114 @@
+/* Test contended arena locks with glibc.malloc.arena_spin.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+/* The tcache is disabled and the number of arenas limited by
+   tst-malloc-arena-spin-ENV, so that every allocation and free
+   acquires a shared arena lock.  */
+enum
+  {
+    thread_count = 8,
+    block_count = 64,
+    rounds = 2000,
+  };
+
+static pthread_barrier_t barrier;
+
+struct block
+{
+  unsigned char *p;
+  size_t size;
+};
+
+static void *
+thread_func (void *closure)
+{
+  unsigned int seed = (uintptr_t) closure;
+  struct block blocks[block_count] = { };
+
+  xpthread_barrier_wait (&barrier);
+  for (int round = 0; round < rounds; ++round)
+    for (int i = 0; i < block_count; ++i)
+      {
+	seed = seed * 1103515245 + 12345;
+	if (blocks[i].p != NULL)
+	  {
+	    for (size_t j = 0; j < blocks[i].size; ++j)
+	      if (blocks[i].p[j] != (unsigned char) i)
+		FAIL_EXIT1 ("block %d of size %zu corrupted at offset %zu",
+			    i, blocks[i].size, j);
+	    free (blocks[i].p);
+	  }
+	blocks[i].size = (seed >> 16) % 2048;
+	blocks[i].p = xmalloc (blocks[i].size);
+	memset (blocks[i].p, i, blocks[i].size);
+      }
+
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i].p);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, thread_count);
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) (uintptr_t) i);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  xpthread_barrier_destroy (&barrier);
+
+  /* The threads could have been scheduled one after the other, so
+     contention is likely, but not guaranteed.  */
+  struct malloc_counters total = { };
+  bool found = false;
+  FILE *fp = tmpfile ();
+  TEST_VERIFY_EXIT (fp != NULL);
+  TEST_COMPARE (malloc_info_json (0, fp), 0);
+  rewind (fp);
+  char line[1024];
+  while (fgets (line, sizeof (line), fp) != NULL)
+    if (sscanf (line, "  \"total\": { \"tcache_hits\": %zu, "
+		"\"tcache_misses\": %zu, \"fastbin_hits\": %zu, "
+		"\"sysmalloc_calls\": %zu, \"mmap_chunks\": %zu, "
+		"\"lock_contentions\": %zu }",
+		&total.tcache_hits, &total.tcache_misses, &total.fastbin_hits,
+		&total.sysmalloc_calls, &total.mmap_chunks,
+		&total.lock_contentions) == 6)
+      found = true;
+  fclose (fp);
+  printf ("info: %zu contended arena lock acquisitions\n",
+	  total.lock_contentions);
+  TEST_VERIFY (found);
+  TEST_COMPARE (total.tcache_hits, 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
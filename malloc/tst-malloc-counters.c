@@ -0,0 +1,210 @@
+/* Test malloc_thread_counters and malloc_info_json.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The test runs with glibc.malloc.tcache_counters=1, so that the
+   thread cache hits and misses are counted.  */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xmemstream.h>
+#include <support/xstdio.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    thread_count = 4,
+    small_count = 20,
+  };
+
+static pthread_barrier_t barrier;
+static struct malloc_counters thread_counters[thread_count];
+
+/* Return the output of malloc_info_json.  */
+static char *
+get_json (void)
+{
+  struct xmemstream mem;
+  xopen_memstream (&mem);
+  TEST_COMPARE (malloc_info_json (0, mem.out), 0);
+  xfclose_memstream (&mem);
+  return mem.buffer;
+}
+
+/* Return the value of the member NAME of the first object in JSON
+   after the string OBJECT.  */
+static size_t
+get_member (const char *json, const char *object, const char *name)
+{
+  const char *p = strstr (json, object);
+  TEST_VERIFY_EXIT (p != NULL);
+  char *key = xasprintf ("\"%s\": ", name);
+  p = strstr (p, key);
+  TEST_VERIFY_EXIT (p != NULL);
+  size_t result = strtoul (p + strlen (key), NULL, 10);
+  free (key);
+  return result;
+}
+
+/* Return the number of entries in the threads array of JSON.  */
+static int
+count_threads (const char *json)
+{
+  const char *p = strstr (json, "\"threads\": [");
+  const char *end = strstr (json, "\"exited_threads\"");
+  TEST_VERIFY_EXIT (p != NULL && end != NULL);
+  int count = 0;
+  while ((p = strstr (p, "\"tcache_hits\"")) != NULL && p < end)
+    {
+      ++count;
+      ++p;
+    }
+  return count;
+}
+
+/* Return the event counters of the calling thread.  */
+static struct malloc_counters
+get_counters (void)
+{
+  struct malloc_counters c;
+  TEST_COMPARE (malloc_thread_counters (&c, sizeof (c)), sizeof (c));
+  return c;
+}
+
+/* Allocate and free small blocks, which are served from the tcache
+   and from the fastbins.  */
+static void
+allocate_small (void)
+{
+  void *p[small_count];
+  for (int round = 0; round < 10; ++round)
+    {
+      for (int i = 0; i < small_count; ++i)
+	p[i] = xmalloc (32);
+      for (int i = 0; i < small_count; ++i)
+	free (p[i]);
+    }
+}
+
+static void *
+thread_func (void *closure)
+{
+  int i = (int) (intptr_t) closure;
+  allocate_small ();
+  thread_counters[i] = get_counters ();
+  TEST_VERIFY (thread_counters[i].tcache_hits > 0);
+
+  /* Keep the thread alive while the main thread checks the counters.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  errno = 0;
+  TEST_COMPARE (malloc_info_json (1, stdout), -1);
+  TEST_COMPARE (errno, EINVAL);
+
+  struct malloc_counters before = get_counters ();
+  allocate_small ();
+  struct malloc_counters after = get_counters ();
+  TEST_VERIFY (after.tcache_hits > before.tcache_hits);
+  TEST_VERIFY (after.tcache_misses > before.tcache_misses);
+  TEST_VERIFY (after.fastbin_hits > before.fastbin_hits);
+
+  /* Members unknown to the library are cleared.  */
+  struct
+  {
+    struct malloc_counters c;
+    size_t extra;
+  } larger;
+  memset (&larger, 0xff, sizeof (larger));
+  TEST_COMPARE (malloc_thread_counters (&larger.c, sizeof (larger)),
+		sizeof (larger.c));
+  TEST_COMPARE (larger.c.fastbin_hits, after.fastbin_hits);
+  TEST_COMPARE (larger.extra, 0);
+
+  /* The first allocation above the mmap threshold is mmap'ed.  The
+     threshold is the huge page size with glibc.malloc.hugetlb.  */
+  before = after;
+  void *large = xmalloc (8 * 1024 * 1024);
+  after = get_counters ();
+  TEST_COMPARE (after.mmap_chunks, before.mmap_chunks + 1);
+  TEST_VERIFY (after.sysmalloc_calls > before.sysmalloc_calls);
+  free (large);
+
+  char *json = get_json ();
+  TEST_VERIFY (strncmp (json, "{\n  \"version\": 1,", 16) == 0);
+  TEST_VERIFY (get_member (json, "\"nr\": 0", "fastbin_hits") > 0);
+  TEST_COMPARE (count_threads (json), 1);
+  free (json);
+
+  xpthread_barrier_init (&barrier, NULL, thread_count + 1);
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, thread_func, (void *) (intptr_t) i);
+  xpthread_barrier_wait (&barrier);
+
+  json = get_json ();
+  TEST_COMPARE (count_threads (json), thread_count + 1);
+  free (json);
+
+  /* Only the forking thread exists in the child.  */
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      json = get_json ();
+      TEST_COMPARE (count_threads (json), 1);
+      free (json);
+      exit (support_record_failure_is_failed () ? 1 : 0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  xpthread_barrier_destroy (&barrier);
+
+  /* The counters of the exited threads are kept.  */
+  size_t tcache_hits = 0;
+  for (int i = 0; i < thread_count; ++i)
+    tcache_hits += thread_counters[i].tcache_hits;
+  after = get_counters ();
+  json = get_json ();
+  TEST_COMPARE (count_threads (json), 1);
+  TEST_VERIFY (get_member (json, "\"exited_threads\"", "tcache_hits")
+	       >= tcache_hits);
+  TEST_VERIFY (get_member (json, "\"total\"", "tcache_hits")
+	       >= tcache_hits + after.tcache_hits);
+  TEST_VERIFY (get_member (json, "\"total\"", "mmap_chunks")
+	       >= after.mmap_chunks);
+  free (json);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
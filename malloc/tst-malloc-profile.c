@@ -0,0 +1,205 @@
+/* Test the sampling heap profiler (glibc.malloc.profile_rate).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <errno.h>
+#include <malloc.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xmemstream.h>
+#include <support/xstdio.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    /* Must match tst-malloc-profile-ENV.  */
+    profile_rate = 4096,
+    block_size = 1000,
+    block_count = 2000,
+    thread_count = 4,
+  };
+
+static void *blocks[block_count];
+
+struct counts
+{
+  size_t inuse_count;
+  size_t inuse_bytes;
+  size_t alloc_count;
+  size_t alloc_bytes;
+};
+
+/* The allocations whose call stack starts in this function are counted
+   separately by get_profile.  */
+static void * __attribute__ ((noinline, noclone))
+allocate_block (size_t size, int i)
+{
+  void *p = i % 2 == 0 ? malloc (size) : calloc (1, size);
+  TEST_VERIFY_EXIT (p != NULL);
+  memset (p, 0xa5, size);
+  return p;
+}
+
+/* Write the heap profile, and return the totals in *TOTAL and the
+   counts of the allocations made by allocate_block in *BLOCK.  */
+static void
+get_profile (struct counts *total, struct counts *block)
+{
+  struct xmemstream mem;
+  xopen_memstream (&mem);
+  TEST_COMPARE (malloc_profile (0, mem.out), 0);
+  xfclose_memstream (&mem);
+
+  size_t rate;
+  TEST_COMPARE (sscanf (mem.buffer,
+			"heap profile: %zu: %zu [%zu: %zu] @ heap_v2/%zu\n",
+			&total->inuse_count, &total->inuse_bytes,
+			&total->alloc_count, &total->alloc_bytes, &rate), 5);
+  TEST_COMPARE (rate, profile_rate);
+
+  memset (block, 0, sizeof (*block));
+  const char *line = strchr (mem.buffer, '\n');
+  TEST_VERIFY_EXIT (line != NULL);
+  for (++line; *line != '\n' && *line != '\0'; line = strchr (line, '\n') + 1)
+    {
+      struct counts c;
+      void *frame;
+      TEST_COMPARE (sscanf (line, "%zu: %zu [%zu: %zu] @ %p",
+			    &c.inuse_count, &c.inuse_bytes,
+			    &c.alloc_count, &c.alloc_bytes, &frame), 5);
+      TEST_VERIFY (c.inuse_count <= c.alloc_count);
+      TEST_VERIFY (c.inuse_bytes <= c.alloc_bytes);
+      /* The first frame is the return address of the malloc call.  */
+      if ((uintptr_t) frame - (uintptr_t) allocate_block < 1024)
+	{
+	  block->inuse_count += c.inuse_count;
+	  block->inuse_bytes += c.inuse_bytes;
+	  block->alloc_count += c.alloc_count;
+	  block->alloc_bytes += c.alloc_bytes;
+	}
+    }
+
+  TEST_VERIFY (strstr (mem.buffer, "\nMAPPED_LIBRARIES:\n") != NULL);
+  free (mem.buffer);
+}
+
+static void
+check_profile (void)
+{
+  struct counts total, block;
+
+  /* In the forked child, the samples of the parent are still counted
+     as allocated.  */
+  get_profile (&total, &block);
+  TEST_COMPARE (block.inuse_count, 0);
+  size_t base = block.alloc_count;
+
+  for (int i = 0; i < block_count; ++i)
+    blocks[i] = allocate_block (block_size, i);
+  get_profile (&total, &block);
+  printf ("info: %zu of %d blocks sampled\n", block.inuse_count, block_count);
+
+  /* Each block is sampled with a probability of
+     1 - exp (-block_size / profile_rate), about 0.22.  */
+  TEST_VERIFY (block.inuse_count >= block_count / 6);
+  TEST_VERIFY (block.inuse_count <= block_count / 4);
+  TEST_COMPARE (block.inuse_bytes, block.inuse_count * block_size);
+  TEST_COMPARE (block.alloc_count, base + block.inuse_count);
+  TEST_VERIFY (total.inuse_count >= block.inuse_count);
+
+  /* Freeing the first half of the blocks removes their samples.  */
+  size_t sampled = block.inuse_count;
+  for (int i = 0; i < block_count / 2; ++i)
+    free (blocks[i]);
+  get_profile (&total, &block);
+  TEST_VERIFY (block.inuse_count < sampled);
+  TEST_COMPARE (block.alloc_count, base + sampled);
+
+  /* A failed realloc keeps the samples.  */
+  size_t remaining = block.inuse_count;
+  for (int i = block_count / 2; i < block_count; ++i)
+    {
+      errno = 0;
+      TEST_VERIFY (realloc (blocks[i], PTRDIFF_MAX) == NULL);
+      TEST_COMPARE (errno, ENOMEM);
+    }
+  get_profile (&total, &block);
+  TEST_COMPARE (block.inuse_count, remaining);
+
+  /* Resizing drops the sample of the old block.  */
+  for (int i = block_count / 2; i < block_count; ++i)
+    {
+      blocks[i] = realloc (blocks[i], 2 * block_size);
+      TEST_VERIFY_EXIT (blocks[i] != NULL);
+    }
+  get_profile (&total, &block);
+  TEST_COMPARE (block.inuse_count, 0);
+  TEST_COMPARE (block.alloc_count, base + sampled);
+
+  for (int i = block_count / 2; i < block_count; ++i)
+    free (blocks[i]);
+}
+
+/* Allocate and free concurrently with the fork in do_test.  */
+static void *
+allocation_thread (void *closure)
+{
+  void *p[100];
+  for (int round = 0; round < 100; ++round)
+    {
+      for (int i = 0; i < array_length (p); ++i)
+	p[i] = xmalloc (block_size + i);
+      for (int i = 0; i < array_length (p); ++i)
+	free (p[i]);
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  errno = 0;
+  TEST_COMPARE (malloc_profile (1, stdout), -1);
+  TEST_COMPARE (errno, EINVAL);
+
+  check_profile ();
+
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, allocation_thread, NULL);
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      check_profile ();
+      exit (support_record_failure_is_failed () ? 1 : 0);
+    }
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,113 @@
+/* Test the background purge thread (glibc.malloc.purge_interval).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* Free a large range of blocks in the middle of the main arena, which
+   free itself does not return to the system because it is not at the
+   top of the heap.  The purge thread must release its pages shortly
+   afterwards, also in a forked child.  The thread is started before
+   main.  */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/single_threaded.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xunistd.h>
+#include <time.h>
+
+enum
+  {
+    /* Below the mmap threshold.  */
+    block_size = 100 * 1024,
+    block_count = 64,
+  };
+
+static void *blocks[block_count];
+
+/* Return true if the page containing P is resident.  */
+static bool
+resident (void *p)
+{
+  long int pagesize = sysconf (_SC_PAGESIZE);
+  void *page = (void *) ((uintptr_t) p & -pagesize);
+  unsigned char vec;
+  if (mincore (page, pagesize, &vec) != 0)
+    FAIL_EXIT1 ("mincore: %m");
+  return vec & 1;
+}
+
+static void
+allocate_and_purge (void)
+{
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xmalloc (block_size);
+      memset (blocks[i], 0xa5, block_size);
+    }
+
+  /* The first and last block keep the freed range away from the top
+     of the heap.  */
+  char *middle = (char *) blocks[block_count / 2] + block_size / 2;
+  for (int i = 1; i < block_count - 1; ++i)
+    free (blocks[i]);
+  TEST_VERIFY (resident (middle));
+
+  /* The purge interval is 10 milliseconds.  */
+  int waited = 0;
+  while (resident (middle) && waited < 10000)
+    {
+      nanosleep (&(struct timespec) { .tv_nsec = 10 * 1000 * 1000 }, NULL);
+      waited += 10;
+    }
+  printf ("info: waited %d ms for the purge\n", waited);
+  TEST_VERIFY (!resident (middle));
+
+  /* The released memory can be used again.  */
+  for (int i = 1; i < block_count - 1; ++i)
+    {
+      blocks[i] = xmalloc (block_size);
+      memset (blocks[i], 0x5a, block_size);
+    }
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+}
+
+static int
+do_test (void)
+{
+  TEST_VERIFY (!__libc_single_threaded);
+  allocate_and_purge ();
+
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      allocate_and_purge ();
+      exit (support_record_failure_is_failed () ? 1 : 0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,196 @@
+/* Test remote free lists for cross-thread frees (glibc.malloc.remote_free).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* A second thread allocates blocks from its own arena, and the main
+   thread frees them.  The blocks must show up as pending remote frees
+   in malloc_info until the second thread allocates again.  A second
+   batch is freed just before the second thread exits, which must drain
+   the list of its arena without another allocation.
+
+   A third thread then fills more than one heap of an arena and the main
+   thread frees all the blocks.  A local free by the third thread trims
+   the arena, which must unmap the heaps emptied by the remote frees.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xmemstream.h>
+#include <support/xthread.h>
+
+enum
+  {
+    block_count = 100,
+    /* Larger than the fast bin limit.  */
+    block_size = 1000,
+  };
+
+static void *blocks[block_count];
+static pthread_barrier_t barrier;
+
+enum
+  {
+    /* Enough for more than one heap, even with 64 MiB heaps.  */
+    trim_block_count = 2048,
+    /* Below the mmap threshold, but large enough to trigger a trim.  */
+    trim_block_size = 64 * 1024,
+  };
+
+static void *trim_blocks[trim_block_count];
+
+static void *
+allocation_thread (void *closure)
+{
+  for (int i = 0; i < block_count; ++i)
+    {
+      blocks[i] = xmalloc (block_size);
+      memset (blocks[i], 0xa5, block_size);
+    }
+
+  /* Let the main thread free the blocks.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+
+  /* This allocation drains the remote free list of the arena.  */
+  free (xmalloc (block_size));
+
+  xpthread_barrier_wait (&barrier);
+
+  for (int i = 0; i < block_count; ++i)
+    blocks[i] = xmalloc (block_size);
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+  return NULL;
+}
+
+static void *
+trim_thread (void *closure)
+{
+  for (int i = 0; i < trim_block_count; ++i)
+    trim_blocks[i] = xmalloc (trim_block_size);
+  void *last = xmalloc (trim_block_size);
+
+  /* Let the main thread free the other blocks.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+
+  /* This merges LAST into the top chunk and trims the arena, after
+     putting the remotely freed blocks into the bins.  */
+  free (last);
+  return NULL;
+}
+
+struct remote_stats
+{
+  size_t pending;
+  size_t pending_size;
+  size_t frees;
+};
+
+/* Return the totals of the remote free counters from malloc_info.  */
+static struct remote_stats
+get_remote_stats (void)
+{
+  struct xmemstream mem;
+  xopen_memstream (&mem);
+  TEST_COMPARE (malloc_info (0, mem.out), 0);
+  xfclose_memstream (&mem);
+
+  /* The totals follow the last heap.  */
+  const char *totals = mem.buffer;
+  for (const char *p = mem.buffer; (p = strstr (p, "</heap>")) != NULL; ++p)
+    totals = p;
+
+  struct remote_stats result;
+  const char *p = strstr (totals, "<total type=\"remote\"");
+  TEST_VERIFY_EXIT (p != NULL);
+  TEST_COMPARE (sscanf (p, "<total type=\"remote\" count=\"%zu\" size=\"%zu\"",
+			&result.pending, &result.pending_size), 2);
+  p = strstr (totals, "<remote type=\"frees\"");
+  TEST_VERIFY_EXIT (p != NULL);
+  TEST_COMPARE (sscanf (p, "<remote type=\"frees\" count=\"%zu\"",
+			&result.frees), 1);
+  free (mem.buffer);
+
+  printf ("info: %zu remote frees, %zu pending (%zu bytes)\n",
+	  result.frees, result.pending, result.pending_size);
+  return result;
+}
+
+static int
+do_test (void)
+{
+  xpthread_barrier_init (&barrier, NULL, 2);
+  pthread_t thr = xpthread_create (NULL, allocation_thread, NULL);
+
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+
+  struct remote_stats stats = get_remote_stats ();
+  TEST_COMPARE (stats.frees, block_count);
+  TEST_COMPARE (stats.pending, block_count);
+  TEST_VERIFY (stats.pending_size >= block_count * block_size);
+
+  xpthread_barrier_wait (&barrier);
+  xpthread_barrier_wait (&barrier);
+
+  stats = get_remote_stats ();
+  TEST_COMPARE (stats.frees, block_count);
+  TEST_COMPARE (stats.pending, 0);
+  TEST_COMPARE (stats.pending_size, 0);
+
+  xpthread_barrier_wait (&barrier);
+  for (int i = 0; i < block_count; ++i)
+    free (blocks[i]);
+  stats = get_remote_stats ();
+  TEST_COMPARE (stats.frees, 2 * block_count);
+  TEST_COMPARE (stats.pending, block_count);
+
+  /* The exiting thread detaches from its arena and drains the list.  */
+  xpthread_barrier_wait (&barrier);
+  xpthread_join (thr);
+  stats = get_remote_stats ();
+  TEST_COMPARE (stats.pending, 0);
+  TEST_COMPARE (stats.pending_size, 0);
+
+  thr = xpthread_create (NULL, trim_thread, NULL);
+  xpthread_barrier_wait (&barrier);
+  size_t before = mallinfo2 ().arena;
+  for (int i = 0; i < trim_block_count; ++i)
+    free (trim_blocks[i]);
+  stats = get_remote_stats ();
+  TEST_COMPARE (stats.pending, trim_block_count);
+  xpthread_barrier_wait (&barrier);
+  xpthread_join (thr);
+  size_t after = mallinfo2 ().arena;
+  printf ("info: arena memory %zu bytes before trim, %zu bytes after\n",
+	  before, after);
+  TEST_VERIFY (before >= (size_t) trim_block_count * trim_block_size);
+  TEST_VERIFY (after < before / 2);
+  stats = get_remote_stats ();
+  TEST_COMPARE (stats.pending, 0);
+
+  xpthread_barrier_destroy (&barrier);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,170 @@
+/* Test the slab allocator for small requests (glibc.malloc.slab_max).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <malloc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xmemstream.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    slab_max = 256,
+    object_count = 20000,
+    thread_count = 4,
+  };
+
+static void
+fill (unsigned char *p, size_t size, unsigned int seed)
+{
+  for (size_t i = 0; i < size; ++i)
+    p[i] = seed + i;
+}
+
+static void
+check (const unsigned char *p, size_t size, unsigned int seed)
+{
+  for (size_t i = 0; i < size; ++i)
+    if (p[i] != (unsigned char) (seed + i))
+      FAIL_EXIT1 ("object %p corrupted at offset %zu", p, i);
+}
+
+/* Allocate objects of all slab sizes, resize some of them across the
+   slab limit, and free them in a different order.  */
+static void *
+allocation_thread (void *closure)
+{
+  unsigned int seed = (uintptr_t) closure;
+  void **objects = xmalloc (object_count * sizeof (void *));
+  size_t *sizes = xmalloc (object_count * sizeof (size_t));
+
+  for (unsigned int i = 0; i < object_count; ++i)
+    {
+      sizes[i] = 1 + (i * 7 + seed) % slab_max;
+      objects[i] = xmalloc (sizes[i]);
+      TEST_VERIFY (((uintptr_t) objects[i]
+		    & (__alignof__ (max_align_t) - 1)) == 0);
+      TEST_VERIFY (malloc_usable_size (objects[i]) >= sizes[i]);
+      fill (objects[i], sizes[i], i);
+    }
+
+  for (unsigned int i = 0; i < object_count; i += 3)
+    {
+      check (objects[i], sizes[i], i);
+      size_t new_size = i % 2 == 0 ? sizes[i] + slab_max : sizes[i] / 2 + 1;
+      objects[i] = xrealloc (objects[i], new_size);
+      check (objects[i], new_size < sizes[i] ? new_size : sizes[i], i);
+      sizes[i] = new_size;
+      fill (objects[i], sizes[i], i);
+    }
+
+  for (unsigned int i = 1; i < object_count; i += 2)
+    {
+      check (objects[i], sizes[i], i);
+      free (objects[i]);
+    }
+  for (unsigned int i = 0; i < object_count; i += 2)
+    {
+      check (objects[i], sizes[i], i);
+      free (objects[i]);
+    }
+
+  free (sizes);
+  free (objects);
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  /* Small objects are packed without chunk headers, so consecutive
+     allocations of the same size class are adjacent.  */
+  enum { small_count = 64, small_size = 32 };
+  char *small[small_count];
+  int adjacent = 0;
+  for (int i = 0; i < small_count; ++i)
+    {
+      small[i] = xmalloc (small_size);
+      TEST_COMPARE (malloc_usable_size (small[i]), small_size);
+      if (i > 0 && small[i] == small[i - 1] + small_size)
+	++adjacent;
+    }
+  TEST_VERIFY (adjacent >= small_count / 2);
+
+  /* The slab memory shows up in the statistics.  */
+  struct mallinfo2 mi = mallinfo2 ();
+  TEST_VERIFY (mi.hblks >= 1);
+  TEST_VERIFY (mi.hblkhd >= 65536);
+  TEST_VERIFY (mi.fsmblks > 0);
+  struct xmemstream mem;
+  xopen_memstream (&mem);
+  TEST_COMPARE (malloc_info (0, mem.out), 0);
+  xfclose_memstream (&mem);
+  size_t used_count, used_size, system_size;
+  const char *s = strstr (mem.buffer, "<slab type=\"used\"");
+  TEST_VERIFY_EXIT (s != NULL);
+  TEST_COMPARE (sscanf (s, "<slab type=\"used\" count=\"%zu\" size=\"%zu\"",
+			&used_count, &used_size), 2);
+  s = strstr (mem.buffer, "<system type=\"slab\"");
+  TEST_VERIFY_EXIT (s != NULL);
+  TEST_COMPARE (sscanf (s, "<system type=\"slab\" size=\"%zu\"",
+			&system_size), 1);
+  TEST_VERIFY (used_count >= small_count);
+  TEST_VERIFY (used_size >= small_count * small_size);
+  TEST_VERIFY (system_size >= 65536);
+  free (mem.buffer);
+
+  for (int i = 0; i < small_count; ++i)
+    free (small[i]);
+
+  /* calloc must clear reused objects.  */
+  unsigned char *p = xmalloc (100);
+  memset (p, 0xff, 100);
+  free (p);
+  p = xcalloc (1, 100);
+  for (int i = 0; i < 100; ++i)
+    TEST_COMPARE (p[i], 0);
+  free (p);
+
+  /* Allocating in the child of a multi-threaded fork must work.  */
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, allocation_thread,
+				  (void *) (uintptr_t) i);
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      allocation_thread (NULL);
+      _exit (0);
+    }
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
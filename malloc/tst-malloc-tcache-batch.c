@@ -0,0 +1,136 @@
+/* Test batched tcache refill and flush (glibc.malloc.tcache_batch).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* A producer thread allocates blocks and hands them to a consumer
+   thread through a pipe, which checks their contents and frees them.
+   This fills the consumer's tcache bins with chunks from the producer's
+   arena, so that both the batched refill (producer) and the batched
+   flush (consumer) paths are exercised.
+
+   check_flush_order checks that a flush keeps the most recently freed
+   chunks in the tcache.  The test runs with glibc.malloc.tcache_batch=4
+   and the default glibc.malloc.tcache_count of 7.  */
+
+#include <malloc.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+enum
+  {
+    block_count = 200000,
+    max_block_size = 512,
+  };
+
+static int fds[2];
+
+static size_t
+block_size (unsigned int i)
+{
+  return 1 + (i * 7919u) % max_block_size;
+}
+
+static void *
+producer_thread (void *closure)
+{
+  for (unsigned int i = 0; i < block_count; ++i)
+    {
+      size_t size = block_size (i);
+      unsigned char *p = xmalloc (size);
+      memset (p, (unsigned char) i, size);
+      xwrite (fds[1], &p, sizeof (p));
+    }
+  xclose (fds[1]);
+  return NULL;
+}
+
+static void *
+consumer_thread (void *closure)
+{
+  for (unsigned int i = 0; i < block_count; ++i)
+    {
+      unsigned char *p;
+      size_t done = 0;
+      while (done < sizeof (p))
+	{
+	  ssize_t ret = read (fds[0], (char *) &p + done, sizeof (p) - done);
+	  if (ret <= 0)
+	    FAIL_EXIT1 ("read from pipe failed: %zd", ret);
+	  done += ret;
+	}
+
+      size_t size = block_size (i);
+      for (size_t j = 0; j < size; ++j)
+	if (p[j] != (unsigned char) i)
+	  FAIL_EXIT1 ("block %u corrupted at offset %zu", i, j);
+      free (p);
+    }
+  return NULL;
+}
+
+static void
+check_flush_order (void)
+{
+  enum { count = 8 };
+  void *blocks[count];
+  for (int i = 0; i < count; ++i)
+    blocks[i] = xmalloc (64);
+
+  /* The last free finds the bin full and flushes four chunks.  */
+  for (int i = 0; i < count; ++i)
+    free (blocks[i]);
+
+  /* The bin now holds blocks[7] and the three chunks freed before it,
+     in last-in, first-out order.  */
+  void *again[4];
+  for (int i = 0; i < 4; ++i)
+    again[i] = xmalloc (64);
+  for (int i = 0; i < 4; ++i)
+    TEST_VERIFY (again[i] == blocks[count - 1 - i]);
+  for (int i = 0; i < 4; ++i)
+    free (again[i]);
+}
+
+static int
+do_test (void)
+{
+  check_flush_order ();
+
+  xpipe (fds);
+
+  pthread_t consumer = xpthread_create (NULL, consumer_thread, NULL);
+  pthread_t producer = xpthread_create (NULL, producer_thread, NULL);
+  xpthread_join (producer);
+  xpthread_join (consumer);
+  xclose (fds[0]);
+
+  /* The arenas must still be consistent after all chunks have been
+     returned.  */
+  struct mallinfo2 mi = mallinfo2 ();
+  TEST_VERIFY (mi.uordblks <= mi.arena + mi.hblkhd);
+  malloc_trim (0);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,144 @@
+/* Test huge page aligned growth and trimming of arena heaps.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* With glibc.malloc.hugetlb=1 and transparent huge pages in madvise
+   mode, the heap of a secondary arena must always end on a huge page
+   boundary, and freeing and reallocating less than a huge page at the
+   top of the heap must not make it shrink and grow.  */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xmemstream.h>
+#include <support/xstdio.h>
+#include <support/xthread.h>
+
+enum
+  {
+    /* Below the mmap threshold.  */
+    block_size = 64 * 1024,
+    block_count = 256,
+    cycles = 100,
+  };
+
+static size_t thp_pagesize;
+
+/* Return the huge page size if transparent huge pages are in madvise
+   mode, or 0.  */
+static size_t
+get_thp_pagesize (void)
+{
+  char mode[64] = "";
+  FILE *f = fopen ("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+  if (f == NULL)
+    return 0;
+  if (fgets (mode, sizeof (mode), f) == NULL)
+    mode[0] = '\0';
+  xfclose (f);
+  if (strstr (mode, "[madvise]") == NULL)
+    return 0;
+
+  size_t size = 0;
+  f = fopen ("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+  if (f == NULL)
+    return 0;
+  if (fscanf (f, "%zu", &size) != 1)
+    size = 0;
+  xfclose (f);
+  return size;
+}
+
+/* Return the memory obtained from the system by the first secondary
+   arena, as reported by malloc_info.  */
+static size_t
+get_arena_size (void)
+{
+  struct xmemstream mem;
+  xopen_memstream (&mem);
+  TEST_COMPARE (malloc_info (0, mem.out), 0);
+  xfclose_memstream (&mem);
+
+  const char *p = strstr (mem.buffer, "<heap nr=\"1\">");
+  TEST_VERIFY_EXIT (p != NULL);
+  p = strstr (p, "<system type=\"current\" size=\"");
+  TEST_VERIFY_EXIT (p != NULL);
+  size_t size;
+  TEST_COMPARE (sscanf (p, "<system type=\"current\" size=\"%zu\"", &size), 1);
+  free (mem.buffer);
+  return size;
+}
+
+static void *
+allocation_thread (void *closure)
+{
+  void *blocks[block_count];
+
+  /* The memory stream used by get_arena_size must not end up at the
+     top of the heap.  Its allocations are reused from the tcache
+     afterwards.  */
+  get_arena_size ();
+
+  for (int i = 0; i < block_count; ++i)
+    blocks[i] = xmalloc (block_size);
+  size_t size = get_arena_size ();
+  printf ("info: arena size after allocation: %zu\n", size);
+  TEST_COMPARE (size % thp_pagesize, 0);
+  TEST_VERIFY (size >= block_count * block_size);
+
+  /* Free the blocks in reverse order, so that the top chunk grows
+     steadily and the heap is trimmed.  */
+  for (int i = block_count - 1; i >= 0; --i)
+    free (blocks[i]);
+  size_t trimmed_size = get_arena_size ();
+  printf ("info: arena size after free: %zu\n", trimmed_size);
+  TEST_COMPARE (trimmed_size % thp_pagesize, 0);
+  TEST_VERIFY (trimmed_size < size);
+
+  /* Allocating and freeing almost a huge page must be served from the
+     huge page kept in reserve.  */
+  int count = thp_pagesize / block_size - 1;
+  for (int cycle = 0; cycle < cycles; ++cycle)
+    {
+      for (int i = 0; i < count; ++i)
+	blocks[i] = xmalloc (block_size);
+      TEST_COMPARE (get_arena_size (), trimmed_size);
+      for (int i = count - 1; i >= 0; --i)
+	free (blocks[i]);
+      TEST_COMPARE (get_arena_size (), trimmed_size);
+    }
+
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  thp_pagesize = get_thp_pagesize ();
+  if (thp_pagesize == 0)
+    FAIL_UNSUPPORTED ("transparent huge pages not in madvise mode");
+  printf ("info: huge page size: %zu\n", thp_pagesize);
+
+  xpthread_join (xpthread_create (NULL, allocation_thread, NULL));
+
+  return 0;
+}
+
+#include <support/test-driver.c>
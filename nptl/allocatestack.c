@@ -35,6 +35,7 @@
 #include <tls-internal.h>
 #include <intprops.h>
 #include <setvmaname.h>
+#include <numa-node.h>
 
 /* Default alignment of stack.  */
 #ifndef STACK_ALIGN
@@ -55,45 +56,53 @@
 #endif
 
 /* Get a stack frame from the cache.  We have to match by size since
-   some blocks might be too small or far too large.  */
+   some blocks might be too small or far too large.  Stacks allocated
+   on NUMA node NODE are preferred.  */
 static struct pthread *
-get_cached_stack (size_t *sizep, void **memp)
+get_cached_stack (size_t *sizep, void **memp, int node)
 {
   size_t size = *sizep;
   struct pthread *result = NULL;
+  bool result_local = false;
   list_t *entry;
 
   lll_lock (GL (dl_stack_cache_lock), LLL_PRIVATE);
 
   /* Search the cache for a matching entry.  We search for the
-     smallest stack which has at least the required size.  Note that
-     in normal situations the size of all allocated stacks is the
-     same.  As the very least there are only a few different sizes.
+     smallest stack which has at least the required size, preferring
+     stacks on the current NUMA node over remote ones.  Note that in
+     normal situations the size of all allocated stacks is the same.
+     As the very least there are only a few different sizes.
      Therefore this loop will exit early most of the time with an
-     exact match.  */
+     exact match.  Make sure the size difference is not too
+     excessive.  In that case we do not use the block.  */
   list_for_each (entry, &GL (dl_stack_cache))
     {
       struct pthread *curr;
 
       curr = list_entry (entry, struct pthread, list);
-      if (__nptl_stack_in_use (curr) && curr->stackblock_size >= size)
+      if (__nptl_stack_in_use (curr) && curr->stackblock_size >= size
+	  && curr->stackblock_size <= 4 * size)
 	{
-	  if (curr->stackblock_size == size)
+	  bool curr_local = node < 0 || curr->stack_node == node;
+	  if (curr_local && curr->stackblock_size == size)
 	    {
 	      result = curr;
 	      break;
 	    }
 
 	  if (result == NULL
-	      || result->stackblock_size > curr->stackblock_size)
-	    result = curr;
+	      || (curr_local && !result_local)
+	      || (curr_local == result_local
+		  && result->stackblock_size > curr->stackblock_size))
+	    {
+	      result = curr;
+	      result_local = curr_local;
+	    }
 	}
     }
 
-  if (__builtin_expect (result == NULL, 0)
-      /* Make sure the size difference is not too excessive.  In that
-	 case we do not use the block.  */
-      || __builtin_expect (result->stackblock_size > 4 * size, 0))
+  if (__builtin_expect (result == NULL, 0))
     {
       /* Release the lock.  */
       lll_unlock (GL (dl_stack_cache_lock), LLL_PRIVATE);
@@ -357,7 +366,8 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 
       /* Try to get a stack from the cache.  */
       reqsize = size;
-      pd = get_cached_stack (&size, &mem);
+      int node = __numa_node ();
+      pd = get_cached_stack (&size, &mem, node);
       if (pd == NULL)
 	{
 	  /* If a guard page is required, avoid committing memory by first
@@ -409,6 +419,10 @@ allocate_stack (const struct pthread_attr *attr, struct pthread **pdp,
 	  /* Update guardsize for newly allocated guardsize to avoid
 	     an mprotect in guard resize below.  */
 	  pd->guardsize = guardsize;
+	  /* The thread descriptor and the static TLS block, which are
+	     not released by advise_stack_range, are faulted in by the
+	     creating thread.  */
+	  pd->stack_node = node;
 
 	  /* We allocated the first block thread-specific data array.
 	     This address will not change for the lifetime of this
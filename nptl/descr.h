@@ -377,6 +377,9 @@ struct pthread
   size_t guardsize;
   /* This is what the user specified and what we will report.  */
   size_t reported_guardsize;
+  /* NUMA node of the thread which allocated the stack, or -1 if
+     unknown.  Used to prefer node-local stacks from the stack cache.  */
+  int stack_node;
 
   /* Thread Priority Protection data.  */
   struct priority_protection_data *tpp;
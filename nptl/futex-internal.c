@@ -141,6 +141,43 @@ __futex_abstimed_wait_cancelable64 (unsigned int* futex_word,
 }
 libc_hidden_def (__futex_abstimed_wait_cancelable64)
 
+int
+__futex_waitv_cancelable64 (struct futex_waitv_entry *waiters,
+			    unsigned int nr, clockid_t clockid,
+			    const struct __timespec64 *abstime)
+{
+  /* Work around the fact that the kernel rejects negative timeout values
+     despite them being valid.  */
+  if (__glibc_unlikely ((abstime != NULL) && (abstime->tv_sec < 0)))
+    return ETIMEDOUT;
+
+  if (! lll_futex_supported_clockid (clockid))
+    return EINVAL;
+
+  /* futex_waitv always uses a 64-bit timeout.  */
+  int err = INTERNAL_SYSCALL_CANCEL (futex_waitv, waiters, nr, 0, abstime,
+				     clockid);
+  /* A non-negative result is the index of the woken futex word.  */
+  if (err >= 0)
+    return 0;
+
+  switch (err)
+    {
+    case -EAGAIN:
+    case -EINTR:
+    case -ETIMEDOUT:
+    case -ENOSYS:
+      return -err;
+
+    case -EINVAL: /* Must have been caused by a glibc bug.  */
+    case -EFAULT: /* Must have been caused by a glibc or application bug.  */
+    /* No other errors are documented at this time.  */
+    default:
+      futex_fatal_error ();
+    }
+}
+libc_hidden_def (__futex_waitv_cancelable64)
+
 int
 __futex_lock_pi64 (int *futex_word, clockid_t clockid,
 		   const struct __timespec64 *abstime, int private)
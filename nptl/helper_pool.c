@@ -0,0 +1,415 @@
+/* Internal pool of helper threads.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/param.h>
+#include <sys/sysinfo.h>
+#include <time.h>
+#include <atomic.h>
+#include <futex-internal.h>
+#include <helper_pool.h>
+#include <lowlevellock.h>
+#include <pthreadP.h>
+
+#define TUNABLE_NAMESPACE pthread
+#include <elf/dl-tunables.h>
+
+/* Work items are queued on one of several queues of their class,
+   selected by the CPU on which the submitting thread runs, so that
+   threads submitting work on different CPUs do not contend for the same
+   lock.  A helper thread takes work from the queue of its own CPU first
+   and steals from the other queues if that is empty.  Each queue is
+   FIFO, so that requests submitted by one thread are started in order.
+
+   Each class of work may occupy up to MAX_THREADS helper threads at a
+   time, counted in RUNNING.  Threads running work of one class do not
+   count against the limit of the other classes, so AIO requests which
+   block for a long time cannot starve getaddrinfo_a, and vice versa.
+   A helper thread only takes work of a class which is below its limit.
+   Work of a class which is at its limit is left queued for the threads
+   running that class, which take it when they finish their current
+   item.
+
+   PENDING counts the queued items of each class, and IDLE the helper
+   threads waiting for work.  A submitter increments PENDING and then
+   reads RUNNING and IDLE, and a helper thread decrements RUNNING or
+   increments IDLE and then reads PENDING, with full barriers in
+   between, so either the submitter wakes up a helper thread, or the
+   helper thread sees the new work and does not block.  If no helper
+   thread is idle, the submitter starts a new one.  Helper threads which
+   have been idle for HELPER_POOL_IDLE_TIME seconds exit.  The decision
+   to exit is made under POOL_LOCK, as is the decision to start a new
+   thread, so that work is never left on a queue without a thread to run
+   it.  */
+
+/* Number of work queues.  CPU numbers are mapped to queues modulo this
+   value.  */
+#define HELPER_POOL_QUEUES 16
+
+/* Number of seconds after which an idle helper thread exits.  */
+#define HELPER_POOL_IDLE_TIME 1
+
+/* Lower bound of the default limit on the number of helper threads,
+   which matches the default number of threads of POSIX AIO and
+   getaddrinfo_a before the pool existed.  */
+#define HELPER_POOL_MIN_THREADS 20
+
+struct helper_queue
+{
+  int lock;
+  struct helper_work *head;
+  struct helper_work *tail;
+} __attribute__ ((aligned (64)));
+
+static struct helper_queue queues[helper_class_count][HELPER_POOL_QUEUES];
+
+/* Number of queued work items of each class.  */
+static unsigned int pending[helper_class_count];
+
+/* Number of helper threads running work of each class.  */
+static unsigned int running[helper_class_count];
+
+/* Number of helper threads waiting for work.  */
+static unsigned int idle;
+
+/* Futex word on which idle helper threads wait.  Incremented to wake
+   them up.  */
+static unsigned int wake_seq;
+
+/* Protects nthreads and max_threads.  */
+static int pool_lock = LLL_LOCK_INITIALIZER;
+
+/* Number of helper threads.  */
+static unsigned int nthreads;
+
+/* Maximum number of helper threads running work of one class.
+   Computed when the first work item is submitted, before the first
+   helper thread is started.  */
+static unsigned int max_threads;
+
+/* Return the index of the queue of the current CPU.  */
+static inline unsigned int
+current_queue (void)
+{
+  int cpu = (int) THREAD_GETMEM_VOLATILE (THREAD_SELF, rseq_area.cpu_id);
+  if (cpu < 0)
+    /* Without rseq, spread the threads over the queues.  */
+    cpu = (uintptr_t) THREAD_SELF / sizeof (struct pthread);
+  return (unsigned int) cpu % HELPER_POOL_QUEUES;
+}
+
+static void
+queue_push (struct helper_queue *q, unsigned int *q_pending,
+	    struct helper_work *work)
+{
+  work->next = NULL;
+  lll_lock (q->lock, LLL_PRIVATE);
+  if (q->tail == NULL)
+    atomic_store_relaxed (&q->head, work);
+  else
+    q->tail->next = work;
+  q->tail = work;
+  atomic_fetch_add_relaxed (q_pending, 1);
+  lll_unlock (q->lock, LLL_PRIVATE);
+}
+
+static struct helper_work *
+queue_pop (struct helper_queue *q, unsigned int *q_pending)
+{
+  /* Do not take the lock of queues which are empty.  */
+  if (atomic_load_relaxed (&q->head) == NULL)
+    return NULL;
+
+  lll_lock (q->lock, LLL_PRIVATE);
+  struct helper_work *work = q->head;
+  if (work != NULL)
+    {
+      atomic_store_relaxed (&q->head, work->next);
+      if (work->next == NULL)
+	q->tail = NULL;
+      atomic_fetch_add_relaxed (q_pending, -1);
+    }
+  lll_unlock (q->lock, LLL_PRIVATE);
+  return work;
+}
+
+/* Remove WORK from Q if it is still queued there.  */
+static bool
+queue_remove (struct helper_queue *q, unsigned int *q_pending,
+	      struct helper_work *work)
+{
+  bool found = false;
+  lll_lock (q->lock, LLL_PRIVATE);
+  struct helper_work *prev = NULL;
+  for (struct helper_work *w = q->head; w != NULL; prev = w, w = w->next)
+    if (w == work)
+      {
+	if (prev == NULL)
+	  atomic_store_relaxed (&q->head, w->next);
+	else
+	  prev->next = w->next;
+	if (q->tail == w)
+	  q->tail = prev;
+	atomic_fetch_add_relaxed (q_pending, -1);
+	found = true;
+	break;
+      }
+  lll_unlock (q->lock, LLL_PRIVATE);
+  return found;
+}
+
+/* Return true if there is queued work of a class which is below its
+   limit.  */
+static bool
+work_available (void)
+{
+  for (int c = 0; c < helper_class_count; ++c)
+    if (atomic_load_relaxed (&pending[c]) != 0
+	&& atomic_load_relaxed (&running[c]) < max_threads)
+      return true;
+  return false;
+}
+
+/* Reserve one of the threads of class C for the current thread.
+   Return false if the class is at its limit.  */
+static bool
+reserve_running (enum helper_class c)
+{
+  unsigned int n = atomic_load_relaxed (&running[c]);
+  do
+    if (n >= max_threads)
+      return false;
+  while (!atomic_compare_exchange_weak_relaxed (&running[c], &n, n + 1));
+  return true;
+}
+
+/* Release the reservation of reserve_running.  Work of class C which
+   was left queued because the class was at its limit is visible to
+   the caller afterwards.  */
+static void
+release_running (enum helper_class c)
+{
+  atomic_fetch_add_relaxed (&running[c], -1);
+  /* Pairs with the barrier in __helper_pool_submit.  */
+  atomic_thread_fence_seq_cst ();
+}
+
+/* Take the next work item of a class which is below its limit,
+   preferably from the queue of the current CPU, and store its class in
+   *PCLASS.  The caller has to call release_running for the class after
+   running the item.  */
+static struct helper_work *
+take_work (enum helper_class *pclass)
+{
+  unsigned int start = current_queue ();
+  for (int c = 0; c < helper_class_count; ++c)
+    {
+      if (atomic_load_relaxed (&pending[c]) == 0 || !reserve_running (c))
+	continue;
+      for (unsigned int i = 0; i < HELPER_POOL_QUEUES; ++i)
+	{
+	  struct helper_work *work
+	    = queue_pop (&queues[c][(start + i) % HELPER_POOL_QUEUES],
+			 &pending[c]);
+	  if (work != NULL)
+	    {
+	      *pclass = c;
+	      return work;
+	    }
+	}
+      release_running (c);
+    }
+  return NULL;
+}
+
+static int wake_helper (void);
+
+static void *
+helper_thread (void *arg)
+{
+  while (true)
+    {
+      enum helper_class c;
+      struct helper_work *work = take_work (&c);
+      if (work != NULL)
+	{
+	  /* A submitter may have woken up this thread for other work
+	     which is still queued.  Make sure that another thread takes
+	     it, because this work may block for a long time.  */
+	  if (work_available ())
+	    wake_helper ();
+	  work->func (work);
+	  release_running (c);
+	  continue;
+	}
+      if (work_available ())
+	/* The work was queued on a queue we had already checked.  */
+	continue;
+
+      unsigned int seq = atomic_load_relaxed (&wake_seq);
+      atomic_fetch_add_relaxed (&idle, 1);
+      /* Pairs with the barrier in __helper_pool_submit.  */
+      atomic_thread_fence_seq_cst ();
+      int err = 0;
+      if (!work_available ())
+	{
+	  struct __timespec64 ts;
+	  __clock_gettime64 (CLOCK_MONOTONIC, &ts);
+	  ts.tv_sec += HELPER_POOL_IDLE_TIME;
+	  err = __futex_abstimed_wait64 (&wake_seq, seq, CLOCK_MONOTONIC,
+					 &ts, FUTEX_PRIVATE);
+	}
+      atomic_fetch_add_relaxed (&idle, -1);
+
+      if (err == ETIMEDOUT)
+	{
+	  /* A submitter which saw us as idle before we decremented IDLE
+	     did not start a new thread, but its work is visible in
+	     PENDING now.  Otherwise, it checks NTHREADS under the
+	     lock.  */
+	  atomic_thread_fence_seq_cst ();
+	  lll_lock (pool_lock, LLL_PRIVATE);
+	  bool leave = !work_available ();
+	  if (leave)
+	    --nthreads;
+	  lll_unlock (pool_lock, LLL_PRIVATE);
+	  if (leave)
+	    return NULL;
+	}
+    }
+}
+
+static int
+start_helper_thread (void)
+{
+  pthread_attr_t attr;
+  __pthread_attr_init (&attr);
+  __pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+  /* getaddrinfo needs more than the minimum stack size.  */
+  __pthread_attr_setstacksize (&attr, (__pthread_get_minstack (&attr)
+				       + 4 * PTHREAD_STACK_MIN));
+
+  /* Block all signals in the helper thread but SIGSETXID.  */
+  sigset_t ss;
+  __sigfillset (&ss);
+  __sigdelset (&ss, SIGSETXID);
+  int ret = __pthread_attr_setsigmask_internal (&attr, &ss);
+  if (ret == 0)
+    {
+      pthread_t th;
+      ret = __pthread_create (&th, &attr, helper_thread, NULL);
+    }
+
+  __pthread_attr_destroy (&attr);
+  return ret;
+}
+
+/* Wake up an idle helper thread, or start a new one if none is idle.
+   Return 0, or the error number if the thread could not be started.  */
+static int
+wake_helper (void)
+{
+  if (atomic_load_relaxed (&idle) > 0)
+    {
+      atomic_fetch_add_relaxed (&wake_seq, 1);
+      futex_wake (&wake_seq, 1, FUTEX_PRIVATE);
+      return 0;
+    }
+
+  /* The threads which are neither idle nor running work of the class
+     of the new work may all be blocked in work of other classes, so
+     start a new thread.  This keeps the number of threads within the
+     sum of the limits of all classes.  */
+  int ret = 0;
+  lll_lock (pool_lock, LLL_PRIVATE);
+  if (nthreads < helper_class_count * max_threads)
+    {
+      ret = start_helper_thread ();
+      if (ret == 0)
+	++nthreads;
+    }
+  lll_unlock (pool_lock, LLL_PRIVATE);
+  return ret;
+}
+
+static unsigned int
+helper_pool_max_threads (void)
+{
+  int32_t limit = TUNABLE_GET (helper_threads, int32_t, NULL);
+  if (limit > 0)
+    return limit;
+  return MAX (HELPER_POOL_MIN_THREADS, 2 * __get_nprocs ());
+}
+
+int
+__helper_pool_submit (struct helper_work *work, enum helper_class c)
+{
+  /* The limit is needed by the helper threads, and by the check of
+     RUNNING below.  */
+  if (atomic_load_relaxed (&max_threads) == 0)
+    {
+      lll_lock (pool_lock, LLL_PRIVATE);
+      if (max_threads == 0)
+	atomic_store_relaxed (&max_threads, helper_pool_max_threads ());
+      lll_unlock (pool_lock, LLL_PRIVATE);
+    }
+
+  struct helper_queue *q = &queues[c][current_queue ()];
+  queue_push (q, &pending[c], work);
+
+  /* Pairs with the barriers in helper_thread and release_running.  */
+  atomic_thread_fence_seq_cst ();
+  if (atomic_load_relaxed (&running[c]) >= max_threads)
+    /* One of the threads running work of this class takes the new
+       work once it has finished.  */
+    return 0;
+
+  int ret = wake_helper ();
+  if (ret != 0)
+    {
+      lll_lock (pool_lock, LLL_PRIVATE);
+      if (nthreads > 0 || !queue_remove (q, &pending[c], work))
+	/* An existing thread will run the work.  */
+	ret = 0;
+      lll_unlock (pool_lock, LLL_PRIVATE);
+    }
+  return ret;
+}
+
+void
+__helper_pool_fork_subprocess (void)
+{
+  for (int c = 0; c < helper_class_count; ++c)
+    {
+      for (int i = 0; i < HELPER_POOL_QUEUES; ++i)
+	{
+	  queues[c][i].lock = LLL_LOCK_INITIALIZER;
+	  queues[c][i].head = NULL;
+	  queues[c][i].tail = NULL;
+	}
+      pending[c] = 0;
+      running[c] = 0;
+    }
+  idle = 0;
+  wake_seq = 0;
+  pool_lock = LLL_LOCK_INITIALIZER;
+  nthreads = 0;
+}
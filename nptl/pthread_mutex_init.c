@@ -85,6 +85,15 @@ ___pthread_mutex_init (pthread_mutex_t *mutex,
       break;
     }
 
+  /* The queue of a queued mutex links threads of one process, and
+     __list is needed for robust mutexes.  */
+  if ((imutexattr->mutexkind & ~PTHREAD_MUTEXATTR_FLAG_BITS)
+      == PTHREAD_MUTEX_QUEUED_NP
+      && (imutexattr->mutexkind & (PTHREAD_MUTEXATTR_FLAG_PSHARED
+				   | PTHREAD_MUTEXATTR_FLAG_ROBUST
+				   | PTHREAD_MUTEXATTR_PROTOCOL_MASK)) != 0)
+    return ENOTSUP;
+
   /* Clear the whole variable.  */
   memset (mutex, '\0', __SIZEOF_PTHREAD_MUTEX_T);
 
@@ -609,6 +609,11 @@ __pthread_mutex_lock_full (pthread_mutex_t *mutex)
       }
       break;
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      /* Like a normal mutex, this does not detect deadlocks.  */
+      __pthread_mutex_lock_queued (mutex);
+      break;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
@@ -0,0 +1,118 @@
+/* Lock a mutex of type PTHREAD_MUTEX_QUEUED_NP.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <atomic.h>
+#include <futex-internal.h>
+#include <pthreadP.h>
+
+/* A queued mutex uses __lock like a normal mutex, so unlocking it and
+   the timed lock operations are the same.  Threads which find the mutex
+   locked line up in an MCS queue, though, whose tail is stored in
+   PTHREAD_MUTEX_QUEUE_TAIL.  Each waiter has a queue node on its stack,
+   and spins and then blocks on a futex word in this node, so that waiters
+   do not all poll the cache line of the mutex.  Only the waiter at the
+   head of the queue competes for __lock.  Once it has acquired __lock,
+   it makes its successor the new head and returns.  Threads acquire the
+   mutex in the order in which they joined the queue, except that a
+   thread which arrives while the queue is empty may take __lock before
+   the current head.  */
+
+typedef __typeof (PTHREAD_MUTEX_QUEUE_TAIL ((pthread_mutex_t *) NULL))
+  queue_tail_t;
+
+struct mutex_queue_node
+{
+  struct mutex_queue_node *next;
+  /* 1 while the predecessor is in the queue, 2 if the owner of the node
+     may be blocked in futex_wait, and 0 once it is the head.  */
+  unsigned int wait;
+};
+
+void
+__pthread_mutex_lock_queued (pthread_mutex_t *mutex)
+{
+  queue_tail_t *tailp = &PTHREAD_MUTEX_QUEUE_TAIL (mutex);
+
+  if (atomic_load_relaxed (tailp) == NULL
+      && lll_trylock (mutex->__data.__lock) == 0)
+    return;
+
+  struct mutex_queue_node node = { NULL, 1 };
+
+  /* Release MO publishes the initialization of NODE to the successor,
+     which sets node.next; the acquire fence makes the initialization of
+     the predecessor's node happen before our store to it.  */
+  struct mutex_queue_node *prev
+    = (struct mutex_queue_node *) atomic_exchange_release (tailp,
+							   (queue_tail_t) &node);
+  atomic_thread_fence_acquire ();
+  if (prev != NULL)
+    {
+      atomic_store_release (&prev->next, &node);
+
+      int spins = max_adaptive_count ();
+      unsigned int wait;
+      while ((wait = atomic_load_acquire (&node.wait)) != 0)
+	{
+	  if (spins > 0)
+	    {
+	      --spins;
+	      atomic_spin_nop ();
+	    }
+	  else if (wait == 2
+		   || atomic_compare_exchange_weak_relaxed (&node.wait,
+							    &wait, 2))
+	    futex_wait (&node.wait, 2, FUTEX_PRIVATE);
+	}
+    }
+
+  /* We are the head of the queue.  Spin for a while before blocking on
+     __lock, as an adaptive mutex would.  */
+  int spins = max_adaptive_count ();
+  while (lll_trylock (mutex->__data.__lock) != 0)
+    {
+      if (spins-- <= 0)
+	{
+	  lll_lock (mutex->__data.__lock, LLL_PRIVATE);
+	  break;
+	}
+      atomic_spin_nop ();
+    }
+
+  /* Leave the queue, or make the successor the new head.  */
+  struct mutex_queue_node *next = atomic_load_acquire (&node.next);
+  if (next == NULL)
+    {
+      queue_tail_t expected = (queue_tail_t) &node;
+      while (!atomic_compare_exchange_weak_relaxed (tailp, &expected, NULL))
+	{
+	  if (expected != (queue_tail_t) &node)
+	    {
+	      /* A successor has joined, but not stored its node in
+		 node.next yet.  */
+	      while ((next = atomic_load_acquire (&node.next)) == NULL)
+		atomic_spin_nop ();
+	      break;
+	    }
+	}
+      if (next == NULL)
+	return;
+    }
+  if (atomic_exchange_release (&next->wait, 0) == 2)
+    futex_wake (&next->wait, 1, FUTEX_PRIVATE);
+}
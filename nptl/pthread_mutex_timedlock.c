@@ -544,6 +544,14 @@ __pthread_mutex_clocklock_common (pthread_mutex_t *mutex,
       }
       break;
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      /* Timed waiters do not join the queue, which could not be left on
+	 timeout.  They block on __lock like waiters of a normal mutex
+	 instead, and compete with the head of the queue for it.  */
+      result = __futex_clocklock64 (&mutex->__data.__lock, clockid, abstime,
+				    LLL_PRIVATE);
+      break;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
@@ -441,6 +441,18 @@ ___pthread_mutex_trylock (pthread_mutex_t *mutex)
       }
       break;
 
+    case PTHREAD_MUTEX_QUEUED_NP:
+      /* Do not overtake queued threads.  */
+      if (atomic_load_relaxed (&PTHREAD_MUTEX_QUEUE_TAIL (mutex)) != NULL
+	  || lll_trylock (mutex->__data.__lock) != 0)
+	break;
+
+      /* Record the ownership.  */
+      mutex->__data.__owner = id;
+      ++mutex->__data.__nusers;
+
+      return 0;
+
     default:
       /* Correct code cannot set any other type.  */
       return EINVAL;
@@ -0,0 +1,232 @@
+/* Reader bias for POSIX reader--writer locks.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
+#include <atomic.h>
+#include <pthreadP.h>
+
+/* With PTHREAD_RWLOCK_READER_BIASED_NP, readers of a lock in reader bias
+   mode do not modify the lock.  Instead, a reader claims a slot in a
+   process-wide table of visible readers, selected by hashing the lock
+   and the thread, and stores the address of the lock there.  Readers
+   of the same lock running on different CPUs thus usually write to
+   different cache lines.  If the slot is in use, or the lock is not in
+   reader bias mode, the reader uses the regular algorithm (see
+   pthread_rwlock_common.c).
+
+   A writer first acquires the lock as usual, which keeps out new
+   readers using the regular algorithm.  It then revokes the reader
+   bias and scans the whole table, waiting for each slot that still
+   refers to the lock to be released.  Readers set their slot before
+   checking the bias flag, and the writer clears the flag before
+   scanning, with full barriers in between; so either the reader sees
+   that the bias was revoked and backs off, or the writer sees the slot.
+   Writers synchronize with fast-path readers through the release store
+   that clears the slot.
+
+   Revoking the bias is expensive, so it is only enabled again after
+   RWLOCK_BIAS_INHIBIT read locks have been released that used the
+   regular algorithm.  The thread releasing the last of these holds a
+   read lock, so no writer can be active at that time.  Write-mostly
+   workloads therefore rarely pay for scanning the table.  The state is
+   kept in fields of pthread_rwlock_t that are otherwise unused: __pad3
+   is nonzero while the lock is in reader bias mode, and __pad4 is the
+   number of read unlocks left before the bias is enabled again.
+   Process-shared locks are never put into reader bias mode.
+
+   Each thread also records the locks it holds through the table, so
+   that the unlock operation can tell which algorithm was used for a
+   read lock, and so that recursive read locks do not block on a writer
+   that is waiting for this thread to release its slot.  */
+
+/* Number of slots in the table of visible readers.  */
+#define RWLOCK_BIAS_TABLE_BITS 12
+#define RWLOCK_BIAS_TABLE_SIZE (1 << RWLOCK_BIAS_TABLE_BITS)
+
+/* Number of locks per thread that can be read-locked through the
+   table at the same time.  */
+#define RWLOCK_BIAS_RECORDS 4
+
+/* Number of read unlocks using the regular algorithm after which the
+   reader bias is enabled again.  */
+#define RWLOCK_BIAS_INHIBIT 256
+
+/* Number of times a writer checks a slot before yielding the CPU.  */
+#define RWLOCK_BIAS_SPIN 100
+
+static pthread_rwlock_t *visible_readers[RWLOCK_BIAS_TABLE_SIZE]
+  __attribute__ ((aligned (64)));
+
+struct rwlock_bias_record
+{
+  pthread_rwlock_t *rwlock;
+  unsigned int count;
+};
+
+static __thread struct rwlock_bias_record bias_records[RWLOCK_BIAS_RECORDS]
+  attribute_tls_model_ie;
+
+static inline pthread_rwlock_t **
+bias_slot (pthread_rwlock_t *rwlock)
+{
+  uint32_t h = (uint32_t) (((uintptr_t) rwlock >> 4)
+			   ^ ((uintptr_t) THREAD_SELF >> 6));
+  return &visible_readers[(h * 0x9e3779b1U) >> (32 - RWLOCK_BIAS_TABLE_BITS)];
+}
+
+static inline struct rwlock_bias_record *
+bias_record (pthread_rwlock_t *rwlock)
+{
+  return &bias_records[((uintptr_t) rwlock >> 5) % RWLOCK_BIAS_RECORDS];
+}
+
+/* Try to acquire RWLOCK for reading without modifying it.  Return false
+   if the regular algorithm has to be used.  */
+bool
+__pthread_rwlock_rdlock_bias (pthread_rwlock_t *rwlock)
+{
+  struct rwlock_bias_record *rec = bias_record (rwlock);
+  if (rec->rwlock == rwlock)
+    {
+      /* A recursive read lock.  A writer may be waiting for us to
+	 release the slot, so we must not block.  */
+      if (rec->count == UINT_MAX)
+	return false;
+      ++rec->count;
+      return true;
+    }
+  if (rec->rwlock != NULL
+      || atomic_load_relaxed (&rwlock->__data.__pad3) == 0)
+    return false;
+
+  pthread_rwlock_t **slot = bias_slot (rwlock);
+  pthread_rwlock_t *expected = NULL;
+  if (atomic_load_relaxed (slot) != NULL
+      || !atomic_compare_exchange_weak_relaxed (slot, &expected, rwlock))
+    return false;
+  /* Pairs with the barrier in __pthread_rwlock_revoke_bias.  The acquire
+     MO load synchronizes with the reader that enabled the bias, which
+     happens after the most recent writer.  */
+  atomic_thread_fence_seq_cst ();
+  if (atomic_load_acquire (&rwlock->__data.__pad3) == 0)
+    {
+      atomic_store_relaxed (slot, NULL);
+      return false;
+    }
+  rec->rwlock = rwlock;
+  rec->count = 1;
+  return true;
+}
+
+/* Release a read lock on RWLOCK if it was acquired by
+   __pthread_rwlock_rdlock_bias and return true.  Otherwise, the caller
+   still holds the read lock and has to release it with the regular
+   algorithm; return false.  */
+bool
+__pthread_rwlock_rdunlock_bias (pthread_rwlock_t *rwlock)
+{
+  struct rwlock_bias_record *rec = bias_record (rwlock);
+  if (rec->rwlock == rwlock)
+    {
+      if (--rec->count == 0)
+	{
+	  rec->rwlock = NULL;
+	  /* Make the critical section happen before the writer that
+	     observes the slot as free.  */
+	  atomic_store_release (bias_slot (rwlock), NULL);
+	}
+      return true;
+    }
+
+  /* No writer can be active while we hold the read lock, so no bias
+     revocation can run concurrently.  The count is only a heuristic,
+     so lost updates do not matter.  */
+  if (atomic_load_relaxed (&rwlock->__data.__pad3) == 0
+      && rwlock->__data.__shared == 0)
+    {
+      unsigned int n = atomic_load_relaxed (&rwlock->__data.__pad4);
+      if (n > 0)
+	atomic_store_relaxed (&rwlock->__data.__pad4, n - 1);
+      else
+	atomic_store_release (&rwlock->__data.__pad3, 1);
+    }
+  return false;
+}
+
+/* Called by a writer that has acquired RWLOCK to disable the reader
+   bias and wait for the readers that acquired the lock through the
+   table.  If TRYLOCK, return EBUSY instead of waiting; otherwise, return
+   ETIMEDOUT if ABSTIME (measured against CLOCKID) passes.  Return 0 once
+   there are no such readers.  The caller has to release the lock if the
+   result is not 0.  */
+int
+__pthread_rwlock_revoke_bias (pthread_rwlock_t *rwlock, bool trylock,
+			      clockid_t clockid,
+			      const struct __timespec64 *abstime)
+{
+  if (atomic_load_relaxed (&rwlock->__data.__pad3) == 0)
+    return 0;
+  atomic_store_relaxed (&rwlock->__data.__pad3, 0);
+  atomic_thread_fence_seq_cst ();
+  atomic_store_relaxed (&rwlock->__data.__pad4, RWLOCK_BIAS_INHIBIT);
+
+  int err = 0;
+  for (size_t i = 0; i < RWLOCK_BIAS_TABLE_SIZE && err == 0; i++)
+    {
+      unsigned int spins = 0;
+      while (atomic_load_acquire (&visible_readers[i]) == rwlock)
+	{
+	  if (trylock)
+	    {
+	      err = EBUSY;
+	      break;
+	    }
+	  if (++spins < RWLOCK_BIAS_SPIN)
+	    {
+	      atomic_spin_nop ();
+	      continue;
+	    }
+	  spins = 0;
+	  if (abstime != NULL)
+	    {
+	      struct __timespec64 now;
+	      __clock_gettime64 (clockid, &now);
+	      if (now.tv_sec > abstime->tv_sec
+		  || (now.tv_sec == abstime->tv_sec
+		      && now.tv_nsec >= abstime->tv_nsec))
+		{
+		  err = ETIMEDOUT;
+		  break;
+		}
+	    }
+	  __sched_yield ();
+	}
+    }
+
+  /* If we give up, there may still be readers in the table, so the next
+     writer has to scan it again.  The caller releases the lock without
+     having modified any data, so new readers may use the table right
+     away.  */
+  if (err != 0)
+    atomic_store_release (&rwlock->__data.__pad3, 1);
+  return err;
+}
@@ -205,6 +205,13 @@
    waiting thread because the waiting thread came first.
 
 
+   Locks of kind PTHREAD_RWLOCK_READER_BIASED_NP use the algorithm above
+   like PTHREAD_RWLOCK_PREFER_WRITER_NP, but while the lock is in reader
+   bias mode, readers do not modify __readers at all: they publish
+   themselves in a table of visible readers shared by all locks, and
+   writers wait for those readers to leave after having acquired the lock
+   (see pthread_rwlock_bias.c).
+
    POSIX allows but does not require rwlock acquisitions to be a cancellation
    point.  We do not support cancellation.
 
@@ -299,6 +306,11 @@ __pthread_rwlock_rdlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
 			== THREAD_GETMEM (THREAD_SELF, tid)))
     return EDEADLK;
 
+  /* Reader-biased locks may be acquired without touching __readers.  */
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP
+      && __pthread_rwlock_rdlock_bias (rwlock))
+    return 0;
+
   /* If we prefer writers, recursive rdlock is disallowed, we are in a read
      phase, and there are other readers present, we try to wait without
      extending the read phase.  We will be unblocked by either one of the
@@ -944,6 +956,18 @@ __pthread_rwlock_wrlock_full64 (pthread_rwlock_t *rwlock, clockid_t clockid,
     }
 
  done:
+  /* Wait for the readers that have acquired a reader-biased lock without
+     registering in __readers.  */
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP)
+    {
+      int err = __pthread_rwlock_revoke_bias (rwlock, false, clockid,
+					      abstime);
+      if (err != 0)
+	{
+	  __pthread_rwlock_wrunlock (rwlock);
+	  return err;
+	}
+    }
   atomic_store_relaxed (&rwlock->__data.__cur_writer,
 			THREAD_GETMEM (THREAD_SELF, tid));
   return 0;
@@ -36,6 +36,9 @@ ___pthread_rwlock_tryrdlock (pthread_rwlock_t *rwlock)
      Because POSIX does not require a failed trylock to "synchronize memory",
      relaxed MO is sufficient here and on the failure path of the CAS
      below.  */
+  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP
+      && __pthread_rwlock_rdlock_bias (rwlock))
+    return 0;
   unsigned int r = atomic_load_relaxed (&rwlock->__data.__readers);
   unsigned int rnew;
   do
@@ -57,6 +57,14 @@ ___pthread_rwlock_trywrlock (pthread_rwlock_t *rwlock)
 	    atomic_store_relaxed (&rwlock->__data.__wrphase_futex, 1);
 	  atomic_store_relaxed (&rwlock->__data.__cur_writer,
 	      THREAD_GETMEM (THREAD_SELF, tid));
+	  /* Fail instead of waiting for readers of a reader-biased lock
+	     that are not registered in __readers.  */
+	  if (rwlock->__data.__flags == PTHREAD_RWLOCK_READER_BIASED_NP
+	      && __pthread_rwlock_revoke_bias (rwlock, true, 0, NULL) != 0)
+	    {
+	      __pthread_rwlock_unlock (rwlock);
+	      return EBUSY;
+	    }
 	  return 0;
 	}
       /* TODO Back-off.  */
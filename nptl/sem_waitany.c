@@ -0,0 +1,256 @@
+/* Wait for any of several semaphores.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <time.h>
+#include "semaphoreP.h"
+#include "sem_waitcommon.c"
+
+/* A waiter registers itself as a waiter on all semaphores (see
+   __new_sem_wait_slow64), and then blocks on the futex words of all of
+   them at once with futex_waitv until one of them has a token.
+
+   sem_post wakes only one waiter.  If that waiter is a sem_waitany_np
+   call which then takes a token from a different semaphore (or times
+   out, or is canceled), the wake-up would be lost for the other waiters
+   of the posted semaphore.  Therefore, before a waiter stops being
+   registered on a semaphore that still has tokens, it wakes another
+   waiter of that semaphore.  This has to happen before unregistering
+   because the semaphore may be destroyed once it has no waiters.  */
+
+/* Set once futex_waitv has failed with ENOSYS.  */
+static int futex_waitv_unsupported;
+
+/* Without futex_waitv, the waiter blocks on one semaphore at a time, and
+   switches to the next one after this many nanoseconds.  */
+#define SEM_WAITANY_POLL_NSEC 1000000
+
+struct sem_waitany_args
+{
+  sem_t *const *sems;
+  unsigned int nsems;
+};
+
+/* Register as a waiter of SEM.  */
+static void
+sem_waitany_register (struct new_sem *sem)
+{
+#if __HAVE_64B_ATOMICS
+  /* See __new_sem_wait_slow64.  */
+  atomic_fetch_add_relaxed (&sem->data, (uint64_t) 1 << SEM_NWAITERS_SHIFT);
+#else
+  atomic_fetch_add_acquire (&sem->nwaiters, 1);
+#endif
+}
+
+/* Set up *ENTRY to block on SEM while it has no tokens.  Return true if
+   SEM has a token.  */
+static bool
+sem_waitany_prepare (struct new_sem *sem, struct futex_waitv_entry *entry)
+{
+#if __HAVE_64B_ATOMICS
+  uint64_t d = atomic_load_relaxed (&sem->data);
+  futex_waitv_entry_init (entry,
+			  (unsigned int *) &sem->data + SEM_VALUE_OFFSET, 0,
+			  sem->private);
+  return (d & SEM_VALUE_MASK) != 0;
+#else
+  /* Make sure that the nwaiters bit is set before blocking, as in
+     __new_sem_wait_slow64.  */
+  unsigned int v = atomic_load_relaxed (&sem->value);
+  do
+    {
+      if ((v & SEM_NWAITERS_MASK) != 0)
+	break;
+    }
+  while (!atomic_compare_exchange_weak_release (&sem->value,
+      &v, v | SEM_NWAITERS_MASK));
+  futex_waitv_entry_init (entry, &sem->value, SEM_NWAITERS_MASK,
+			  sem->private);
+  return (v >> SEM_VALUE_SHIFT) != 0;
+#endif
+}
+
+/* Stop being a waiter of all semaphores in ARGS, passing on wake-ups
+   for the ones with tokens left.  */
+static void
+sem_waitany_finish (const struct sem_waitany_args *args)
+{
+  for (unsigned int i = 0; i < args->nsems; ++i)
+    {
+      struct new_sem *sem = (struct new_sem *) args->sems[i];
+#if __HAVE_64B_ATOMICS
+      unsigned int *futex_word = (unsigned int *) &sem->data
+				 + SEM_VALUE_OFFSET;
+      if ((atomic_load_relaxed (&sem->data) & SEM_VALUE_MASK) != 0)
+	futex_wake (futex_word, 1, sem->private);
+      atomic_fetch_add_relaxed (&sem->data,
+	  -((uint64_t) 1 << SEM_NWAITERS_SHIFT));
+#else
+      if ((atomic_load_relaxed (&sem->value) >> SEM_VALUE_SHIFT) != 0)
+	futex_wake (&sem->value, 1, sem->private);
+      __sem_wait_32_finish (sem);
+#endif
+    }
+}
+
+static void
+sem_waitany_cleanup (void *arg)
+{
+  sem_waitany_finish (arg);
+}
+
+/* Block until one of the NSEMS futex words in WAITERS is woken or
+   ABSTIME has passed.  ROUND counts the calls of this function.  Returns
+   the same values as __futex_waitv_cancelable64, except ENOSYS.  */
+static int
+sem_waitany_block (sem_t *const *sems, struct futex_waitv_entry *waiters,
+		   unsigned int nsems, unsigned int round, clockid_t clockid,
+		   const struct __timespec64 *abstime)
+{
+  if (!atomic_load_relaxed (&futex_waitv_unsupported))
+    {
+      int err = __futex_waitv_cancelable64 (waiters, nsems, clockid,
+					    abstime);
+      if (err != ENOSYS)
+	return err;
+      atomic_store_relaxed (&futex_waitv_unsupported, 1);
+    }
+
+  /* Block on one semaphore for a short time, so that posts to the other
+     semaphores are noticed after at most SEM_WAITANY_POLL_NSEC.  */
+  struct __timespec64 deadline;
+  __clock_gettime64 (clockid, &deadline);
+  deadline.tv_nsec += SEM_WAITANY_POLL_NSEC;
+  if (deadline.tv_nsec >= 1000000000)
+    {
+      deadline.tv_nsec -= 1000000000;
+      ++deadline.tv_sec;
+    }
+  bool last = (abstime != NULL
+	       && (abstime->tv_sec < deadline.tv_sec
+		   || (abstime->tv_sec == deadline.tv_sec
+		       && abstime->tv_nsec <= deadline.tv_nsec)));
+  if (last)
+    deadline = *abstime;
+
+  unsigned int i = round % nsems;
+  int err = __futex_abstimed_wait_cancelable64
+    ((unsigned int *) (uintptr_t) waiters[i].uaddr, waiters[i].val,
+     clockid, &deadline, ((struct new_sem *) sems[i])->private);
+  if (err == ETIMEDOUT && !last)
+    err = 0;
+  return err;
+}
+
+/* Slow path that blocks.  */
+static int
+__attribute__ ((noinline))
+__sem_waitany_slow64 (sem_t *const *sems, unsigned int nsems,
+		      clockid_t clockid, const struct __timespec64 *abstime)
+{
+  struct futex_waitv_entry waiters[FUTEX_WAITV_MAX];
+  struct sem_waitany_args args = { sems, nsems };
+  int result = -1;
+
+  for (unsigned int i = 0; i < nsems; ++i)
+    sem_waitany_register ((struct new_sem *) sems[i]);
+
+  pthread_cleanup_push (sem_waitany_cleanup, &args);
+
+  for (unsigned int round = 0; ; ++round)
+    {
+      /* Try to grab a token from the semaphores in order.  If a token
+	 was taken by another thread after we have seen it, retry
+	 without blocking.  */
+      bool seen_token = false;
+      for (unsigned int i = 0; i < nsems; ++i)
+	{
+	  struct new_sem *sem = (struct new_sem *) sems[i];
+	  if (sem_waitany_prepare (sem, &waiters[i]))
+	    {
+	      seen_token = true;
+	      if (__new_sem_wait_fast (sem, 1) == 0)
+		{
+		  result = i;
+		  break;
+		}
+	    }
+	}
+      if (result >= 0)
+	break;
+      if (seen_token)
+	continue;
+
+      /* A return value of 0 or EAGAIN is due to a real or spurious
+	 wake-up, or due to a change in the number of tokens.  See
+	 __new_sem_wait_slow64.  */
+      int err = sem_waitany_block (sems, waiters, nsems, round, clockid,
+				   abstime);
+      if (err == ETIMEDOUT || err == EINTR || err == EOVERFLOW)
+	{
+	  __set_errno (err);
+	  break;
+	}
+    }
+
+  pthread_cleanup_pop (0);
+
+  sem_waitany_finish (&args);
+  return result;
+}
+
+int
+__sem_waitany_np64 (sem_t *const *sems, unsigned int nsems,
+		    clockid_t clockid, const struct __timespec64 *abstime)
+{
+  if (nsems == 0 || nsems > FUTEX_WAITV_MAX
+      || !futex_abstimed_supported_clockid (clockid)
+      || (abstime != NULL && !valid_nanoseconds (abstime->tv_nsec)))
+    {
+      __set_errno (EINVAL);
+      return -1;
+    }
+
+  for (unsigned int i = 0; i < nsems; ++i)
+    if (__new_sem_wait_fast ((struct new_sem *) sems[i], 0) == 0)
+      return i;
+
+  /* With a single semaphore, this is sem_clockwait.  */
+  if (nsems == 1)
+    return __new_sem_wait_slow64 ((struct new_sem *) sems[0], clockid,
+				  abstime);
+
+  return __sem_waitany_slow64 (sems, nsems, clockid, abstime);
+}
+
+#if __TIMESIZE != 64
+libc_hidden_def (__sem_waitany_np64)
+
+int
+sem_waitany_np (sem_t *const *sems, unsigned int nsems, clockid_t clockid,
+		const struct timespec *abstime)
+{
+  struct __timespec64 ts64, *pts64 = NULL;
+  if (abstime != NULL)
+    {
+      ts64 = valid_timespec_to_timespec64 (*abstime);
+      pts64 = &ts64;
+    }
+  return __sem_waitany_np64 (sems, nsems, clockid, pts64);
+}
+#endif
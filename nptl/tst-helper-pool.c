@@ -0,0 +1,126 @@
+/* Test the helper thread pool shared by POSIX AIO and getaddrinfo_a.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The pool runs at most max_helper_threads AIO requests at a time.
+   The test starts more reads than that from pipes, which block until
+   data is written, and checks that getaddrinfo_a lookups still
+   complete, in the process and in a subprocess created by fork.  */
+
+#include <aio.h>
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <support/check.h>
+#include <support/xunistd.h>
+
+/* Must match glibc.pthread.helper_threads in tst-helper-pool-ENV.  */
+enum { max_helper_threads = 3 };
+
+enum { request_count = 3 * max_helper_threads };
+
+static int pipes[request_count][2];
+static struct aiocb cbs[request_count];
+static char bufs[request_count];
+
+/* Start reads from all pipes.  */
+static void
+start_reads (void)
+{
+  for (int i = 0; i < request_count; ++i)
+    {
+      xpipe (pipes[i]);
+      memset (&cbs[i], 0, sizeof (cbs[i]));
+      cbs[i].aio_fildes = pipes[i][0];
+      cbs[i].aio_buf = &bufs[i];
+      cbs[i].aio_nbytes = 1;
+      TEST_COMPARE (aio_read (&cbs[i]), 0);
+    }
+}
+
+/* Write to the pipes, and check that all reads complete.  */
+static void
+finish_reads (void)
+{
+  for (int i = 0; i < request_count; ++i)
+    {
+      char c = 'a' + i;
+      xwrite (pipes[i][1], &c, 1);
+    }
+  for (int i = 0; i < request_count; ++i)
+    {
+      const struct aiocb *list[] = { &cbs[i] };
+      while (aio_error (&cbs[i]) == EINPROGRESS)
+	TEST_VERIFY (aio_suspend (list, 1, NULL) == 0 || errno == EINTR);
+      TEST_COMPARE (aio_error (&cbs[i]), 0);
+      TEST_COMPARE (aio_return (&cbs[i]), 1);
+      TEST_COMPARE (bufs[i], 'a' + i);
+      xclose (pipes[i][0]);
+      xclose (pipes[i][1]);
+    }
+}
+
+/* Run a getaddrinfo_a lookup and wait for its completion.  The test
+   times out if the lookup is never started.  */
+static void
+check_lookup (void)
+{
+  struct addrinfo hints = { .ai_flags = AI_NUMERICHOST };
+  struct gaicb gcb = { .ar_name = "127.0.0.1", .ar_request = &hints };
+  struct gaicb *gcbs[] = { &gcb };
+  TEST_COMPARE (getaddrinfo_a (GAI_NOWAIT, gcbs, 1, NULL), 0);
+
+  const struct gaicb *wait_list[] = { &gcb };
+  while (gai_error (&gcb) == EAI_INPROGRESS)
+    gai_suspend (wait_list, 1, NULL);
+  TEST_COMPARE (gai_error (&gcb), 0);
+  TEST_VERIFY (gcb.ar_result != NULL);
+  freeaddrinfo (gcb.ar_result);
+}
+
+static int
+do_test (void)
+{
+  start_reads ();
+
+  /* The helper threads of the parent do not exist in the subprocess,
+     so the pool has to start a new one there.  The subprocess does not
+     use AIO, whose lock may be held by a helper thread at the time of
+     the fork.  */
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      check_lookup ();
+      _exit (support_record_failure_is_failed () ? 1 : 0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  /* The blocked reads do not count against the limit for lookups.  */
+  check_lookup ();
+  check_lookup ();
+
+  /* The queued reads are run once the first ones complete.  */
+  finish_reads ();
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -0,0 +1,167 @@
+/* Test mutexes of type PTHREAD_MUTEX_QUEUED_NP.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+
+enum
+  {
+    fifo_threads = 6,
+    stress_threads = 4,
+    stress_loops = 20000,
+  };
+
+static pthread_mutex_t lock;
+
+/* The last thread in the queue of waiters.  See
+   PTHREAD_MUTEX_QUEUE_TAIL.  */
+static void *
+queue_tail (void)
+{
+  return atomic_load_explicit ((void *_Atomic *) &lock.__data.__list.__next,
+			       memory_order_relaxed);
+}
+
+/* Protected by LOCK.  */
+static int order[fifo_threads];
+static int order_count;
+
+static void *
+fifo_thread (void *closure)
+{
+  xpthread_mutex_lock (&lock);
+  order[order_count++] = (int) (intptr_t) closure;
+  xpthread_mutex_unlock (&lock);
+  return NULL;
+}
+
+static void *
+timedlock_thread (void *closure)
+{
+  struct timespec ts = timespec_add (xclock_now (CLOCK_REALTIME),
+				     make_timespec (0, 100000000));
+  TEST_COMPARE (pthread_mutex_timedlock (&lock, &ts), ETIMEDOUT);
+  TEST_COMPARE (pthread_mutex_trylock (&lock), EBUSY);
+  return NULL;
+}
+
+/* Protected by LOCK.  */
+static unsigned int counter;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static void *
+stress_thread (void *closure)
+{
+  for (int i = 0; i < stress_loops; ++i)
+    {
+      if (i % 3 != 0 || pthread_mutex_trylock (&lock) != 0)
+	xpthread_mutex_lock (&lock);
+      unsigned int c = counter;
+      if (i % 128 == 0)
+	sched_yield ();
+      counter = c + 1;
+      if (i % 1024 == 0)
+	TEST_COMPARE (pthread_cond_broadcast (&cond), 0);
+      xpthread_mutex_unlock (&lock);
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  pthread_mutexattr_t attr;
+  xpthread_mutexattr_init (&attr);
+  xpthread_mutexattr_settype (&attr, PTHREAD_MUTEX_QUEUED_NP);
+  int kind;
+  TEST_COMPARE (pthread_mutexattr_gettype (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_MUTEX_QUEUED_NP);
+
+  /* The queue is private to the process, and there is no support for
+     robust or priority-aware queued mutexes.  */
+  xpthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+  TEST_COMPARE (pthread_mutex_init (&lock, &attr), ENOTSUP);
+  xpthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_PRIVATE);
+  xpthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+  TEST_COMPARE (pthread_mutex_init (&lock, &attr), ENOTSUP);
+  xpthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_STALLED);
+  xpthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_INHERIT);
+  TEST_COMPARE (pthread_mutex_init (&lock, &attr), ENOTSUP);
+  xpthread_mutexattr_setprotocol (&attr, PTHREAD_PRIO_NONE);
+  xpthread_mutex_init (&lock, &attr);
+  xpthread_mutexattr_destroy (&attr);
+
+  /* Basic operations, which behave as for a normal mutex.  */
+  TEST_COMPARE (pthread_mutex_trylock (&lock), 0);
+  pthread_t thr = xpthread_create (NULL, timedlock_thread, NULL);
+  xpthread_join (thr);
+  xpthread_mutex_unlock (&lock);
+  struct timespec ts = timespec_add (xclock_now (CLOCK_MONOTONIC),
+				     make_timespec (1, 0));
+  TEST_COMPARE (pthread_mutex_clocklock (&lock, CLOCK_MONOTONIC, &ts), 0);
+  xpthread_mutex_unlock (&lock);
+
+  /* Waiters acquire the mutex in the order in which they queued up.  */
+  pthread_t threads[fifo_threads];
+  xpthread_mutex_lock (&lock);
+  for (int i = 0; i < fifo_threads; ++i)
+    {
+      void *tail = queue_tail ();
+      threads[i] = xpthread_create (NULL, fifo_thread, (void *) (intptr_t) i);
+      while (queue_tail () == tail)
+	sched_yield ();
+    }
+  xpthread_mutex_unlock (&lock);
+  for (int i = 0; i < fifo_threads; ++i)
+    xpthread_join (threads[i]);
+  TEST_COMPARE (order_count, fifo_threads);
+  for (int i = 0; i < fifo_threads; ++i)
+    TEST_COMPARE (order[i], i);
+  TEST_VERIFY (queue_tail () == NULL);
+
+  /* Mutual exclusion under contention, and with a condition
+     variable.  */
+  pthread_t stress[stress_threads];
+  for (int i = 0; i < stress_threads; ++i)
+    stress[i] = xpthread_create (NULL, stress_thread, NULL);
+  xpthread_mutex_lock (&lock);
+  while (counter < stress_threads * stress_loops)
+    {
+      ts = timespec_add (xclock_now (CLOCK_REALTIME),
+			 make_timespec (0, 10000000));
+      int ret = pthread_cond_timedwait (&cond, &lock, &ts);
+      TEST_VERIFY (ret == 0 || ret == ETIMEDOUT);
+    }
+  xpthread_mutex_unlock (&lock);
+  for (int i = 0; i < stress_threads; ++i)
+    xpthread_join (stress[i]);
+  TEST_COMPARE (counter, stress_threads * stress_loops);
+  TEST_VERIFY (queue_tail () == NULL);
+
+  xpthread_mutex_destroy (&lock);
+  return 0;
+}
+
+#include <support/test-driver.c>
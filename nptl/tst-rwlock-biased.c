@@ -0,0 +1,198 @@
+/* Test rwlocks of kind PTHREAD_RWLOCK_READER_BIASED_NP.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+
+enum
+  {
+    reader_count = 4,
+    writer_count = 2,
+    writer_loops = 2000,
+  };
+
+static pthread_rwlock_t lock;
+static pthread_barrier_t barrier;
+
+/* Protected by LOCK, and always equal outside of write critical
+   sections.  */
+static volatile unsigned int value1;
+static volatile unsigned int value2;
+
+static atomic_bool done;
+
+/* Number of readers registered in the lock word, which excludes those
+   which acquired the lock through the table of visible readers.  See
+   PTHREAD_RWLOCK_READER_SHIFT.  */
+static unsigned int
+registered_readers (void)
+{
+  return lock.__data.__readers >> 3;
+}
+
+/* Acquire and release read locks until the lock is in reader bias mode,
+   in which read locks do not show up in __readers.  */
+static void
+enable_bias (void)
+{
+  for (int i = 0; i < 1000; ++i)
+    {
+      xpthread_rwlock_rdlock (&lock);
+      bool biased = registered_readers () == 0;
+      xpthread_rwlock_unlock (&lock);
+      if (biased)
+	return;
+    }
+  FAIL_EXIT1 ("reader bias not enabled");
+}
+
+static void *
+hold_read_thread (void *closure)
+{
+  enable_bias ();
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (registered_readers (), 0);
+  xpthread_barrier_wait (&barrier);
+  /* The main thread tries to acquire the write lock.  */
+  xpthread_barrier_wait (&barrier);
+  /* A recursive read lock must not block on the pending writer.  */
+  struct timespec ts = make_timespec (0, 100000000);
+  nanosleep (&ts, NULL);
+  xpthread_rwlock_rdlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  return NULL;
+}
+
+static void *
+reader_thread (void *closure)
+{
+  while (!done)
+    {
+      xpthread_rwlock_rdlock (&lock);
+      TEST_COMPARE (value1, value2);
+      xpthread_rwlock_unlock (&lock);
+      if (pthread_rwlock_tryrdlock (&lock) == 0)
+	{
+	  TEST_COMPARE (value1, value2);
+	  xpthread_rwlock_unlock (&lock);
+	}
+      /* New readers may join a read phase while a writer is waiting,
+	 so the readers must not keep the lock busy all the time.  */
+      sched_yield ();
+    }
+  return NULL;
+}
+
+static void *
+writer_thread (void *closure)
+{
+  for (int i = 0; i < writer_loops; ++i)
+    {
+      if (i % 2 == 0 || pthread_rwlock_trywrlock (&lock) != 0)
+	xpthread_rwlock_wrlock (&lock);
+      ++value1;
+      sched_yield ();
+      ++value2;
+      xpthread_rwlock_unlock (&lock);
+      /* Give the readers time to enable the bias again.  */
+      if (i % 16 == 0)
+	{
+	  struct timespec ts = make_timespec (0, 1000000);
+	  nanosleep (&ts, NULL);
+	}
+    }
+  return NULL;
+}
+
+static int
+do_test (void)
+{
+  pthread_rwlockattr_t attr;
+  xpthread_rwlockattr_init (&attr);
+  xpthread_rwlockattr_setkind_np (&attr, PTHREAD_RWLOCK_READER_BIASED_NP);
+  int kind;
+  TEST_COMPARE (pthread_rwlockattr_getkind_np (&attr, &kind), 0);
+  TEST_COMPARE (kind, PTHREAD_RWLOCK_READER_BIASED_NP);
+  xpthread_rwlock_init (&lock, &attr);
+
+  /* Recursive read locks, and write locks while holding a read lock
+     through the table.  */
+  enable_bias ();
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (pthread_rwlock_tryrdlock (&lock), 0);
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (registered_readers (), 0);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), EBUSY);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+
+  /* A failed trywrlock keeps the reader bias, a write lock revokes it.  */
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (registered_readers (), 0);
+  xpthread_rwlock_unlock (&lock);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), 0);
+  TEST_COMPARE (pthread_rwlock_rdlock (&lock), EDEADLK);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_rwlock_rdlock (&lock);
+  TEST_COMPARE (registered_readers (), 1);
+  xpthread_rwlock_unlock (&lock);
+
+  /* Writers time out and wait for readers in the table.  */
+  xpthread_barrier_init (&barrier, NULL, 2);
+  pthread_t thr = xpthread_create (NULL, hold_read_thread, NULL);
+  xpthread_barrier_wait (&barrier);
+  struct timespec ts = timespec_add (xclock_now (CLOCK_REALTIME),
+				     make_timespec (0, 100000000));
+  TEST_COMPARE (pthread_rwlock_timedwrlock (&lock, &ts), ETIMEDOUT);
+  TEST_VERIFY (timespec_sub (xclock_now (CLOCK_REALTIME), ts).tv_sec >= 0);
+  TEST_COMPARE (pthread_rwlock_trywrlock (&lock), EBUSY);
+  xpthread_barrier_wait (&barrier);
+  xpthread_rwlock_wrlock (&lock);
+  xpthread_rwlock_unlock (&lock);
+  xpthread_join (thr);
+  xpthread_barrier_destroy (&barrier);
+
+  /* Readers never observe partial updates.  */
+  pthread_t readers[reader_count];
+  pthread_t writers[writer_count];
+  for (int i = 0; i < reader_count; ++i)
+    readers[i] = xpthread_create (NULL, reader_thread, NULL);
+  for (int i = 0; i < writer_count; ++i)
+    writers[i] = xpthread_create (NULL, writer_thread, NULL);
+  for (int i = 0; i < writer_count; ++i)
+    xpthread_join (writers[i]);
+  done = true;
+  for (int i = 0; i < reader_count; ++i)
+    xpthread_join (readers[i]);
+  TEST_COMPARE (value1, writer_count * writer_loops);
+  TEST_COMPARE (value2, writer_count * writer_loops);
+
+  xpthread_rwlock_destroy (&lock);
+  return 0;
+}
+
+#include <support/test-driver.c>
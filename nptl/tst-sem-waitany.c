@@ -0,0 +1,183 @@
+/* Test sem_waitany_np.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+
+enum
+  {
+    sem_count = 4,
+    consumer_count = 3,
+    posts_per_sem = 2000,
+  };
+
+static sem_t sems[sem_count];
+static sem_t *sem_ptrs[sem_count];
+
+static void
+check_values (const int *expected)
+{
+  for (int i = 0; i < sem_count; ++i)
+    {
+      int value;
+      TEST_COMPARE (sem_getvalue (&sems[i], &value), 0);
+      TEST_COMPARE (value, expected[i]);
+    }
+}
+
+static void *
+waiter_thread (void *closure)
+{
+  int result = sem_waitany_np (sem_ptrs, sem_count, CLOCK_MONOTONIC, NULL);
+  return (void *) (intptr_t) result;
+}
+
+static void *
+cancel_thread (void *closure)
+{
+  sem_waitany_np (sem_ptrs, sem_count, CLOCK_REALTIME, NULL);
+  FAIL_EXIT1 ("sem_waitany_np returned after cancellation");
+}
+
+/* Total number of tokens taken by the consumer threads, and whether
+   all tokens have been taken.  */
+static atomic_int total_taken;
+static atomic_bool done;
+
+/* Count the tokens taken from each semaphore.  */
+static void *
+consumer_thread (void *closure)
+{
+  int *taken = closure;
+  while (true)
+    {
+      int result = sem_waitany_np (sem_ptrs, sem_count, CLOCK_MONOTONIC,
+				   NULL);
+      TEST_VERIFY_EXIT (result >= 0 && result < sem_count);
+      if (done)
+	/* An additional token posted to end the thread.  */
+	return NULL;
+      ++taken[result];
+      ++total_taken;
+    }
+}
+
+static int
+do_test (void)
+{
+  for (int i = 0; i < sem_count; ++i)
+    {
+      TEST_COMPARE (sem_init (&sems[i], 0, 0), 0);
+      sem_ptrs[i] = &sems[i];
+    }
+
+  struct timespec ts = make_timespec (0, 0);
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, 0, CLOCK_MONOTONIC, &ts), -1);
+  TEST_COMPARE (errno, EINVAL);
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, sem_count,
+				CLOCK_PROCESS_CPUTIME_ID, &ts), -1);
+  TEST_COMPARE (errno, EINVAL);
+  ts.tv_nsec = 1000000000;
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, sem_count, CLOCK_MONOTONIC, &ts),
+		-1);
+  TEST_COMPARE (errno, EINVAL);
+
+  /* A timeout in the past.  */
+  ts = make_timespec (0, 0);
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, sem_count, CLOCK_MONOTONIC, &ts),
+		-1);
+  TEST_COMPARE (errno, ETIMEDOUT);
+
+  /* A timeout in the future.  */
+  ts = timespec_add (xclock_now (CLOCK_REALTIME),
+		     make_timespec (0, 100000000));
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, sem_count, CLOCK_REALTIME, &ts),
+		-1);
+  TEST_COMPARE (errno, ETIMEDOUT);
+  TEST_VERIFY (timespec_sub (xclock_now (CLOCK_REALTIME), ts).tv_sec >= 0);
+  check_values ((int[]) { 0, 0, 0, 0 });
+
+  /* Available tokens are taken without blocking, from the first
+     semaphore that has one.  */
+  TEST_COMPARE (sem_post (&sems[2]), 0);
+  TEST_COMPARE (sem_post (&sems[3]), 0);
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, sem_count, CLOCK_MONOTONIC, &ts),
+		2);
+  TEST_COMPARE (sem_waitany_np (sem_ptrs, sem_count, CLOCK_MONOTONIC, NULL),
+		3);
+  check_values ((int[]) { 0, 0, 0, 0 });
+
+  /* A blocked waiter takes the token of the posted semaphore.  */
+  pthread_t thr = xpthread_create (NULL, waiter_thread, NULL);
+  ts = make_timespec (0, 50000000);
+  nanosleep (&ts, NULL);
+  TEST_COMPARE (sem_post (&sems[3]), 0);
+  TEST_COMPARE ((intptr_t) xpthread_join (thr), 3);
+  check_values ((int[]) { 0, 0, 0, 0 });
+
+  /* A canceled waiter does not consume a token.  */
+  thr = xpthread_create (NULL, cancel_thread, NULL);
+  nanosleep (&ts, NULL);
+  xpthread_cancel (thr);
+  TEST_VERIFY (xpthread_join (thr) == PTHREAD_CANCELED);
+  TEST_COMPARE (sem_post (&sems[1]), 0);
+  check_values ((int[]) { 0, 1, 0, 0 });
+  TEST_COMPARE (sem_trywait (&sems[1]), 0);
+
+  /* Every token is consumed exactly once, and no wake-up is lost when
+     consumers take tokens from semaphores other than the one which
+     woke them.  */
+  int taken[consumer_count][sem_count] = { };
+  pthread_t consumers[consumer_count];
+  for (int i = 0; i < consumer_count; ++i)
+    consumers[i] = xpthread_create (NULL, consumer_thread, taken[i]);
+  for (int round = 0; round < posts_per_sem; ++round)
+    for (int i = 0; i < sem_count; ++i)
+      TEST_COMPARE (sem_post (&sems[i]), 0);
+  /* A lost wake-up would leave tokens behind and block here until the
+     test times out.  */
+  while (total_taken < sem_count * posts_per_sem)
+    sched_yield ();
+  done = true;
+  for (int i = 0; i < consumer_count; ++i)
+    TEST_COMPARE (sem_post (&sems[i % sem_count]), 0);
+  for (int i = 0; i < consumer_count; ++i)
+    xpthread_join (consumers[i]);
+  for (int i = 0; i < sem_count; ++i)
+    {
+      int sum = 0;
+      for (int j = 0; j < consumer_count; ++j)
+	sum += taken[j][i];
+      TEST_COMPARE (sum, posts_per_sem);
+    }
+  check_values ((int[]) { 0, 0, 0, 0 });
+
+  for (int i = 0; i < sem_count; ++i)
+    TEST_COMPARE (sem_destroy (&sems[i]), 0);
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -105,6 +105,10 @@ __libc_fork (void)
 
       reclaim_stacks ();
 
+      /* Restart the malloc helper threads.  */
+      if (multiple_threads)
+	call_function_static_weak (__malloc_fork_restart_child);
+
       /* Run the handlers registered for the child.  */
       __run_postfork_handlers (atfork_run_child, multiple_threads, lastrun);
     }
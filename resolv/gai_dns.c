@@ -0,0 +1,622 @@
+/* Send the DNS queries of getaddrinfo_a lookups without blocking.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <netinet/in.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <gai_misc.h>
+#include <not-cancel.h>
+#include <nss_files.h>
+#include <nsswitch.h>
+#include <resolv/resolv-internal.h>
+#include <resolv/resolv_context.h>
+#include <scratch_buffer.h>
+
+#if PACKETSZ > 65536
+# define MAXPACKET	PACKETSZ
+#else
+# define MAXPACKET	65536
+#endif
+
+/* A lookup usually spends almost all of its time waiting for the
+   responses of the name servers.  Instead of blocking a helper thread
+   for that, the engine thread sends the DNS queries of many lookups
+   and waits for all responses with poll.  Once the responses for a
+   lookup have arrived, a helper thread runs getaddrinfo with the
+   responses installed by __resolv_prefetch_set, so that it processes
+   them as usual but does not have to wait for them.
+
+   The engine only sends the queries which nss_dns sends first for the
+   name, that is, if the name has at least as many dots as the ndots
+   option requires and the hosts database only consults "files" before
+   "dns", and the name is not in /etc/hosts.  getaddrinfo processes
+   other lookups, and sends any further queries, as usual.  Responses
+   which cause getaddrinfo to retry, such as truncated responses or
+   server failures, are not used.
+
+   As in res_send, each query is sent from a socket of its own, which
+   is connected to the name server, so that each query has a random
+   source port and responses from other addresses are rejected.  The
+   number of lookups in progress is limited to bound the number of
+   sockets.
+
+   Submitted requests are linked through the next_dns member and
+   protected by __gai_requests_mutex.  All other state is private to
+   the engine thread.  */
+
+/* Maximum number of lookups whose queries are in progress.  */
+#define GAI_DNS_MAX_LOOKUPS 128
+
+struct dns_query
+{
+  /* Socket from which the query has been sent, or -1 once the query
+     is done.  */
+  int fd;
+
+  /* Number of times the query has been sent.  */
+  unsigned int sends;
+
+  /* True if any attempt failed other than by a timeout.  */
+  bool failed;
+
+  struct __timespec64 deadline;
+
+  /* The response, if one has been received.  */
+  unsigned char *response;
+  int response_length;
+
+  int length;
+  unsigned char packet[PACKETSZ];
+};
+
+struct dns_lookup
+{
+  struct dns_lookup *next;
+  struct requestlist *req;
+
+  /* The name servers and the timing parameters of the resolver
+     configuration.  */
+  struct sockaddr_in6 ns[MAXNS];
+  unsigned int nscount;
+  int retrans;
+  int retry;
+
+  int nqueries;
+  struct dns_query queries[2];
+};
+
+/* Requests submitted to the engine thread.  */
+static struct requestlist *submitted;
+static struct requestlist *submitted_tail;
+
+/* True while the engine thread runs.  */
+static bool engine_running;
+
+/* Pipe used to wake up the engine thread.  */
+static int wake_pipe[2] = { -1, -1 };
+
+static void *gai_dns_engine (void *arg);
+
+bool
+__gai_dns_submit (struct requestlist *req)
+{
+  const struct gaicb *cb = req->gaicbp;
+  const char *name = cb->ar_name;
+  int family = AF_UNSPEC;
+  int flags = 0;
+  if (cb->ar_request != NULL)
+    {
+      family = cb->ar_request->ai_family;
+      flags = cb->ar_request->ai_flags;
+    }
+
+  /* Only plain host names are resolved in the background.  Names which
+     getaddrinfo transforms first, or which need not be sent to the
+     name server, are processed right away.  */
+  if (name == NULL || (flags & (AI_NUMERICHOST | AI_IDN)) != 0
+      || (family != AF_UNSPEC && family != AF_INET && family != AF_INET6)
+      || strchr (name, '.') == NULL)
+    return false;
+  for (const char *p = name; *p != '\0'; ++p)
+    if (!((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z')
+	  || (*p >= '0' && *p <= '9') || *p == '-' || *p == '.'
+	  || *p == '_'))
+      return false;
+  struct in_addr addr;
+  if (__inet_aton_exact (name, &addr))
+    return false;
+
+  if (!engine_running)
+    {
+      if (__pipe2 (wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0)
+	return false;
+      pthread_t th;
+      if (gai_create_helper_thread (&th, gai_dns_engine, NULL) != 0)
+	{
+	  __close_nocancel_nostatus (wake_pipe[0]);
+	  __close_nocancel_nostatus (wake_pipe[1]);
+	  return false;
+	}
+      engine_running = true;
+    }
+  else if (submitted == NULL)
+    {
+      char c = 0;
+      __write_nocancel (wake_pipe[1], &c, 1);
+    }
+
+  req->running = 2;
+  req->next_dns = NULL;
+  if (submitted == NULL)
+    submitted = req;
+  else
+    submitted_tail->next_dns = req;
+  submitted_tail = req;
+  return true;
+}
+
+void
+__gai_dns_fork_subprocess (void)
+{
+  /* The engine thread does not exist in the subprocess.  */
+  if (engine_running)
+    {
+      __close_nocancel_nostatus (wake_pipe[0]);
+      __close_nocancel_nostatus (wake_pipe[1]);
+    }
+  engine_running = false;
+  submitted = NULL;
+  submitted_tail = NULL;
+}
+
+/* Return true if the hosts database consults "dns" for NAME, and only
+   "files" before, which does not know NAME.  */
+static bool
+hosts_uses_dns (const char *name)
+{
+  nss_action_list nip;
+  if (!__nss_database_get (nss_database_hosts, &nip) || nip == NULL)
+    return false;
+
+  for (; nip->module != NULL; ++nip)
+    {
+      if (strcmp (nip->module->name, "dns") == 0)
+	return true;
+      if (strcmp (nip->module->name, "files") != 0
+	  || nss_action_get (nip, NSS_STATUS_NOTFOUND) != NSS_ACTION_CONTINUE)
+	return false;
+
+      struct scratch_buffer buf;
+      scratch_buffer_init (&buf);
+      enum nss_status status;
+      while (true)
+	{
+	  struct gaih_addrtuple *at = NULL;
+	  int err;
+	  int herr;
+	  status = _nss_files_gethostbyname4_r (name, &at, buf.data,
+						buf.length, &err, &herr, NULL);
+	  if (status != NSS_STATUS_TRYAGAIN || err != ERANGE
+	      || !scratch_buffer_grow (&buf))
+	    break;
+	}
+      scratch_buffer_free (&buf);
+      if (status != NSS_STATUS_NOTFOUND)
+	return false;
+    }
+
+  return false;
+}
+
+/* Send QUERY to the next name server, from a new socket.  Return false
+   if all attempts have been made.  */
+static bool
+send_query (struct dns_lookup *lookup, struct dns_query *query)
+{
+  if (query->fd >= 0)
+    __close_nocancel_nostatus (query->fd);
+  query->fd = -1;
+
+  while (query->sends < lookup->retry * lookup->nscount)
+    {
+      unsigned int ns = query->sends % lookup->nscount;
+      ++query->sends;
+
+      const struct sockaddr *sa = (const struct sockaddr *) &lookup->ns[ns];
+      socklen_t salen = (sa->sa_family == AF_INET6
+			 ? sizeof (struct sockaddr_in6)
+			 : sizeof (struct sockaddr_in));
+      int fd = __socket (sa->sa_family,
+			 SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd < 0)
+	{
+	  query->failed = true;
+	  continue;
+	}
+      __res_enable_icmp (sa->sa_family, fd);
+      if (__connect (fd, sa, salen) != 0
+	  || __send (fd, query->packet, query->length, MSG_NOSIGNAL)
+	     != query->length)
+	{
+	  __close_nocancel_nostatus (fd);
+	  query->failed = true;
+	  continue;
+	}
+
+      /* Use the timeout of send_dg.  */
+      int seconds = lookup->retrans << ns;
+      if (ns > 0)
+	seconds /= lookup->nscount;
+      if (seconds <= 0)
+	seconds = 1;
+      __clock_gettime64 (CLOCK_MONOTONIC, &query->deadline);
+      query->deadline.tv_sec += seconds;
+      query->fd = fd;
+      return true;
+    }
+
+  return false;
+}
+
+/* Set up LOOKUP for REQ and send its queries.  Return false if the
+   lookup has to be processed without the engine.  */
+static bool
+start_lookup (struct dns_lookup *lookup, struct requestlist *req)
+{
+  const struct gaicb *cb = req->gaicbp;
+  const char *name = cb->ar_name;
+  int family = AF_UNSPEC;
+  int flags = 0;
+  if (cb->ar_request != NULL)
+    {
+      family = cb->ar_request->ai_family;
+      flags = cb->ar_request->ai_flags;
+    }
+
+  memset (lookup, 0, offsetof (struct dns_lookup, queries));
+  lookup->req = req;
+
+  if (!hosts_uses_dns (name))
+    return false;
+
+  struct resolv_context *ctx = __resolv_context_get ();
+  if (ctx == NULL)
+    return false;
+  struct __res_state *statp = ctx->resp;
+
+  /* nss_dns sends the name unchanged first only if it has enough dots.
+     Lookups over TCP are not supported.  */
+  size_t len = strlen (name);
+  int dots = 0;
+  for (const char *p = name; *p != '\0'; ++p)
+    dots += *p == '.';
+  bool ok = (statp->nscount > 0 && (statp->options & RES_USEVC) == 0
+	     && (name[len - 1] == '.' || dots >= statp->ndots));
+
+  /* The queries nss_dns sends for the address family.  */
+  int types[2];
+  if (family == AF_INET)
+    types[lookup->nqueries++] = T_A;
+  else if ((statp->options & RES_NOAAAA) != 0)
+    {
+      if (family == AF_INET6 && (flags & AI_V4MAPPED) == 0)
+	ok = false;
+      types[lookup->nqueries++] = T_A;
+    }
+  else
+    {
+      if (family == AF_UNSPEC || (flags & AI_V4MAPPED) != 0)
+	types[lookup->nqueries++] = T_A;
+      types[lookup->nqueries++] = T_AAAA;
+    }
+
+  for (int i = 0; ok && i < lookup->nqueries; ++i)
+    {
+      struct dns_query *query = &lookup->queries[i];
+      query->fd = -1;
+      query->sends = 0;
+      query->failed = false;
+      query->response = NULL;
+      int n = __res_context_mkquery (ctx, QUERY, name, C_IN, types[i], NULL,
+				     query->packet, sizeof (query->packet));
+      if (n > 0 && (statp->options & (RES_USE_EDNS0 | RES_USE_DNSSEC)) != 0)
+	n = __res_nopt (ctx, n, query->packet, sizeof (query->packet),
+			RESOLV_EDNS_BUFFER_SIZE);
+      query->length = n;
+      ok = n > 0;
+    }
+
+  /* If the response cache can answer all queries, the lookup does not
+     block and does not need the engine.  */
+  if (ok)
+    {
+      bool cached = true;
+      for (int i = 0; cached && i < lookup->nqueries; ++i)
+	cached = __res_cache_contains (ctx, lookup->queries[i].packet,
+				       lookup->queries[i].length);
+      ok = !cached;
+    }
+
+  if (ok)
+    {
+      lookup->nscount = MIN (statp->nscount, MAXNS);
+      for (unsigned int i = 0; i < lookup->nscount; ++i)
+	{
+	  const struct sockaddr *sa = __res_get_nsaddr (statp, i);
+	  memcpy (&lookup->ns[i], sa, (sa->sa_family == AF_INET6
+				       ? sizeof (struct sockaddr_in6)
+				       : sizeof (struct sockaddr_in)));
+	}
+      lookup->retrans = statp->retrans;
+      lookup->retry = statp->retry;
+    }
+  __resolv_context_put (ctx);
+  if (!ok)
+    return false;
+
+  for (int i = 0; i < lookup->nqueries; ++i)
+    send_query (lookup, &lookup->queries[i]);
+  return true;
+}
+
+/* Process the datagram on the socket of QUERY.  BUF is a MAXPACKET
+   bytes large scratch buffer.  */
+static void
+receive_response (struct dns_lookup *lookup, struct dns_query *query,
+		  unsigned char *buf)
+{
+  ssize_t n = __recv (query->fd, buf, MAXPACKET, 0);
+  if (n < 0)
+    {
+      if (errno == EAGAIN || errno == EINTR)
+	return;
+      /* For example, ECONNREFUSED.  Try the next name server.  */
+      query->failed = true;
+      send_query (lookup, query);
+      return;
+    }
+
+  const UHEADER *qhp = (const UHEADER *) query->packet;
+  const UHEADER *hp = (const UHEADER *) buf;
+  if (n < HFIXEDSZ || hp->id != qhp->id
+      || __libc_res_queriesmatch (query->packet,
+				  query->packet + query->length,
+				  buf, buf + n) != 1)
+    /* Ignore spurious datagrams, as send_dg does.  */
+    return;
+
+  if (hp->tc || (hp->rcode != NOERROR && hp->rcode != NXDOMAIN))
+    {
+      /* getaddrinfo retries over TCP or with the next name server.  Let
+	 it do that from the start.  */
+      query->failed = true;
+      query->sends = lookup->retry * lookup->nscount;
+      send_query (lookup, query);
+      return;
+    }
+
+  query->response = malloc (n);
+  if (query->response != NULL)
+    {
+      memcpy (query->response, buf, n);
+      query->response_length = n;
+    }
+  else
+    query->failed = true;
+  __close_nocancel_nostatus (query->fd);
+  query->fd = -1;
+}
+
+/* Return true if all queries of LOOKUP are done.  */
+static bool
+lookup_done (const struct dns_lookup *lookup)
+{
+  for (int i = 0; i < lookup->nqueries; ++i)
+    if (lookup->queries[i].fd >= 0)
+      return false;
+  return true;
+}
+
+/* Pass the responses for LOOKUP to getaddrinfo.  */
+static void
+finish_lookup (struct dns_lookup *lookup)
+{
+  struct resolv_prefetch *prefetch = NULL;
+  for (int i = 0; i < lookup->nqueries; ++i)
+    {
+      struct dns_query *query = &lookup->queries[i];
+      if (query->response != NULL)
+	__resolv_prefetch_add (&prefetch, query->response,
+			       query->response_length, false);
+      else if (!query->failed)
+	/* All attempts timed out.  */
+	__resolv_prefetch_add (&prefetch, query->packet, query->length,
+			       true);
+      free (query->response);
+    }
+  __gai_dns_done (lookup->req, prefetch);
+}
+
+/* Used to find the query for a polled socket.  */
+struct poll_entry
+{
+  struct dns_lookup *lookup;
+  struct dns_query *query;
+};
+
+static void *
+gai_dns_engine (void *arg)
+{
+  struct dns_lookup *lookups = NULL;
+  struct dns_lookup *free_lookups = NULL;
+  unsigned int nlookups = 0;
+  struct pollfd *pfd = malloc ((2 * GAI_DNS_MAX_LOOKUPS + 1)
+			       * sizeof (*pfd));
+  struct poll_entry *pfd_entry = malloc (2 * GAI_DNS_MAX_LOOKUPS
+					 * sizeof (*pfd_entry));
+  unsigned char *buf = malloc (MAXPACKET);
+
+  while (true)
+    {
+      /* Take new requests.  */
+      __pthread_mutex_lock (&__gai_requests_mutex);
+      struct requestlist *new = NULL;
+      if (pfd == NULL || pfd_entry == NULL || buf == NULL)
+	{
+	  /* Let getaddrinfo process all submitted requests.  */
+	  new = submitted;
+	  submitted = NULL;
+	}
+      else if (nlookups < GAI_DNS_MAX_LOOKUPS && submitted != NULL)
+	{
+	  new = submitted;
+	  struct requestlist *last = new;
+	  for (unsigned int n = nlookups + 1;
+	       n < GAI_DNS_MAX_LOOKUPS && last->next_dns != NULL; ++n)
+	    last = last->next_dns;
+	  submitted = last->next_dns;
+	  last->next_dns = NULL;
+	}
+      if (nlookups == 0 && new == NULL)
+	{
+	  engine_running = false;
+	  __close_nocancel_nostatus (wake_pipe[0]);
+	  __close_nocancel_nostatus (wake_pipe[1]);
+	  __pthread_mutex_unlock (&__gai_requests_mutex);
+	  break;
+	}
+      __pthread_mutex_unlock (&__gai_requests_mutex);
+
+      while (new != NULL)
+	{
+	  struct requestlist *req = new;
+	  new = req->next_dns;
+
+	  struct dns_lookup *lookup = free_lookups;
+	  if (lookup != NULL)
+	    free_lookups = lookup->next;
+	  else if (pfd != NULL && pfd_entry != NULL && buf != NULL)
+	    lookup = malloc (sizeof (*lookup));
+	  if (lookup == NULL || !start_lookup (lookup, req))
+	    {
+	      if (lookup != NULL)
+		{
+		  lookup->next = free_lookups;
+		  free_lookups = lookup;
+		}
+	      __gai_dns_done (req, NULL);
+	      continue;
+	    }
+	  lookup->next = lookups;
+	  lookups = lookup;
+	  ++nlookups;
+	}
+
+      /* Wait for responses, or until the next timeout.  */
+      struct __timespec64 now;
+      __clock_gettime64 (CLOCK_MONOTONIC, &now);
+      int timeout = -1;
+      nfds_t nfds = 0;
+      for (struct dns_lookup *lookup = lookups; lookup != NULL;
+	   lookup = lookup->next)
+	{
+	  /* Lookups whose queries could not be sent are finished right
+	     away.  */
+	  if (lookup_done (lookup))
+	    timeout = 0;
+	  for (int i = 0; i < lookup->nqueries; ++i)
+	    {
+	      struct dns_query *query = &lookup->queries[i];
+	      if (query->fd < 0)
+		continue;
+	      pfd[nfds].fd = query->fd;
+	      pfd[nfds].events = POLLIN;
+	      pfd_entry[nfds].lookup = lookup;
+	      pfd_entry[nfds++].query = query;
+	      long int ms = ((query->deadline.tv_sec - now.tv_sec) * 1000
+			     + (query->deadline.tv_nsec - now.tv_nsec
+				+ 999999) / 1000000);
+	      if (ms < 0)
+		ms = 0;
+	      if (timeout < 0 || ms < timeout)
+		timeout = ms;
+	    }
+	}
+      pfd[nfds].fd = wake_pipe[0];
+      pfd[nfds].events = POLLIN;
+      if (__poll (pfd, nfds + 1, timeout) > 0 && pfd[nfds].revents != 0)
+	{
+	  char tmp[16];
+	  while (__read_nocancel (wake_pipe[0], tmp, sizeof (tmp)) > 0)
+	    ;
+	}
+
+      __clock_gettime64 (CLOCK_MONOTONIC, &now);
+      for (nfds_t i = 0; i < nfds; ++i)
+	if (pfd[i].revents != 0)
+	  receive_response (pfd_entry[i].lookup, pfd_entry[i].query, buf);
+
+      /* Handle timeouts and finished lookups.  */
+      struct dns_lookup **lookupp = &lookups;
+      while (*lookupp != NULL)
+	{
+	  struct dns_lookup *lookup = *lookupp;
+	  for (int i = 0; i < lookup->nqueries; ++i)
+	    {
+	      struct dns_query *query = &lookup->queries[i];
+	      if (query->fd >= 0
+		  && (query->deadline.tv_sec < now.tv_sec
+		      || (query->deadline.tv_sec == now.tv_sec
+			  && query->deadline.tv_nsec <= now.tv_nsec)))
+		send_query (lookup, query);
+	    }
+
+	  if (lookup_done (lookup))
+	    {
+	      *lookupp = lookup->next;
+	      --nlookups;
+	      finish_lookup (lookup);
+	      lookup->next = free_lookups;
+	      free_lookups = lookup;
+	    }
+	  else
+	    lookupp = &lookup->next;
+	}
+    }
+
+  while (free_lookups != NULL)
+    {
+      struct dns_lookup *next = free_lookups->next;
+      free (free_lookups);
+      free_lookups = next;
+    }
+  free (pfd);
+  free (pfd_entry);
+  free (buf);
+  return NULL;
+}
@@ -19,10 +19,14 @@
 #include <assert.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <sys/time.h>
 
 #include <gai_misc.h>
+#ifdef GAI_USE_DNS_ENGINE
+# include <resolv-internal.h>
+#endif
 
 #if !PTHREAD_IN_LIBC
 /* The available function names differ outside of libc.  (In libc, we
@@ -212,8 +216,86 @@ __gai_remove_request (struct gaicb *gaicbp)
 }
 
 
+/* Process RUNP, and then the other queued requests.  */
+static void run_requests (struct requestlist *runp);
+
+#ifdef GAI_USE_HELPER_POOL
+static void
+handle_requests_work (struct helper_work *work)
+{
+  run_requests ((struct requestlist *)
+		((char *) work - offsetof (struct requestlist, work)));
+}
+#else
 /* The thread handler.  */
-static void *handle_requests (void *arg);
+static void *
+__attribute__ ((noreturn))
+handle_requests (void *arg)
+{
+  run_requests (arg);
+  __pthread_exit (NULL);
+}
+#endif
+
+/* Start processing REQ, and then the other queued requests, in the
+   background.  */
+static int
+gai_start_helper (struct requestlist *req)
+{
+#ifdef GAI_USE_HELPER_POOL
+  req->work.func = handle_requests_work;
+  return __helper_pool_submit (&req->work, helper_class_gai);
+#else
+  pthread_t thid;
+  return gai_create_helper_thread (&thid, handle_requests, req);
+#endif
+}
+
+
+/* Try to let the DNS engine send the queries for REQ.  */
+static bool
+gai_dns_submit (struct requestlist *req)
+{
+#ifdef GAI_USE_DNS_ENGINE
+  return __gai_dns_submit (req);
+#else
+  return false;
+#endif
+}
+
+
+/* Notify the initiator of RUNP, which has been processed, and remove
+   it from the list.  Must be called with __gai_requests_mutex held.  */
+static void
+finish_request (struct requestlist *runp)
+{
+  struct requestlist *srchp;
+  struct requestlist *lastp;
+
+  /* Send the signal to notify about finished processing of the
+     request.  */
+  __gai_notify (runp);
+
+  /* Now dequeue the current request.  */
+  lastp = NULL;
+  srchp = requests;
+  while (srchp != runp)
+    {
+      lastp = srchp;
+      srchp = srchp->next;
+    }
+
+  if (requests_tail == runp)
+    requests_tail = lastp;
+  if (lastp == NULL)
+    requests = requests->next;
+  else
+    lastp->next = runp->next;
+
+  /* Free the old element.  */
+  runp->next = freelist;
+  freelist = runp;
+}
 
 
 /* The main function of the async I/O handling.  It enqueues requests
@@ -239,6 +321,9 @@ __gai_enqueue_request (struct gaicb *gaicbp)
   newp->gaicbp = gaicbp;
   newp->waiting = NULL;
   newp->next = NULL;
+#ifdef GAI_USE_DNS_ENGINE
+  newp->prefetch = NULL;
+#endif
 
   lastp = requests_tail;
   if (requests_tail == NULL)
@@ -252,14 +337,15 @@ __gai_enqueue_request (struct gaicb *gaicbp)
   gaicbp->__return = EAI_INPROGRESS;
 
   /* See if we need to and are able to create a thread.  */
-  if (nthreads < optim.gai_threads && idle_thread_count == 0)
+  if (gai_dns_submit (newp))
+    /* A helper thread is started once the responses have arrived.  */
+    ;
+  else if (nthreads < optim.gai_threads && idle_thread_count == 0)
     {
-      pthread_t thid;
-
       newp->running = 1;
 
       /* Now try to start a thread.  */
-      if (gai_create_helper_thread (&thid, handle_requests, newp) == 0)
+      if (gai_start_helper (newp) == 0)
 	/* We managed to enqueue the request.  All errors which can
 	   happen now can be recognized by calls to `gai_error'.  */
 	++nthreads;
@@ -304,12 +390,9 @@ __gai_enqueue_request (struct gaicb *gaicbp)
 }
 
 
-static void *
-__attribute__ ((noreturn))
-handle_requests (void *arg)
+static void
+run_requests (struct requestlist *runp)
 {
-  struct requestlist *runp = (struct requestlist *) arg;
-
   do
     {
       /* If runp is NULL, then we were created to service the work queue
@@ -323,47 +406,35 @@ handle_requests (void *arg)
 	{
 	  /* Make the request.  */
 	  struct gaicb *req = runp->gaicbp;
-	  struct requestlist *srchp;
-	  struct requestlist *lastp;
 
+#ifdef GAI_USE_DNS_ENGINE
+	  /* Use the responses the DNS engine has received.  */
+	  struct resolv_prefetch *old_prefetch
+	    = __resolv_prefetch_set (runp->prefetch);
+#endif
 	  req->__return = getaddrinfo (req->ar_name, req->ar_service,
 				       req->ar_request, &req->ar_result);
+#ifdef GAI_USE_DNS_ENGINE
+	  __resolv_prefetch_set (old_prefetch);
+	  __resolv_prefetch_free (runp->prefetch);
+	  runp->prefetch = NULL;
+#endif
 
 	  /* Get the mutex.  */
 	  __pthread_mutex_lock (&__gai_requests_mutex);
 
-	  /* Send the signal to notify about finished processing of the
-	     request.  */
-	  __gai_notify (runp);
-
-	  /* Now dequeue the current request.  */
-	  lastp = NULL;
-	  srchp = requests;
-	  while (srchp != runp)
-	    {
-	      lastp = srchp;
-	      srchp = srchp->next;
-	    }
 	  assert (runp->running == 1);
-
-	  if (requests_tail == runp)
-	    requests_tail = lastp;
-	  if (lastp == NULL)
-	    requests = requests->next;
-	  else
-	    lastp->next = runp->next;
-
-	  /* Free the old element.  */
-	  runp->next = freelist;
-	  freelist = runp;
+	  finish_request (runp);
 	}
 
       runp = requests;
       while (runp != NULL && runp->running != 0)
 	runp = runp->next;
 
+#ifndef GAI_USE_HELPER_POOL
       /* If the runlist is empty, then we sleep for a while, waiting for
-	 something to arrive in it. */
+	 something to arrive in it.  Idle helper threads of the pool
+	 wait for any kind of work instead.  */
       if (runp == NULL && optim.gai_idle_time >= 0)
 	{
 	  struct timespec now;
@@ -385,6 +456,7 @@ handle_requests (void *arg)
 	  while (runp != NULL && runp->running != 0)
 	    runp = runp->next;
 	}
+#endif
 
       if (runp == NULL)
 	--nthreads;
@@ -407,6 +479,21 @@ handle_requests (void *arg)
 		__pthread_cond_signal (&__gai_new_request_notification);
 	      else if (nthreads < optim.gai_threads)
 		{
+#ifdef GAI_USE_HELPER_POOL
+		  /* Hand the next request which is not being processed to
+		     another helper thread.  */
+		  struct requestlist *nextp = runp->next;
+		  while (nextp != NULL && nextp->running != 0)
+		    nextp = nextp->next;
+		  if (nextp != NULL)
+		    {
+		      nextp->running = 1;
+		      if (gai_start_helper (nextp) == 0)
+			++nthreads;
+		      else
+			nextp->running = 0;
+		    }
+#else
 		  pthread_t thid;
 		  pthread_attr_t attr;
 
@@ -421,6 +508,7 @@ handle_requests (void *arg)
 		  if (__pthread_create (&thid, &attr, handle_requests, NULL)
 		      == 0)
 		    ++nthreads;
+#endif
 		}
 	    }
 	}
@@ -429,9 +517,43 @@ handle_requests (void *arg)
       __pthread_mutex_unlock (&__gai_requests_mutex);
     }
   while (runp != NULL);
+}
 
-  __pthread_exit (NULL);
+
+#ifdef GAI_USE_DNS_ENGINE
+void
+__gai_dns_done (struct requestlist *req, struct resolv_prefetch *prefetch)
+{
+  __pthread_mutex_lock (&__gai_requests_mutex);
+
+  assert (req->running == 2);
+  req->prefetch = prefetch;
+  req->running = 0;
+
+  if (nthreads < optim.gai_threads && idle_thread_count == 0)
+    {
+      req->running = 1;
+      if (gai_start_helper (req) == 0)
+	++nthreads;
+      else
+	{
+	  req->running = 0;
+	  if (nthreads == 0)
+	    {
+	      /* No thread could process the request.  */
+	      __resolv_prefetch_free (req->prefetch);
+	      req->prefetch = NULL;
+	      req->gaicbp->__return = EAI_AGAIN;
+	      finish_request (req);
+	    }
+	}
+    }
+  else if (idle_thread_count > 0)
+    __pthread_cond_signal (&__gai_new_request_notification);
+
+  __pthread_mutex_unlock (&__gai_requests_mutex);
 }
+#endif
 
 
 /* Free allocated resources.  */
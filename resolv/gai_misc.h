@@ -20,6 +20,7 @@
 
 #include <netdb.h>
 #include <signal.h>
+#include <stdbool.h>
 
 
 /* Used to synchronize.  */
@@ -42,6 +43,8 @@ struct waitlist
 /* Used to queue requests..  */
 struct requestlist
   {
+    /* 0 if the request is queued, 1 if a helper thread processes it,
+       and 2 if the DNS engine sends its queries.  */
     int running;
 
     struct requestlist *next;
@@ -51,6 +54,19 @@ struct requestlist
 
     /* List of waiting processes.  */
     struct waitlist *waiting;
+
+#ifdef GAI_USE_HELPER_POOL
+    /* Used to process the request on a helper thread.  */
+    struct helper_work work;
+#endif
+
+#ifdef GAI_USE_DNS_ENGINE
+    /* Responses received by the DNS engine, for use by getaddrinfo.  */
+    struct resolv_prefetch *prefetch;
+
+    /* Next request submitted to the DNS engine.  */
+    struct requestlist *next_dns;
+#endif
   };
 
 /* To customize the implementation one can use the following struct.
@@ -93,6 +109,19 @@ extern void __gai_notify (struct requestlist *req)
 extern int __gai_notify_only (struct sigevent *sigev, pid_t caller_pid)
      attribute_hidden;
 
+#ifdef GAI_USE_DNS_ENGINE
+/* Pass REQ to the DNS engine, which sends the DNS queries for it in
+   the background.  Return false if the request has to be processed
+   right away.  Must be called with __gai_requests_mutex held.  */
+extern bool __gai_dns_submit (struct requestlist *req) attribute_hidden;
+
+/* Called by the DNS engine once the responses PREFETCH for REQ have
+   arrived, to let a helper thread process REQ.  */
+extern void __gai_dns_done (struct requestlist *req,
+			    struct resolv_prefetch *prefetch)
+     attribute_hidden;
+#endif
+
 /* Send the signal.  */
 extern int __gai_sigqueue (int sig, const union sigval val, pid_t caller_pid);
 libc_hidden_proto (__gai_sigqueue)
@@ -0,0 +1,511 @@
+/* In-process cache of DNS responses.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <libc-lock.h>
+#include <list.h>
+#include <resolv.h>
+#include <resolv-internal.h>
+#include <resolv_conf.h>
+#include <resolv_context.h>
+#include <set-freeres.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/nameser.h>
+
+/* In RES_CACHE mode, __res_context_send stores cacheable responses in
+   the cache below, and answers later queries which are identical
+   (except for the transaction ID) from the cache, until the time to
+   live of the response has expired.  The time to live of a positive
+   response is the minimum of the TTLs of its answer records.  Negative
+   responses (NXDOMAIN or no data) are cached according to the SOA
+   record in the authority section (RFC 2308), and not at all if there
+   is none.  When a cached response is used, the TTLs in it are reduced
+   by the time which has passed since it was received.
+
+   Entries are only used with the resolver configuration which was
+   used to obtain them.  Each entry holds a reference to this
+   configuration, so it cannot be reused for another configuration
+   while the entry exists.  Applications which change the name server
+   list in _res do not use the cache at all because there is no
+   matching configuration object.  */
+
+enum
+  {
+    /* Number of hash table buckets.  */
+    cache_buckets = 256,
+
+    /* Maximum number of entries.  */
+    cache_max_entries = 512,
+
+    /* Maximum amount of response and query data in the cache.  */
+    cache_max_bytes = 1024 * 1024,
+
+    /* Upper limit for the time to live of entries, in seconds.  */
+    cache_max_ttl = 24 * 60 * 60,
+  };
+
+struct cache_entry
+{
+  /* Next entry in the hash chain.  */
+  struct cache_entry *next;
+
+  /* Element of the LRU list.  The most recently used entry is
+     first.  */
+  list_t lru;
+
+  /* The resolver configuration which was used to obtain the response.
+     The entry holds a reference.  */
+  struct resolv_conf *conf;
+
+  uint32_t hash;
+
+  /* Reception time and expiry time of the response, in seconds,
+     according to CLOCK_MONOTONIC.  */
+  time_t stored;
+  time_t expires;
+
+  /* The query without the transaction ID (the first two bytes),
+     followed by the response.  */
+  int querylen;
+  int resplen;
+  unsigned char data[];
+};
+
+/* The lock protects all variables below.  */
+__libc_lock_define_initialized (static, lock);
+static struct cache_entry *table[cache_buckets];
+static LIST_HEAD (lru_list);
+static size_t entry_count;
+static size_t entry_bytes;
+
+/* Return the current time in seconds.  */
+static time_t
+now (void)
+{
+  struct timespec ts;
+  __clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec;
+}
+
+/* Hash the query (without its transaction ID) for CONF.  */
+static uint32_t
+hash_query (const struct resolv_conf *conf,
+            const unsigned char *query, int querylen)
+{
+  uint32_t hash = (uintptr_t) conf;
+  for (int i = 2; i < querylen; ++i)
+    hash = hash * 31 + query[i];
+  return hash;
+}
+
+/* Return the bucket for HASH.  */
+static struct cache_entry **
+bucket (uint32_t hash)
+{
+  return &table[(hash ^ (hash >> 16)) % cache_buckets];
+}
+
+/* Return the size of ENTRY for accounting against cache_max_bytes.  */
+static size_t
+entry_size (const struct cache_entry *entry)
+{
+  return sizeof (*entry) + entry->querylen + entry->resplen;
+}
+
+/* Remove ENTRY from the table and the LRU list.  It has to be
+   deallocated with free_entry after the lock has been released.  */
+static void
+unlink_entry (struct cache_entry *entry)
+{
+  for (struct cache_entry **p = bucket (entry->hash); *p != NULL;
+       p = &(*p)->next)
+    if (*p == entry)
+      {
+        *p = entry->next;
+        break;
+      }
+  list_del (&entry->lru);
+  --entry_count;
+  entry_bytes -= entry_size (entry);
+}
+
+static void
+free_entry (struct cache_entry *entry)
+{
+  __resolv_conf_put (entry->conf);
+  free (entry);
+}
+
+/* Find the entry for QUERY and CONF and mark it as most recently used.
+   Expired entries are unlinked and added to *EXPIRED.  Return NULL if
+   there is no usable entry.  */
+static struct cache_entry *
+find_entry (const struct resolv_conf *conf,
+            const unsigned char *query, int querylen, time_t current,
+            struct cache_entry **expired)
+{
+  uint32_t hash = hash_query (conf, query, querylen);
+  for (struct cache_entry *entry = *bucket (hash); entry != NULL;
+       entry = entry->next)
+    if (entry->hash == hash && entry->conf == conf
+        && entry->querylen == querylen - 2
+        && memcmp (entry->data, query + 2, querylen - 2) == 0)
+      {
+        if (current >= entry->expires)
+          {
+            unlink_entry (entry);
+            entry->next = *expired;
+            *expired = entry;
+            return NULL;
+          }
+        list_del (&entry->lru);
+        list_add (&entry->lru, &lru_list);
+        return entry;
+      }
+  return NULL;
+}
+
+/* Deallocate the entries on the list ENTRIES.  */
+static void
+free_entries (struct cache_entry *entries)
+{
+  while (entries != NULL)
+    {
+      struct cache_entry *next = entries->next;
+      free_entry (entries);
+      entries = next;
+    }
+}
+
+/* Subtract ELAPSED seconds from the TTLs in the LENGTH bytes of
+   RESPONSE.  The OPT pseudo-record is skipped.  */
+static void
+adjust_ttls (unsigned char *response, int length, time_t elapsed)
+{
+  struct ns_rr_cursor c;
+  if (elapsed <= 0 || !__ns_rr_cursor_init (&c, response, length))
+    return;
+  int count = (ns_rr_cursor_ancount (&c) + ns_rr_cursor_nscount (&c)
+               + ns_rr_cursor_adcount (&c));
+  for (int i = 0; i < count; ++i)
+    {
+      struct ns_rr_wire rr;
+      if (!__ns_rr_cursor_next (&c, &rr))
+        return;
+      if (rr.rtype == ns_t_opt)
+        continue;
+      uint32_t ttl = rr.ttl > elapsed ? rr.ttl - elapsed : 0;
+      /* The TTL is followed by the 16-bit RDLENGTH field.  */
+      unsigned char *p = (unsigned char *) rr.rdata - 6;
+      NS_PUT32 (ttl, p);
+    }
+}
+
+/* Copy the response in ENTRY to *ANSP for QUERY, as
+   __res_copy_response does, and adjust its TTLs.  */
+static bool
+copy_entry (const struct cache_entry *entry, const unsigned char *query,
+            time_t current, unsigned char **ansp, int *anssizp,
+            bool may_realloc, int *malloced)
+{
+  if (!__res_copy_response (query, entry->data + entry->querylen,
+                            entry->resplen, ansp, anssizp, may_realloc,
+                            malloced))
+    return false;
+  adjust_ttls (*ansp, entry->resplen, current - entry->stored);
+  return true;
+}
+
+bool
+__res_cache_lookup (struct resolv_context *ctx,
+                    const unsigned char *buf, int buflen,
+                    const unsigned char *buf2, int buflen2,
+                    unsigned char **ansp, int *anssizp,
+                    unsigned char **anscp, unsigned char **ansp2,
+                    int *anssizp2, int *resplen2, int *ansp2_malloced,
+                    int *result)
+{
+  if (!(ctx->resp->options & RES_CACHE) || ctx->conf == NULL)
+    return false;
+
+  time_t current = now ();
+  struct cache_entry *expired = NULL;
+  bool ok = false;
+  __libc_lock_lock (lock);
+  struct cache_entry *e1 = find_entry (ctx->conf, buf, buflen, current,
+                                       &expired);
+  struct cache_entry *e2 = NULL;
+  if (e1 != NULL && buf2 != NULL)
+    e2 = find_entry (ctx->conf, buf2, buflen2, current, &expired);
+  /* Both queries are sent if only one of them can be answered from
+     the cache.  */
+  if (e1 != NULL && (buf2 == NULL || e2 != NULL))
+    {
+      ok = copy_entry (e1, buf, current, anscp ?: ansp, anssizp,
+                       anscp != NULL, NULL);
+      if (ok && e2 != NULL)
+        {
+          ok = copy_entry (e2, buf2, current, ansp2, anssizp2, true,
+                           ansp2_malloced);
+          if (ok)
+            *resplen2 = e2->resplen;
+        }
+      if (ok)
+        *result = e1->resplen;
+    }
+  __libc_lock_unlock (lock);
+  free_entries (expired);
+  return ok;
+}
+
+bool
+__res_cache_contains (struct resolv_context *ctx,
+                      const unsigned char *query, int querylen)
+{
+  if (!(ctx->resp->options & RES_CACHE) || ctx->conf == NULL)
+    return false;
+
+  time_t current = now ();
+  struct cache_entry *expired = NULL;
+  __libc_lock_lock (lock);
+  bool found = find_entry (ctx->conf, query, querylen, current,
+                           &expired) != NULL;
+  __libc_lock_unlock (lock);
+  free_entries (expired);
+  return found;
+}
+
+/* Return the time to live of RESPONSE in seconds, or 0 if it is not
+   cacheable.  */
+static uint32_t
+response_ttl (const unsigned char *response, int length)
+{
+  const HEADER *hp = (const HEADER *) response;
+  if (length < HFIXEDSZ || !hp->qr || hp->opcode != QUERY || hp->tc
+      || (hp->rcode != NOERROR && hp->rcode != NXDOMAIN))
+    return 0;
+
+  struct ns_rr_cursor c;
+  if (!__ns_rr_cursor_init (&c, response, length))
+    return 0;
+
+  uint32_t ttl = cache_max_ttl;
+  int qtype = ns_rr_cursor_qtype (&c);
+  bool has_data = false;
+  int ancount = ns_rr_cursor_ancount (&c);
+  for (int i = 0; i < ancount; ++i)
+    {
+      struct ns_rr_wire rr;
+      if (!__ns_rr_cursor_next (&c, &rr))
+        return 0;
+      if (rr.ttl < ttl)
+        ttl = rr.ttl;
+      if (rr.rtype == qtype || qtype == ns_t_any)
+        has_data = true;
+    }
+
+  /* Negative responses need an SOA record for their time to live.
+     Responses with a CNAME but no record of the queried type are
+     negative, too, but their TTL is limited by the answer section as
+     well.  */
+  if (has_data && hp->rcode == NOERROR)
+    return ttl;
+  int nscount = ns_rr_cursor_nscount (&c);
+  for (int i = 0; i < nscount; ++i)
+    {
+      struct ns_rr_wire rr;
+      if (!__ns_rr_cursor_next (&c, &rr))
+        return 0;
+      /* The MINIMUM field is the last field of the SOA data.  */
+      if (rr.rtype == ns_t_soa && rr.rdlength >= 4)
+        {
+          const unsigned char *p = rr.rdata + rr.rdlength - 4;
+          uint32_t minimum;
+          NS_GET32 (minimum, p);
+          if (rr.ttl < ttl)
+            ttl = rr.ttl;
+          if (minimum < ttl)
+            ttl = minimum;
+          return ttl;
+        }
+    }
+  return 0;
+}
+
+/* Allocate a cache entry for the RESPLEN bytes of RESPONSE to QUERY.
+   Return NULL if the response is not cacheable.  */
+static struct cache_entry *
+make_entry (struct resolv_context *ctx,
+            const unsigned char *query, int querylen,
+            const unsigned char *response, int resplen, time_t current)
+{
+  uint32_t ttl = response_ttl (response, resplen);
+  /* TTL values with the most significant bit set are treated as zero
+     (RFC 2181, section 8).  */
+  if (ttl == 0 || ttl > INT32_MAX || querylen <= 2)
+    return NULL;
+  size_t size = sizeof (struct cache_entry) + querylen - 2 + resplen;
+  if (size > cache_max_bytes / 8)
+    return NULL;
+
+  struct cache_entry *entry = malloc (size);
+  if (entry == NULL)
+    return NULL;
+  /* This takes a reference.  Do not cache if *CTX->resp has changed
+     since the context was obtained.  */
+  entry->conf = __resolv_conf_get (ctx->resp);
+  if (entry->conf != ctx->conf)
+    {
+      if (entry->conf != NULL)
+        __resolv_conf_put (entry->conf);
+      free (entry);
+      return NULL;
+    }
+  entry->hash = hash_query (entry->conf, query, querylen);
+  entry->stored = current;
+  entry->expires = current + (ttl < cache_max_ttl ? ttl : cache_max_ttl);
+  entry->querylen = querylen - 2;
+  entry->resplen = resplen;
+  memcpy (entry->data, query + 2, querylen - 2);
+  memcpy (entry->data + entry->querylen, response, resplen);
+  return entry;
+}
+
+/* Add ENTRY to the cache, replacing the entry for the same query.
+   Entries which have to be deallocated are added to *EVICTED.  */
+static void
+insert_entry (struct cache_entry *entry, struct cache_entry **evicted)
+{
+  struct cache_entry *old = NULL;
+  for (struct cache_entry *e = *bucket (entry->hash); e != NULL; e = e->next)
+    if (e->hash == entry->hash && e->conf == entry->conf
+        && e->querylen == entry->querylen
+        && memcmp (e->data, entry->data, e->querylen) == 0)
+      {
+        old = e;
+        break;
+      }
+  if (old != NULL)
+    {
+      unlink_entry (old);
+      old->next = *evicted;
+      *evicted = old;
+    }
+
+  while (lru_list.next != &lru_list
+         && (entry_count >= cache_max_entries
+             || entry_bytes + entry_size (entry) > cache_max_bytes))
+    {
+      struct cache_entry *last = list_entry (lru_list.prev,
+                                             struct cache_entry, lru);
+      unlink_entry (last);
+      last->next = *evicted;
+      *evicted = last;
+    }
+
+  struct cache_entry **head = bucket (entry->hash);
+  entry->next = *head;
+  *head = entry;
+  list_add (&entry->lru, &lru_list);
+  ++entry_count;
+  entry_bytes += entry_size (entry);
+}
+
+/* Return the query among BUF and BUF2 which matches RESPONSE, or NULL
+   if there is none.  */
+static const unsigned char *
+matching_query (const unsigned char *buf, int buflen,
+                const unsigned char *buf2, int buflen2,
+                const unsigned char *response, int resplen, int *querylen)
+{
+  if (__libc_res_queriesmatch (buf, buf + buflen,
+                               response, response + resplen) == 1)
+    {
+      *querylen = buflen;
+      return buf;
+    }
+  if (buf2 != NULL
+      && __libc_res_queriesmatch (buf2, buf2 + buflen2,
+                                  response, response + resplen) == 1)
+    {
+      *querylen = buflen2;
+      return buf2;
+    }
+  return NULL;
+}
+
+void
+__res_cache_store (struct resolv_context *ctx,
+                   const unsigned char *buf, int buflen,
+                   const unsigned char *buf2, int buflen2,
+                   const unsigned char *ans, int anslen,
+                   const unsigned char *ans2, int anslen2)
+{
+  if (!(ctx->resp->options & RES_CACHE) || ctx->conf == NULL)
+    return;
+
+  /* send_dg stores the response which arrives first in the first
+     buffer, so the responses have to be matched against the
+     queries.  */
+  const unsigned char *q1 = NULL;
+  const unsigned char *q2 = NULL;
+  int qlen1 = 0;
+  int qlen2 = 0;
+  if (ans != NULL && anslen > HFIXEDSZ)
+    q1 = matching_query (buf, buflen, buf2, buflen2, ans, anslen, &qlen1);
+  if (ans2 != NULL && anslen2 > HFIXEDSZ)
+    q2 = matching_query (buf, buflen, buf2, buflen2, ans2, anslen2,
+                         &qlen2);
+  if (q1 == NULL && q2 == NULL)
+    return;
+
+  /* Allocate the entries before acquiring the lock.  */
+  time_t current = now ();
+  struct cache_entry *e1 = NULL;
+  struct cache_entry *e2 = NULL;
+  if (q1 != NULL)
+    e1 = make_entry (ctx, q1, qlen1, ans, anslen, current);
+  if (q2 != NULL && q2 != q1)
+    e2 = make_entry (ctx, q2, qlen2, ans2, anslen2, current);
+  if (e1 == NULL && e2 == NULL)
+    return;
+
+  struct cache_entry *evicted = NULL;
+  __libc_lock_lock (lock);
+  if (e1 != NULL)
+    insert_entry (e1, &evicted);
+  if (e2 != NULL)
+    insert_entry (e2, &evicted);
+  __libc_lock_unlock (lock);
+  free_entries (evicted);
+}
+
+void
+__res_cache_freemem (void)
+{
+  for (size_t i = 0; i < cache_buckets; ++i)
+    {
+      free_entries (table[i]);
+      table[i] = NULL;
+    }
+  INIT_LIST_HEAD (&lru_list);
+  entry_count = 0;
+  entry_bytes = 0;
+}
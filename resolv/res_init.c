@@ -696,6 +696,9 @@ res_setoptions (struct resolv_conf_parser *parser, const char *options)
             { STRnLEN ("trust-ad"), RES_TRUSTAD },
             { STRnLEN ("no-aaaa"), RES_NOAAAA },
             { STRnLEN ("strict-error"), RES_STRICTERR },
+            { STRnLEN ("happy-eyeballs"), RES_HAPPYEYEBALLS },
+            { STRnLEN ("cache"), RES_CACHE },
+            { STRnLEN ("stay-open"), RES_STAYOPEN },
           };
 #define noptions (sizeof (options) / sizeof (options[0]))
           bool negate_option = *cp == '-';
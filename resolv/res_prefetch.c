@@ -0,0 +1,172 @@
+/* Use DNS responses which have been received in advance.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <resolv.h>
+#include <resolv-internal.h>
+#include <arpa/nameser.h>
+
+#if PACKETSZ > 65536
+# define MAXPACKET	PACKETSZ
+#else
+# define MAXPACKET	65536
+#endif
+
+/* Code which sends DNS queries without blocking, such as the
+   getaddrinfo_a DNS engine, collects the responses in a list, and then
+   performs the actual lookup with the list installed for the current
+   thread.  __res_context_send then returns the collected responses
+   instead of sending the queries again, so that the lookup itself does
+   not block, but processes the responses exactly as if they had just
+   been received.  Queries which are not on the list are sent as
+   usual.  */
+
+struct resolv_prefetch
+{
+  struct resolv_prefetch *next;
+
+  /* If true, PACKET is a query for which no response was received.
+     Otherwise, it is the response.  */
+  bool timed_out;
+
+  int length;
+  unsigned char packet[];
+};
+
+/* The list used by __res_context_send on this thread.  */
+static __thread struct resolv_prefetch *current attribute_tls_model_ie;
+
+bool
+__resolv_prefetch_add (struct resolv_prefetch **list,
+		       const unsigned char *packet, int length,
+		       bool timed_out)
+{
+  struct resolv_prefetch *p = malloc (sizeof (*p) + length);
+  if (p == NULL)
+    return false;
+  p->timed_out = timed_out;
+  p->length = length;
+  memcpy (p->packet, packet, length);
+  p->next = *list;
+  *list = p;
+  return true;
+}
+
+void
+__resolv_prefetch_free (struct resolv_prefetch *list)
+{
+  while (list != NULL)
+    {
+      struct resolv_prefetch *next = list->next;
+      free (list);
+      list = next;
+    }
+}
+
+struct resolv_prefetch *
+__resolv_prefetch_set (struct resolv_prefetch *list)
+{
+  struct resolv_prefetch *old = current;
+  current = list;
+  return old;
+}
+
+/* Return the entry for the query in BUF, or NULL.  */
+static struct resolv_prefetch *
+find_entry (const unsigned char *buf, int buflen)
+{
+  for (struct resolv_prefetch *p = current; p != NULL; p = p->next)
+    if (__libc_res_queriesmatch (buf, buf + buflen,
+				 p->packet, p->packet + p->length) == 1)
+      return p;
+  return NULL;
+}
+
+bool
+__res_copy_response (const unsigned char *query,
+		     const unsigned char *response, int resplen,
+		     unsigned char **ansp, int *anssizp, bool may_realloc,
+		     int *malloced)
+{
+  if (*anssizp < resplen)
+    {
+      if (!may_realloc || resplen > MAXPACKET)
+	return false;
+      /* Always allocate MAXPACKET, callers expect this specific
+	 size.  */
+      unsigned char *newp = malloc (MAXPACKET);
+      if (newp == NULL)
+	return false;
+      *anssizp = MAXPACKET;
+      *ansp = newp;
+      if (malloced != NULL)
+	*malloced = 1;
+    }
+  memcpy (*ansp, response, resplen);
+  /* Use the transaction ID of the query.  */
+  ((UHEADER *) *ansp)->id = ((const UHEADER *) query)->id;
+  return true;
+}
+
+bool
+__res_handle_prefetch (const unsigned char *buf, int buflen,
+		       const unsigned char *buf2, int buflen2,
+		       unsigned char **ansp, int *anssizp,
+		       unsigned char **anscp, unsigned char **ansp2,
+		       int *anssizp2, int *resplen2, int *ansp2_malloced,
+		       int *result)
+{
+  if (current == NULL)
+    return false;
+
+  struct resolv_prefetch *p1 = find_entry (buf, buflen);
+  if (p1 == NULL)
+    return false;
+  struct resolv_prefetch *p2 = NULL;
+  if (buf2 != NULL)
+    {
+      p2 = find_entry (buf2, buflen2);
+      /* Send both queries again if only one of them timed out.  */
+      if (p2 == NULL || p1->timed_out != p2->timed_out)
+	return false;
+    }
+
+  if (p1->timed_out)
+    {
+      __set_errno (ETIMEDOUT);
+      *result = -1;
+      return true;
+    }
+
+  /* Do not use the responses if they do not fit.  The queries are sent
+     again instead.  */
+  if (!__res_copy_response (buf, p1->packet, p1->length, anscp ?: ansp,
+			    anssizp, anscp != NULL, NULL))
+    return false;
+  if (p2 != NULL)
+    {
+      if (!__res_copy_response (buf2, p2->packet, p2->length, ansp2,
+				anssizp2, true, ansp2_malloced))
+	return false;
+      *resplen2 = p2->length;
+    }
+  *result = p1->length;
+  return true;
+}
@@ -109,6 +109,7 @@
 #include <unistd.h>
 #include <kernel-features.h>
 #include <libc-diag.h>
+#include <not-cancel.h>
 #include <random-bits.h>
 
 #if PACKETSZ > 65536
@@ -280,6 +281,33 @@ __res_context_send (struct resolv_context *ctx,
 		return (-1);
 	}
 
+	/* Use responses which have been received in advance.  */
+	if (__res_handle_prefetch (buf, buflen, buf2, buflen2, &ans, &anssiz,
+				   ansp, ansp2, nansp2, resplen2,
+				   ansp2_malloced, &n)) {
+		if (n > HFIXEDSZ)
+			mask_ad_bit (ctx, ansp != NULL ? *ansp : ans);
+		if (resplen2 != NULL && *resplen2 > HFIXEDSZ)
+			mask_ad_bit (ctx, *ansp2);
+		if (n > 0)
+			__res_cache_store (ctx, buf, buflen, buf2, buflen2,
+					   ansp != NULL ? *ansp : ans, n,
+					   resplen2 != NULL ? *ansp2 : NULL,
+					   resplen2 != NULL ? *resplen2 : 0);
+		return n;
+	}
+
+	/* Use cached responses in RES_CACHE mode.  */
+	if (__res_cache_lookup (ctx, buf, buflen, buf2, buflen2, &ans, &anssiz,
+				ansp, ansp2, nansp2, resplen2,
+				ansp2_malloced, &n)) {
+		if (n > HFIXEDSZ)
+			mask_ad_bit (ctx, ansp != NULL ? *ansp : ans);
+		if (resplen2 != NULL && *resplen2 > HFIXEDSZ)
+			mask_ad_bit (ctx, *ansp2);
+		return n;
+	}
+
 	v_circuit = ((statp->options & RES_USEVC)
 		     || buflen > PACKETSZ
 		     || buflen2 > PACKETSZ);
@@ -403,14 +431,19 @@ __res_context_send (struct resolv_context *ctx,
 		  mask_ad_bit (ctx, *ansp2);
 
 		/*
-		 * If we have temporarily opened a virtual circuit,
-		 * or if we haven't been asked to keep a socket open,
-		 * close the socket.
+		 * If we haven't been asked to keep a socket open,
+		 * close the socket.  This includes virtual circuits
+		 * opened for truncated responses, which are reused
+		 * by later truncated responses (RFC 7766, section
+		 * 6.2.1).
 		 */
-		if ((v_circuit && (statp->options & RES_USEVC) == 0) ||
-		    (statp->options & RES_STAYOPEN) == 0) {
+		if ((statp->options & RES_STAYOPEN) == 0) {
 			__res_iclose(statp, false);
 		}
+		__res_cache_store (ctx, buf, buflen, buf2, buflen2,
+				   ansp != NULL ? *ansp : ans, resplen,
+				   resplen2 != NULL ? *ansp2 : NULL,
+				   resplen2 != NULL ? *resplen2 : 0);
 		return (resplen);
  next_ns: ;
 	   } /*foreach ns*/
@@ -487,6 +520,40 @@ close_and_return_error (res_state statp, int *resplen2)
   return 0;
 }
 
+/* Return true if the idle TCP connection FD has been closed by the
+   server, which is allowed to do this at any time (RFC 7766, section
+   6.2.3).  Pending responses to abandoned queries are left in the
+   socket because send_vc skips them.  */
+static bool
+vc_closed (int fd)
+{
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  if (__poll (&pfd, 1, 0) <= 0)
+    return false;
+  char byte;
+  return __recv (fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) <= 0;
+}
+
+/* Return true if the response ANS of ANSLEN bytes has records of the
+   query type in its answer section, and not just aliases.  */
+static bool
+response_has_data (const unsigned char *ans, int anslen)
+{
+  struct ns_rr_cursor c;
+  if (!__ns_rr_cursor_init (&c, ans, anslen))
+    return false;
+  int qtype = ns_rr_cursor_qtype (&c);
+  for (int i = 0; i < ns_rr_cursor_ancount (&c); ++i)
+    {
+      struct ns_rr_wire rr;
+      if (!__ns_rr_cursor_next (&c, &rr))
+	return false;
+      if (rr.rtype == qtype)
+	return true;
+    }
+  return false;
+}
+
 /* The send_vc function is responsible for sending a DNS query over TCP
    to the nameserver numbered NS from the res_state STATP i.e.
    EXT(statp).nssocks[ns].  The function supports sending both IPv4 and
@@ -570,6 +637,8 @@ send_vc(res_state statp,
 	UHEADER *anhp = (UHEADER *) *ansp;
 	struct sockaddr *nsap = __res_get_nsaddr (statp, ns);
 	int truncating, connreset, n;
+	/* True if the connection was kept open by an earlier call.  */
+	bool reused;
 	/* On some architectures compiler might emit a warning indicating
 	   'resplen' may be used uninitialized.  However if buf2 == NULL
 	   then this code won't be executed; if buf2 != NULL, then first
@@ -599,11 +668,13 @@ send_vc(res_state statp,
 
 		if (__getpeername (statp->_vcsock,
 				   (struct sockaddr *) &peer, &size) < 0
-		    || !sock_eq (&peer, (struct sockaddr_in6 *) nsap)) {
+		    || !sock_eq (&peer, (struct sockaddr_in6 *) nsap)
+		    || vc_closed (statp->_vcsock)) {
 			__res_iclose(statp, false);
 			statp->_flags &= ~RES_F_VC;
 		}
 	}
+	reused = statp->_vcsock >= 0 && (statp->_flags & RES_F_VC) != 0;
 
 	if (statp->_vcsock < 0 || (statp->_flags & RES_F_VC) == 0) {
 		if (statp->_vcsock >= 0)
@@ -643,9 +714,17 @@ send_vc(res_state statp,
 		niov = 4;
 		explen += INT16SZ + buflen2;
 	}
-	if (TEMP_FAILURE_RETRY (__writev (statp->_vcsock, iov, niov))
+	/* Use MSG_NOSIGNAL because the server may have closed a reused
+	   connection in the meantime.  */
+	struct msghdr mh = { .msg_iov = iov, .msg_iovlen = niov };
+	if (TEMP_FAILURE_RETRY (__sendmsg (statp->_vcsock, &mh, MSG_NOSIGNAL))
 	    != explen) {
 		*terrno = errno;
+		if (reused && !connreset) {
+			__res_iclose (statp, false);
+			connreset = 1;
+			goto same_ns;
+		}
 		return close_and_return_error (statp, resplen2);
 	}
 	/*
@@ -673,10 +752,12 @@ send_vc(res_state statp,
 		 * restarted.  Requery the server instead of
 		 * trying a new one.  When there is only one
 		 * server, this means that a query might work
-		 * instead of failing.  We only allow one reset
-		 * per query to prevent looping.
+		 * instead of failing.  Likewise if the server
+		 * has closed a connection which was kept open
+		 * (RFC 7766, section 6.2.3).  We only allow one
+		 * reset per query to prevent looping.
 		 */
-		if (*terrno == ECONNRESET && !connreset)
+		if ((*terrno == ECONNRESET || reused) && !connreset)
 		  {
 		    __res_iclose (statp, false);
 		    connreset = 1;
@@ -969,6 +1050,9 @@ send_dg(res_state statp,
 	evAddTime(&finish, &now, &timeout);
 	int need_recompute = 0;
 	int nwritten = 0;
+	/* True if only the resolution delay is left to wait for the
+	   second response.  */
+	bool resolution_delay = false;
 	int recvresp1 = 0;
 	/* Skip the second response if there is no second query.
 	   To do that we mark the second response as received.  */
@@ -980,6 +1064,10 @@ send_dg(res_state statp,
 	recompute_resend:
 		evNowTime(&now);
 		if (evCmpTime(finish, now) <= 0) {
+			if (resolution_delay) {
+				*resplen2 = 0;
+				return resplen;
+			}
 		poll_err_out:
 			return close_and_return_error (statp, resplen2);
 		}
@@ -997,6 +1085,11 @@ send_dg(res_state statp,
 		need_recompute = 1;
 	}
 	if (n == 0) {
+		if (resolution_delay) {
+			/* The second response did not arrive in time.  */
+			*resplen2 = 0;
+			return resplen;
+		}
 		if (resplen > 1 && (recvresp1 || (buf2 != NULL && recvresp2)))
 		  {
 		    /* There are quite a few broken name servers out
@@ -1283,7 +1376,11 @@ send_dg(res_state statp,
 			 * use TCP with same server.
 			 */
 			*v_circuit = 1;
-			__res_iclose(statp, false);
+			/* Only close the UDP socket, so that a TCP
+			   connection kept open by RES_STAYOPEN can be
+			   reused.  */
+			__close_nocancel_nostatus (EXT (statp).nssocks[ns]);
+			EXT (statp).nssocks[ns] = -1;
 			// XXX if we have received one reply we could
 			// XXX use it and not repeat it over TCP...
 			if (resplen2 != NULL)
@@ -1297,6 +1394,32 @@ send_dg(res_state statp,
 			recvresp2 = 1;
 		/* Repeat waiting if we have a second answer to arrive.  */
 		if ((recvresp1 & recvresp2) == 0) {
+			/* In happy-eyeballs mode, do not wait for the A
+			   response once the AAAA response (the second
+			   query) has addresses, and wait for the AAAA
+			   response only for the resolution delay of RFC
+			   8305 once the A response has addresses.  */
+			if ((statp->options & RES_HAPPYEYEBALLS)
+			    && anhp->rcode == NOERROR
+			    && response_has_data (*thisansp,
+						  *thisresplenp)) {
+				if (matching_query == 2) {
+					*resplen2 = 0;
+					return resplen;
+				}
+				if (!resolution_delay) {
+					struct timespec delay, delay_finish;
+					evNowTime(&now);
+					evConsTime(&delay, 0,
+						   RESOLV_RESOLUTION_DELAY_MS
+						   * 1000000);
+					evAddTime(&delay_finish, &now, &delay);
+					if (evCmpTime(delay_finish, finish) < 0)
+						finish = delay_finish;
+					resolution_delay = true;
+				}
+				need_recompute = 1;
+			}
 			if (single_request) {
 				pfd[0].events = POLLOUT;
 				if (single_request_reopen) {
@@ -70,6 +70,11 @@ enum
        concentrated in the first fragment (with the headers) and does
        not protect subsequent fragments.  */
     RESOLV_EDNS_BUFFER_SIZE = 1200,
+
+    /* In happy-eyeballs mode, the time to wait for the AAAA response
+       after an A response with addresses has arrived, in milliseconds.
+       This is the recommended Resolution Delay of RFC 8305.  */
+    RESOLV_RESOLUTION_DELAY_MS = 50,
   };
 
 struct resolv_context;
@@ -109,6 +114,74 @@ bool __res_handle_no_aaaa (struct resolv_context *ctx,
                            unsigned char *ans, int anssiz, int *result)
   attribute_hidden;
 
+/* List of DNS responses which have been received in advance.  See
+   res_prefetch.c.  */
+struct resolv_prefetch;
+
+/* Add PACKET to *LIST.  If TIMED_OUT, PACKET is a query which has not
+   been answered, otherwise the response to a query.  Return false on
+   memory allocation failure.  */
+bool __resolv_prefetch_add (struct resolv_prefetch **list,
+                            const unsigned char *packet, int length,
+                            bool timed_out) attribute_hidden;
+
+/* Free all entries of LIST.  */
+void __resolv_prefetch_free (struct resolv_prefetch *list)
+  attribute_hidden;
+
+/* Make __res_context_send use the responses on LIST for the current
+   thread, and return the previous list.  LIST may be NULL.  */
+struct resolv_prefetch *__resolv_prefetch_set (struct resolv_prefetch *list)
+  attribute_hidden;
+
+/* Return true if the queries have been handled with the responses
+   installed by __resolv_prefetch_set.  The arguments are those of
+   send_dg.  The caller is expected to return *RESULT as the return
+   value.  */
+bool __res_handle_prefetch (const unsigned char *buf, int buflen,
+                            const unsigned char *buf2, int buflen2,
+                            unsigned char **ansp, int *anssizp,
+                            unsigned char **anscp, unsigned char **ansp2,
+                            int *anssizp2, int *resplen2,
+                            int *ansp2_malloced, int *result)
+  attribute_hidden;
+
+/* Copy the RESPLEN bytes of RESPONSE to *ANSP, whose size is *ANSSIZP,
+   and set its transaction ID to that of QUERY.  If MAY_REALLOC, a
+   larger buffer can be allocated, as send_dg does, and *MALLOCED is
+   set to 1 if MALLOCED is not NULL.  Return false if the response
+   does not fit.  */
+bool __res_copy_response (const unsigned char *query,
+                          const unsigned char *response, int resplen,
+                          unsigned char **ansp, int *anssizp,
+                          bool may_realloc, int *malloced) attribute_hidden;
+
+/* Return true if the queries have been answered from the response
+   cache, which is used in RES_CACHE mode.  The arguments are those of
+   __res_handle_prefetch.  See res_cache.c.  */
+bool __res_cache_lookup (struct resolv_context *ctx,
+                         const unsigned char *buf, int buflen,
+                         const unsigned char *buf2, int buflen2,
+                         unsigned char **ansp, int *anssizp,
+                         unsigned char **anscp, unsigned char **ansp2,
+                         int *anssizp2, int *resplen2, int *ansp2_malloced,
+                         int *result) attribute_hidden;
+
+/* Add the responses ANS and ANS2 (which may be NULL) to the queries
+   BUF and BUF2 (which may be NULL) to the response cache, as far as
+   they are cacheable.  The responses may be in any order.  */
+void __res_cache_store (struct resolv_context *ctx,
+                        const unsigned char *buf, int buflen,
+                        const unsigned char *buf2, int buflen2,
+                        const unsigned char *ans, int anslen,
+                        const unsigned char *ans2, int anslen2)
+  attribute_hidden;
+
+/* Return true if the response cache has an answer for QUERY.  */
+bool __res_cache_contains (struct resolv_context *ctx,
+                           const unsigned char *query, int querylen)
+  attribute_hidden;
+
 /* Internal function similar to res_hostalias.  */
 const char *__res_context_hostalias (struct resolv_context *,
                                      const char *, char *, size_t);
@@ -134,6 +134,8 @@ struct res_sym {
 #define RES_TRUSTAD     0x04000000 /* Request AD bit, keep it in responses.  */
 #define RES_NOAAAA      0x08000000 /* Suppress AAAA queries.  */
 #define RES_STRICTERR   0x10000000 /* Report more DNS errors as errors.  */
+#define RES_HAPPYEYEBALLS 0x20000000 /* Do not wait long for A after AAAA.  */
+#define RES_CACHE       0x40000000 /* Cache responses in-process.  */
 
 #define RES_DEFAULT	(RES_RECURSE|RES_DEFNAMES|RES_DNSRCH)
 
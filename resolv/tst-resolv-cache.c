@@ -0,0 +1,332 @@
+/* Test the in-process DNS response cache (options cache).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* The cache is only used with the configuration loaded from
+   /etc/resolv.conf, so this test uses a chroot environment with a
+   custom /etc/resolv.conf file, like tst-resolv-threads.  */
+
+#include <array_length.h>
+#include <dlfcn.h>
+#include <gnu/lib-names.h>
+#include <netdb.h>
+#include <resolv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <support/check.h>
+#include <support/check_nss.h>
+#include <support/namespace.h>
+#include <support/resolv_test.h>
+#include <support/support.h>
+#include <support/test-driver.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+/* The names known to the server.  */
+static const char *const names[] =
+  {
+    "www.example",              /* TTL 300.  */
+    "short.example",            /* TTL 1.  */
+    "zero.example",             /* TTL 0, not cacheable.  */
+    "nxdomain.example",         /* NXDOMAIN with SOA record.  */
+    "nosoa.example",            /* NXDOMAIN without SOA record.  */
+    "servfail.example",         /* SERVFAIL, not cacheable.  */
+    "alias.example",            /* CNAME without data, with SOA record.  */
+    "alias-bare.example",       /* CNAME without data or SOA record.  */
+  };
+enum { name_count = array_length (names) };
+
+/* Number of queries received, by name and query type (A or AAAA).  */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int queries[name_count][2];
+
+/* Return the number of queries for NAME and QTYPE received so far.  */
+static int
+query_count (const char *name, int qtype)
+{
+  for (int i = 0; i < name_count; ++i)
+    if (strcmp (names[i], name) == 0)
+      {
+        xpthread_mutex_lock (&lock);
+        int result = queries[i][qtype == T_AAAA];
+        xpthread_mutex_unlock (&lock);
+        return result;
+      }
+  FAIL_EXIT1 ("unknown name: %s", name);
+}
+
+/* Add an SOA record for a negative response to the authority
+   section.  */
+static void
+add_soa (struct resolv_response_builder *b, uint16_t qclass)
+{
+  /* The negative TTL is the smaller one of the record TTL and the
+     MINIMUM field.  */
+  resolv_response_section (b, ns_s_ns);
+  resolv_response_open_record (b, "example", qclass, T_SOA, 300);
+  resolv_response_add_name (b, "ns.example");
+  resolv_response_add_name (b, "hostmaster.example");
+  static const unsigned char soa_fields[20] =
+    {
+      0, 0, 0, 1,               /* SERIAL.  */
+      0, 0, 14, 16,             /* REFRESH.  */
+      0, 0, 3, 132,             /* RETRY.  */
+      0, 9, 58, 128,            /* EXPIRE.  */
+      0, 0, 0, 60,              /* MINIMUM.  */
+    };
+  resolv_response_add_data (b, soa_fields, sizeof (soa_fields));
+  resolv_response_close_record (b);
+}
+
+static void
+response (const struct resolv_response_context *ctx,
+          struct resolv_response_builder *b,
+          const char *qname, uint16_t qclass, uint16_t qtype)
+{
+  TEST_VERIFY (qtype == T_A || qtype == T_AAAA);
+
+  int index = -1;
+  for (int i = 0; i < name_count; ++i)
+    if (strcmp (names[i], qname) == 0)
+      index = i;
+  TEST_VERIFY_EXIT (index >= 0);
+  xpthread_mutex_lock (&lock);
+  ++queries[index][qtype == T_AAAA];
+  xpthread_mutex_unlock (&lock);
+
+  if (strcmp (qname, "servfail.example") == 0)
+    {
+      struct resolv_response_flags flags = { .rcode = ns_r_servfail };
+      resolv_response_init (b, flags);
+      resolv_response_add_question (b, qname, qclass, qtype);
+      return;
+    }
+  if (strstr (qname, "nxdomain") != NULL || strstr (qname, "nosoa") != NULL)
+    {
+      struct resolv_response_flags flags = { .rcode = ns_r_nxdomain };
+      resolv_response_init (b, flags);
+      resolv_response_add_question (b, qname, qclass, qtype);
+      if (strstr (qname, "nxdomain") != NULL)
+        add_soa (b, qclass);
+      return;
+    }
+  if (strncmp (qname, "alias", 5) == 0)
+    {
+      /* The target name has no record of the queried type.  */
+      struct resolv_response_flags flags = { 0 };
+      resolv_response_init (b, flags);
+      resolv_response_add_question (b, qname, qclass, qtype);
+      resolv_response_section (b, ns_s_an);
+      resolv_response_open_record (b, qname, qclass, T_CNAME, 300);
+      resolv_response_add_name (b, "target.example");
+      resolv_response_close_record (b);
+      if (strcmp (qname, "alias.example") == 0)
+        add_soa (b, qclass);
+      return;
+    }
+
+  int ttl = 300;
+  if (strcmp (qname, "short.example") == 0)
+    ttl = 1;
+  else if (strcmp (qname, "zero.example") == 0)
+    ttl = 0;
+
+  struct resolv_response_flags flags = { 0 };
+  resolv_response_init (b, flags);
+  resolv_response_add_question (b, qname, qclass, qtype);
+  resolv_response_section (b, ns_s_an);
+  resolv_response_open_record (b, qname, qclass, qtype, ttl);
+  if (qtype == T_A)
+    {
+      char ipv4[4] = { 192, 0, 2, 1 };
+      resolv_response_add_data (b, &ipv4, sizeof (ipv4));
+    }
+  else
+    {
+      char ipv6[16]
+        = { 0x20, 0x01, 0xd, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+      resolv_response_add_data (b, &ipv6, sizeof (ipv6));
+    }
+  resolv_response_close_record (b);
+}
+
+/* Look up NAME with getaddrinfo and compare the result with
+   EXPECTED.  */
+static void
+check_gai (const char *name, const char *expected)
+{
+  struct addrinfo hints =
+    {
+      .ai_family = AF_UNSPEC,
+      .ai_socktype = SOCK_STREAM,
+    };
+  struct addrinfo *ai;
+  int ret = getaddrinfo (name, "80", &hints, &ai);
+  check_addrinfo (name, ai, ret, expected);
+  if (ret == 0)
+    freeaddrinfo (ai);
+}
+
+/* Send an A query for NAME with res_query.  Return the TTL of the
+   answer record, or -1 if the lookup failed.  */
+static int
+query_ttl (const char *name)
+{
+  unsigned char buf[512];
+  int ret = res_query (name, C_IN, T_A, buf, sizeof (buf));
+  if (ret < 0)
+    return -1;
+  ns_msg handle;
+  ns_rr rr;
+  TEST_VERIFY_EXIT (ns_initparse (buf, ret, &handle) == 0);
+  TEST_COMPARE (ns_msg_count (handle, ns_s_an), 1);
+  TEST_VERIFY_EXIT (ns_parserr (&handle, ns_s_an, 0, &rr) == 0);
+  return ns_rr_ttl (rr);
+}
+
+static const char www_addresses[] =
+  "address: STREAM/TCP 192.0.2.1 80\n"
+  "address: STREAM/TCP 2001:db8::1 80\n";
+
+/* Description of the chroot environment used to run the tests.  */
+static struct support_chroot *chroot_env;
+
+/* Set up the chroot environment.  */
+static void
+prepare (int argc, char **argv)
+{
+  chroot_env = support_chroot_create
+    ((struct support_chroot_configuration)
+     {
+       .resolv_conf =
+         "nameserver 127.0.0.1\n"
+         "options cache timeout:1 attempts:1\n",
+     });
+}
+
+static int
+do_test (void)
+{
+  support_become_root ();
+  if (!support_enter_network_namespace ())
+    return EXIT_UNSUPPORTED;
+  if (!support_can_chroot ())
+    return EXIT_UNSUPPORTED;
+
+  /* Load the shared object outside of the chroot.  */
+  TEST_VERIFY (dlopen (LIBNSS_DNS_SO, RTLD_LAZY) != NULL);
+
+  xchroot (chroot_env->path_chroot);
+  TEST_VERIFY_EXIT (chdir ("/") == 0);
+
+  struct sockaddr_in server_address =
+    {
+      .sin_family = AF_INET,
+      .sin_addr = { .s_addr = htonl (INADDR_LOOPBACK) },
+      .sin_port = htons (53)
+    };
+  const struct sockaddr *server_addresses[1] =
+    { (const struct sockaddr *) &server_address };
+
+  struct resolv_test *aux = resolv_test_start
+    ((struct resolv_redirect_config)
+     {
+       .response_callback = response,
+       .nscount = 1,
+       .disable_redirect = true,
+       .server_address_overrides = server_addresses,
+     });
+
+  /* Positive responses are cached.  */
+  check_gai ("www.example", www_addresses);
+  check_gai ("www.example", www_addresses);
+  TEST_COMPARE (query_count ("www.example", T_A), 1);
+  TEST_COMPARE (query_count ("www.example", T_AAAA), 1);
+  TEST_COMPARE (query_ttl ("www.example"), 300);
+  TEST_COMPARE (query_count ("www.example", T_A), 1);
+
+  /* Negative responses are cached if they have an SOA record.  */
+  for (int i = 0; i < 2; ++i)
+    {
+      check_gai ("nxdomain.example", "error: Name or service not known\n");
+      check_gai ("nosoa.example", "error: Name or service not known\n");
+      check_gai ("servfail.example",
+                 "error: Temporary failure in name resolution\n");
+      check_gai ("zero.example", www_addresses);
+    }
+  TEST_COMPARE (query_count ("nxdomain.example", T_A), 1);
+  TEST_COMPARE (query_count ("nosoa.example", T_A), 2);
+  TEST_COMPARE (query_count ("zero.example", T_A), 2);
+  TEST_COMPARE (query_count ("zero.example", T_AAAA), 2);
+  TEST_VERIFY (query_count ("servfail.example", T_A) >= 2);
+
+  /* A CNAME record without a record of the queried type is a negative
+     response, which is cached only with an SOA record.  */
+  for (int i = 0; i < 2; ++i)
+    {
+      unsigned char buf[512];
+      TEST_VERIFY (res_query ("alias.example", C_IN, T_A,
+                              buf, sizeof (buf)) > 0);
+      TEST_VERIFY (res_query ("alias-bare.example", C_IN, T_A,
+                              buf, sizeof (buf)) > 0);
+    }
+  TEST_COMPARE (query_count ("alias.example", T_A), 1);
+  TEST_COMPARE (query_count ("alias-bare.example", T_A), 2);
+
+  /* Entries expire after their TTL, and the TTL in cached responses
+     is decremented.  */
+  TEST_COMPARE (query_ttl ("short.example"), 1);
+  TEST_COMPARE (query_ttl ("short.example"), 1);
+  TEST_COMPARE (query_count ("short.example", T_A), 1);
+  sleep (2);
+  TEST_COMPARE (query_ttl ("short.example"), 1);
+  TEST_COMPARE (query_count ("short.example", T_A), 2);
+  int ttl = query_ttl ("www.example");
+  TEST_VERIFY (ttl > 0 && ttl <= 298);
+  TEST_COMPARE (query_count ("www.example", T_A), 1);
+
+  /* Entries are not used with a different configuration.  The file
+     size changes, so the configuration is reloaded.  */
+  support_write_file_string ("/etc/resolv.conf",
+                             "nameserver 127.0.0.1\n"
+                             "options cache timeout:1 attempts:1 ndots:1\n");
+  check_gai ("www.example", www_addresses);
+  TEST_COMPARE (query_count ("www.example", T_A), 2);
+  TEST_COMPARE (query_count ("www.example", T_AAAA), 2);
+  check_gai ("www.example", www_addresses);
+  TEST_COMPARE (query_count ("www.example", T_A), 2);
+
+  /* Without the option, the cache is not used.  */
+  support_write_file_string ("/etc/resolv.conf",
+                             "nameserver 127.0.0.1\n"
+                             "options timeout:1 attempts:1\n");
+  check_gai ("www.example", www_addresses);
+  check_gai ("www.example", www_addresses);
+  TEST_COMPARE (query_count ("www.example", T_A), 4);
+  TEST_COMPARE (query_count ("www.example", T_AAAA), 4);
+
+  resolv_test_end (aux);
+  support_chroot_free (chroot_env);
+
+  return 0;
+}
+
+#define PREPARE prepare
+#include <support/test-driver.c>
@@ -0,0 +1,271 @@
+/* Test DNS lookups with getaddrinfo_a.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* Many lookups are submitted at once, so that the DNS queries for
+   them are sent in the background.  Like tst-resolv-threads, this
+   test uses a custom /etc/resolv.conf file, which all threads use.  */
+
+#include <dlfcn.h>
+#include <array_length.h>
+#include <gnu/lib-names.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <support/check.h>
+#include <support/check_nss.h>
+#include <support/namespace.h>
+#include <support/resolv_test.h>
+#include <support/support.h>
+#include <support/test-driver.h>
+#include <support/xthread.h>
+#include <support/xunistd.h>
+
+/* Number of lookups of names which the server knows.  More than the
+   DNS engine processes at once.  */
+enum { host_count = 300 };
+
+/* Number of queries received for hostN.example and drop.example, by
+   query type.  */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int host_a_queries[host_count + 1];
+static int host_aaaa_queries[host_count + 1];
+static int drop_queries;
+
+static void
+response (const struct resolv_response_context *ctx,
+          struct resolv_response_builder *b,
+          const char *qname, uint16_t qclass, uint16_t qtype)
+{
+  TEST_VERIFY (qtype == T_A || qtype == T_AAAA);
+
+  int host = -1;
+  int dummy = 0;
+  if (strcmp (qname, "drop.example") == 0)
+    {
+      xpthread_mutex_lock (&lock);
+      ++drop_queries;
+      xpthread_mutex_unlock (&lock);
+      resolv_response_drop (b);
+      return;
+    }
+  if (strcmp (qname, "short.test") == 0)
+    host = 254;
+  else if (sscanf (qname, "host%d.example%n", &host, &dummy) != 1
+           || qname[dummy] != '\0' || host <= 0 || host > host_count)
+    {
+      struct resolv_response_flags flags = { .rcode = NXDOMAIN };
+      resolv_response_init (b, flags);
+      resolv_response_add_question (b, qname, qclass, qtype);
+      return;
+    }
+  else
+    {
+      xpthread_mutex_lock (&lock);
+      if (qtype == T_A)
+        ++host_a_queries[host];
+      else
+        ++host_aaaa_queries[host];
+      xpthread_mutex_unlock (&lock);
+    }
+
+  struct resolv_response_flags flags = { 0 };
+  resolv_response_init (b, flags);
+  resolv_response_add_question (b, qname, qclass, qtype);
+  resolv_response_section (b, ns_s_an);
+  resolv_response_open_record (b, qname, qclass, qtype, 0);
+  if (qtype == T_A)
+    {
+      char ipv4[4] = { 192, 0, host >> 8, host };
+      resolv_response_add_data (b, &ipv4, sizeof (ipv4));
+    }
+  else
+    {
+      char ipv6[16]
+        = { 0x20, 0x01, 0xd, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            host >> 8, host };
+      resolv_response_add_data (b, &ipv6, sizeof (ipv6));
+    }
+  resolv_response_close_record (b);
+}
+
+/* Check that AI contains the addresses of HOST for FAMILY.  */
+static void
+check_host (const char *name, int ret, struct addrinfo *ai, int family,
+            int host)
+{
+  if (ret != 0)
+    {
+      support_record_failure ();
+      printf ("error: %s: %s\n", name, gai_strerror (ret));
+      return;
+    }
+
+  char ipv4[INET_ADDRSTRLEN];
+  snprintf (ipv4, sizeof (ipv4), "192.0.%d.%d", host >> 8, host & 0xff);
+  char ipv6[INET6_ADDRSTRLEN];
+  snprintf (ipv6, sizeof (ipv6), "2001:db8::%x", host);
+  bool found_ipv4 = false;
+  bool found_ipv6 = false;
+  for (; ai != NULL; ai = ai->ai_next)
+    {
+      char buf[INET6_ADDRSTRLEN];
+      if (ai->ai_family == AF_INET)
+        {
+          struct sockaddr_in *sin = (struct sockaddr_in *) ai->ai_addr;
+          inet_ntop (AF_INET, &sin->sin_addr, buf, sizeof (buf));
+          TEST_COMPARE_STRING (buf, ipv4);
+          TEST_VERIFY (!found_ipv4);
+          found_ipv4 = true;
+        }
+      else
+        {
+          TEST_COMPARE (ai->ai_family, AF_INET6);
+          struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) ai->ai_addr;
+          inet_ntop (AF_INET6, &sin6->sin6_addr, buf, sizeof (buf));
+          TEST_COMPARE_STRING (buf, ipv6);
+          TEST_VERIFY (!found_ipv6);
+          found_ipv6 = true;
+        }
+    }
+  TEST_COMPARE (found_ipv4, family != AF_INET6);
+  TEST_COMPARE (found_ipv6, family != AF_INET);
+}
+
+/* Description of the chroot environment used to run the tests.  */
+static struct support_chroot *chroot_env;
+
+/* Set up the chroot environment.  */
+static void
+prepare (int argc, char **argv)
+{
+  chroot_env = support_chroot_create
+    ((struct support_chroot_configuration)
+     {
+       .resolv_conf =
+         "search test\n"
+         "nameserver 127.0.0.1\n"
+         "options timeout:1 attempts:1\n",
+       .hosts = "192.0.2.253 files.example\n",
+     });
+}
+
+static int
+do_test (void)
+{
+  support_become_root ();
+  if (!support_enter_network_namespace ())
+    return EXIT_UNSUPPORTED;
+  if (!support_can_chroot ())
+    return EXIT_UNSUPPORTED;
+
+  /* Load the shared object outside of the chroot.  */
+  TEST_VERIFY (dlopen (LIBNSS_DNS_SO, RTLD_LAZY) != NULL);
+
+  xchroot (chroot_env->path_chroot);
+  TEST_VERIFY_EXIT (chdir ("/") == 0);
+
+  struct sockaddr_in server_address =
+    {
+      .sin_family = AF_INET,
+      .sin_addr = { .s_addr = htonl (INADDR_LOOPBACK) },
+      .sin_port = htons (53)
+    };
+  const struct sockaddr *server_addresses[1] =
+    { (const struct sockaddr *) &server_address };
+
+  struct resolv_test *aux = resolv_test_start
+    ((struct resolv_redirect_config)
+     {
+       .response_callback = response,
+       .nscount = 1,
+       .disable_redirect = true,
+       .server_address_overrides = server_addresses,
+     });
+
+  /* The lookups of hostN.example use all address families, and the
+     other lookups test names which are not in DNS, for which no
+     response is received, which are not processed by nss_dns first,
+     and which are not sent unchanged.  */
+  enum { total = host_count + 4 };
+  static const int families[] = { AF_UNSPEC, AF_INET, AF_INET6 };
+  struct addrinfo hints[total];
+  struct gaicb cbs[total];
+  struct gaicb *list[total];
+  for (int i = 0; i < total; ++i)
+    {
+      memset (&hints[i], 0, sizeof (hints[i]));
+      hints[i].ai_family = families[i % array_length (families)];
+      hints[i].ai_socktype = SOCK_STREAM;
+      memset (&cbs[i], 0, sizeof (cbs[i]));
+      if (i < host_count)
+        cbs[i].ar_name = xasprintf ("host%d.example", i + 1);
+      cbs[i].ar_request = &hints[i];
+      list[i] = &cbs[i];
+    }
+  cbs[host_count].ar_name = xstrdup ("nxdomain.example");
+  cbs[host_count + 1].ar_name = xstrdup ("drop.example");
+  hints[host_count + 1].ai_family = AF_INET;
+  cbs[host_count + 2].ar_name = xstrdup ("files.example");
+  hints[host_count + 2].ai_family = AF_INET;
+  cbs[host_count + 3].ar_name = xstrdup ("short");
+  hints[host_count + 3].ai_family = AF_INET;
+
+  TEST_COMPARE (getaddrinfo_a (GAI_WAIT, list, total, NULL), 0);
+
+  for (int i = 0; i < host_count; ++i)
+    {
+      check_host (cbs[i].ar_name, gai_error (&cbs[i]), cbs[i].ar_result,
+                  hints[i].ai_family, i + 1);
+      /* Each query is sent only once.  The responses the DNS engine has
+         received are used by getaddrinfo.  */
+      TEST_COMPARE (host_a_queries[i + 1], hints[i].ai_family != AF_INET6);
+      TEST_COMPARE (host_aaaa_queries[i + 1], hints[i].ai_family != AF_INET);
+    }
+  check_addrinfo ("nxdomain.example", cbs[host_count].ar_result,
+                  gai_error (&cbs[host_count]),
+                  "error: Name or service not known\n");
+  /* After the timeout, the search list is tried, and drop.example.test
+     does not exist.  The query which timed out is not sent again.  */
+  check_addrinfo ("drop.example", cbs[host_count + 1].ar_result,
+                  gai_error (&cbs[host_count + 1]),
+                  "error: Name or service not known\n");
+  TEST_COMPARE (drop_queries, 1);
+  check_addrinfo ("files.example", cbs[host_count + 2].ar_result,
+                  gai_error (&cbs[host_count + 2]),
+                  "address: STREAM/TCP 192.0.2.253 0\n");
+  check_addrinfo ("short", cbs[host_count + 3].ar_result,
+                  gai_error (&cbs[host_count + 3]),
+                  "address: STREAM/TCP 192.0.0.254 0\n");
+
+  for (int i = 0; i < total; ++i)
+    {
+      if (cbs[i].ar_result != NULL)
+        freeaddrinfo (cbs[i].ar_result);
+      free ((char *) cbs[i].ar_name);
+    }
+
+  resolv_test_end (aux);
+  support_chroot_free (chroot_env);
+
+  return 0;
+}
+
+#define PREPARE prepare
+#include <support/test-driver.c>
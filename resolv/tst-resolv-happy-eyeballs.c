@@ -0,0 +1,195 @@
+/* Test the happy-eyeballs resolver option.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <netdb.h>
+#include <resolv.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <support/check.h>
+#include <support/check_nss.h>
+#include <support/resolv_test.h>
+#include <support/support.h>
+#include <support/timespec.h>
+#include <support/xthread.h>
+#include <support/xtime.h>
+
+/* Responses for a name delayed-TYPE.example are sent after this many
+   milliseconds.  This is well below the one second timeout of the
+   test framework.  */
+enum { response_delay = 500 };
+
+/* Build the response for QNAME and QTYPE.  Names containing "nodata"
+   have no AAAA records.  */
+static void
+build_response (struct resolv_response_builder *b,
+                const char *qname, uint16_t qclass, uint16_t qtype)
+{
+  struct resolv_response_flags flags = { 0 };
+  resolv_response_init (b, flags);
+  resolv_response_add_question (b, qname, qclass, qtype);
+  if (qtype == T_AAAA && strstr (qname, "nodata") != NULL)
+    return;
+
+  resolv_response_section (b, ns_s_an);
+  resolv_response_open_record (b, qname, qclass, qtype, 0);
+  if (qtype == T_A)
+    {
+      char ipv4[4] = { 192, 0, 2, 1 };
+      resolv_response_add_data (b, &ipv4, sizeof (ipv4));
+    }
+  else
+    {
+      char ipv6[16]
+        = { 0x20, 0x01, 0xd, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+      resolv_response_add_data (b, &ipv6, sizeof (ipv6));
+    }
+  resolv_response_close_record (b);
+}
+
+/* A response which is sent later.  */
+struct delayed_response
+{
+  struct resolv_response_context *ctx;
+  char *qname;
+  uint16_t qclass;
+  uint16_t qtype;
+};
+
+static void *
+send_delayed_response (void *closure)
+{
+  struct delayed_response *r = closure;
+  struct timespec ts = make_timespec (0, response_delay * 1000000);
+  nanosleep (&ts, NULL);
+
+  struct resolv_response_builder *b
+    = resolv_response_builder_allocate (r->ctx->query_buffer,
+                                        r->ctx->query_length);
+  build_response (b, r->qname, r->qclass, r->qtype);
+  resolv_response_send_udp (r->ctx, b);
+  resolv_response_builder_free (b);
+  resolv_response_context_free (r->ctx);
+  free (r->qname);
+  free (r);
+  return NULL;
+}
+
+/* Threads sending delayed responses.  */
+static pthread_t delay_threads[16];
+static int delay_thread_count;
+
+static void
+response (const struct resolv_response_context *ctx,
+          struct resolv_response_builder *b,
+          const char *qname, uint16_t qclass, uint16_t qtype)
+{
+  TEST_VERIFY (qtype == T_A || qtype == T_AAAA);
+
+  const char *type = qtype == T_A ? "delayed-a" : "delayed-aaaa";
+  if (strncmp (qname, type, strlen (type)) == 0
+      && (qname[strlen (type)] == '.' || qname[strlen (type)] == '-'))
+    {
+      struct delayed_response *r = xmalloc (sizeof (*r));
+      r->ctx = resolv_response_context_duplicate (ctx);
+      r->qname = xstrdup (qname);
+      r->qclass = qclass;
+      r->qtype = qtype;
+      TEST_VERIFY_EXIT (delay_thread_count < array_length (delay_threads));
+      delay_threads[delay_thread_count++]
+        = xpthread_create (NULL, send_delayed_response, r);
+      resolv_response_drop (b);
+      return;
+    }
+
+  build_response (b, qname, qclass, qtype);
+}
+
+/* Look up NAME for AF_UNSPEC and compare the result with EXPECTED.
+   Return the elapsed time in milliseconds.  */
+static long int
+check (const char *name, const char *expected)
+{
+  struct addrinfo hints =
+    {
+      .ai_family = AF_UNSPEC,
+      .ai_socktype = SOCK_STREAM,
+    };
+  struct timespec start = xclock_now (CLOCK_MONOTONIC);
+  struct addrinfo *ai;
+  int ret = getaddrinfo (name, "80", &hints, &ai);
+  struct timespec end = xclock_now (CLOCK_MONOTONIC);
+  check_addrinfo (name, ai, ret, expected);
+  if (ret == 0)
+    freeaddrinfo (ai);
+  return support_timespec_ns (timespec_sub (end, start)) / 1000000;
+}
+
+static int
+do_test (void)
+{
+  struct resolv_test *aux = resolv_test_start
+    ((struct resolv_redirect_config)
+     {
+       .response_callback = response,
+       .nscount = 1,
+     });
+
+  /* Without the option, getaddrinfo waits for both responses.  */
+  check ("delayed-a.example",
+         "address: STREAM/TCP 192.0.2.1 80\n"
+         "address: STREAM/TCP 2001:db8::1 80\n");
+  check ("delayed-aaaa.example",
+         "address: STREAM/TCP 192.0.2.1 80\n"
+         "address: STREAM/TCP 2001:db8::1 80\n");
+
+  _res.options |= RES_HAPPYEYEBALLS;
+
+  /* Responses which arrive together are both used.  */
+  check ("both.example",
+         "address: STREAM/TCP 192.0.2.1 80\n"
+         "address: STREAM/TCP 2001:db8::1 80\n");
+
+  /* Once the AAAA response has arrived, the A response is not
+     waited for.  */
+  TEST_VERIFY (check ("delayed-a-2.example",
+                      "address: STREAM/TCP 2001:db8::1 80\n")
+               < response_delay);
+
+  /* After the A response, the AAAA response is waited for only for the
+     resolution delay.  */
+  TEST_VERIFY (check ("delayed-aaaa-2.example",
+                      "address: STREAM/TCP 192.0.2.1 80\n")
+               < response_delay);
+
+  /* AAAA responses without addresses are not usable, and the A
+     response is still waited for.  */
+  TEST_VERIFY (check ("delayed-a-nodata.example",
+                      "address: STREAM/TCP 192.0.2.1 80\n")
+               >= response_delay);
+
+  for (int i = 0; i < delay_thread_count; ++i)
+    xpthread_join (delay_threads[i]);
+  resolv_test_end (aux);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -130,6 +130,10 @@ print_resp (FILE *fp, res_state resp)
         print_option_flag (fp, &options, RES_TRUSTAD, "trust-ad");
         print_option_flag (fp, &options, RES_NOAAAA, "no-aaaa");
         print_option_flag (fp, &options, RES_STRICTERR, "strict-error");
+        print_option_flag (fp, &options, RES_HAPPYEYEBALLS,
+                           "happy-eyeballs");
+        print_option_flag (fp, &options, RES_CACHE, "cache");
+        print_option_flag (fp, &options, RES_STAYOPEN, "stay-open");
         fputc ('\n', fp);
         if (options != 0)
           fprintf (fp, "; error: unresolved option bits: 0x%x\n", options);
@@ -751,6 +755,33 @@ struct test_case test_cases[] =
      "nameserver 192.0.2.1\n"
      "; nameserver[0]: [192.0.2.1]:53\n"
     },
+    {.name = "happy-eyeballs flag",
+     .conf = "options happy-eyeballs\n"
+     "nameserver 192.0.2.1\n",
+     .expected = "options happy-eyeballs\n"
+     "search example.com\n"
+     "; search[0]: example.com\n"
+     "nameserver 192.0.2.1\n"
+     "; nameserver[0]: [192.0.2.1]:53\n"
+    },
+    {.name = "cache flag",
+     .conf = "options cache\n"
+     "nameserver 192.0.2.1\n",
+     .expected = "options cache\n"
+     "search example.com\n"
+     "; search[0]: example.com\n"
+     "nameserver 192.0.2.1\n"
+     "; nameserver[0]: [192.0.2.1]:53\n"
+    },
+    {.name = "stay-open flag",
+     .conf = "options use-vc stay-open\n"
+     "nameserver 192.0.2.1\n",
+     .expected = "options use-vc stay-open\n"
+     "search example.com\n"
+     "; search[0]: example.com\n"
+     "nameserver 192.0.2.1\n"
+     "; nameserver[0]: [192.0.2.1]:53\n"
+    },
     { NULL }
   };
 
@@ -0,0 +1,212 @@
+/* Test reuse of TCP connections with RES_STAYOPEN.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <array_length.h>
+#include <netdb.h>
+#include <resolv.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <support/check.h>
+#include <support/check_nss.h>
+#include <support/resolv_test.h>
+#include <support/support.h>
+#include <support/xthread.h>
+
+/* Client ports of the TCP connections on which queries have been
+   received.  */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static int ports[64];
+static int port_count;
+
+/* Number of distinct client ports in ports since index START.  */
+static int
+connections (int start)
+{
+  xpthread_mutex_lock (&lock);
+  int result = 0;
+  for (int i = start; i < port_count; ++i)
+    {
+      bool seen = false;
+      for (int j = start; j < i; ++j)
+        seen |= ports[j] == ports[i];
+      result += !seen;
+    }
+  xpthread_mutex_unlock (&lock);
+  return result;
+}
+
+static int
+query_count (void)
+{
+  xpthread_mutex_lock (&lock);
+  int result = port_count;
+  xpthread_mutex_unlock (&lock);
+  return result;
+}
+
+static void
+response (const struct resolv_response_context *ctx,
+          struct resolv_response_builder *b,
+          const char *qname, uint16_t qclass, uint16_t qtype)
+{
+  TEST_VERIFY (qtype == T_A || qtype == T_AAAA);
+
+  /* Names starting with "tc" are truncated over UDP.  */
+  struct resolv_response_flags flags = { 0 };
+  if (!ctx->tcp)
+    {
+      if (strncmp (qname, "tc", 2) == 0)
+        flags.tc = true;
+    }
+  else
+    {
+      const struct sockaddr_in *sin = ctx->client_address;
+      TEST_COMPARE (sin->sin_family, AF_INET);
+      xpthread_mutex_lock (&lock);
+      TEST_VERIFY_EXIT (port_count < array_length (ports));
+      ports[port_count++] = ntohs (sin->sin_port);
+      xpthread_mutex_unlock (&lock);
+    }
+
+  resolv_response_init (b, flags);
+  resolv_response_add_question (b, qname, qclass, qtype);
+  if (flags.tc)
+    return;
+  resolv_response_section (b, ns_s_an);
+  resolv_response_open_record (b, qname, qclass, qtype, 0);
+  if (qtype == T_A)
+    {
+      char ipv4[4] = { 192, 0, 2, 1 };
+      resolv_response_add_data (b, &ipv4, sizeof (ipv4));
+    }
+  else
+    {
+      char ipv6[16]
+        = { 0x20, 0x01, 0xd, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+      resolv_response_add_data (b, &ipv6, sizeof (ipv6));
+    }
+  resolv_response_close_record (b);
+
+  /* Simulate a server which closes idle connections.  */
+  if (strstr (qname, "close") != NULL)
+    resolv_response_close (b);
+}
+
+/* Look up NAME with res_query and check that it succeeds.  */
+static void
+check_query (const char *name)
+{
+  unsigned char buf[512];
+  int ret = res_query (name, C_IN, T_A, buf, sizeof (buf));
+  if (ret < 0)
+    FAIL ("res_query for %s failed: %s", name, hstrerror (h_errno));
+}
+
+static void
+check_gai (const char *name)
+{
+  struct addrinfo hints =
+    {
+      .ai_family = AF_UNSPEC,
+      .ai_socktype = SOCK_STREAM,
+    };
+  struct addrinfo *ai;
+  int ret = getaddrinfo (name, "80", &hints, &ai);
+  check_addrinfo (name, ai, ret,
+                  "address: STREAM/TCP 192.0.2.1 80\n"
+                  "address: STREAM/TCP 2001:db8::1 80\n");
+  if (ret == 0)
+    freeaddrinfo (ai);
+}
+
+static int
+do_test (void)
+{
+  struct resolv_test *aux = resolv_test_start
+    ((struct resolv_redirect_config)
+     {
+       .response_callback = response,
+       .nscount = 1,
+     });
+
+  /* Without RES_STAYOPEN, each lookup uses a new connection.  */
+  _res.options |= RES_USEVC;
+  int start = query_count ();
+  check_query ("www1.example");
+  check_query ("www2.example");
+  check_gai ("www3.example");
+  TEST_COMPARE (query_count () - start, 4);
+  TEST_COMPARE (connections (start), 3);
+
+  /* With RES_STAYOPEN, the connection is reused, including for both
+     queries of getaddrinfo.  */
+  _res.options |= RES_STAYOPEN;
+  start = query_count ();
+  check_query ("www1.example");
+  check_query ("www2.example");
+  check_gai ("www3.example");
+  check_gai ("www4.example");
+  TEST_COMPARE (query_count () - start, 6);
+  TEST_COMPARE (connections (start), 1);
+
+  /* If the server closes the connection, a new one is opened.  */
+  start = query_count ();
+  check_query ("close.example");
+  /* Give the server time to close the connection.  */
+  struct timespec ts = { 0, 100 * 1000 * 1000 };
+  nanosleep (&ts, NULL);
+  check_query ("www1.example");
+  check_query ("www2.example");
+  TEST_COMPARE (query_count () - start, 3);
+  TEST_COMPARE (connections (start), 2);
+
+  /* The server closes the connection right after the response, and
+     the next query is sent on the closed connection.  It is sent
+     again on a new connection.  */
+  start = query_count ();
+  check_query ("close.example");
+  check_query ("www1.example");
+  TEST_COMPARE (query_count () - start, 2);
+  TEST_COMPARE (connections (start), 2);
+
+  /* Connections opened after truncated UDP responses are reused,
+     too.  */
+  _res.options &= ~RES_USEVC;
+  start = query_count ();
+  check_query ("tc1.example");
+  check_query ("tc2.example");
+  check_gai ("tc3.example");
+  TEST_COMPARE (query_count () - start, 4);
+  TEST_COMPARE (connections (start), 1);
+
+  /* Without RES_STAYOPEN, they are closed.  */
+  _res.options &= ~RES_STAYOPEN;
+  start = query_count ();
+  check_query ("tc1.example");
+  check_query ("tc2.example");
+  TEST_COMPARE (query_count () - start, 2);
+  TEST_COMPARE (connections (start), 2);
+
+  resolv_test_end (aux);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
@@ -110,13 +110,18 @@ __aio_cancel (int fildes, struct aiocb *aiocbp)
       req = __aio_find_req_fd (fildes);
 
       /* If any request is worked on by a thread it must be the first.
-	 So either we can delete all requests or all but the first.  */
+	 So either we can delete all requests or all but the first.
+	 Several requests passed to the kernel may be running, and they
+	 are at the start.  */
       if (req != NULL)
 	{
 	  if (req->running == allocated)
 	    {
 	      struct requestlist *old = req;
-	      req = req->next_prio;
+	      while (old->next_prio != NULL
+		     && old->next_prio->running == allocated)
+		old = old->next_prio;
+	      req = old->next_prio;
 	      old->next_prio = NULL;
 
 	      result = AIO_NOTCANCELED;
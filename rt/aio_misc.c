@@ -20,6 +20,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <pthreadP.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -278,6 +280,72 @@ __aio_remove_request (struct requestlist *last, struct requestlist *req,
 /* The thread handler.  */
 static void *handle_fildes_io (void *arg);
 
+#ifdef AIO_USE_HELPER_POOL
+static void
+handle_fildes_io_work (struct helper_work *work)
+{
+  handle_fildes_io ((char *) work - offsetof (struct requestlist, work));
+}
+#endif
+
+/* Start processing REQ, and then the run list, in the background.  */
+static int
+aio_start_helper (struct requestlist *req)
+{
+#ifdef AIO_USE_HELPER_POOL
+  req->work.func = handle_fildes_io_work;
+  return __helper_pool_submit (&req->work, helper_class_aio);
+#else
+  pthread_t thid;
+  return aio_create_helper_thread (&thid, handle_fildes_io, req);
+#endif
+}
+
+
+#ifdef AIO_USE_URING
+/* Number of calls to __aio_begin_batch without a matching call to
+   __aio_end_batch.  */
+static unsigned int batch_depth;
+
+/* Pass REQ to the kernel through io_uring.  Return false if it has to
+   wait or be processed by a helper thread instead, in which case its
+   state is unchanged.  */
+static bool
+aio_start_uring (struct requestlist *req)
+{
+  int running = req->running;
+  req->running = allocated;
+  if (__aio_uring_submit (req) != 0)
+    {
+      req->running = running;
+      return false;
+    }
+  req->uring = true;
+  if (batch_depth == 0)
+    __aio_uring_flush ();
+  return true;
+}
+#endif
+
+
+void
+__aio_begin_batch (void)
+{
+#ifdef AIO_USE_URING
+  ++batch_depth;
+#endif
+}
+
+
+void
+__aio_end_batch (void)
+{
+#ifdef AIO_USE_URING
+  if (--batch_depth == 0)
+    __aio_uring_flush ();
+#endif
+}
+
 
 /* User optimization.  */
 void
@@ -358,6 +426,9 @@ __aio_enqueue_request (aiocb_union *aiocbp, int operation)
     }
   newp->aiocbp = aiocbp;
   newp->waiting = NULL;
+#ifdef AIO_USE_URING
+  newp->uring = false;
+#endif
 
   aiocbp->aiocb.__abs_prio = prio;
   aiocbp->aiocb.__policy = policy;
@@ -379,6 +450,12 @@ __aio_enqueue_request (aiocb_union *aiocbp, int operation)
       /* Simply enqueue it after the running one according to the
 	 priority.  */
       last = NULL;
+#ifdef AIO_USE_URING
+      /* Several requests passed to the kernel may be running.  */
+      if (runp->uring)
+	while (runp->next_prio != NULL && runp->next_prio->uring)
+	  runp = runp->next_prio;
+#endif
       while (runp->next_prio != NULL
 	     && runp->next_prio->aiocbp->aiocb.__abs_prio >= prio)
 	{
@@ -390,6 +467,13 @@ __aio_enqueue_request (aiocb_union *aiocbp, int operation)
       runp->next_prio = newp;
 
       running = queued;
+#ifdef AIO_USE_URING
+      /* If the kernel runs all requests before this one, it can run
+	 this one as well.  Sync requests are ordered by the kernel.  */
+      newp->running = queued;
+      if (runp->uring && aio_start_uring (newp))
+	running = allocated;
+#endif
     }
   else
     {
@@ -416,6 +500,23 @@ __aio_enqueue_request (aiocb_union *aiocbp, int operation)
       last = NULL;
     }
 
+#ifdef AIO_USE_URING
+  if (running == yes)
+    {
+      newp->running = yes;
+      if (aio_start_uring (newp))
+	running = allocated;
+    }
+
+  /* The request is owned by the ring now, or by a helper thread if the
+     kernel did not accept it.  */
+  if (running == allocated)
+    {
+      __pthread_mutex_unlock (&__aio_requests_mutex);
+      return newp;
+    }
+#endif
+
   if (running == yes)
     {
       /* We try to create a new thread for this file descriptor.  The
@@ -429,12 +530,10 @@ __aio_enqueue_request (aiocb_union *aiocbp, int operation)
       /* See if we need to and are able to create a thread.  */
       if (nthreads < optim.aio_threads && idle_thread_count == 0)
 	{
-	  pthread_t thid;
-
 	  running = newp->running = allocated;
 
 	  /* Now try to start a thread.  */
-	  result = aio_create_helper_thread (&thid, handle_fildes_io, newp);
+	  result = aio_start_helper (newp);
 	  if (result == 0)
 	    /* We managed to enqueue the request.  All errors which can
 	       happen now can be recognized by calls to `aio_return' and
@@ -498,6 +597,8 @@ handle_fildes_io (void *arg)
   int fildes;
 
   __pthread_getschedparam (self, &policy, &param);
+  struct sched_param orig_param = param;
+  int orig_policy = policy;
 
   do
     {
@@ -622,8 +723,10 @@ handle_fildes_io (void *arg)
 
       runp = runlist;
 
+#ifndef AIO_USE_HELPER_POOL
       /* If the runlist is empty, then we sleep for a while, waiting for
-	 something to arrive in it. */
+	 something to arrive in it.  Idle helper threads of the pool
+	 wait for any kind of work instead.  */
       if (runp == NULL && optim.aio_idle_time >= 0)
 	{
 	  struct timespec now;
@@ -644,6 +747,7 @@ handle_fildes_io (void *arg)
 	  --idle_thread_count;
 	  runp = runlist;
 	}
+#endif
 
       if (runp == NULL)
 	--nthreads;
@@ -666,6 +770,20 @@ handle_fildes_io (void *arg)
 		__pthread_cond_signal (&__aio_new_request_notification);
 	      else if (nthreads < optim.aio_threads)
 		{
+#ifdef AIO_USE_HELPER_POOL
+		  /* Hand the next request to another helper thread.  If
+		     that fails, we will process it ourselves.  */
+		  struct requestlist *nextp = runlist;
+		  nextp->running = allocated;
+		  runlist = nextp->next_run;
+		  if (aio_start_helper (nextp) == 0)
+		    ++nthreads;
+		  else
+		    {
+		      nextp->running = yes;
+		      runlist = nextp;
+		    }
+#else
 		  pthread_t thid;
 		  pthread_attr_t attr;
 
@@ -680,6 +798,7 @@ handle_fildes_io (void *arg)
 		  if (__pthread_create (&thid, &attr, handle_fildes_io, NULL)
 		      == 0)
 		    ++nthreads;
+#endif
 		}
 	    }
 	}
@@ -689,10 +808,120 @@ handle_fildes_io (void *arg)
     }
   while (runp != NULL);
 
+  /* The thread may be reused for other work.  */
+  if (policy != orig_policy
+      || param.sched_priority != orig_param.sched_priority)
+    __pthread_setschedparam (self, orig_policy, &orig_param);
+
   return NULL;
 }
 
 
+#ifdef AIO_USE_URING
+/* Let a helper thread process REQ, which is the first request for its
+   descriptor and marked as runnable.  */
+static void
+aio_uring_run_request (struct requestlist *req)
+{
+  add_request_to_runlist (req);
+  if (idle_thread_count > 0)
+    __pthread_cond_signal (&__aio_new_request_notification);
+  else if (nthreads < optim.aio_threads)
+    {
+      /* If no helper thread can be started, the request is processed
+	 by the next one which becomes available.  */
+      struct requestlist *runp = runlist;
+      runp->running = allocated;
+      runlist = runp->next_run;
+      if (aio_start_helper (runp) == 0)
+	++nthreads;
+      else
+	{
+	  runp->running = yes;
+	  runlist = runp;
+	}
+    }
+}
+
+
+void
+__aio_uring_done (struct requestlist *req, ssize_t result, int error)
+{
+  aiocb_union *aiocbp = req->aiocbp;
+  int fildes = aiocbp->aiocb.aio_fildes;
+
+  aiocbp->aiocb.__return_value = result;
+  aiocbp->aiocb.__error_code = result == -1 ? error : 0;
+
+  /* Send the signal to notify about finished processing of the
+     request.  */
+  __aio_notify (req);
+
+  assert (req->running == allocated && req->uring);
+  req->running = done;
+
+  /* Now dequeue the request.  Requests for the same descriptor before
+     and after it may still be running.  */
+  struct requestlist *last = NULL;
+  struct requestlist *runp = __aio_find_req_fd (fildes);
+  while (runp != req)
+    {
+      last = runp;
+      runp = runp->next_prio;
+    }
+  struct requestlist *next = req->next_prio;
+  __aio_remove_request (last, req, 0);
+  __aio_free_request (req);
+
+  if (next == NULL)
+    return;
+  if (last == NULL)
+    {
+      if (next->uring)
+	/* The next request was marked as runnable, but it is still
+	   running.  */
+	next->running = allocated;
+      else if (!aio_start_uring (next))
+	{
+	  aio_uring_run_request (next);
+	  return;
+	}
+      runp = next;
+    }
+  else
+    runp = last;
+
+  /* Start the requests which had to wait because the ring was full.
+     If the kernel does not accept them, all requests for the
+     descriptor are returned to the helper threads.  */
+  while (runp->uring && runp->next_prio != NULL && runp->next_prio->uring)
+    runp = runp->next_prio;
+  while (runp->uring && runp->next_prio != NULL
+	 && aio_start_uring (runp->next_prio))
+    runp = runp->next_prio;
+}
+
+
+void
+__aio_uring_fallback (struct requestlist *req)
+{
+  assert (req->running == allocated && req->uring);
+  req->uring = false;
+
+  /* Only the first request for the descriptor is run.  All requests
+     passed to the kernel are returned together, so the requests after
+     it wait again.  */
+  if (__aio_find_req_fd (req->aiocbp->aiocb.aio_fildes) != req)
+    req->running = queued;
+  else
+    {
+      req->running = yes;
+      aio_uring_run_request (req);
+    }
+}
+#endif
+
+
 /* Free allocated resources.  */
 #if !PTHREAD_IN_LIBC
 __attribute__ ((__destructor__)) static
@@ -91,6 +91,7 @@ lio_listio_internal (int mode, struct AIOCB *const list[], int nent,
 
   /* Now we can enqueue all requests.  Since we already acquired the
      mutex the enqueue function need not do this.  */
+  __aio_begin_batch ();
   for (cnt = 0; cnt < nent; ++cnt)
     if (list[cnt] != NULL && list[cnt]->aio_lio_opcode != LIO_NOP)
       {
@@ -111,6 +112,7 @@ lio_listio_internal (int mode, struct AIOCB *const list[], int nent,
       }
     else
       requests[cnt] = NULL;
+  __aio_end_batch ();
 
   if (total == 0)
     {
@@ -686,6 +686,17 @@ extern void *realloc (void *__ptr, size_t __size)
 /* Free a block allocated by `malloc', `realloc' or `calloc'.  */
 extern void free (void *__ptr) __THROW;
 
+#if __GLIBC_USE (ISOC23)
+/* Free a block of SIZE bytes allocated by `malloc', `realloc' or
+   `calloc'.  */
+extern void free_sized (void *__ptr, size_t __size) __THROW;
+
+/* Free a block of SIZE bytes allocated by `aligned_alloc' with an
+   alignment of ALIGNMENT.  */
+extern void free_aligned_sized (void *__ptr, size_t __alignment,
+				size_t __size) __THROW;
+#endif
+
 #ifdef __USE_MISC
 /* Re-allocate the previously allocated block in PTR, making the new
    block large enough for NMEMB elements of SIZE bytes each.  */
@@ -795,6 +795,8 @@ struct tcp_thread_closure
   struct resolv_test *obj;
   int server_index;
   int client_socket;
+  struct sockaddr_in client_address;
+  socklen_t client_address_length;
 };
 
 /* Read a complete DNS query packet.  If EOF_OK, an immediate
@@ -912,6 +914,8 @@ server_thread_tcp_client (void *arg)
       struct resolv_response_context ctx =
         {
           .test = closure->obj,
+          .client_address = &closure->client_address,
+          .client_address_length = closure->client_address_length,
           .query_buffer = query_buffer,
           .query_length = query_length,
           .server_index = closure->server_index,
@@ -970,8 +974,11 @@ server_thread_tcp (struct resolv_test *obj, int server_index)
   while (true)
     {
       /* Get the client connection.  */
+      struct sockaddr_in client_address;
+      socklen_t client_address_length = sizeof (client_address);
       int client_socket = xaccept
-        (obj->servers[server_index].socket_tcp, NULL, NULL);
+        (obj->servers[server_index].socket_tcp,
+         (struct sockaddr *) &client_address, &client_address_length);
 
       /* Check for termination.  */
       xpthread_mutex_lock (&obj->lock);
@@ -990,6 +997,8 @@ server_thread_tcp (struct resolv_test *obj, int server_index)
           .obj = obj,
           .server_index = server_index,
           .client_socket = client_socket,
+          .client_address = client_address,
+          .client_address_length = client_address_length,
         };
 
       pthread_t thr
@@ -20,6 +20,7 @@
 
 #include <aio.h>
 #include <pthread.h>
+#include <stdbool.h>
 
 
 /* Extend the operation enum.  */
@@ -83,6 +84,18 @@ struct requestlist
 
     /* List of waiting processes.  */
     struct waitlist *waiting;
+
+#ifdef AIO_USE_HELPER_POOL
+    /* Used to process the request on a helper thread.  */
+    struct helper_work work;
+#endif
+
+#ifdef AIO_USE_URING
+    /* Set while the request is passed to the kernel through io_uring.
+       Such requests are in flight together, and precede all waiting
+       requests for the same descriptor.  */
+    bool uring;
+#endif
   };
 
 
@@ -95,6 +108,12 @@ extern struct requestlist *__aio_enqueue_request (aiocb_union *aiocbp,
 						  int operation)
   attribute_hidden;
 
+/* Requests enqueued between these two calls may be started together by
+   __aio_end_batch.  Both must be called with __aio_requests_mutex
+   held.  */
+extern void __aio_begin_batch (void) attribute_hidden;
+extern void __aio_end_batch (void) attribute_hidden;
+
 /* Find request entry for given AIO control block.  */
 extern struct requestlist *__aio_find_req (aiocb_union *elem) attribute_hidden;
 
@@ -220,6 +220,15 @@ enum cache_extension_tag
       size must be a multiple of 4.  */
    cache_extension_tag_glibc_hwcaps,
 
+   /* Hash table from library names to the first entry with that name
+      in the sorted entry array.  A struct cache_soname_hash header,
+      followed by the slots.  This allows lookups without a binary
+      search.  Readers which do not know this section use the binary
+      search, which gives the same result.
+
+      For this section, 4-byte alignment is required.  */
+   cache_extension_tag_soname_hash,
+
    /* Total number of known cache extension tags.  */
    cache_extension_count
   };
@@ -255,6 +264,47 @@ struct cache_extension
   struct cache_extension_section sections[];
 };
 
+/* Header of the cache_extension_tag_soname_hash section.  */
+struct cache_soname_hash
+{
+  /* Number of entries in the cache.  Must match the nlibs member of
+     struct cache_file_new.  */
+  uint32_t nlibs;
+
+  /* Number of slots.  A power of two, larger than the number of
+     distinct library names.  */
+  uint32_t nslots;
+
+  /* Open-addressing hash table with linear probing.  The first slot
+     for a name is its _dl_cache_libhash value modulo nslots.  */
+  struct cache_soname_hash_slot
+  {
+    uint32_t hash;		/* _dl_cache_libhash value.  */
+    uint32_t index;		/* Entry index, or UINT32_MAX if unused.  */
+  } slots[];
+};
+
+/* Hash function for library names, compatible with the
+   _dl_cache_libcmp comparison: names which compare equal have the same
+   hash value, so sequences of digits are hashed by their value.  */
+static inline uint32_t
+_dl_cache_libhash (const char *name)
+{
+  uint32_t hash = 5381;
+  while (*name != '\0')
+    if (*name >= '0' && *name <= '9')
+      {
+	uint32_t value = 0;
+	while (*name >= '0' && *name <= '9')
+	  value = value * 10 + *name++ - '0';
+	hash = hash * 33 + '0';
+	hash = hash * 33 + value;
+      }
+    else
+      hash = hash * 33 + (unsigned char) *name++;
+  return hash;
+}
+
 /* A relocated version of struct cache_extension_section.  */
 struct cache_extension_loaded
 {
@@ -293,6 +343,27 @@ cache_extension_verify (struct cache_extension_all_loaded *loaded)
 	hwcaps->flags = 0;
       }
   }
+
+  {
+    /* The section must be aligned at 4 bytes, the number of slots
+       must be a power of two, and the section size must match it.  */
+    struct cache_extension_loaded *hash
+      = &loaded->sections[cache_extension_tag_soname_hash];
+    const struct cache_soname_hash *table = hash->base;
+    if (hash->size < sizeof (struct cache_soname_hash)
+	|| ((uintptr_t) hash->base % 4) != 0
+	|| table->nslots == 0
+	|| (table->nslots & (table->nslots - 1)) != 0
+	|| ((hash->size - sizeof (struct cache_soname_hash))
+	    / sizeof (struct cache_soname_hash_slot)) != table->nslots
+	|| ((hash->size - sizeof (struct cache_soname_hash))
+	    % sizeof (struct cache_soname_hash_slot)) != 0)
+      {
+	hash->base = NULL;
+	hash->size = 0;
+	hash->flags = 0;
+      }
+  }
 }
 
 static bool __attribute__ ((unused))
@@ -0,0 +1,43 @@
+/* System-specific parts of the dlopen directory cache.  Generic version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _DL_DIR_CACHE_H
+#define _DL_DIR_CACHE_H
+
+#include <stdbool.h>
+#include <time.h>
+
+/* Call ADD (CLOSURE, NAME) for each entry in the directory open at FD.
+   Return false if the directory cannot be read, or if ADD returns
+   false.  This generic version does not support reading directories,
+   which disables the directory cache.  */
+static inline bool
+_dl_readdir (int fd, bool (*add) (void *closure, const char *name),
+	     void *closure)
+{
+  return false;
+}
+
+/* Store the current time in *NOW.  Return false on failure.  */
+static inline bool
+_dl_dir_cache_clock (struct __timespec64 *now)
+{
+  return false;
+}
+
+#endif /* _DL_DIR_CACHE_H */
@@ -1014,6 +1014,43 @@ extern void _dl_relocate_object (struct link_map *map,
 				 int reloc_mode, int consider_profiling)
      attribute_hidden;
 
+/* Start using the relocation cache selected by the
+   glibc.rtld.reloc_cache tunable for the objects on the namespace list
+   starting at MAIN_MAP, if any.  */
+extern void _dl_reloc_cache_setup (struct link_map *main_map)
+     attribute_hidden;
+
+/* Stop using the relocation cache after the initial relocation.  If
+   the lookups have been recorded, write them to the cache file.  */
+extern void _dl_reloc_cache_finish (void) attribute_hidden;
+
+/* Perform a symbol lookup for relocation processing of L, using the
+   recorded result if available.  The arguments are those of
+   _dl_lookup_symbol_x.  */
+extern lookup_t _dl_reloc_cache_resolve (struct link_map *l,
+					 struct r_scope_elem *scope[],
+					 const ElfW(Sym) **ref,
+					 const struct r_found_version *version,
+					 int type_class) attribute_hidden;
+
+/* Return false if the directory cache selected by the
+   glibc.rtld.dir_cache tunable shows that the directory DIR of length
+   DIRLEN (including the trailing slash) does not contain a file called
+   NAME.  Otherwise, return true.  */
+extern bool _dl_dir_cache_may_exist (const char *dir, size_t dirlen,
+				     const char *name) attribute_hidden;
+
+/* Bring outdated directory cache entries which have caused directories
+   to be skipped up to date after a failed search.  Return true if any
+   entry has changed.  */
+extern bool _dl_dir_cache_revalidate (void) attribute_hidden;
+
+/* Called at the start of each dlopen call.  */
+extern void _dl_dir_cache_new_generation (void) attribute_hidden;
+
+/* Free the directory cache.  */
+extern void _dl_dir_cache_freeres (void) attribute_hidden;
+
 /* Protect PT_GNU_RELRO area.  */
 extern void _dl_protect_relro (struct link_map *map) attribute_hidden;
 
@@ -26,3 +26,21 @@ check_may_shrink_heap (void)
 {
   return __libc_enable_secure;
 }
+
+/* Return the number of the CPU the calling thread is running on, or a
+   negative value if this cannot be determined cheaply.  Used to select
+   an arena when glibc.malloc.percpu is enabled.  */
+static inline int
+malloc_getcpu (void)
+{
+  return -1;
+}
+
+/* Return the NUMA node of the CPU the calling thread is running on,
+   or a negative value if it is not known.  Used to prefer arenas
+   created on the same node.  */
+static inline int
+malloc_getnode (void)
+{
+  return -1;
+}
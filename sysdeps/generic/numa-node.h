@@ -0,0 +1,32 @@
+/* Determine the NUMA node of the calling thread.  Generic version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _NUMA_NODE_H
+#define _NUMA_NODE_H
+
+/* Return the NUMA node of the CPU the calling thread is running on,
+   or -1 if it is not known.  The result is only a hint: the thread
+   may be migrated to another node at any time.  Does not set
+   errno.  */
+static inline int
+__numa_node (void)
+{
+  return -1;
+}
+
+#endif /* _NUMA_NODE_H */
@@ -34,3 +34,5 @@ typedef union
   char __size[__SIZEOF_SEM_T];
   long int __align;
 } sem_t;
+
+#include <bits/semaphore-linux.h>
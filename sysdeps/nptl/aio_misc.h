@@ -23,9 +23,13 @@
 #include <assert.h>
 #include <pthreadP.h>
 #include <futex-internal.h>
+#include <helper_pool.h>
 
 #define DONT_NEED_AIO_MISC_COND	1
 
+/* Requests are processed by the shared pool of helper threads.  */
+#define AIO_USE_HELPER_POOL	1
+
 #define AIO_MISC_NOTIFY(waitlist) \
   do {									      \
     if (*waitlist->counterp > 0 && --*waitlist->counterp == 0)		      \
@@ -19,11 +19,14 @@
 #ifndef _FORK_H
 #define _FORK_H
 
+#include <aio_uring.h>
 #include <assert.h>
+#include <helper_pool.h>
 #include <kernel-posix-timers.h>
 #include <ldsodefs.h>
 #include <list.h>
 #include <mqueue.h>
+#include <netdb.h>
 #include <pthreadP.h>
 #include <sysdep.h>
 
@@ -46,6 +49,9 @@ fork_system_setup_after_fork (void)
 
   call_function_static_weak (__mq_notify_fork_subprocess);
   call_function_static_weak (__timer_fork_subprocess);
+  call_function_static_weak (__helper_pool_fork_subprocess);
+  call_function_static_weak (__aio_uring_fork_subprocess);
+  call_function_static_weak (__gai_dns_fork_subprocess);
 }
 
 /* In case of a fork() call the memory allocation in the child will be
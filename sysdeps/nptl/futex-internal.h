@@ -23,6 +23,7 @@
 #include <sys/time.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <lowlevellock-futex.h>
 #include <libc-diag.h>
 
@@ -312,6 +313,46 @@ __futex_abstimed_wait64 (unsigned int* futex_word, unsigned int expected,
                          int private);
 libc_hidden_proto (__futex_abstimed_wait64);
 
+/* An entry of the array passed to __futex_waitv_cancelable64.  This has
+   the layout of struct futex_waitv of the Linux kernel.  */
+struct futex_waitv_entry
+{
+  uint64_t val;
+  uint64_t uaddr;
+  uint32_t flags;
+  uint32_t __reserved;
+};
+
+/* Set *ENTRY up to wait on FUTEX_WORD while it contains EXPECTED.
+   PRIVATE is FUTEX_PRIVATE or FUTEX_SHARED.  */
+static __always_inline void
+futex_waitv_entry_init (struct futex_waitv_entry *entry,
+			unsigned int *futex_word, unsigned int expected,
+			int private)
+{
+  entry->val = expected;
+  entry->uaddr = (uintptr_t) futex_word;
+  entry->flags = __lll_private_flag (FUTEX2_SIZE_U32, private);
+  entry->__reserved = 0;
+}
+
+/* Block on the NR (at most FUTEX_WAITV_MAX) futex words described by
+   WAITERS until one of them is woken, like futex_wait does for a
+   single futex word, or until the absolute time ABSTIME on clock
+   CLOCKID (CLOCK_REALTIME or CLOCK_MONOTONIC) has passed.  ABSTIME
+   can be NULL to block indefinitely.
+
+   Returns 0, EAGAIN, EINTR or ETIMEDOUT like
+   __futex_abstimed_wait_cancelable64, or ENOSYS if the kernel does
+   not support futex_waitv.
+
+   The call acts as a cancellation entrypoint.  */
+int
+__futex_waitv_cancelable64 (struct futex_waitv_entry *waiters,
+			    unsigned int nr, clockid_t clockid,
+			    const struct __timespec64 *abstime);
+libc_hidden_proto (__futex_waitv_cancelable64);
+
 
 static __always_inline int
 __futex_clocklock64 (int *futex, clockid_t clockid,
@@ -24,9 +24,16 @@
 #include <signal.h>
 #include <pthreadP.h>
 #include <futex-internal.h>
+#include <helper_pool.h>
 
 #define DONT_NEED_GAI_MISC_COND	1
 
+/* Requests are processed by the shared pool of helper threads.  */
+#define GAI_USE_HELPER_POOL	1
+
+/* DNS queries are sent without blocking the helper threads.  */
+#define GAI_USE_DNS_ENGINE	1
+
 #define GAI_MISC_NOTIFY(waitlist) \
   do {									      \
     if (*waitlist->counterp > 0 && --*waitlist->counterp == 0)		      \
@@ -0,0 +1,62 @@
+/* Internal pool of helper threads.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _HELPER_POOL_H
+#define _HELPER_POOL_H 1
+
+/* Subsystems which need threads to run blocking operations in the
+   background (POSIX AIO, getaddrinfo_a) share one pool of helper
+   threads.  The number of threads running the work of each subsystem
+   is bounded by the glibc.pthread.helper_threads tunable, so that work
+   of one subsystem which blocks for a long time does not hold up the
+   others, and idle threads are reused by all subsystems.  Helper
+   threads run with all signals except SIGSETXID blocked and are never
+   canceled.  A work item must restore any thread state it changes,
+   such as the scheduling parameters, before it returns.  */
+
+/* The subsystems which submit work to the pool.  */
+enum helper_class
+{
+  helper_class_aio,
+  helper_class_gai,
+  helper_class_count
+};
+
+struct helper_work
+{
+  /* Used by the pool while the item is queued.  */
+  struct helper_work *next;
+
+  /* Called on a helper thread with the item as argument.  The item is
+     not accessed by the pool afterwards, so FUNC may free it.  */
+  void (*func) (struct helper_work *);
+};
+
+/* Queue WORK->func to run on a helper thread for the subsystem CLASS,
+   starting a new one if none is idle and the limit of CLASS has not been
+   reached.  Return 0 on success, or an error number if no helper thread
+   could be started while there are none, in which case WORK has not been
+   queued.  */
+extern int __helper_pool_submit (struct helper_work *work,
+				 enum helper_class class) attribute_hidden;
+
+/* Discard the pool state in a new subprocess, where no helper threads
+   exist.  */
+extern void __helper_pool_fork_subprocess (void) attribute_hidden;
+
+#endif /* helper_pool.h */
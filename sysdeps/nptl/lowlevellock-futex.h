@@ -43,6 +43,10 @@
 
 #define FUTEX_BITSET_MATCH_ANY	0xffffffff
 
+/* Flag for futex_waitv entries and maximum number of entries.  */
+#define FUTEX2_SIZE_U32		2
+#define FUTEX_WAITV_MAX		128
+
 /* Values for 'private' parameter of locking macros.  Yes, the
    definition seems to be backwards.  But it is not.  The bit will be
    reversed before passing to the system call.  */
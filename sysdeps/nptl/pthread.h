@@ -60,6 +60,8 @@ enum
 #ifdef __USE_GNU
   /* For compatibility.  */
   , PTHREAD_MUTEX_FAST_NP = PTHREAD_MUTEX_TIMED_NP
+  /* Waiters are queued and acquire the mutex in FIFO order.  */
+  , PTHREAD_MUTEX_QUEUED_NP = 4
 #endif
 };
 
@@ -106,6 +108,9 @@ enum
   PTHREAD_RWLOCK_PREFER_READER_NP,
   PTHREAD_RWLOCK_PREFER_WRITER_NP,
   PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP,
+# ifdef __USE_GNU
+  PTHREAD_RWLOCK_READER_BIASED_NP,
+# endif
   PTHREAD_RWLOCK_DEFAULT_NP = PTHREAD_RWLOCK_PREFER_READER_NP
 };
 
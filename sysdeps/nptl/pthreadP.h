@@ -129,6 +129,15 @@ enum
    FUTEX_PRIVATE_FLAG FUTEX_WAKE.  */
 #define PTHREAD_ROBUST_MUTEX_PSHARED(m) LLL_SHARED
 
+/* The last waiter in the queue of a PTHREAD_MUTEX_QUEUED_NP mutex.
+   __list is otherwise only used by robust mutexes.  */
+#define PTHREAD_MUTEX_QUEUE_TAIL(m) ((m)->__data.__list.__next)
+
+/* Acquire __lock of a PTHREAD_MUTEX_QUEUED_NP mutex.  See
+   pthread_mutex_queued.c.  */
+extern void __pthread_mutex_lock_queued (pthread_mutex_t *mutex)
+     attribute_hidden;
+
 /* Ceiling in __data.__lock.  __data.__lock is signed, so don't
    use the MSB bit in there, but in the mask also include that bit,
    so that the compiler can optimize & PTHREAD_MUTEX_PRIO_CEILING_MASK
@@ -411,6 +420,16 @@ extern int __pthread_rwlock_wrlock (pthread_rwlock_t *__rwlock);
 libc_hidden_proto (__pthread_rwlock_wrlock)
 extern int __pthread_rwlock_trywrlock (pthread_rwlock_t *__rwlock);
 extern int __pthread_rwlock_unlock (pthread_rwlock_t *__rwlock);
+/* Fast paths and writer-side revocation for rwlocks of kind
+   PTHREAD_RWLOCK_READER_BIASED_NP.  See pthread_rwlock_bias.c.  */
+extern bool __pthread_rwlock_rdlock_bias (pthread_rwlock_t *rwlock)
+     attribute_hidden;
+extern bool __pthread_rwlock_rdunlock_bias (pthread_rwlock_t *rwlock)
+     attribute_hidden;
+extern int __pthread_rwlock_revoke_bias (pthread_rwlock_t *rwlock,
+					 bool trylock, clockid_t clockid,
+					 const struct __timespec64 *abstime)
+     attribute_hidden;
 extern int __pthread_cond_broadcast (pthread_cond_t *cond);
 libc_hidden_proto (__pthread_cond_broadcast)
 extern int __pthread_cond_destroy (pthread_cond_t *cond);
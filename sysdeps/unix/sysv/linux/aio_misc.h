@@ -16,11 +16,15 @@
    not, see <https://www.gnu.org/licenses/>.  */
 
 #ifndef _AIO_MISC_H
+/* Requests can be passed to the kernel through io_uring.  */
+# define AIO_USE_URING 1
+
 # include_next <aio_misc.h>
 # include <limits.h>
 # include <pthread.h>
 # include <signal.h>
 # include <sysdep.h>
+# include <aio_uring.h>
 
 # define aio_start_notify_thread __aio_start_notify_thread
 # define aio_create_helper_thread __aio_create_helper_thread
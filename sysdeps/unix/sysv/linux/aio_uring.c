@@ -0,0 +1,432 @@
+/* io_uring backend for POSIX AIO.  Linux version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <aio_misc.h>
+#include <atomic.h>
+#include <not-cancel.h>
+#include <sysdep.h>
+
+#define TUNABLE_NAMESPACE aio
+#include <elf/dl-tunables.h>
+
+/* The subset of the io_uring interface of the kernel which is used
+   here.  */
+
+struct io_sqring_offsets
+{
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t resv1;
+  uint64_t user_addr;
+};
+
+struct io_cqring_offsets
+{
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint32_t flags;
+  uint32_t resv1;
+  uint64_t user_addr;
+};
+
+struct io_uring_params
+{
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t resv[3];
+  struct io_sqring_offsets sq_off;
+  struct io_cqring_offsets cq_off;
+};
+_Static_assert (sizeof (struct io_uring_params) == 120,
+		"size of struct io_uring_params");
+
+struct io_uring_sqe
+{
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;
+  uint64_t addr;
+  uint32_t len;
+  uint32_t op_flags;
+  uint64_t user_data;
+  uint64_t pad[3];
+};
+_Static_assert (sizeof (struct io_uring_sqe) == 64,
+		"size of struct io_uring_sqe");
+
+struct io_uring_cqe
+{
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+#define IORING_OFF_SQ_RING	0ULL
+#define IORING_OFF_SQES		0x10000000ULL
+
+#define IORING_OP_FSYNC		3
+#define IORING_OP_READ		22
+#define IORING_OP_WRITE		23
+
+#define IOSQE_IO_DRAIN		(1U << 1)
+
+#define IORING_FSYNC_DATASYNC	(1U << 0)
+
+#define IORING_ENTER_GETEVENTS	(1U << 0)
+
+#define IORING_FEAT_SINGLE_MMAP	(1U << 0)
+#define IORING_FEAT_NODROP	(1U << 1)
+#define IORING_FEAT_RW_CUR_POS	(1U << 3)
+
+/* Number of submission queue entries.  The kernel makes the completion
+   queue twice as large.  */
+#define AIO_URING_ENTRIES	128
+
+/* The ring is set up when the first request is submitted, and the
+   reaper thread is started then.  It waits for completions, and then
+   finishes the requests with __aio_requests_mutex held, which protects
+   all state below.  Requests are added to the submission queue without
+   updating the tail which the kernel sees, so that __aio_uring_flush
+   can pass several requests to the kernel with one system call.  The
+   number of requests in flight is limited by the size of the completion
+   queue, so that it never overflows.  */
+
+static enum
+{
+  ring_unknown,
+  ring_disabled,
+  ring_enabled
+} ring_state;
+
+static int ring_fd;
+
+static void *ring_mem;
+static size_t ring_mem_size;
+
+static struct io_uring_sqe *sqes;
+static size_t sqes_size;
+
+static unsigned int *sq_head;
+static unsigned int *sq_tail;
+static unsigned int *sq_array;
+static unsigned int sq_mask;
+static unsigned int sq_entries;
+
+/* Tail of the submission queue including the entries not yet passed to
+   the kernel.  */
+static unsigned int sq_local_tail;
+
+static unsigned int *cq_head;
+static unsigned int *cq_tail;
+static struct io_uring_cqe *cqes;
+static unsigned int cq_mask;
+static unsigned int cq_entries;
+
+/* Number of requests on the submission queue or in the kernel.  */
+static unsigned int inflight;
+
+static void
+ring_unmap (void)
+{
+  if (sqes != NULL)
+    __munmap (sqes, sqes_size);
+  if (ring_mem != NULL)
+    __munmap (ring_mem, ring_mem_size);
+  __close_nocancel_nostatus (ring_fd);
+  sqes = NULL;
+  ring_mem = NULL;
+}
+
+/* Process all completions.  */
+static void reap_completions (void);
+
+static void *
+reaper_thread (void *arg)
+{
+  int fd = (intptr_t) arg;
+
+  while (true)
+    {
+      /* Errors such as EINTR only cause a spurious wakeup.  */
+      INTERNAL_SYSCALL_CALL (io_uring_enter, fd, 0, 1,
+			     IORING_ENTER_GETEVENTS, NULL, 0);
+
+      __pthread_mutex_lock (&__aio_requests_mutex);
+      reap_completions ();
+      /* Requests for the same descriptors may have been queued.  */
+      __aio_uring_flush ();
+      __pthread_mutex_unlock (&__aio_requests_mutex);
+    }
+
+  return NULL;
+}
+
+static bool
+ring_setup (void)
+{
+  if (TUNABLE_GET (io_uring, int32_t, NULL) == 0)
+    return false;
+
+  struct io_uring_params p;
+  memset (&p, 0, sizeof (p));
+  int fd = INTERNAL_SYSCALL_CALL (io_uring_setup, AIO_URING_ENTRIES, &p);
+  if (INTERNAL_SYSCALL_ERROR_P (fd))
+    return false;
+  ring_fd = fd;
+
+  /* The ring must not drop completions, and file descriptors which do
+     not support offsets are accessed at the current position.  */
+  const unsigned int features = (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP
+				 | IORING_FEAT_RW_CUR_POS);
+  if ((p.features & features) != features)
+    {
+      ring_unmap ();
+      return false;
+    }
+
+  /* With IORING_FEAT_SINGLE_MMAP, one mapping covers both rings.  */
+  ring_mem_size = MAX (p.sq_off.array + p.sq_entries * sizeof (unsigned int),
+		       p.cq_off.cqes
+		       + p.cq_entries * sizeof (struct io_uring_cqe));
+  void *mem = __mmap (NULL, ring_mem_size, PROT_READ | PROT_WRITE,
+		      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (mem == MAP_FAILED)
+    {
+      ring_unmap ();
+      return false;
+    }
+  ring_mem = mem;
+
+  sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  mem = __mmap (NULL, sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (mem == MAP_FAILED)
+    {
+      ring_unmap ();
+      return false;
+    }
+  sqes = mem;
+
+  sq_head = ring_mem + p.sq_off.head;
+  sq_tail = ring_mem + p.sq_off.tail;
+  sq_array = ring_mem + p.sq_off.array;
+  sq_mask = *(unsigned int *) (ring_mem + p.sq_off.ring_mask);
+  sq_entries = p.sq_entries;
+  sq_local_tail = *sq_tail;
+  cq_head = ring_mem + p.cq_off.head;
+  cq_tail = ring_mem + p.cq_off.tail;
+  cqes = ring_mem + p.cq_off.cqes;
+  cq_mask = *(unsigned int *) (ring_mem + p.cq_off.ring_mask);
+  cq_entries = p.cq_entries;
+  inflight = 0;
+
+  pthread_t th;
+  if (aio_create_helper_thread (&th, reaper_thread, (void *) (intptr_t) fd)
+      != 0)
+    {
+      ring_unmap ();
+      return false;
+    }
+
+  return true;
+}
+
+/* Add REQ to the submission queue.  If CUR_POS, read or write at the
+   current file position instead of the offset of the request.  Return
+   false if the queue is full.  */
+static bool
+queue_request (struct requestlist *req, bool cur_pos)
+{
+  if (sq_local_tail - atomic_load_acquire (sq_head) == sq_entries)
+    {
+      __aio_uring_flush ();
+      if (sq_local_tail - atomic_load_acquire (sq_head) == sq_entries)
+	return false;
+    }
+
+  aiocb_union *aiocbp = req->aiocbp;
+  int opcode = aiocbp->aiocb.aio_lio_opcode;
+  unsigned int index = sq_local_tail & sq_mask;
+  struct io_uring_sqe *sqe = &sqes[index];
+
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->fd = aiocbp->aiocb.aio_fildes;
+  sqe->user_data = (uintptr_t) req;
+  if ((opcode & 127) == LIO_READ || (opcode & 127) == LIO_WRITE)
+    {
+      sqe->opcode = ((opcode & 127) == LIO_READ
+		     ? IORING_OP_READ : IORING_OP_WRITE);
+      sqe->addr = (uintptr_t) aiocbp->aiocb.aio_buf;
+      /* The kernel limits the size of a single transfer further, which
+	 results in a short read or write, as with pread and pwrite.  */
+      sqe->len = MIN (aiocbp->aiocb.aio_nbytes, UINT32_MAX);
+      if (cur_pos)
+	sqe->off = -1;
+      else if (sizeof (off_t) != sizeof (off64_t) && opcode & 128)
+	sqe->off = aiocbp->aiocb64.aio_offset;
+      else
+	sqe->off = aiocbp->aiocb.aio_offset;
+    }
+  else
+    {
+      /* Reads and writes for the same descriptor run concurrently, but
+	 a sync request must wait for those submitted before it.  */
+      sqe->opcode = IORING_OP_FSYNC;
+      sqe->flags = IOSQE_IO_DRAIN;
+      if (opcode == LIO_DSYNC)
+	sqe->op_flags = IORING_FSYNC_DATASYNC;
+    }
+
+  sq_array[index] = index;
+  ++sq_local_tail;
+  return true;
+}
+
+int
+__aio_uring_submit (struct requestlist *req)
+{
+  if (ring_state == ring_unknown)
+    ring_state = ring_setup () ? ring_enabled : ring_disabled;
+  if (ring_state != ring_enabled)
+    return ENOSYS;
+
+  aiocb_union *aiocbp = req->aiocbp;
+  int opcode = aiocbp->aiocb.aio_lio_opcode;
+  if ((opcode & 127) == LIO_READ || (opcode & 127) == LIO_WRITE)
+    {
+      /* The kernel interprets an offset of -1 as the current position,
+	 but pread and pwrite fail with EINVAL.  */
+      off64_t offset = (sizeof (off_t) != sizeof (off64_t) && opcode & 128
+			? aiocbp->aiocb64.aio_offset
+			: aiocbp->aiocb.aio_offset);
+      if (offset < 0)
+	return EINVAL;
+    }
+  else if (opcode != LIO_DSYNC && opcode != LIO_SYNC)
+    return EINVAL;
+
+  if (inflight == cq_entries || !queue_request (req, false))
+    return EAGAIN;
+  ++inflight;
+  return 0;
+}
+
+void
+__aio_uring_flush (void)
+{
+  if (ring_state != ring_enabled)
+    return;
+
+  unsigned int to_submit;
+  atomic_store_release (sq_tail, sq_local_tail);
+  while ((to_submit = sq_local_tail - atomic_load_acquire (sq_head)) != 0)
+    {
+      int ret = INTERNAL_SYSCALL_CALL (io_uring_enter, ring_fd, to_submit,
+				       0, 0, NULL, 0);
+      if (INTERNAL_SYSCALL_ERROR_P (ret)
+	  && INTERNAL_SYSCALL_ERRNO (ret) != EINTR)
+	break;
+    }
+  if (to_submit == 0)
+    return;
+
+  /* The kernel fails with EAGAIN if it is short of memory, and with
+     EBUSY until completions are reaped.  If requests are in flight,
+     the reaper thread passes the entries again after the next
+     completion.  */
+  if (inflight != to_submit)
+    return;
+
+  /* Otherwise nothing wakes the reaper thread.  The kernel consumes
+     entries only in io_uring_enter, which is called with
+     __aio_requests_mutex held, so they can be taken back and processed
+     by helper threads.  */
+  unsigned int head = atomic_load_relaxed (sq_head);
+  sq_local_tail = head;
+  atomic_store_release (sq_tail, head);
+  inflight = 0;
+  for (unsigned int i = 0; i < to_submit; ++i)
+    {
+      struct io_uring_sqe *sqe = &sqes[sq_array[(head + i) & sq_mask]];
+      __aio_uring_fallback ((struct requestlist *) (uintptr_t)
+			    sqe->user_data);
+    }
+}
+
+static void
+reap_completions (void)
+{
+  unsigned int head = *cq_head;
+  unsigned int tail = atomic_load_acquire (cq_tail);
+
+  while (head != tail)
+    {
+      struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+      struct requestlist *req = (struct requestlist *) (uintptr_t)
+	cqe->user_data;
+      int res = cqe->res;
+
+      /* Release the entry before the request is queued again.  */
+      atomic_store_release (cq_head, ++head);
+
+      if (res == -ESPIPE && queue_request (req, true))
+	/* As for pread and pwrite, ignore the offset for descriptors
+	   which do not support it.  */
+	continue;
+
+      --inflight;
+      if (res < 0)
+	__aio_uring_done (req, -1, -res);
+      else
+	__aio_uring_done (req, res, 0);
+    }
+}
+
+void
+__aio_uring_fork_subprocess (void)
+{
+  /* The reaper thread does not exist in the subprocess.  Requests in
+     flight are never finished, as with requests which were processed
+     by helper threads.  */
+  if (ring_state == ring_enabled)
+    ring_unmap ();
+  ring_state = ring_unknown;
+  inflight = 0;
+}
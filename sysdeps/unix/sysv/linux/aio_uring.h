@@ -0,0 +1,60 @@
+/* io_uring backend for POSIX AIO.  Linux version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _AIO_URING_H
+#define _AIO_URING_H 1
+
+#include <sys/types.h>
+
+/* If the glibc.aio.io_uring tunable is set, read, write and sync
+   requests are passed to the kernel through an io_uring instance
+   instead of being run on helper threads.  A reaper thread waits for
+   completions and finishes the requests.  All functions below must be
+   called with __aio_requests_mutex held.  */
+
+struct requestlist;
+
+/* Queue REQ, which must be marked as allocated, on the ring.  The
+   request is not passed to the kernel before the next call to
+   __aio_uring_flush.  Return 0 on success, or an error number if the
+   ring is not available or full, in which case the request has to be
+   processed by a helper thread.  */
+extern int __aio_uring_submit (struct requestlist *req) attribute_hidden;
+
+/* Pass all queued requests to the kernel.  If the kernel does not
+   accept them, they are passed again after the next completion, or
+   returned through __aio_uring_fallback if nothing is in flight.  */
+extern void __aio_uring_flush (void) attribute_hidden;
+
+/* Called by __aio_uring_flush for a request which was queued on the
+   ring but could not be passed to the kernel, and has to be processed
+   by a helper thread instead.  */
+extern void __aio_uring_fallback (struct requestlist *req)
+  attribute_hidden;
+
+/* Called by the reaper thread once the kernel has processed REQ.
+   RESULT is the return value of the operation, or -1 if it failed
+   with ERROR.  */
+extern void __aio_uring_done (struct requestlist *req, ssize_t result,
+			      int error) attribute_hidden;
+
+/* Discard the ring in a new subprocess.  The ring memory is shared
+   with the parent process.  */
+extern void __aio_uring_fork_subprocess (void) attribute_hidden;
+
+#endif /* aio_uring.h */
@@ -0,0 +1,54 @@
+/* Linux-specific semaphore functions.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _SEMAPHORE_H
+# error "Never use <bits/semaphore-linux.h> directly; include <semaphore.h> instead."
+#endif
+
+/* This file is included by <bits/semaphore.h> after the definition of
+   sem_t.  */
+
+#ifdef __USE_GNU
+__BEGIN_DECLS
+
+/* Wait until any of the NSEMS semaphores in SEMS is posted, or until
+   ABSTIME measured against CLOCK has passed if ABSTIME is not NULL.
+   Decrement the semaphore and return its index in SEMS.
+
+   This function is a cancellation point and therefore not marked with
+   __THROW.  */
+# ifndef __USE_TIME64_REDIRECTS
+extern int sem_waitany_np (sem_t *const *__sems, unsigned int __nsems,
+			   clockid_t __clock,
+			   const struct timespec *__abstime)
+  __nonnull ((1));
+# else
+#  ifdef __REDIRECT
+extern int __REDIRECT (sem_waitany_np,
+                       (sem_t *const *__sems, unsigned int __nsems,
+                        clockid_t __clock,
+                        const struct timespec *__abstime),
+                        __sem_waitany_np64)
+  __nonnull ((1));
+#  else
+#   define sem_waitany_np __sem_waitany_np64
+#  endif
+# endif
+
+__END_DECLS
+#endif
@@ -0,0 +1,70 @@
+/* System-specific parts of the dlopen directory cache.  Linux version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _DL_DIR_CACHE_H
+#define _DL_DIR_CACHE_H
+
+#include <dirent.h>
+#include <stdbool.h>
+#include <sysdep.h>
+#include <time.h>
+
+/* Call ADD (CLOSURE, NAME) for each entry in the directory open at FD.
+   Return false if the directory cannot be read, or if ADD returns
+   false.  */
+static inline bool
+_dl_readdir (int fd, bool (*add) (void *closure, const char *name),
+	     void *closure)
+{
+  /* Use getdents64 directly because opendir is not available in
+     ld.so.  */
+  union
+  {
+    struct dirent64 d;
+    char b[4096];
+  } buf;
+  while (true)
+    {
+      ssize_t ret = __getdents64 (fd, &buf, sizeof (buf));
+      if (ret == 0)
+	return true;
+      if (ret < 0)
+	return false;
+      for (char *p = buf.b; p < buf.b + ret; )
+	{
+	  struct dirent64 *e = (struct dirent64 *) p;
+	  if (!add (closure, e->d_name))
+	    return false;
+	  p += e->d_reclen;
+	}
+    }
+}
+
+/* Store the current time in *NOW.  Return false on failure.  Calling
+   clock_gettime is not possible in ld.so because of its symbol
+   version.  */
+static inline bool
+_dl_dir_cache_clock (struct __timespec64 *now)
+{
+#ifndef __NR_clock_gettime64
+# define __NR_clock_gettime64 __NR_clock_gettime
+#endif
+  return INTERNAL_SYSCALL_CALL (clock_gettime64, CLOCK_REALTIME, now) == 0;
+}
+
+#endif /* _DL_DIR_CACHE_H */
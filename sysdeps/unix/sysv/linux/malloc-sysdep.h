@@ -18,6 +18,8 @@
 
 #include <fcntl.h>
 #include <not-cancel.h>
+#include <numa-node.h>
+#include <tls.h>
 
 /* The Linux kernel overcommits address space by default and if there is not
    enough memory available, it uses various parameters to decide the process to
@@ -56,4 +58,27 @@ check_may_shrink_heap (void)
   return may_shrink_heap;
 }
 
+/* Return the number of the CPU the calling thread is running on, as
+   published by the kernel in the rseq area.  The result is negative if
+   rseq registration failed or was disabled with glibc.pthread.rseq.  */
+static inline int
+malloc_getcpu (void)
+{
+  return (int) THREAD_GETMEM_VOLATILE (THREAD_SELF, rseq_area.cpu_id);
+}
+
+/* Return the NUMA node of the CPU the calling thread is running on,
+   or a negative value if it is not known.  Used to prefer arenas
+   created on the same node.  */
+static inline int
+malloc_getnode (void)
+{
+  return __numa_node ();
+}
+
 #define HAVE_MREMAP 1
+
+/* In static programs, the purge thread would pull in pthread_create.  */
+#ifdef SHARED
+# define HAVE_MALLOC_PURGE_THREAD 1
+#endif
@@ -0,0 +1,55 @@
+/* Determine whether the system has a single NUMA node.  Linux version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <intprops.h>
+#include <not-cancel.h>
+#include <numa-node.h>
+
+int __numa_only_node = numa_only_node_unknown;
+
+int
+__numa_only_node_init (void)
+{
+  int saved_errno = errno;
+  int result = numa_only_node_multiple;
+
+  /* The file lists the online nodes, for example "0" or "0-3,8".  A
+     single number means that there is only one node.  Without the
+     file, the node is determined with getcpu.  */
+  int fd = __open64_nocancel ("/sys/devices/system/node/online",
+			      O_RDONLY | O_CLOEXEC);
+  if (fd != -1)
+    {
+      char str[INT_BUFSIZE_BOUND (int)];
+      ssize_t s = __read_nocancel (fd, str, sizeof (str));
+      __close_nocancel_nostatus (fd);
+
+      int node = 0;
+      ssize_t i;
+      for (i = 0; i < s && str[i] >= '0' && str[i] <= '9'; ++i)
+	node = node * 10 + (str[i] - '0');
+      if (i > 0 && i < s && str[i] == '\n')
+	result = node;
+    }
+
+  __set_errno (saved_errno);
+  atomic_store_relaxed (&__numa_only_node, result);
+  return result;
+}
@@ -0,0 +1,64 @@
+/* Determine the NUMA node of the calling thread.  Linux version.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#ifndef _NUMA_NODE_H
+#define _NUMA_NODE_H
+
+#include <atomic.h>
+#include <sysdep.h>
+#include <sysdep-vdso.h>
+
+/* The only online NUMA node of the system, or one of the following
+   values.  Determined on first use by __numa_only_node_init, so a
+   node brought online later is not noticed.  Accessed with relaxed
+   MO.  */
+enum
+  {
+    numa_only_node_unknown = -2,
+    numa_only_node_multiple = -1,
+  };
+extern int __numa_only_node attribute_hidden;
+int __numa_only_node_init (void) attribute_hidden;
+
+/* Return the NUMA node of the CPU the calling thread is running on,
+   or -1 if it is not known.  The result is only a hint: the thread
+   may be migrated to another node at any time.  Does not set
+   errno.  */
+static inline int
+__numa_node (void)
+{
+  /* On systems with a single node, avoid the getcpu call.  */
+  int only_node = atomic_load_relaxed (&__numa_only_node);
+  if (__glibc_unlikely (only_node == numa_only_node_unknown))
+    only_node = __numa_only_node_init ();
+  if (only_node >= 0)
+    return only_node;
+
+  unsigned int cpu;
+  unsigned int node;
+#ifdef HAVE_GETCPU_VSYSCALL
+  long int r = INTERNAL_VSYSCALL (getcpu, 3, &cpu, &node, NULL);
+#else
+  long int r = INTERNAL_SYSCALL_CALL (getcpu, &cpu, &node, NULL);
+#endif
+  if (INTERNAL_SYSCALL_ERROR_P (r))
+    return -1;
+  return node;
+}
+
+#endif /* _NUMA_NODE_H */
@@ -0,0 +1,314 @@
+/* Test POSIX AIO with the io_uring backend.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <aio.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <support/check.h>
+#include <support/temp_file.h>
+#include <support/xdirent.h>
+#include <support/xsignal.h>
+#include <support/xunistd.h>
+
+enum { block_count = 16, block_size = 64 };
+
+static int fd;
+
+/* Return true if the process has an io_uring file descriptor.  */
+static bool
+have_ring (void)
+{
+  DIR *dir = xopendir ("/proc/self/fd");
+  bool found = false;
+  struct dirent *d;
+  while (!found && (d = readdir (dir)) != NULL)
+    {
+      char target[64];
+      ssize_t len = readlinkat (dirfd (dir), d->d_name, target,
+				sizeof (target) - 1);
+      if (len > 0)
+	{
+	  target[len] = '\0';
+	  found = strcmp (target, "anon_inode:[io_uring]") == 0;
+	}
+    }
+  xclosedir (dir);
+  return found;
+}
+
+static void
+wait_for (struct aiocb *cb)
+{
+  const struct aiocb *list[] = { cb };
+  while (aio_error (cb) == EINPROGRESS)
+    TEST_VERIFY (aio_suspend (list, 1, NULL) == 0 || errno == EINTR);
+}
+
+static void
+fill_block (char *buf, int block)
+{
+  memset (buf, 'A' + block, block_size);
+}
+
+/* Write the blocks of the file with individual requests, which run
+   concurrently.  */
+static void
+write_blocks (void)
+{
+  static char bufs[block_count][block_size];
+  struct aiocb cbs[block_count];
+  for (int i = 0; i < block_count; ++i)
+    {
+      fill_block (bufs[i], i);
+      memset (&cbs[i], 0, sizeof (cbs[i]));
+      cbs[i].aio_fildes = fd;
+      cbs[i].aio_buf = bufs[i];
+      cbs[i].aio_nbytes = block_size;
+      cbs[i].aio_offset = i * block_size;
+      TEST_COMPARE (aio_write (&cbs[i]), 0);
+    }
+  for (int i = 0; i < block_count; ++i)
+    {
+      wait_for (&cbs[i]);
+      TEST_COMPARE (aio_error (&cbs[i]), 0);
+      TEST_COMPARE (aio_return (&cbs[i]), block_size);
+    }
+}
+
+/* Read the blocks in reverse order with one lio_listio call.  */
+static void
+read_blocks (void)
+{
+  static char bufs[block_count][block_size];
+  struct aiocb cbs[block_count];
+  struct aiocb *list[block_count];
+  for (int i = 0; i < block_count; ++i)
+    {
+      memset (&cbs[i], 0, sizeof (cbs[i]));
+      cbs[i].aio_fildes = fd;
+      cbs[i].aio_lio_opcode = LIO_READ;
+      cbs[i].aio_buf = bufs[i];
+      cbs[i].aio_nbytes = block_size;
+      cbs[i].aio_offset = (block_count - 1 - i) * block_size;
+      list[i] = &cbs[i];
+    }
+  TEST_COMPARE (lio_listio (LIO_WAIT, list, block_count, NULL), 0);
+  for (int i = 0; i < block_count; ++i)
+    {
+      char expected[block_size];
+      fill_block (expected, block_count - 1 - i);
+      TEST_COMPARE (aio_error (&cbs[i]), 0);
+      TEST_COMPARE (aio_return (&cbs[i]), block_size);
+      TEST_COMPARE_BLOB (bufs[i], block_size, expected, block_size);
+    }
+}
+
+static sem_t notified;
+static int notify_value;
+
+static void
+notify_thread (union sigval sv)
+{
+  notify_value = sv.sival_int;
+  sem_post (&notified);
+}
+
+static int
+do_test (void)
+{
+  /* Skip the test if the kernel does not support io_uring.  The
+     structure is struct io_uring_params.  */
+  long int params[15] = { 0 };
+  int ring = syscall (SYS_io_uring_setup, 1, params);
+  if (ring < 0)
+    FAIL_UNSUPPORTED ("io_uring_setup: %m");
+  xclose (ring);
+
+  fd = create_temp_file ("tst-aio-uring.", NULL);
+  TEST_VERIFY_EXIT (fd >= 0);
+
+  write_blocks ();
+  TEST_VERIFY (have_ring ());
+  read_blocks ();
+
+  /* Synchronization requests.  */
+  struct aiocb cb;
+  memset (&cb, 0, sizeof (cb));
+  cb.aio_fildes = fd;
+  TEST_COMPARE (aio_fsync (O_DSYNC, &cb), 0);
+  wait_for (&cb);
+  TEST_COMPARE (aio_error (&cb), 0);
+  TEST_COMPARE (aio_return (&cb), 0);
+  TEST_COMPARE (aio_fsync (O_SYNC, &cb), 0);
+  wait_for (&cb);
+  TEST_COMPARE (aio_error (&cb), 0);
+  TEST_COMPARE (aio_return (&cb), 0);
+
+  /* Errors are reported through the control block.  */
+  char buf[block_size];
+  memset (&cb, 0, sizeof (cb));
+  cb.aio_fildes = fd;
+  cb.aio_buf = buf;
+  cb.aio_nbytes = sizeof (buf);
+  cb.aio_offset = -1;
+  TEST_COMPARE (aio_read (&cb), 0);
+  wait_for (&cb);
+  TEST_COMPARE (aio_error (&cb), EINVAL);
+  TEST_COMPARE (aio_return (&cb), -1);
+
+  int wronly = xopen ("/dev/null", O_WRONLY, 0);
+  cb.aio_fildes = wronly;
+  cb.aio_offset = 0;
+  TEST_COMPARE (aio_read (&cb), 0);
+  wait_for (&cb);
+  TEST_COMPARE (aio_error (&cb), EBADF);
+  TEST_COMPARE (aio_return (&cb), -1);
+  xclose (wronly);
+
+  /* The offset is ignored for pipes.  The read completes only after
+     the write.  */
+  int pipefd[2];
+  xpipe (pipefd);
+  memset (&cb, 0, sizeof (cb));
+  cb.aio_fildes = pipefd[0];
+  cb.aio_buf = buf;
+  cb.aio_nbytes = sizeof (buf);
+  cb.aio_offset = 1234;
+  TEST_COMPARE (aio_read (&cb), 0);
+  usleep (10000);
+  TEST_COMPARE (aio_error (&cb), EINPROGRESS);
+  struct aiocb wcb;
+  memset (&wcb, 0, sizeof (wcb));
+  wcb.aio_fildes = pipefd[1];
+  wcb.aio_buf = (char *) "pipe";
+  wcb.aio_nbytes = 4;
+  wcb.aio_offset = 1234;
+  TEST_COMPARE (aio_write (&wcb), 0);
+  wait_for (&wcb);
+  TEST_COMPARE (aio_return (&wcb), 4);
+  wait_for (&cb);
+  TEST_COMPARE (aio_return (&cb), 4);
+  TEST_COMPARE_BLOB (buf, 4, "pipe", 4);
+
+  /* Reads and writes for the same descriptor run concurrently.  The
+     read completes only after the write on the same end of the socket
+     pair has been received.  */
+  int sv[2];
+  TEST_COMPARE (socketpair (AF_UNIX, SOCK_STREAM, 0, sv), 0);
+  memset (&cb, 0, sizeof (cb));
+  cb.aio_fildes = sv[0];
+  cb.aio_buf = buf;
+  cb.aio_nbytes = 4;
+  TEST_COMPARE (aio_read (&cb), 0);
+  wcb.aio_fildes = sv[0];
+  wcb.aio_buf = (char *) "ping";
+  wcb.aio_offset = 0;
+  TEST_COMPARE (aio_write (&wcb), 0);
+  char reply[4];
+  TEST_COMPARE (read (sv[1], reply, sizeof (reply)), 4);
+  TEST_COMPARE_BLOB (reply, 4, "ping", 4);
+  wait_for (&wcb);
+  TEST_COMPARE (aio_return (&wcb), 4);
+  TEST_COMPARE (aio_error (&cb), EINPROGRESS);
+  xwrite (sv[1], "pong", 4);
+  wait_for (&cb);
+  TEST_COMPARE (aio_return (&cb), 4);
+  TEST_COMPARE_BLOB (buf, 4, "pong", 4);
+  xclose (sv[0]);
+  xclose (sv[1]);
+
+  /* A sync request waits for the write before it.  */
+  struct aiocb scb;
+  memset (&scb, 0, sizeof (scb));
+  scb.aio_fildes = fd;
+  memset (&wcb, 0, sizeof (wcb));
+  wcb.aio_fildes = fd;
+  wcb.aio_buf = (char *) "sync";
+  wcb.aio_nbytes = 4;
+  wcb.aio_offset = block_count * block_size;
+  TEST_COMPARE (aio_write (&wcb), 0);
+  TEST_COMPARE (aio_fsync (O_SYNC, &scb), 0);
+  wait_for (&scb);
+  TEST_COMPARE (aio_return (&scb), 0);
+  TEST_VERIFY (aio_error (&wcb) != EINPROGRESS);
+  TEST_COMPARE (aio_return (&wcb), 4);
+
+  /* Completion notification by thread and by signal.  */
+  sem_init (&notified, 0, 0);
+  memset (&cb, 0, sizeof (cb));
+  cb.aio_fildes = fd;
+  cb.aio_buf = buf;
+  cb.aio_nbytes = block_size;
+  cb.aio_sigevent.sigev_notify = SIGEV_THREAD;
+  cb.aio_sigevent.sigev_notify_function = notify_thread;
+  cb.aio_sigevent.sigev_value.sival_int = 42;
+  TEST_COMPARE (aio_read (&cb), 0);
+  TEST_COMPARE (sem_wait (&notified), 0);
+  TEST_COMPARE (notify_value, 42);
+  TEST_COMPARE (aio_return (&cb), block_size);
+
+  sigset_t ss;
+  sigemptyset (&ss);
+  sigaddset (&ss, SIGUSR1);
+  xpthread_sigmask (SIG_BLOCK, &ss, NULL);
+  memset (&cb, 0, sizeof (cb));
+  cb.aio_fildes = fd;
+  cb.aio_buf = buf;
+  cb.aio_nbytes = block_size;
+  cb.aio_offset = block_size;
+  cb.aio_sigevent.sigev_notify = SIGEV_SIGNAL;
+  cb.aio_sigevent.sigev_signo = SIGUSR1;
+  cb.aio_sigevent.sigev_value.sival_ptr = &cb;
+  TEST_COMPARE (aio_read (&cb), 0);
+  siginfo_t si;
+  TEST_COMPARE (sigwaitinfo (&ss, &si), SIGUSR1);
+  TEST_COMPARE (si.si_code, SI_ASYNCIO);
+  TEST_VERIFY (si.si_value.sival_ptr == &cb);
+  TEST_COMPARE (aio_return (&cb), block_size);
+  TEST_COMPARE (buf[0], 'B');
+
+  /* A subprocess uses a ring of its own.  Give the reaper thread time
+     to release the AIO lock first.  */
+  usleep (10000);
+  pid_t pid = xfork ();
+  if (pid == 0)
+    {
+      read_blocks ();
+      TEST_VERIFY (have_ring ());
+      _exit (0);
+    }
+  int status;
+  xwaitpid (pid, &status, 0);
+  TEST_COMPARE (status, 0);
+
+  xclose (pipefd[0]);
+  xclose (pipefd[1]);
+  xclose (fd);
+  return 0;
+}
+
+#include <support/test-driver.c>
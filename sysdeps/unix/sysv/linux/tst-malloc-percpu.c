@@ -0,0 +1,114 @@
+/* Test per-CPU arena selection (glibc.malloc.percpu).
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+/* All threads are pinned to a single CPU.  With per-CPU arenas, they
+   must all share the arena of that CPU, so at most one arena besides
+   the main arena may exist, no matter how many threads allocate.  */
+
+#include <malloc.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/rseq.h>
+#include <support/check.h>
+#include <support/support.h>
+#include <support/xmemstream.h>
+#include <support/xthread.h>
+
+enum
+  {
+    thread_count = 16,
+    allocation_count = 1000,
+  };
+
+static pthread_barrier_t barrier;
+
+static void *
+allocation_thread (void *closure)
+{
+  void *ptrs[allocation_count];
+
+  for (int i = 0; i < allocation_count; ++i)
+    {
+      ptrs[i] = xmalloc (16 + (i % 64) * 16);
+      memset (ptrs[i], 0xa5, 16);
+    }
+
+  /* Keep the allocations alive until all threads have allocated.  */
+  xpthread_barrier_wait (&barrier);
+
+  for (int i = 0; i < allocation_count; ++i)
+    free (ptrs[i]);
+  return NULL;
+}
+
+/* Return the number of heaps (arenas) reported by malloc_info.  */
+static int
+count_arenas (void)
+{
+  struct xmemstream mem;
+  xopen_memstream (&mem);
+  TEST_COMPARE (malloc_info (0, mem.out), 0);
+  xfclose_memstream (&mem);
+
+  int count = 0;
+  for (const char *p = mem.buffer; (p = strstr (p, "<heap nr=")) != NULL;
+       ++p)
+    ++count;
+  free (mem.buffer);
+  return count;
+}
+
+static int
+do_test (void)
+{
+  if (__rseq_size == 0)
+    FAIL_UNSUPPORTED ("rseq not available, per-CPU arenas are disabled");
+
+  cpu_set_t set;
+  TEST_COMPARE (sched_getaffinity (0, sizeof (set), &set), 0);
+  int cpu = 0;
+  while (!CPU_ISSET (cpu, &set))
+    ++cpu;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  if (sched_setaffinity (0, sizeof (set), &set) != 0)
+    FAIL_UNSUPPORTED ("cannot restrict the process to CPU %d", cpu);
+
+  xpthread_barrier_init (&barrier, NULL, thread_count + 1);
+
+  pthread_t threads[thread_count];
+  for (int i = 0; i < thread_count; ++i)
+    threads[i] = xpthread_create (NULL, allocation_thread, NULL);
+
+  xpthread_barrier_wait (&barrier);
+  int arenas = count_arenas ();
+  printf ("info: %d arenas with %d threads on CPU %d\n",
+	  arenas, thread_count, cpu);
+  TEST_VERIFY (arenas >= 1);
+  TEST_VERIFY (arenas <= 2);
+
+  for (int i = 0; i < thread_count; ++i)
+    xpthread_join (threads[i]);
+  xpthread_barrier_destroy (&barrier);
+
+  return 0;
+}
+
+#include <support/test-driver.c>
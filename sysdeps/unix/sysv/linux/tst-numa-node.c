@@ -0,0 +1,80 @@
+/* Test the NUMA node lookup used by malloc and pthread_create.
+   Copyright (C) 2024 Free Software Foundation, Inc.
+   This file is part of the GNU C Library.
+
+   The GNU C Library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   The GNU C Library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with the GNU C Library; if not, see
+   <https://www.gnu.org/licenses/>.  */
+
+#include <errno.h>
+#include <numa-node.h>
+#include <sched.h>
+#include <stdio.h>
+#include <support/check.h>
+
+static int
+do_test (void)
+{
+  /* The first call reads the list of online nodes, which must not
+     change errno.  The test driver does not create threads or
+     arenas, so nothing has called __numa_node yet.  */
+  TEST_COMPARE (__numa_only_node, numa_only_node_unknown);
+  errno = 12345;
+  int node = __numa_node ();
+  TEST_COMPARE (errno, 12345);
+  int only_node = __numa_only_node;
+  TEST_VERIFY (only_node != numa_only_node_unknown);
+  if (only_node >= 0)
+    {
+      printf ("info: single NUMA node %d\n", only_node);
+      TEST_COMPARE (node, only_node);
+    }
+  else
+    printf ("info: multiple NUMA nodes\n");
+
+  /* On each CPU, the node must match the one reported by the kernel.
+     With a single node, this is the node returned without calling
+     getcpu.  */
+  cpu_set_t initial;
+  TEST_COMPARE (sched_getaffinity (0, sizeof (initial), &initial), 0);
+  int checked = 0;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (!CPU_ISSET (cpu, &initial))
+	continue;
+      cpu_set_t set;
+      CPU_ZERO (&set);
+      CPU_SET (cpu, &set);
+      if (sched_setaffinity (0, sizeof (set), &set) != 0)
+	continue;
+
+      unsigned int current_cpu;
+      unsigned int current_node;
+      TEST_COMPARE (getcpu (&current_cpu, &current_node), 0);
+      TEST_COMPARE (current_cpu, cpu);
+      TEST_COMPARE (__numa_node (), current_node);
+      if (only_node >= 0)
+	TEST_COMPARE (current_node, only_node);
+      ++checked;
+    }
+  TEST_COMPARE (sched_setaffinity (0, sizeof (initial), &initial), 0);
+  printf ("info: checked %d CPUs\n", checked);
+  TEST_VERIFY (checked > 0);
+
+  /* The list of nodes is only read once.  */
+  TEST_COMPARE (__numa_only_node, only_node);
+
+  return 0;
+}
+
+#include <support/test-driver.c>